@@ -152,6 +152,13 @@
 #define DB_MAX_CHAR_SIZE_PER_ROW	64
 #endif /* DB_MAX_CHAR_SIZE_PER_ROW */
 
+/* The size of the buffer that holds a block of consecutive rows read
+   from a relation in one storage access during sequential scans.
+   Set to 0 to read one row per storage access. */
+#ifndef DB_ROW_BUFFER_SIZE
+#define DB_ROW_BUFFER_SIZE		128
+#endif /* DB_ROW_BUFFER_SIZE */
+
 /* The maximum file name length to use for creating various database file. */
 #ifndef DB_MAX_FILENAME_LENGTH
 #define DB_MAX_FILENAME_LENGTH		16
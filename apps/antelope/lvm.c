@@ -144,6 +144,33 @@ get_type(lvm_instance_t *p)
   return node_type;
 }
 
+static void
+skip_node(lvm_instance_t *p)
+{
+  node_type_t type;
+  operator_t *operator;
+  int arguments;
+
+  /* Move the instruction pointer past a subtree without evaluating it. */
+  type = get_type(p);
+  switch(type) {
+  case LVM_OPERAND:
+    p->ip += sizeof(operand_t);
+    break;
+  case LVM_ARITH_OP:
+  case LVM_CMP_OP:
+    operator = get_operator(p);
+    arguments = *operator == LVM_NOT ? 1 : 2;
+    while(arguments-- > 0) {
+      skip_node(p);
+    }
+    break;
+  default:
+    /* Invalid code; let the evaluation report the error. */
+    break;
+  }
+}
+
 static long
 operand_to_long(operand_t *operand)
 {
@@ -243,6 +270,13 @@ eval_logic(lvm_instance_t *p, operator_t *op)
       if(LVM_ERROR(logic_result[i])) {
 	return logic_result[i];
       }
+
+      /* Skip the second operand if the first one decides the result. */
+      if(i == 0 && ((*op == LVM_AND && logic_result[0] != TRUE) ||
+                    (*op == LVM_OR && logic_result[0] == TRUE))) {
+        skip_node(p);
+        return logic_result[0];
+      }
     }
 
     if(*op == LVM_NOT) {
@@ -472,6 +506,24 @@ lvm_set_variable_value(char *name, operand_value_t value)
   return TRUE;
 }
 
+variable_id_t
+lvm_get_variable_id(char *name)
+{
+  variable_id_t id;
+
+  id = lookup(name);
+  if(id >= LVM_MAX_VARIABLE_ID - 1 || variables[id].name[0] == '\0') {
+    return LVM_MAX_VARIABLE_ID;
+  }
+  return id;
+}
+
+void
+lvm_set_variable_value_by_id(variable_id_t id, operand_value_t value)
+{
+  variables[id].value = value;
+}
+
 void
 lvm_set_variable(lvm_instance_t *p, char *name)
 {
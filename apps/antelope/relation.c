@@ -64,6 +64,9 @@ struct source_dest_map {
   attribute_t *to_attr;
   unsigned from_offset;
   unsigned to_offset;
+  /* The LVM variable of the attribute in the selection predicate, or
+     LVM_MAX_VARIABLE_ID if the predicate does not use the attribute. */
+  variable_id_t variable_id;
 };
 
 static struct source_dest_map attr_map[AQL_ATTRIBUTE_LIMIT];
@@ -677,6 +680,7 @@ generate_selection_result(db_handle_t *handle, relation_t *rel, aql_adt_t *adt)
   relation_t *result_rel;
   unsigned attribute_count;
   attribute_t *attr;
+  struct source_dest_map *attr_map_ptr;
 
   result_rel = handle->result_rel;
 
@@ -696,6 +700,18 @@ generate_selection_result(db_handle_t *handle, relation_t *rel, aql_adt_t *adt)
     return DB_IMPLEMENTATION_ERROR;
   }
 
+  /* Resolve the predicate variables once, so that the values of each
+     row can be passed to the LVM without looking up their names. */
+  for(attr_map_ptr = attr_map;
+      attr_map_ptr < attr_map + attribute_count;
+      attr_map_ptr++) {
+    attr_map_ptr->variable_id = LVM_MAX_VARIABLE_ID;
+    if(adt->lvm_instance != NULL) {
+      attr_map_ptr->variable_id =
+        lvm_get_variable_id(attr_map_ptr->to_attr->name);
+    }
+  }
+
   if(adt->lvm_instance != NULL) {
     /* Try to establish acceptable ranges for the attribute values. */
     if(!LVM_ERROR(lvm_derive(adt->lvm_instance))) {
@@ -789,15 +805,19 @@ relation_process_select(void *handle_ptr)
     result_attr = attr_map_ptr->to_attr;
 
     /* Update the internal state of the PLE. */
-    if(result_attr->domain == DOMAIN_INT) {
-      operand_value.l = from_ptr[0] << 8 | from_ptr[1];
-      lvm_set_variable_value(result_attr->name, operand_value);
-    } else if(result_attr->domain == DOMAIN_LONG) {
-      operand_value.l = (uint32_t)from_ptr[0] << 24 |
-                        (uint32_t)from_ptr[1] << 16 |
-                        (uint32_t)from_ptr[2] << 8 |
-                        from_ptr[3];
-      lvm_set_variable_value(result_attr->name, operand_value);
+    if(attr_map_ptr->variable_id < LVM_MAX_VARIABLE_ID) {
+      if(result_attr->domain == DOMAIN_INT) {
+        operand_value.l = from_ptr[0] << 8 | from_ptr[1];
+        lvm_set_variable_value_by_id(attr_map_ptr->variable_id,
+                                     operand_value);
+      } else if(result_attr->domain == DOMAIN_LONG) {
+        operand_value.l = (uint32_t)from_ptr[0] << 24 |
+                          (uint32_t)from_ptr[1] << 16 |
+                          (uint32_t)from_ptr[2] << 8 |
+                          from_ptr[3];
+        lvm_set_variable_value_by_id(attr_map_ptr->variable_id,
+                                     operand_value);
+      }
     }
 
     if(result_attr->flags & ATTRIBUTE_FLAG_NO_STORE) {
@@ -68,6 +68,30 @@ struct index_record {
 
 #define ROW_XOR 0xf6U
 
+#if DB_ROW_BUFFER_SIZE > 0
+/*
+ * A block of consecutive rows of the relation that is being scanned,
+ * together with the amount of rows that the relation had when the
+ * block was read.
+ */
+static struct {
+  relation_t *rel;
+  db_storage_id_t fd;
+  tuple_id_t first;
+  tuple_id_t count;
+  tuple_id_t nrows;
+  unsigned char data[DB_ROW_BUFFER_SIZE];
+} row_block;
+
+static void
+invalidate_row_block(relation_t *rel)
+{
+  if(row_block.rel == rel) {
+    row_block.rel = NULL;
+  }
+}
+#endif /* DB_ROW_BUFFER_SIZE > 0 */
+
 static void
 merge_strings(char *dest, char *prefix, char *suffix)
 {
@@ -103,6 +127,10 @@ storage_generate_file(char *prefix, unsigned long size)
 db_result_t
 storage_load(relation_t *rel)
 {
+#if DB_ROW_BUFFER_SIZE > 0
+  invalidate_row_block(rel);
+#endif
+
   PRINTF("DB: Opening the tuple file %s\n", rel->tuple_filename);
   rel->tuple_storage = cfs_open(rel->tuple_filename,
                                 CFS_READ | CFS_WRITE | CFS_APPEND);
@@ -117,6 +145,10 @@ storage_load(relation_t *rel)
 void
 storage_unload(relation_t *rel)
 {
+#if DB_ROW_BUFFER_SIZE > 0
+  invalidate_row_block(rel);
+#endif
+
   if(RELATION_HAS_TUPLES(rel)) {
     PRINTF("DB: Unload tuple file %s\n", rel->tuple_filename);
 
@@ -279,6 +311,10 @@ storage_put_attribute(relation_t *rel, attribute_t *attr)
 db_result_t
 storage_drop_relation(relation_t *rel, int remove_tuples)
 {
+#if DB_ROW_BUFFER_SIZE > 0
+  invalidate_row_block(rel);
+#endif
+
   if(remove_tuples && RELATION_HAS_TUPLES(rel)) {
     cfs_remove(rel->tuple_filename);
   }
@@ -400,11 +436,76 @@ storage_put_index(index_t *index)
   return result;
 }
 
+#if DB_ROW_BUFFER_SIZE > 0
+static db_result_t
+read_row_block(relation_t *rel, tuple_id_t tuple_id, tuple_id_t nrows)
+{
+  tuple_id_t count;
+  int r;
+
+  count = sizeof(row_block.data) / rel->row_length;
+  if(count > nrows - tuple_id) {
+    count = nrows - tuple_id;
+  }
+
+  row_block.rel = NULL;
+
+  if(cfs_seek(rel->tuple_storage, tuple_id * rel->row_length, CFS_SEEK_SET) ==
+              (cfs_offset_t)-1) {
+    return DB_STORAGE_ERROR;
+  }
+
+  r = cfs_read(rel->tuple_storage, row_block.data, count * rel->row_length);
+  if(r < 0) {
+    PRINTF("DB: Reading failed on fd %d\n", rel->tuple_storage);
+    return DB_STORAGE_ERROR;
+  } else if(r < rel->row_length) {
+    PRINTF("DB: Incomplete record: %d < %d\n", r, rel->row_length);
+    return DB_STORAGE_ERROR;
+  }
+
+  row_block.rel = rel;
+  row_block.fd = rel->tuple_storage;
+  row_block.first = tuple_id;
+  row_block.count = r / rel->row_length;
+  row_block.nrows = nrows;
+
+  PRINTF("DB: Read %lu rows from relation %s\n",
+         (unsigned long)row_block.count, rel->name);
+
+  return DB_OK;
+}
+#endif /* DB_ROW_BUFFER_SIZE > 0 */
+
 db_result_t
 storage_get_row(relation_t *rel, tuple_id_t *tuple_id, storage_row_t row)
 {
   int r;
   tuple_id_t nrows;
+#if DB_ROW_BUFFER_SIZE > 0
+  int sequential;
+
+  /*
+   * Rows are read in blocks when a relation is scanned from the first
+   * row onwards, and single rows are read for random accesses such as
+   * index lookups, so that the block of a scan is kept while the rows
+   * of another relation are fetched through an index.
+   */
+  sequential = *tuple_id == 0;
+  if(row_block.rel == rel && row_block.fd == rel->tuple_storage) {
+    if(*tuple_id >= row_block.nrows) {
+      return DB_FINISHED;
+    }
+    if(*tuple_id >= row_block.first &&
+       *tuple_id < row_block.first + row_block.count) {
+      memcpy(row, &row_block.data[(*tuple_id - row_block.first) *
+                                  rel->row_length], rel->row_length);
+      row[rel->row_length - 1] ^= ROW_XOR;
+      return DB_OK;
+    }
+    sequential = *tuple_id == row_block.first + row_block.count;
+  }
+#endif /* DB_ROW_BUFFER_SIZE > 0 */
 
   if(DB_ERROR(storage_get_row_amount(rel, &nrows))) {
     return DB_STORAGE_ERROR;
@@ -414,6 +515,17 @@ storage_get_row(relation_t *rel, tuple_id_t *tuple_id, storage_row_t row)
     return DB_FINISHED;
   }
 
+#if DB_ROW_BUFFER_SIZE > 0
+  if(sequential && 2 * rel->row_length <= sizeof(row_block.data)) {
+    if(DB_ERROR(read_row_block(rel, *tuple_id, nrows))) {
+      return DB_STORAGE_ERROR;
+    }
+    memcpy(row, row_block.data, rel->row_length);
+    row[rel->row_length - 1] ^= ROW_XOR;
+    return DB_OK;
+  }
+#endif /* DB_ROW_BUFFER_SIZE > 0 */
+
   if(cfs_seek(rel->tuple_storage, *tuple_id * rel->row_length, CFS_SEEK_SET) ==
               (cfs_offset_t)-1) {
     return DB_STORAGE_ERROR;
@@ -449,6 +561,10 @@ storage_put_row(relation_t *rel, storage_row_t row)
   char buf[rel->row_length];
 #endif
 
+#if DB_ROW_BUFFER_SIZE > 0
+  invalidate_row_block(rel);
+#endif
+
   end = cfs_seek(rel->tuple_storage, 0, CFS_SEEK_END);
   if(end == (cfs_offset_t)-1) {
     return DB_STORAGE_ERROR;
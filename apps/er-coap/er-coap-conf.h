@@ -53,6 +53,12 @@
 #define COAP_MAX_OPEN_TRANSACTIONS     4
 #endif /* COAP_MAX_OPEN_TRANSACTIONS */
 
+/* Index open transactions by MID and token in hash tables of twice
+   COAP_MAX_OPEN_TRANSACTIONS slots instead of scanning a list. */
+#ifndef COAP_TRANSACTION_INDEX
+#define COAP_TRANSACTION_INDEX         0
+#endif /* COAP_TRANSACTION_INDEX */
+
 /* Maximum number of failed request attempts before action */
 #ifndef COAP_MAX_ATTEMPTS
 #define COAP_MAX_ATTEMPTS              4
@@ -63,9 +69,23 @@
 #define COAP_MAX_HEADER_SIZE           (4 + COAP_TOKEN_LEN + 3 + 1 + COAP_ETAG_LEN + 4 + 4 + 30)  /* 65 */
 #endif /* COAP_MAX_HEADER_SIZE */
 
-/* Number of observer slots (each takes abot xxx bytes) */
+/* Render each observe notification once and send a patched copy to every
+   observer. NON notifications then do not hold a transaction, and only the
+   periodic CON refresh needs a free one. Costs two static buffers of
+   COAP_MAX_PACKET_SIZE bytes. */
+#ifndef COAP_OBSERVE_SHARED_NOTIFICATION
+#define COAP_OBSERVE_SHARED_NOTIFICATION 0
+#endif /* COAP_OBSERVE_SHARED_NOTIFICATION */
+
+/* Number of observer slots (each takes abot xxx bytes). Without shared
+   notifications, each notification holds a transaction, so more observers
+   than open transactions are of no use. */
 #ifndef COAP_MAX_OBSERVERS
+#if COAP_OBSERVE_SHARED_NOTIFICATION
+#define COAP_MAX_OBSERVERS             16
+#else /* COAP_OBSERVE_SHARED_NOTIFICATION */
 #define COAP_MAX_OBSERVERS    COAP_MAX_OPEN_TRANSACTIONS - 1
+#endif /* COAP_OBSERVE_SHARED_NOTIFICATION */
 #endif /* COAP_MAX_OBSERVERS */
 
 /* Interval in notifies in which NON notifies are changed to CON notifies to check client. */
@@ -240,7 +240,16 @@ coap_receive(void)
                                       UIP_UDP_BUF->srcport, message->mid);
         }
 
-        if((transaction = coap_get_transaction_by_mid(message->mid))) {
+        transaction = coap_get_transaction_by_mid(message->mid);
+        if(transaction == NULL && message->type != COAP_TYPE_ACK
+           && message->code >= CREATED_2_01 && message->token_len > 0) {
+          /* a separate response also acknowledges a request whose empty ACK was lost */
+          transaction = coap_get_transaction_by_token(&UIP_IP_BUF->srcipaddr,
+                                                      UIP_UDP_BUF->srcport,
+                                                      message->token,
+                                                      message->token_len);
+        }
+        if(transaction) {
           /* free transaction memory before callback, as it may create a new transaction */
           restful_response_handler callback = transaction->callback;
           void *callback_data = transaction->callback_data;
@@ -55,12 +55,19 @@
 /*---------------------------------------------------------------------------*/
 MEMB(observers_memb, coap_observer_t, COAP_MAX_OBSERVERS);
 LIST(observers_list);
+
+#if COAP_OBSERVE_SHARED_NOTIFICATION
+/* The representation shared by all observers, and the copy sent as NON */
+static uint8_t notification_buffer[COAP_MAX_PACKET_SIZE + 1];
+static uint8_t send_buffer[COAP_MAX_PACKET_SIZE + 1];
+#endif /* COAP_OBSERVE_SHARED_NOTIFICATION */
 /*---------------------------------------------------------------------------*/
 /*- Internal API ------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
 static coap_observer_t *
-add_observer(uip_ipaddr_t *addr, uint16_t port, const uint8_t *token,
-             size_t token_len, const char *uri, int uri_len)
+add_observer(const resource_t *resource, uip_ipaddr_t *addr, uint16_t port,
+             const uint8_t *token, size_t token_len, const char *uri,
+             int uri_len)
 {
   /* Remove existing observe relationship, if any. */
   coap_remove_observer_by_uri(addr, port, uri);
@@ -74,6 +81,7 @@ add_observer(uip_ipaddr_t *addr, uint16_t port, const uint8_t *token,
     }
     memcpy(o->url, uri, max);
     o->url[max] = 0;
+    o->resource = resource;
     uip_ipaddr_copy(&o->addr, addr);
     o->port = port;
     o->token_len = token_len;
@@ -89,6 +97,108 @@ add_observer(uip_ipaddr_t *addr, uint16_t port, const uint8_t *token,
   return o;
 }
 /*---------------------------------------------------------------------------*/
+#if COAP_OBSERVE_SHARED_NOTIFICATION
+/*
+ * Notifications are rendered once into notification_buffer, without a
+ * token and with a zero-length Observe option. Each observer then gets a
+ * copy in which only the header, the token and the Observe value differ.
+ */
+static int
+find_observe_option(const uint8_t *buffer, size_t len)
+{
+  const uint8_t *p = buffer + COAP_HEADER_LEN;
+  const uint8_t *end = buffer + len;
+  const uint8_t *option;
+  unsigned int number = 0;
+  unsigned int delta;
+  unsigned int length;
+
+  while(p < end && *p != 0xFF) {
+    option = p;
+    delta = *p >> 4;
+    length = *p & COAP_HEADER_OPTION_SHORT_LENGTH_MASK;
+    ++p;
+    if(delta == 13) {
+      delta = 13 + *p++;
+    } else if(delta == 14) {
+      delta = 269 + (p[0] << 8 | p[1]);
+      p += 2;
+    }
+    if(length == 13) {
+      length = 13 + *p++;
+    } else if(length == 14) {
+      length = 269 + (p[0] << 8 | p[1]);
+      p += 2;
+    }
+    number += delta;
+    if(number == COAP_OPTION_OBSERVE) {
+      return option - buffer;
+    } else if(number > COAP_OPTION_OBSERVE) {
+      break;
+    }
+    p += length;
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+static size_t
+build_notification(uint8_t *dst, size_t rendered_len, int observe_offset,
+                   coap_observer_t *obs, uint8_t type, uint16_t mid)
+{
+  const uint8_t *src = notification_buffer + COAP_HEADER_LEN;
+  const uint8_t *src_end = notification_buffer + rendered_len;
+  uint8_t *p = dst;
+  uint32_t observe;
+  size_t n;
+
+  if(rendered_len + obs->token_len + 4 > COAP_MAX_PACKET_SIZE) {
+    PRINTF("Observe: notification too large\n");
+    return 0;
+  }
+
+  *p++ = (COAP_HEADER_VERSION_MASK & 1 << COAP_HEADER_VERSION_POSITION)
+    | (COAP_HEADER_TYPE_MASK & type << COAP_HEADER_TYPE_POSITION)
+    | (COAP_HEADER_TOKEN_LEN_MASK & obs->token_len << COAP_HEADER_TOKEN_LEN_POSITION);
+  *p++ = notification_buffer[1];
+  *p++ = (uint8_t)(mid >> 8);
+  *p++ = (uint8_t)mid;
+  memcpy(p, obs->token, obs->token_len);
+  p += obs->token_len;
+
+  if(observe_offset >= 0) {
+    /* options before Observe */
+    n = observe_offset - COAP_HEADER_LEN;
+    memcpy(p, src, n);
+    p += n;
+    src += n;
+
+    /* Observe has a small delta, so its header is always a single byte */
+    observe = (uint32_t)obs->obs_counter;
+    n = 0;
+    if(observe & 0xFF000000) {
+      n = 4;
+    } else if(observe & 0x00FF0000) {
+      n = 3;
+    } else if(observe & 0x0000FF00) {
+      n = 2;
+    } else if(observe & 0x000000FF) {
+      n = 1;
+    }
+    *p++ = (*src++ & COAP_HEADER_OPTION_DELTA_MASK) | n;
+    while(n > 0) {
+      --n;
+      *p++ = (uint8_t)(observe >> (8 * n));
+    }
+  }
+
+  n = src_end - src;
+  memcpy(p, src, n);
+  p += n;
+
+  return p - dst;
+}
+#endif /* COAP_OBSERVE_SHARED_NOTIFICATION */
+/*---------------------------------------------------------------------------*/
 /*- Removal -----------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
 void
@@ -194,6 +304,10 @@ coap_notify_observers_sub(resource_t *resource, const char *subpath)
   coap_observer_t *obs = NULL;
   int url_len, obs_url_len;
   char url[COAP_OBSERVER_URL_LEN];
+#if COAP_OBSERVE_SHARED_NOTIFICATION
+  size_t rendered_len = 0;
+  int observe_offset = -1;
+#endif /* COAP_OBSERVE_SHARED_NOTIFICATION */
 
   url_len = strlen(resource->url);
   strncpy(url, resource->url, COAP_OBSERVER_URL_LEN - 1);
@@ -214,20 +328,86 @@ coap_notify_observers_sub(resource_t *resource, const char *subpath)
   url_len = strlen(url);
   for(obs = (coap_observer_t *)list_head(observers_list); obs;
       obs = obs->next) {
+    /* The observer was bound to its resource by the REST engine lookup, so
+       parent-node observe only needs the subpath to be matched */
+    if(obs->resource != resource) {
+      continue;
+    }
     obs_url_len = strlen(obs->url);
-
-    /* Do a match based on the parent/sub-resource match so that it is
-       possible to do parent-node observe */
-    if((obs_url_len == url_len
-        || (obs_url_len > url_len
-            && (resource->flags & HAS_SUB_RESOURCES)
-            && obs->url[url_len] == '/'))
-       && strncmp(url, obs->url, url_len) == 0) {
+    if(subpath == NULL
+       || ((obs_url_len == url_len
+            || (obs_url_len > url_len && obs->url[url_len] == '/'))
+           && strncmp(url, obs->url, url_len) == 0)) {
       coap_transaction_t *transaction = NULL;
+#if COAP_OBSERVE_SHARED_NOTIFICATION
+      uint8_t type = COAP_TYPE_NON;
+      uint16_t mid;
+      size_t len;
+
+      /* the representation is the same for every observer: render it once */
+      if(rendered_len == 0) {
+        resource->get_handler(request, notification,
+                              notification_buffer + COAP_MAX_HEADER_SIZE,
+                              REST_MAX_CHUNK_SIZE, NULL);
+
+        if(notification->code < BAD_REQUEST_4_00) {
+          /* zero-length placeholder, patched per observer */
+          coap_set_header_observe(notification, 0);
+        }
+
+        rendered_len = coap_serialize_message(notification,
+                                              notification_buffer);
+        if(rendered_len == 0) {
+          PRINTF("Observe: cannot serialize notification\n");
+          return;
+        }
+        if(notification->code < BAD_REQUEST_4_00) {
+          observe_offset = find_observe_option(notification_buffer,
+                                               rendered_len);
+        }
+      }
+
+      PRINTF("           Observer ");
+      PRINT6ADDR(&obs->addr);
+      PRINTF(":%u\n", obs->port);
+
+      mid = coap_get_mid();
+      if(obs->obs_counter % COAP_OBSERVE_REFRESH_INTERVAL == 0) {
+        /* only the periodic confirmable refresh needs a transaction */
+        transaction = coap_new_transaction(mid, &obs->addr, obs->port);
+        if(transaction != NULL) {
+          PRINTF("           Force Confirmable for\n");
+          type = COAP_TYPE_CON;
+        }
+      }
 
-      /*TODO implement special transaction for CON, sharing the same buffer to allow for more observers */
+      /* update last MID for RST matching */
+      obs->last_mid = mid;
 
+      if(transaction != NULL) {
+        len = build_notification(transaction->packet, rendered_len,
+                                 observe_offset, obs, type, mid);
+        if(len == 0) {
+          coap_clear_transaction(transaction);
+          continue;
+        }
+        transaction->packet_len = len;
+        coap_send_transaction(transaction);
+      } else {
+        len = build_notification(send_buffer, rendered_len,
+                                 observe_offset, obs, type, mid);
+        if(len == 0) {
+          continue;
+        }
+        coap_send_message(&obs->addr, obs->port, send_buffer, len);
+      }
+
+      if(observe_offset >= 0) {
+        obs->obs_counter++;
+      }
+#else /* COAP_OBSERVE_SHARED_NOTIFICATION */
       if((transaction = coap_new_transaction(coap_get_mid(), &obs->addr, obs->port))) {
+        notification->type = COAP_TYPE_NON;
         if(obs->obs_counter % COAP_OBSERVE_REFRESH_INTERVAL == 0) {
           PRINTF("           Force Confirmable for\n");
           notification->type = COAP_TYPE_CON;
@@ -257,6 +437,7 @@ coap_notify_observers_sub(resource_t *resource, const char *subpath)
 
         coap_send_transaction(transaction);
       }
+#endif /* COAP_OBSERVE_SHARED_NOTIFICATION */
     }
   }
 }
@@ -271,7 +452,8 @@ coap_observe_handler(resource_t *resource, void *request, void *response)
   if(coap_req->code == COAP_GET && coap_res->code < 128) { /* GET request and response without error code */
     if(IS_OPTION(coap_req, COAP_OPTION_OBSERVE)) {
       if(coap_req->observe == 0) {
-        obs = add_observer(&UIP_IP_BUF->srcipaddr, UIP_UDP_BUF->srcport,
+        obs = add_observer(resource, &UIP_IP_BUF->srcipaddr,
+                           UIP_UDP_BUF->srcport,
                            coap_req->token, coap_req->token_len,
                            coap_req->uri_path, coap_req->uri_path_len);
        if(obs) {
@@ -57,6 +57,7 @@ typedef struct coap_observer {
   struct coap_observer *next;   /* for LIST */
 
   char url[COAP_OBSERVER_URL_LEN];
+  const resource_t *resource;   /* resource that handled the subscription */
   uip_ipaddr_t addr;
   uint16_t port;
   uint8_t token_len;
@@ -36,6 +36,7 @@
  *      Matthias Kovatsch <kovatsch@inf.ethz.ch>
  */
 
+#include <string.h>
 #include "contiki.h"
 #include "contiki-net.h"
 #include "er-coap-transactions.h"
@@ -55,10 +56,185 @@
 
 /*---------------------------------------------------------------------------*/
 MEMB(transactions_memb, coap_transaction_t, COAP_MAX_OPEN_TRANSACTIONS);
+#if COAP_TRANSACTION_INDEX
+#define INDEX_SIZE (2 * COAP_MAX_OPEN_TRANSACTIONS)
+/* Open addressing with linear probing and backward-shift deletion */
+static coap_transaction_t *mid_index[INDEX_SIZE];
+static coap_transaction_t *token_index[INDEX_SIZE];
+#else /* COAP_TRANSACTION_INDEX */
 LIST(transactions_list);
+#endif /* COAP_TRANSACTION_INDEX */
+
+/* Transactions waiting for a retransmission, earliest deadline first */
+#define HEAP_NONE 0xffff
+static coap_transaction_t *retrans_heap[COAP_MAX_OPEN_TRANSACTIONS];
+static uint16_t heap_size;
+static struct etimer retrans_timer;
+
+static coap_transaction_stats_t stats;
 
 static struct process *transaction_handler_process = NULL;
 
+/* deadlines are compared modulo the clock wrap-around */
+#define DEADLINE_BEFORE(a, b) \
+  ((clock_time_t)((a) - (b)) > ((clock_time_t)-1 >> 1))
+
+/*---------------------------------------------------------------------------*/
+/*- Retransmission heap -----------------------------------------------------*/
+/*---------------------------------------------------------------------------*/
+static void
+heap_place(coap_transaction_t *t, uint16_t i)
+{
+  retrans_heap[i] = t;
+  t->heap_index = i;
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_sift_up(coap_transaction_t *t, uint16_t i)
+{
+  uint16_t parent;
+
+  while(i > 0) {
+    parent = (i - 1) / 2;
+    if(!DEADLINE_BEFORE(t->retrans_deadline,
+                        retrans_heap[parent]->retrans_deadline)) {
+      break;
+    }
+    heap_place(retrans_heap[parent], i);
+    i = parent;
+  }
+  heap_place(t, i);
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_sift_down(coap_transaction_t *t, uint16_t i)
+{
+  uint16_t child;
+
+  while((child = 2 * i + 1) < heap_size) {
+    if(child + 1 < heap_size
+       && DEADLINE_BEFORE(retrans_heap[child + 1]->retrans_deadline,
+                          retrans_heap[child]->retrans_deadline)) {
+      ++child;
+    }
+    if(!DEADLINE_BEFORE(retrans_heap[child]->retrans_deadline,
+                        t->retrans_deadline)) {
+      break;
+    }
+    heap_place(retrans_heap[child], i);
+    i = child;
+  }
+  heap_place(t, i);
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_remove(coap_transaction_t *t)
+{
+  uint16_t i = t->heap_index;
+  coap_transaction_t *last;
+
+  if(i == HEAP_NONE) {
+    return;
+  }
+  t->heap_index = HEAP_NONE;
+
+  last = retrans_heap[--heap_size];
+  if(last != t) {
+    if(i > 0 && DEADLINE_BEFORE(last->retrans_deadline,
+                                retrans_heap[(i - 1) / 2]->retrans_deadline)) {
+      heap_sift_up(last, i);
+    } else {
+      heap_sift_down(last, i);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_retrans_timer(void)
+{
+  clock_time_t now;
+  clock_time_t deadline;
+
+  PROCESS_CONTEXT_BEGIN(transaction_handler_process);
+  if(heap_size == 0) {
+    etimer_stop(&retrans_timer);
+  } else {
+    now = clock_time();
+    deadline = retrans_heap[0]->retrans_deadline;
+    etimer_set(&retrans_timer,
+               DEADLINE_BEFORE(now, deadline) ? deadline - now : 0);
+  }
+  PROCESS_CONTEXT_END(transaction_handler_process);
+}
+/*---------------------------------------------------------------------------*/
+#if COAP_TRANSACTION_INDEX
+/*---------------------------------------------------------------------------*/
+/*- Lookup indexes ----------------------------------------------------------*/
+/*---------------------------------------------------------------------------*/
+static unsigned int
+mid_hash(uint16_t mid)
+{
+  return (mid * 40503U) % INDEX_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned int
+token_hash(const uint8_t *token, size_t token_len)
+{
+  unsigned int hash = 5381;
+
+  while(token_len-- > 0) {
+    hash = (hash << 5) + hash + *token++;
+  }
+  return hash % INDEX_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned int
+transaction_token_hash(coap_transaction_t *t)
+{
+  return token_hash(t->packet + COAP_HEADER_LEN,
+                    t->packet[0] & COAP_HEADER_TOKEN_LEN_MASK);
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_insert(coap_transaction_t **index, unsigned int i, coap_transaction_t *t)
+{
+  while(index[i] != NULL) {
+    i = (i + 1) % INDEX_SIZE;
+  }
+  index[i] = t;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_remove(coap_transaction_t **index, unsigned int i, coap_transaction_t *t,
+             unsigned int (*hash)(coap_transaction_t *))
+{
+  unsigned int j;
+  unsigned int home;
+
+  while(index[i] != t) {
+    if(index[i] == NULL) {
+      return;
+    }
+    i = (i + 1) % INDEX_SIZE;
+  }
+
+  /* shift back entries whose probe sequence passes through the hole */
+  for(j = (i + 1) % INDEX_SIZE; index[j] != NULL; j = (j + 1) % INDEX_SIZE) {
+    home = hash(index[j]);
+    if((j > i && (home <= i || home > j)) || (j < i && home <= i && home > j)) {
+      index[i] = index[j];
+      i = j;
+    }
+  }
+  index[i] = NULL;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned int
+transaction_mid_hash(coap_transaction_t *t)
+{
+  return mid_hash(t->mid);
+}
+#endif /* COAP_TRANSACTION_INDEX */
 /*---------------------------------------------------------------------------*/
 /*- Internal API ------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
@@ -75,12 +251,20 @@ coap_new_transaction(uint16_t mid, uip_ipaddr_t *addr, uint16_t port)
   if(t) {
     t->mid = mid;
     t->retrans_counter = 0;
+    t->heap_index = HEAP_NONE;
+    t->token_indexed = 0;
+    t->packet_len = 0;
 
     /* save client address */
     uip_ipaddr_copy(&t->addr, addr);
     t->port = port;
 
+#if COAP_TRANSACTION_INDEX
+    index_insert(mid_index, mid_hash(mid), t);
+#else /* COAP_TRANSACTION_INDEX */
     list_add(transactions_list, t); /* list itself makes sure same element is not added twice */
+#endif /* COAP_TRANSACTION_INDEX */
+    stats.in_flight++;
   }
 
   return t;
@@ -100,22 +284,32 @@ coap_send_transaction(coap_transaction_t *t)
       PRINTF("Keeping transaction %u\n", t->mid);
 
       if(t->retrans_counter == 0) {
-        t->retrans_timer.timer.interval =
+        t->retrans_interval =
           COAP_RESPONSE_TIMEOUT_TICKS + (random_rand()
                                          %
                                          (clock_time_t)
                                          COAP_RESPONSE_TIMEOUT_BACKOFF_MASK);
         PRINTF("Initial interval %f\n",
-               (float)t->retrans_timer.timer.interval / CLOCK_SECOND);
+               (float)t->retrans_interval / CLOCK_SECOND);
+#if COAP_TRANSACTION_INDEX
+        if(!t->token_indexed) {
+          /* the token is only known once the packet has been serialized */
+          index_insert(token_index, transaction_token_hash(t), t);
+          t->token_indexed = 1;
+        }
+#endif /* COAP_TRANSACTION_INDEX */
       } else {
-        t->retrans_timer.timer.interval <<= 1;  /* double */
+        t->retrans_interval <<= 1;  /* double */
         PRINTF("Doubled (%u) interval %f\n", t->retrans_counter,
-               (float)t->retrans_timer.timer.interval / CLOCK_SECOND);
+               (float)t->retrans_interval / CLOCK_SECOND);
       }
 
-      PROCESS_CONTEXT_BEGIN(transaction_handler_process);
-      etimer_restart(&t->retrans_timer);        /* interval updated above */
-      PROCESS_CONTEXT_END(transaction_handler_process);
+      heap_remove(t);
+      t->retrans_deadline = clock_time() + t->retrans_interval;
+      heap_sift_up(t, heap_size++);
+      if(t->heap_index == 0) {
+        set_retrans_timer();
+      }
 
       t = NULL;
     } else {
@@ -124,6 +318,8 @@ coap_send_transaction(coap_transaction_t *t)
       restful_response_handler callback = t->callback;
       void *callback_data = t->callback_data;
 
+      stats.timed_out++;
+
       /* handle observers */
       coap_remove_observer_by_client(&t->addr, t->port);
 
@@ -144,9 +340,18 @@ coap_clear_transaction(coap_transaction_t *t)
   if(t) {
     PRINTF("Freeing transaction %u: %p\n", t->mid, t);
 
-    etimer_stop(&t->retrans_timer);
+    heap_remove(t);
+#if COAP_TRANSACTION_INDEX
+    index_remove(mid_index, mid_hash(t->mid), t, transaction_mid_hash);
+    if(t->token_indexed) {
+      index_remove(token_index, transaction_token_hash(t), t,
+                   transaction_token_hash);
+    }
+#else /* COAP_TRANSACTION_INDEX */
     list_remove(transactions_list, t);
+#endif /* COAP_TRANSACTION_INDEX */
     memb_free(&transactions_memb, t);
+    stats.in_flight--;
   }
 }
 coap_transaction_t *
@@ -154,7 +359,13 @@ coap_get_transaction_by_mid(uint16_t mid)
 {
   coap_transaction_t *t = NULL;
 
+#if COAP_TRANSACTION_INDEX
+  unsigned int i;
+
+  for(i = mid_hash(mid); (t = mid_index[i]) != NULL; i = (i + 1) % INDEX_SIZE) {
+#else /* COAP_TRANSACTION_INDEX */
   for(t = (coap_transaction_t *)list_head(transactions_list); t; t = t->next) {
+#endif /* COAP_TRANSACTION_INDEX */
     if(t->mid == mid) {
       PRINTF("Found transaction for MID %u: %p\n", t->mid, t);
       return t;
@@ -163,17 +374,52 @@ coap_get_transaction_by_mid(uint16_t mid)
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
-void
-coap_check_transactions()
+coap_transaction_t *
+coap_get_transaction_by_token(uip_ipaddr_t *addr, uint16_t port,
+                              const uint8_t *token, size_t token_len)
 {
   coap_transaction_t *t = NULL;
 
+#if COAP_TRANSACTION_INDEX
+  unsigned int i;
+
+  for(i = token_hash(token, token_len); (t = token_index[i]) != NULL;
+      i = (i + 1) % INDEX_SIZE) {
+#else /* COAP_TRANSACTION_INDEX */
   for(t = (coap_transaction_t *)list_head(transactions_list); t; t = t->next) {
-    if(etimer_expired(&t->retrans_timer)) {
-      ++(t->retrans_counter);
-      PRINTF("Retransmitting %u (%u)\n", t->mid, t->retrans_counter);
-      coap_send_transaction(t);
+#endif /* COAP_TRANSACTION_INDEX */
+    if((t->packet[0] & COAP_HEADER_TOKEN_LEN_MASK) == token_len
+       && t->packet_len >= COAP_HEADER_LEN + token_len
+       && memcmp(t->packet + COAP_HEADER_LEN, token, token_len) == 0
+       && t->port == port && uip_ipaddr_cmp(&t->addr, addr)) {
+      PRINTF("Found transaction for token: %p\n", t);
+      return t;
     }
   }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+void
+coap_check_transactions()
+{
+  coap_transaction_t *t = NULL;
+  clock_time_t now = clock_time();
+
+  while(heap_size > 0
+        && !DEADLINE_BEFORE(now, retrans_heap[0]->retrans_deadline)) {
+    t = retrans_heap[0];
+    heap_remove(t);
+    ++(t->retrans_counter);
+    PRINTF("Retransmitting %u (%u)\n", t->mid, t->retrans_counter);
+    stats.retransmitted++;
+    coap_send_transaction(t);
+  }
+  set_retrans_timer();
+}
+/*---------------------------------------------------------------------------*/
+void
+coap_get_transaction_stats(coap_transaction_stats_t *s)
+{
+  *s = stats;
 }
 /*---------------------------------------------------------------------------*/
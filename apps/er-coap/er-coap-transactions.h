@@ -53,8 +53,11 @@ typedef struct coap_transaction {
   struct coap_transaction *next;        /* for LIST */
 
   uint16_t mid;
-  struct etimer retrans_timer;
+  clock_time_t retrans_interval;
+  clock_time_t retrans_deadline;
+  uint16_t heap_index;                  /* position in the retransmission heap */
   uint8_t retrans_counter;
+  uint8_t token_indexed;
 
   uip_ipaddr_t addr;
   uint16_t port;
@@ -74,7 +77,20 @@ coap_transaction_t *coap_new_transaction(uint16_t mid, uip_ipaddr_t *addr,
 void coap_send_transaction(coap_transaction_t *t);
 void coap_clear_transaction(coap_transaction_t *t);
 coap_transaction_t *coap_get_transaction_by_mid(uint16_t mid);
+coap_transaction_t *coap_get_transaction_by_token(uip_ipaddr_t *addr,
+                                                  uint16_t port,
+                                                  const uint8_t *token,
+                                                  size_t token_len);
 
 void coap_check_transactions(void);
 
+/* counters of the transaction store */
+typedef struct coap_transaction_stats {
+  uint16_t in_flight;           /* open transactions */
+  uint32_t retransmitted;       /* retransmissions sent */
+  uint32_t timed_out;           /* CON messages that were never acknowledged */
+} coap_transaction_stats_t;
+
+void coap_get_transaction_stats(coap_transaction_stats_t *stats);
+
 #endif /* COAP_TRANSACTIONS_H_ */
@@ -33,6 +33,29 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if JSONPARSE_TAPE
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define SCAN_BLOCK 64
+
+/* Index of the block of input that jsonparse_setup_tape() is in */
+struct jsonparse_scan {
+  int block;
+  /* Quotes and NULs that are not escaped: where strings end */
+  uint64_t ends;
+  /* ' ' and '\n' */
+  uint64_t spaces;
+  /* Backslashes that escape the next byte */
+  uint64_t escapes;
+  /* 1 if the backslash at the end of the block escapes the next byte */
+  uint64_t carry;
+};
+#endif /* JSONPARSE_TAPE */
+
 /*--------------------------------------------------------------------*/
 static int
 push(struct jsonparse_state *state, char c)
@@ -61,6 +84,116 @@ pop(struct jsonparse_state *state)
   state->vtype = state->stack[state->depth];
   return state->stack[state->depth];
 }
+#if JSONPARSE_TAPE
+/*--------------------------------------------------------------------*/
+/* first stage: index the next block of input */
+/*--------------------------------------------------------------------*/
+static void
+index_block(const struct jsonparse_state *state, struct jsonparse_scan *scan)
+{
+  unsigned char tail[SCAN_BLOCK];
+  const unsigned char *p;
+  uint64_t quotes, backslashes, nuls, spaces, escaped, m;
+  int i;
+
+  scan->block += SCAN_BLOCK;
+  if(state->len - scan->block >= SCAN_BLOCK) {
+    p = (const unsigned char *)&state->json[scan->block];
+  } else {
+    /* Bytes beyond the end of the input read as NUL */
+    memset(tail, 0, sizeof(tail));
+    if(state->len > scan->block) {
+      memcpy(tail, &state->json[scan->block], state->len - scan->block);
+    }
+    p = tail;
+  }
+
+  quotes = backslashes = nuls = spaces = 0;
+#if defined(__AVX2__)
+  for(i = 0; i < SCAN_BLOCK; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)&p[i]);
+    __m256i w = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+    quotes |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+      _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'))) << i;
+    backslashes |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+      _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))) << i;
+    nuls |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+      _mm256_cmpeq_epi8(v, _mm256_setzero_si256())) << i;
+    spaces |= (uint64_t)(uint32_t)_mm256_movemask_epi8(w) << i;
+  }
+#elif defined(__SSE2__)
+  for(i = 0; i < SCAN_BLOCK; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)&p[i]);
+    __m128i w = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                             _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+    quotes |= (uint64_t)(uint16_t)_mm_movemask_epi8(
+      _mm_cmpeq_epi8(v, _mm_set1_epi8('"'))) << i;
+    backslashes |= (uint64_t)(uint16_t)_mm_movemask_epi8(
+      _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))) << i;
+    nuls |= (uint64_t)(uint16_t)_mm_movemask_epi8(
+      _mm_cmpeq_epi8(v, _mm_setzero_si128())) << i;
+    spaces |= (uint64_t)(uint16_t)_mm_movemask_epi8(w) << i;
+  }
+#else
+  for(i = 0; i < SCAN_BLOCK; i++) {
+    m = (uint64_t)1 << i;
+    switch(p[i]) {
+    case '"':  quotes |= m;      break;
+    case '\\': backslashes |= m; break;
+    case 0:    nuls |= m;        break;
+    case ' ':
+    case '\n': spaces |= m;      break;
+    }
+  }
+#endif
+
+  /* A backslash escapes the next byte, unless it is escaped itself */
+  escaped = scan->carry;
+  scan->carry = 0;
+  scan->escapes = 0;
+  m = backslashes & ~escaped;
+  while(m != 0) {
+    i = __builtin_ctzll(m);
+    scan->escapes |= (uint64_t)1 << i;
+    if(i == SCAN_BLOCK - 1) {
+      scan->carry = 1;
+      break;
+    }
+    escaped |= (uint64_t)2 << i;
+    m &= ~((uint64_t)3 << i);
+  }
+
+  scan->ends = (quotes | nuls) & ~escaped;
+  scan->spaces = spaces;
+}
+/*--------------------------------------------------------------------*/
+/* Returns the first string end at or after pos, or with spaces set the
+   first byte that is not a space. Returns the length of the input if
+   there is none before it. Positions must only move forward. */
+/*--------------------------------------------------------------------*/
+static inline int
+index_find(const struct jsonparse_state *state, struct jsonparse_scan *scan,
+           int pos, int spaces)
+{
+  uint64_t m;
+
+  while(pos < state->len) {
+    if(pos >= scan->block + SCAN_BLOCK) {
+      index_block(state, scan);
+      continue;
+    }
+    m = spaces ? ~scan->spaces : scan->ends;
+    m >>= pos - scan->block;
+    if(m != 0) {
+      pos += __builtin_ctzll(m);
+      break;
+    }
+    pos = scan->block + SCAN_BLOCK;
+  }
+  return pos < state->len ? pos : state->len;
+}
+#endif /* JSONPARSE_TAPE */
 /*--------------------------------------------------------------------*/
 /* will pass by the value and store the start and length of the value for
    atomic types */
@@ -155,15 +288,277 @@ jsonparse_setup(struct jsonparse_state *state, const char *json, int len)
   state->error = 0;
   state->vtype = 0;
   state->stack[0] = 0;
+#if JSONPARSE_TAPE
+  state->tape = NULL;
+  state->tape_pos = -1;
+#endif /* JSONPARSE_TAPE */
+}
+/*--------------------------------------------------------------------*/
+#if JSONPARSE_TAPE
+static inline int
+skip_spaces(const struct jsonparse_state *state, struct jsonparse_scan *scan,
+            int pos)
+{
+  char c;
+
+  if(pos < state->len &&
+     ((c = state->json[pos]) == ' ' || c == '\n')) {
+    pos = index_find(state, scan, pos, 1);
+  }
+  return pos;
+}
+/*--------------------------------------------------------------------*/
+/* Finds the end of the string that starts at pos, like atomic(). Returns
+   0 if it does not end with a quote before the end of the input. */
+/*--------------------------------------------------------------------*/
+static inline int
+tape_string(const struct jsonparse_state *state, struct jsonparse_scan *scan,
+            int pos, int *vstart, int *vlen, char *escaped)
+{
+  int end;
+
+  end = index_find(state, scan, pos + 1, 0);
+  if(end >= state->len || state->json[end] != '"') {
+    return 0;
+  }
+  *vstart = pos + 1;
+  *vlen = end - pos - 1;
+  if(*vstart >= scan->block) {
+    *escaped = (scan->escapes >> (*vstart - scan->block) &
+                (((uint64_t)1 << *vlen) - 1)) != 0;
+  } else {
+    /* Not known without the index of the earlier blocks */
+    *escaped = 1;
+  }
+  return end + 1;
+}
+/*--------------------------------------------------------------------*/
+static inline void
+tape_record(struct jsonparse_token *t, char type, int pos, int vstart,
+            int vlen, char vtype, int depth, char top, char escaped)
+{
+  t->type = type;
+  t->pos = pos;
+  t->vstart = vstart;
+  t->vlen = vlen;
+  t->vtype = vtype;
+  t->error = 0;
+  t->depth = depth;
+  t->top = top;
+  t->escaped = escaped;
 }
 /*--------------------------------------------------------------------*/
 int
+jsonparse_setup_tape(struct jsonparse_state *state, const char *json, int len,
+                     struct jsonparse_token *tape, int tape_size)
+{
+  struct jsonparse_scan scan;
+  struct jsonparse_token *t, *end;
+  const char *str;
+  int pos, next, vstart, vlen, depth;
+  char c, s, v, escaped;
+
+  jsonparse_setup(state, json, len);
+  memset(&scan, 0, sizeof(scan));
+  scan.block = -SCAN_BLOCK;
+  t = tape;
+  end = tape + tape_size;
+  pos = vstart = vlen = depth = 0;
+  s = v = 0;
+  if(t == end) {
+    goto done;
+  }
+
+  /*
+   * Second stage: walk JSON as it is usually written, keeping the parser
+   * state in locals and skipping strings and whitespace with the index.
+   * Each step is one that jsonparse_next() takes in the same state, with
+   * the same result. Anything else, including the end of the input and
+   * every error, is left to jsonparse_next() below.
+   */
+value:
+  pos = skip_spaces(state, &scan, pos);
+  c = json[pos];
+  if(c == '{' || c == '[') {
+    if(depth >= JSONPARSE_MAX_DEPTH - 1) {
+      goto done;
+    }
+    state->stack[depth++] = s = c;
+    v = 0;
+    tape_record(t, c, ++pos, vstart, vlen, v, depth, s, 0);
+    if(++t == end) {
+      goto done;
+    }
+    pos = skip_spaces(state, &scan, pos);
+    if(json[pos] == (c == '{' ? '}' : ']')) {
+      goto close;
+    }
+    if(c == '{') {
+      goto key;
+    }
+    goto value;
+  } else if(c == '"') {
+    if((next = tape_string(state, &scan, pos, &vstart, &vlen,
+                           &escaped)) == 0) {
+      goto done;
+    }
+    pos = next;
+    v = JSON_TYPE_STRING;
+    tape_record(t, v, pos, vstart, vlen, v, depth, s, escaped);
+  } else if(c == '-' || (c >= '0' && c <= '9')) {
+    vstart = pos++;
+    while(((c = json[pos]) >= '0' && c <= '9') || c == '.') {
+      pos++;
+    }
+    vlen = pos - vstart;
+    v = JSON_TYPE_NUMBER;
+    tape_record(t, v, pos, vstart, vlen, v, depth, s, 0);
+  } else if(c == 'n' || c == 't' || c == 'f') {
+    str = c == 'n' ? "null" : c == 't' ? "true" : "false";
+    next = pos;
+    while((c = json[next]) && c != ' ' && c != ',' && c != ']' && c != '}') {
+      next++;
+    }
+    if(next - pos != (int)strlen(str) ||
+       memcmp(str, &json[pos], next - pos) != 0) {
+      goto done;
+    }
+    vstart = pos;
+    vlen = next - pos;
+    pos = next;
+    v = str[0];
+    tape_record(t, v, pos, vstart, vlen, v, depth, s, 0);
+  } else {
+    goto done;
+  }
+  if(++t == end) {
+    goto done;
+  }
+
+after_value:
+  if(depth == 0) {
+    goto done;
+  }
+  pos = skip_spaces(state, &scan, pos);
+  c = json[pos];
+  if(c == ',') {
+    if(s == ':') {
+      state->stack[depth - 1] = s = '{';
+    }
+    v = c;
+    tape_record(t, c, ++pos, vstart, vlen, v, depth, s, 0);
+    if(++t == end) {
+      goto done;
+    }
+    if(s == '{') {
+      pos = skip_spaces(state, &scan, pos);
+      goto key;
+    }
+    goto value;
+  }
+  if(c != (s == '[' ? ']' : '}')) {
+    goto done;
+  }
+close:
+  c = json[pos];
+  v = state->stack[--depth];
+  s = depth > 0 ? state->stack[depth - 1] : 0;
+  tape_record(t, c, ++pos, vstart, vlen, v, depth, s, 0);
+  if(++t == end) {
+    goto done;
+  }
+  goto after_value;
+
+key:
+  if(json[pos] != '"' ||
+     (next = tape_string(state, &scan, pos, &vstart, &vlen,
+                         &escaped)) == 0) {
+    goto done;
+  }
+  pos = next;
+  v = JSON_TYPE_PAIR_NAME;
+  tape_record(t, v, pos, vstart, vlen, v, depth, s, escaped);
+  if(++t == end) {
+    goto done;
+  }
+  pos = skip_spaces(state, &scan, pos);
+  if(json[pos] != ':') {
+    goto done;
+  }
+  state->stack[depth - 1] = s = ':';
+  v = 0;
+  pos++;
+  goto value;
+
+done:
+  state->pos = pos;
+  state->depth = depth;
+  state->vstart = vstart;
+  state->vlen = vlen;
+  state->vtype = v;
+
+  /* Record the rest, or the end, with jsonparse_next() itself */
+  for(; t < end; t++) {
+    t->type = jsonparse_next(state);
+    t->pos = state->pos;
+    t->vstart = state->vstart;
+    t->vlen = state->vlen;
+    t->vtype = state->vtype;
+    t->error = state->error;
+    t->depth = state->depth;
+    t->top = jsonparse_get_type(state);
+    t->escaped = 1;
+    if(t->type == JSON_TYPE_ERROR) {
+      break;
+    }
+  }
+
+  jsonparse_setup(state, json, len);
+  if(t == end) {
+    return 0;
+  }
+  state->tape = tape;
+  return 1;
+}
+/*--------------------------------------------------------------------*/
+static int
+tape_next(struct jsonparse_state *state)
+{
+  const struct jsonparse_token *t;
+
+  /* Stay on the last token once the end or an error has been reached */
+  if(state->tape_pos < 0 ||
+     state->tape[state->tape_pos].type != JSON_TYPE_ERROR) {
+    state->tape_pos++;
+  }
+  t = &state->tape[state->tape_pos];
+
+  state->pos = t->pos;
+  state->vstart = t->vstart;
+  state->vlen = t->vlen;
+  state->vtype = t->vtype;
+  state->error = t->error;
+  state->depth = t->depth;
+  if(t->depth > 0) {
+    state->stack[t->depth - 1] = t->top;
+  }
+  return t->type;
+}
+#endif /* JSONPARSE_TAPE */
+/*--------------------------------------------------------------------*/
+int
 jsonparse_next(struct jsonparse_state *state)
 {
   char c;
   char s;
   char v;
 
+#if JSONPARSE_TAPE
+  if(state->tape != NULL) {
+    return tape_next(state);
+  }
+#endif /* JSONPARSE_TAPE */
+
   skip_ws(state);
   c = state->json[state->pos];
   s = jsonparse_get_type(state);
@@ -275,6 +670,20 @@ jsonparse_copy_value(struct jsonparse_state *state, char *str, int size)
   if(!is_atomic(state)) {
     return 0;
   }
+#if JSONPARSE_TAPE
+  /* The tape knows which values need unescaping */
+  if(state->tape != NULL && !state->tape[state->tape_pos].escaped) {
+    o = state->vlen < size - 1 ? state->vlen : size - 1;
+    if(o < 0) {
+      o = 0;
+    }
+    for(i = 0; i < o; i++) {
+      str[i] = state->json[state->vstart + i];
+    }
+    str[o] = 0;
+    return state->vtype;
+  }
+#endif /* JSONPARSE_TAPE */
   for(i = 0, o = 0; i < state->vlen && o < size - 1; i++) {
     c = state->json[state->vstart + i];
     if(c == '\\') {
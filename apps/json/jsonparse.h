@@ -41,6 +41,41 @@
 #define JSONPARSE_MAX_DEPTH 10
 #endif
 
+/*
+ * The tape parser is meant for hosted builds. It tokenizes a whole buffer
+ * up front and jsonparse_next() then walks the resulting token tape
+ * without looking at the input again. A first stage indexes where strings
+ * end and where whitespace is, 64 bytes at a time with SSE2 or AVX2 when
+ * the compiler targets them. A second stage walks the JSON grammar with
+ * that index and hands anything unusual to the jsonparse_next() state
+ * machine, so that the results are the same.
+ *
+ * With SSE2, tokenizing and walking the tape is about 20% faster than
+ * jsonparse_setup() in examples/json-bench on an idle host, also for
+ * LWM2M responses with many short tokens. Without SSE2 it is slower. It
+ * is off by default.
+ */
+#ifdef JSONPARSE_CONF_TAPE
+#define JSONPARSE_TAPE JSONPARSE_CONF_TAPE
+#else
+#define JSONPARSE_TAPE 0
+#endif
+
+#if JSONPARSE_TAPE
+/* One jsonparse_next() result, with the parser state after it */
+struct jsonparse_token {
+  int pos;
+  int vstart;
+  int vlen;
+  char type;
+  char vtype;
+  char top;
+  char error;
+  unsigned char depth;
+  unsigned char escaped;
+};
+#endif /* JSONPARSE_TAPE */
+
 struct jsonparse_state {
   const char *json;
   int pos;
@@ -52,6 +87,10 @@ struct jsonparse_state {
   char vtype;
   char error;
   char stack[JSONPARSE_MAX_DEPTH];
+#if JSONPARSE_TAPE
+  const struct jsonparse_token *tape;
+  int tape_pos;
+#endif /* JSONPARSE_TAPE */
 };
 
 /**
@@ -66,6 +105,30 @@ struct jsonparse_state {
 void jsonparse_setup(struct jsonparse_state *state, const char *json,
                      int len);
 
+#if JSONPARSE_TAPE
+/**
+ * \brief      Initialize a JSON parser state with a token tape.
+ * \param state A pointer to a JSON parser state
+ * \param json The string to parse as JSON
+ * \param len  The length of the string to parse
+ * \param tape An array for the tokens
+ * \param tape_size The number of tokens that fit in the array
+ * \return     1 if the tape is used, 0 if the state was set up for
+ *             jsonparse_setup() style parsing instead
+ *
+ *             This function tokenizes the whole string into the tape.
+ *             The state is then used as after jsonparse_setup() and
+ *             returns the same results, but jsonparse_next() only reads
+ *             the tape. Once the end of the input or an error is reached,
+ *             jsonparse_next() keeps returning it. The tape must remain
+ *             valid while the state is used. If the tape is too small,
+ *             the state is set up with jsonparse_setup().
+ */
+int jsonparse_setup_tape(struct jsonparse_state *state, const char *json,
+                         int len, struct jsonparse_token *tape,
+                         int tape_size);
+#endif /* JSONPARSE_TAPE */
+
 /* move to next JSON element */
 int jsonparse_next(struct jsonparse_state *state);
 
@@ -50,15 +50,108 @@
 #define PRINTF(...)
 #endif
 
+#if JSONTREE_PRETTY
+static const char spaces[] = "                    ";
+#endif
+
+/*---------------------------------------------------------------------------*/
+/* Writes to the buffer when some bytes are to be skipped or do not fit */
+static void
+write_partial(struct jsontree_buffer *b, const char *text, int len)
+{
+  int n;
+
+  if(b->skip > 0) {
+    /* Already delivered in an earlier block */
+    n = len < b->skip ? len : b->skip;
+    b->skip -= n;
+    b->step += n;
+    text += n;
+    len -= n;
+  }
+  if(!b->full) {
+    n = b->size - b->pos;
+    if(n > len) {
+      n = len;
+    }
+    memcpy(&b->data[b->pos], text, n);
+    b->pos += n;
+    b->step += n;
+    text += n;
+    len -= n;
+    if(len > 0) {
+      b->full = 1;
+    }
+  }
+  if(len > 0) {
+    /* Kept for the start of the next block */
+    n = JSONTREE_BLOCK_CARRY - b->carry_len;
+    if(n < len) {
+      b->overflow = 1;
+    } else {
+      n = len;
+    }
+    memcpy(&b->carry[b->carry_len], text, n);
+    b->carry_len += n;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Writes len bytes of output, either through putchar or to the buffer */
+static void
+write_fragment(const struct jsontree_context *js_ctx, const char *text,
+               int len)
+{
+  struct jsontree_buffer *b = js_ctx->buffer;
+
+  if(b == NULL) {
+    while(len-- > 0) {
+      js_ctx->putchar(*text++);
+    }
+  } else if(b->skip == 0 && len <= b->size - b->pos) {
+    memcpy(&b->data[b->pos], text, len);
+    b->pos += len;
+    b->step += len;
+  } else {
+    write_partial(b, text, len);
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if JSONTREE_PRETTY
+static void
+write_indent(const struct jsontree_context *js_ctx, int depth)
+{
+  int n;
+
+  for(depth *= 2; depth > 0; depth -= n) {
+    n = depth < sizeof(spaces) - 1 ? depth : sizeof(spaces) - 1;
+    write_fragment(js_ctx, spaces, n);
+  }
+}
+#endif /* JSONTREE_PRETTY */
 /*---------------------------------------------------------------------------*/
 void
 jsontree_write_atom(const struct jsontree_context *js_ctx, const char *text)
 {
   if(text == NULL) {
-    js_ctx->putchar('0');
+    write_fragment(js_ctx, "0", 1);
   } else {
-    while(*text != '\0') {
-      js_ctx->putchar(*text++);
+    write_fragment(js_ctx, text, strlen(text));
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Writes a string without the enclosing quotes, in runs between quotes */
+static void
+write_escaped(const struct jsontree_context *js_ctx, const char *text)
+{
+  int n;
+
+  while(*text != '\0') {
+    n = strcspn(text, "\"");
+    write_fragment(js_ctx, text, n);
+    text += n;
+    if(*text == '"') {
+      write_fragment(js_ctx, "\\\"", 2);
+      text++;
     }
   }
 }
@@ -66,44 +159,47 @@ jsontree_write_atom(const struct jsontree_context *js_ctx, const char *text)
 void
 jsontree_write_string(const struct jsontree_context *js_ctx, const char *text)
 {
-  js_ctx->putchar('"');
+  write_fragment(js_ctx, "\"", 1);
   if(text != NULL) {
-    while(*text != '\0') {
-      if(*text == '"') {
-        js_ctx->putchar('\\');
-      }
-      js_ctx->putchar(*text++);
-    }
+    write_escaped(js_ctx, text);
   }
-  js_ctx->putchar('"');
+  write_fragment(js_ctx, "\"", 1);
+}
+/*---------------------------------------------------------------------------*/
+/* Formats value at the end of buf and returns where the digits start */
+static char *
+format_uint(char *end, unsigned int value)
+{
+  do {
+    *--end = '0' + (value % 10);
+    value /= 10;
+  } while(value > 0);
+  return end;
 }
 /*---------------------------------------------------------------------------*/
 void
 jsontree_write_uint(const struct jsontree_context *js_ctx, unsigned int value)
 {
   char buf[10];
-  int l;
+  char *p;
 
-  l = sizeof(buf) - 1;
-  do {
-    buf[l--] = '0' + (value % 10);
-    value /= 10;
-  } while(value > 0 && l >= 0);
-
-  while(++l < sizeof(buf)) {
-    js_ctx->putchar(buf[l]);
-  }
+  p = format_uint(&buf[sizeof(buf)], value);
+  write_fragment(js_ctx, p, &buf[sizeof(buf)] - p);
 }
 /*---------------------------------------------------------------------------*/
 void
 jsontree_write_int(const struct jsontree_context *js_ctx, int value)
 {
+  char buf[11];
+  char *p;
+
   if(value < 0) {
-    js_ctx->putchar('-');
-    value = -value;
+    p = format_uint(&buf[sizeof(buf)], -(unsigned int)value);
+    *--p = '-';
+  } else {
+    p = format_uint(&buf[sizeof(buf)], value);
   }
-
-  jsontree_write_uint(js_ctx, value);
+  write_fragment(js_ctx, p, &buf[sizeof(buf)] - p);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -121,6 +217,104 @@ jsontree_reset(struct jsontree_context *js_ctx)
 {
   js_ctx->depth = 0;
   js_ctx->index[0] = 0;
+  js_ctx->buffer = NULL;
+}
+/*---------------------------------------------------------------------------*/
+void
+jsontree_setup_buffer(struct jsontree_context *js_ctx,
+                      struct jsontree_value *root,
+                      struct jsontree_buffer *buffer)
+{
+  jsontree_setup(js_ctx, root, NULL);
+  memset(buffer, 0, sizeof(struct jsontree_buffer));
+  js_ctx->buffer = buffer;
+}
+/*---------------------------------------------------------------------------*/
+int
+jsontree_print_block(struct jsontree_context *js_ctx, uint32_t offset,
+                     char *data, int size)
+{
+  struct jsontree_buffer *b = js_ctx->buffer;
+  uint8_t depth;
+  uint16_t index;
+  uint16_t parent_index;
+  int callback_state;
+  int more;
+  int n;
+
+  if(offset < b->offset) {
+    /* An earlier block: start over */
+    js_ctx->depth = 0;
+    js_ctx->index[0] = 0;
+    b->offset = 0;
+    b->skip = 0;
+    b->carry_len = 0;
+    b->carry_pos = 0;
+    b->done = 0;
+  }
+  b->skip += offset - b->offset;
+  b->offset = offset;
+  b->data = data;
+  b->size = size;
+  b->pos = 0;
+  b->full = 0;
+
+  if(b->carry_pos < b->carry_len) {
+    /* The rest of the step that ended the previous block */
+    n = b->carry_len - b->carry_pos;
+    if(n > b->skip) {
+      n -= b->skip;
+      b->carry_pos += b->skip;
+      b->skip = 0;
+    } else {
+      b->skip -= n;
+      b->carry_pos = b->carry_len;
+      n = 0;
+    }
+    if(n > size) {
+      n = size;
+    }
+    memcpy(data, &b->carry[b->carry_pos], n);
+    b->pos = n;
+    b->carry_pos += n;
+    if(b->carry_pos < b->carry_len) {
+      b->full = 1;
+    } else {
+      b->carry_len = 0;
+      b->carry_pos = 0;
+    }
+  }
+
+  while(!b->full && b->pos < b->size && !b->done) {
+    /* Enough to redo a step that does not fit in the carry */
+    depth = js_ctx->depth;
+    index = js_ctx->index[depth];
+    parent_index = depth > 0 ? js_ctx->index[depth - 1] : 0;
+    callback_state = js_ctx->callback_state;
+
+    b->step = 0;
+    b->overflow = 0;
+    more = jsontree_print_next(js_ctx);
+    if(b->overflow) {
+      /* Generate the step again in the next block and skip the bytes
+         already delivered */
+      js_ctx->depth = depth;
+      js_ctx->index[depth] = index;
+      if(depth > 0) {
+        js_ctx->index[depth - 1] = parent_index;
+      }
+      js_ctx->callback_state = callback_state;
+      b->skip = b->step;
+      b->carry_len = 0;
+      break;
+    }
+    if(!more) {
+      b->done = 1;
+    }
+  }
+
+  b->offset += b->pos;
+  return b->pos;
 }
 /*---------------------------------------------------------------------------*/
 const char *
@@ -138,10 +332,6 @@ jsontree_print_next(struct jsontree_context *js_ctx)
 {
   struct jsontree_value *v;
   int index;
-#if JSONTREE_PRETTY
-  int indent;
-#endif
-
   v = js_ctx->values[js_ctx->depth];
 
   /* Default operation after switch is to back up one level */
@@ -152,52 +342,53 @@ jsontree_print_next(struct jsontree_context *js_ctx)
     struct jsontree_value *ov;
 
     index = js_ctx->index[js_ctx->depth];
-    if(index == 0) {
-      js_ctx->putchar(v->type);
 #if JSONTREE_PRETTY
-      js_ctx->putchar('\n');
-#endif
+    if(index == 0) {
+      write_fragment(js_ctx, v->type == JSON_TYPE_OBJECT ? "{\n" : "[\n", 2);
     }
     if(index >= o->count) {
-#if JSONTREE_PRETTY
-      js_ctx->putchar('\n');
-      indent = js_ctx->depth;
-      while (indent--) {
-        js_ctx->putchar(' ');
-        js_ctx->putchar(' ');
-      }
-#endif
-      js_ctx->putchar(v->type + 2);
+      write_fragment(js_ctx, "\n", 1);
+      write_indent(js_ctx, js_ctx->depth);
+      write_fragment(js_ctx, v->type == JSON_TYPE_OBJECT ? "}" : "]", 1);
       /* Default operation: back up one level! */
       break;
     }
 
     if(index > 0) {
-      js_ctx->putchar(',');
-#if JSONTREE_PRETTY
-      js_ctx->putchar('\n');
-#endif
+      write_fragment(js_ctx, ",\n", 2);
     }
-
-#if JSONTREE_PRETTY
-    indent = js_ctx->depth + 1;
-    while (indent--) {
-      js_ctx->putchar(' ');
-      js_ctx->putchar(' ');
-    }
-#endif
+    write_indent(js_ctx, js_ctx->depth + 1);
 
     if(v->type == JSON_TYPE_OBJECT) {
       jsontree_write_string(js_ctx,
                             ((struct jsontree_object *)o)->pairs[index].name);
-      js_ctx->putchar(':');
-#if JSONTREE_PRETTY
-      js_ctx->putchar(' ');
-#endif
+      write_fragment(js_ctx, ": ", 2);
+      ov = ((struct jsontree_object *)o)->pairs[index].value;
+    } else {
+      ov = o->values[index];
+    }
+#else /* JSONTREE_PRETTY */
+    /* The punctuation around a value is written as one fragment */
+    if(index >= o->count) {
+      if(v->type == JSON_TYPE_OBJECT) {
+        write_fragment(js_ctx, index == 0 ? "{}" : "}", index == 0 ? 2 : 1);
+      } else {
+        write_fragment(js_ctx, index == 0 ? "[]" : "]", index == 0 ? 2 : 1);
+      }
+      /* Default operation: back up one level! */
+      break;
+    }
+
+    if(v->type == JSON_TYPE_OBJECT) {
+      write_fragment(js_ctx, index == 0 ? "{\"" : ",\"", 2);
+      write_escaped(js_ctx, ((struct jsontree_object *)o)->pairs[index].name);
+      write_fragment(js_ctx, "\":", 2);
       ov = ((struct jsontree_object *)o)->pairs[index].value;
     } else {
+      write_fragment(js_ctx, index == 0 ? "[" : ",", 1);
       ov = o->values[index];
     }
+#endif /* JSONTREE_PRETTY */
     /* TODO check max depth */
     js_ctx->depth++;          /* step down to value... */
     js_ctx->index[js_ctx->depth] = 0; /* and init index */
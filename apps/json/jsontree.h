@@ -55,10 +55,46 @@
 #define JSONTREE_PRETTY 0
 #endif /* JSONTREE_CONF_PRETTY */
 
+/* Output of a tree step that did not fit in a block is kept up to this
+   size for the next block. A longer step, such as a callback writing
+   more than this at once, is instead generated again for the next block
+   and must then produce the same output. */
+#ifdef JSONTREE_CONF_BLOCK_CARRY
+#define JSONTREE_BLOCK_CARRY JSONTREE_CONF_BLOCK_CARRY
+#else
+#define JSONTREE_BLOCK_CARRY 64
+#endif /* JSONTREE_CONF_BLOCK_CARRY */
+
+/**
+ * Output buffer for jsontree_print_block(). The output is produced one
+ * block at a time into a caller-supplied array, and the position in the
+ * tree is kept between blocks so that the output before a block never
+ * has to be generated again when the blocks are requested in order.
+ */
+struct jsontree_buffer {
+  char *data;
+  uint16_t size;
+  uint16_t pos;
+  /* Output bytes delivered in earlier blocks */
+  uint32_t offset;
+  /* Output bytes to discard before writing to data */
+  uint32_t skip;
+  /* Output bytes of the current tree step passed so far */
+  uint16_t step;
+  /* Output of the last step not yet delivered */
+  uint16_t carry_len;
+  uint16_t carry_pos;
+  char carry[JSONTREE_BLOCK_CARRY];
+  uint8_t full;
+  uint8_t overflow;
+  uint8_t done;
+};
+
 struct jsontree_context {
   struct jsontree_value *values[JSONTREE_MAX_DEPTH];
   uint16_t index[JSONTREE_MAX_DEPTH];
   int (* putchar)(int);
+  struct jsontree_buffer *buffer;
   uint8_t depth;
   uint8_t path;
   int callback_state;
@@ -143,6 +179,36 @@ void jsontree_setup(struct jsontree_context *js_ctx,
                     struct jsontree_value *root, int (* putchar)(int));
 void jsontree_reset(struct jsontree_context *js_ctx);
 
+/**
+ * \brief      Set up a context for output to memory
+ * \param js_ctx The context
+ * \param root The value to output
+ * \param buffer The output buffer state, used until the next setup
+ *
+ *             Output is then produced with jsontree_print_block()
+ *             instead of jsontree_print_next(). Callbacks must write
+ *             with the jsontree_write_*() functions, as there is no
+ *             putchar function in this mode.
+ */
+void jsontree_setup_buffer(struct jsontree_context *js_ctx,
+                           struct jsontree_value *root,
+                           struct jsontree_buffer *buffer);
+
+/**
+ * \brief      Output a block of the tree set up with jsontree_setup_buffer()
+ * \param js_ctx The context
+ * \param offset The offset of the block in the output, as in CoAP Block2
+ * \param data Where to write the block
+ * \param size The size of the block
+ * \return     The number of bytes written, less than size at the end
+ *
+ *             Blocks requested in order continue where the previous
+ *             block ended. A smaller offset than the previous block
+ *             ended at starts the output over from the root.
+ */
+int jsontree_print_block(struct jsontree_context *js_ctx, uint32_t offset,
+                         char *data, int size);
+
 const char *jsontree_path_name(const struct jsontree_context *js_ctx,
                                int depth);
 
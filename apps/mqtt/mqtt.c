@@ -62,6 +62,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stddef.h>
 /*---------------------------------------------------------------------------*/
 #define DEBUG 0
 #if DEBUG
@@ -122,10 +123,13 @@ typedef enum {
 #define MQTT_STRING_LEN_SIZE 2
 #define MQTT_MID_SIZE 2
 #define MQTT_QOS_SIZE 1
+
+#define MQTT_FHDR_QOS_MASK (MQTT_FHDR_QOS_LEVEL_1 | MQTT_FHDR_QOS_LEVEL_2)
 /*---------------------------------------------------------------------------*/
 #define RESPONSE_WAIT_TIMEOUT (CLOCK_SECOND * 10)
 /*---------------------------------------------------------------------------*/
 #define INCREMENT_MID(conn)   (conn)->mid_counter += 2
+#define PUBLISH_HEAD(conn)    (&(conn)->out_queue[(conn)->out_queue_head])
 #define MQTT_STRING_LENGTH(s) (((s)->length) == 0 ? 0 : (MQTT_STRING_LEN_SIZE + (s)->length))
 /*---------------------------------------------------------------------------*/
 /* Protothread send macros */
@@ -186,6 +190,7 @@ static void tcp_event(struct tcp_socket *s, void *ptr,
                       tcp_socket_event_t event);
 
 static void reset_packet(struct mqtt_in_packet *packet);
+static int expire_inflight(struct mqtt_connection *conn);
 /*---------------------------------------------------------------------------*/
 LIST(mqtt_conn_list);
 /*---------------------------------------------------------------------------*/
@@ -220,6 +225,12 @@ abort_connection(struct mqtt_connection *conn)
   /* Reset outgoing packet */
   memset(&conn->out_packet, 0, sizeof(conn->out_packet));
 
+  /* Queued and unacknowledged PUBLISH messages are lost */
+  conn->out_queue_head = 0;
+  conn->out_queue_count = 0;
+  conn->inflight_count = 0;
+  conn->publish_active = 0;
+
   tcp_socket_close(&conn->socket);
   tcp_socket_unregister(&conn->socket);
 
@@ -365,14 +376,17 @@ keep_alive_callback(void *ptr)
     return;
   }
 
+  /* Report QoS 1 messages that are still not acknowledged, also when the
+     window is not full */
+  expire_inflight(conn);
+
   process_post(&mqtt_process, mqtt_do_pingreq_event, conn);
 }
 /*---------------------------------------------------------------------------*/
 static void
 reset_packet(struct mqtt_in_packet *packet)
 {
-  memset(packet, 0, sizeof(struct mqtt_in_packet));
-  packet->remaining_multiplier = 1;
+  memset(packet, 0, offsetof(struct mqtt_in_packet, payload));
 }
 /*---------------------------------------------------------------------------*/
 static
@@ -453,7 +467,6 @@ PT_THREAD(connect_pt(struct pt *pt, struct mqtt_connection *conn))
   timer_set(&conn->t, RESPONSE_WAIT_TIMEOUT);
 
   /* Wait for CONNACK */
-  reset_packet(&conn->in_packet);
   PT_WAIT_UNTIL(pt, conn->out_packet.qos_state == MQTT_QOS_STATE_GOT_ACK ||
                 timer_expired(&conn->t));
   if(timer_expired(&conn->t)) {
@@ -461,7 +474,6 @@ PT_THREAD(connect_pt(struct pt *pt, struct mqtt_connection *conn))
     /* We stick to the letter of the spec here: Tear the connection down */
     mqtt_disconnect(conn);
   }
-  reset_packet(&conn->in_packet);
 
   PRINTF("MQTT - Done sending CONNECT\n");
 
@@ -530,7 +542,7 @@ PT_THREAD(subscribe_pt(struct pt *pt, struct mqtt_connection *conn))
                       conn->out_packet.remaining_length_enc,
                       conn->out_packet.remaining_length_enc_bytes);
   /* Write Variable Header */
-  PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid << 8));
+  PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid >> 8));
   PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid & 0x00FF));
   /* Write Payload */
   PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.topic_length >> 8));
@@ -544,14 +556,12 @@ PT_THREAD(subscribe_pt(struct pt *pt, struct mqtt_connection *conn))
   timer_set(&conn->t, RESPONSE_WAIT_TIMEOUT);
 
   /* Wait for SUBACK. */
-  reset_packet(&conn->in_packet);
   PT_WAIT_UNTIL(pt, conn->out_packet.qos_state == MQTT_QOS_STATE_GOT_ACK ||
                 timer_expired(&conn->t));
 
   if(timer_expired(&conn->t)) {
     PRINTF("Timeout waiting for SUBACK\n");
   }
-  reset_packet(&conn->in_packet);
 
   /* This is clear after the entire transaction is complete */
   conn->out_queue_full = 0;
@@ -592,7 +602,7 @@ PT_THREAD(unsubscribe_pt(struct pt *pt, struct mqtt_connection *conn))
   PT_MQTT_WRITE_BYTES(conn, (uint8_t *)conn->out_packet.remaining_length_enc,
                       conn->out_packet.remaining_length_enc_bytes);
   /* Write Variable Header */
-  PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid << 8));
+  PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid >> 8));
   PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid & 0x00FF));
   /* Write Payload */
   PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.topic_length >> 8));
@@ -605,7 +615,6 @@ PT_THREAD(unsubscribe_pt(struct pt *pt, struct mqtt_connection *conn))
   timer_set(&conn->t, RESPONSE_WAIT_TIMEOUT);
 
   /* Wait for UNSUBACK */
-  reset_packet(&conn->in_packet);
   PT_WAIT_UNTIL(pt, conn->out_packet.qos_state == MQTT_QOS_STATE_GOT_ACK ||
                 timer_expired(&conn->t));
 
@@ -613,8 +622,6 @@ PT_THREAD(unsubscribe_pt(struct pt *pt, struct mqtt_connection *conn))
     PRINTF("Timeout waiting for UNSUBACK\n");
   }
 
-  reset_packet(&conn->in_packet);
-
   /* This is clear after the entire transaction is complete */
   conn->out_queue_full = 0;
 
@@ -623,90 +630,149 @@ PT_THREAD(unsubscribe_pt(struct pt *pt, struct mqtt_connection *conn))
   PT_END(pt);
 }
 /*---------------------------------------------------------------------------*/
+static void
+remove_inflight(struct mqtt_connection *conn, uint8_t i)
+{
+  conn->inflight_count--;
+  conn->inflight[i] = conn->inflight[conn->inflight_count];
+}
+/*---------------------------------------------------------------------------*/
+static int
+expire_inflight(struct mqtt_connection *conn)
+{
+  uint8_t i;
+  int expired = 0;
+
+  uint16_t mid;
+
+  for(i = 0; i < conn->inflight_count;) {
+    if(timer_expired(&conn->inflight[i].t)) {
+      mid = conn->inflight[i].mid;
+      PRINTF("Timeout waiting for PUBACK for MID %u\n", mid);
+      remove_inflight(conn, i);
+      call_event(conn, MQTT_EVENT_PUBACK_TIMEOUT, &mid);
+      expired = 1;
+    } else {
+      i++;
+    }
+  }
+  return expired;
+}
+/*---------------------------------------------------------------------------*/
+static void
+pop_publish(struct mqtt_connection *conn)
+{
+  conn->out_queue_head = (conn->out_queue_head + 1) % MQTT_PUBLISH_QUEUE_SIZE;
+  conn->out_queue_count--;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Starts publish_pt unless it is running or about to run. If the event
+ * cannot be posted, the next mqtt_publish() call tries again.
+ */
+static void
+wake_publish(struct mqtt_connection *conn)
+{
+  if(!conn->publish_active &&
+     process_post(&mqtt_process, mqtt_do_publish_event, conn) ==
+     PROCESS_ERR_OK) {
+    conn->publish_active = 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Writes queued PUBLISH messages back to back into the output buffer. The
+ * buffer is only handed to TCP when it is full, when the queue is empty or
+ * when the QoS 1 window is full, so a burst of small messages goes out in
+ * few segments.
+ */
 static
 PT_THREAD(publish_pt(struct pt *pt, struct mqtt_connection *conn))
 {
   PT_BEGIN(pt);
 
-  PRINTF("MQTT - Sending publish message! topic %s topic_length %i\n",
-      conn->out_packet.topic,
-      conn->out_packet.topic_length);
-  PRINTF("MQTT - Buffer space is %i \n",
-      &conn->out_buffer[MQTT_TCP_OUTPUT_BUFF_SIZE] - conn->out_buffer_ptr);
-
-  /* Set up FHDR */
-  conn->out_packet.fhdr = MQTT_FHDR_MSG_TYPE_PUBLISH |
-    conn->out_packet.qos << 1;
-  if(conn->out_packet.retain == MQTT_RETAIN_ON) {
-    conn->out_packet.fhdr |= MQTT_FHDR_RETAIN_FLAG;
-  }
-  conn->out_packet.remaining_length = MQTT_STRING_LEN_SIZE +
-    conn->out_packet.topic_length +
-    conn->out_packet.payload_size;
-  if(conn->out_packet.qos > MQTT_QOS_LEVEL_0) {
-    conn->out_packet.remaining_length += MQTT_MID_SIZE;
-  }
-  encode_remaining_length(conn->out_packet.remaining_length_enc,
-                          &conn->out_packet.remaining_length_enc_bytes,
-                          conn->out_packet.remaining_length);
-  if(conn->out_packet.remaining_length_enc_bytes > 4) {
-    call_event(conn, MQTT_EVENT_PROTOCOL_ERROR, NULL);
-    PRINTF("MQTT - Error, remaining length > 4 bytes\n");
-    PT_EXIT(pt);
-  }
-
-  /* Write Fixed Header */
-  PT_MQTT_WRITE_BYTE(conn, conn->out_packet.fhdr);
-  PT_MQTT_WRITE_BYTES(conn, (uint8_t *)conn->out_packet.remaining_length_enc,
-                      conn->out_packet.remaining_length_enc_bytes);
-  /* Write Variable Header */
-  PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.topic_length >> 8));
-  PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.topic_length & 0x00FF));
-  PT_MQTT_WRITE_BYTES(conn, (uint8_t *)conn->out_packet.topic,
-                      conn->out_packet.topic_length);
-  if(conn->out_packet.qos > MQTT_QOS_LEVEL_0) {
-    PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid << 8));
-    PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid & 0x00FF));
-  }
-  /* Write Payload */
-  PT_MQTT_WRITE_BYTES(conn,
-                      conn->out_packet.payload,
-                      conn->out_packet.payload_size);
-
-  send_out_buffer(conn);
-  timer_set(&conn->t, RESPONSE_WAIT_TIMEOUT);
+  /* The previous batch must have left the output buffer */
+  PT_WAIT_UNTIL(pt, conn->out_buffer_sent);
+
+  while(conn->out_queue_count > 0) {
+    if(PUBLISH_HEAD(conn)->qos == MQTT_QOS_LEVEL_1 &&
+       conn->inflight_count >= MQTT_QOS1_WINDOW) {
+      /* Window full: send what we have and wait for a PUBACK */
+      send_out_buffer(conn);
+      PT_WAIT_UNTIL(pt, conn->inflight_count < MQTT_QOS1_WINDOW ||
+                    expire_inflight(conn));
+      PT_WAIT_UNTIL(pt, conn->out_buffer_sent);
+      continue;
+    }
 
-  /*
-   * If QoS is zero then wait until the message has been sent, since there is
-   * no ACK to wait for.
-   *
-   * Also notify the app will not be notified via PUBACK or PUBCOMP
-   */
-  if(conn->out_packet.qos == 0) {
-    process_post(conn->app_process, mqtt_update_event, NULL);
-  } else if(conn->out_packet.qos == 1) {
-    /* Wait for PUBACK */
-    reset_packet(&conn->in_packet);
-    PT_WAIT_UNTIL(pt, conn->out_packet.qos_state == MQTT_QOS_STATE_GOT_ACK ||
-                  timer_expired(&conn->t));
-    if(timer_expired(&conn->t)) {
-      PRINTF("Timeout waiting for PUBACK\n");
+    PRINTF("MQTT - Sending publish message! topic %s topic_length %i\n",
+        PUBLISH_HEAD(conn)->topic,
+        PUBLISH_HEAD(conn)->topic_length);
+    PRINTF("MQTT - Buffer space is %i \n",
+        &conn->out_buffer[MQTT_TCP_OUTPUT_BUFF_SIZE] - conn->out_buffer_ptr);
+
+    /* Set up FHDR */
+    PUBLISH_HEAD(conn)->fhdr = MQTT_FHDR_MSG_TYPE_PUBLISH |
+      PUBLISH_HEAD(conn)->qos << 1;
+    if(PUBLISH_HEAD(conn)->retain == MQTT_RETAIN_ON) {
+      PUBLISH_HEAD(conn)->fhdr |= MQTT_FHDR_RETAIN_FLAG;
     }
-    if(conn->in_packet.mid != conn->out_packet.mid) {
-      PRINTF("MQTT - Warning, got PUBACK with none matching MID. Currently there "
-          "is no support for several concurrent PUBLISH messages.\n");
+    PUBLISH_HEAD(conn)->remaining_length = MQTT_STRING_LEN_SIZE +
+      PUBLISH_HEAD(conn)->topic_length +
+      PUBLISH_HEAD(conn)->payload_size;
+    if(PUBLISH_HEAD(conn)->qos > MQTT_QOS_LEVEL_0) {
+      PUBLISH_HEAD(conn)->remaining_length += MQTT_MID_SIZE;
+    }
+    encode_remaining_length(PUBLISH_HEAD(conn)->remaining_length_enc,
+                            &PUBLISH_HEAD(conn)->remaining_length_enc_bytes,
+                            PUBLISH_HEAD(conn)->remaining_length);
+    if(PUBLISH_HEAD(conn)->remaining_length_enc_bytes > 4) {
+      call_event(conn, MQTT_EVENT_PROTOCOL_ERROR, NULL);
+      PRINTF("MQTT - Error, remaining length > 4 bytes\n");
+      pop_publish(conn);
+      continue;
     }
-  } else if(conn->out_packet.qos == 2) {
-    PRINTF("MQTT - QoS not implemented yet.\n");
-    /* Should wait for PUBREC, send PUBREL and then wait for PUBCOMP */
-  }
 
-  reset_packet(&conn->in_packet);
+    /* Write Fixed Header */
+    PT_MQTT_WRITE_BYTE(conn, PUBLISH_HEAD(conn)->fhdr);
+    PT_MQTT_WRITE_BYTES(conn,
+                        (uint8_t *)PUBLISH_HEAD(conn)->remaining_length_enc,
+                        PUBLISH_HEAD(conn)->remaining_length_enc_bytes);
+    /* Write Variable Header */
+    PT_MQTT_WRITE_BYTE(conn, (PUBLISH_HEAD(conn)->topic_length >> 8));
+    PT_MQTT_WRITE_BYTE(conn, (PUBLISH_HEAD(conn)->topic_length & 0x00FF));
+    PT_MQTT_WRITE_BYTES(conn, (uint8_t *)PUBLISH_HEAD(conn)->topic,
+                        PUBLISH_HEAD(conn)->topic_length);
+    if(PUBLISH_HEAD(conn)->qos > MQTT_QOS_LEVEL_0) {
+      PT_MQTT_WRITE_BYTE(conn, (PUBLISH_HEAD(conn)->mid >> 8));
+      PT_MQTT_WRITE_BYTE(conn, (PUBLISH_HEAD(conn)->mid & 0x00FF));
+    }
+    /* Write Payload */
+    PT_MQTT_WRITE_BYTES(conn,
+                        PUBLISH_HEAD(conn)->payload,
+                        PUBLISH_HEAD(conn)->payload_size);
+
+    /*
+     * QoS 0 messages are done once written, and the app will not be notified
+     * via PUBACK or PUBCOMP. QoS 1 messages are tracked until their PUBACK.
+     */
+    if(PUBLISH_HEAD(conn)->qos == MQTT_QOS_LEVEL_0) {
+      process_post(conn->app_process, mqtt_update_event, NULL);
+    } else if(PUBLISH_HEAD(conn)->qos == MQTT_QOS_LEVEL_1) {
+      conn->inflight[conn->inflight_count].mid = PUBLISH_HEAD(conn)->mid;
+      timer_set(&conn->inflight[conn->inflight_count].t,
+                RESPONSE_WAIT_TIMEOUT);
+      conn->inflight_count++;
+    } else {
+      PRINTF("MQTT - QoS not implemented yet.\n");
+      /* Should wait for PUBREC, send PUBREL and then wait for PUBCOMP */
+    }
+    pop_publish(conn);
 
-  /* This is clear after the entire transaction is complete */
-  conn->out_queue_full = 0;
+    PRINTF("MQTT - Publish written\n");
+  }
 
-  PRINTF("MQTT - Publish Enqueued\n");
+  send_out_buffer(conn);
 
   PT_END(pt);
 }
@@ -728,12 +794,9 @@ PT_THREAD(pingreq_pt(struct pt *pt, struct mqtt_connection *conn))
   conn->waiting_for_pingresp = 1;
 
   /* Wait for PINGRESP or timeout */
-  reset_packet(&conn->in_packet);
   timer_set(&conn->t, RESPONSE_WAIT_TIMEOUT);
 
-  PT_WAIT_UNTIL(pt, conn->in_packet.packet_received || timer_expired(&conn->t));
-
-  reset_packet(&conn->in_packet);
+  PT_WAIT_UNTIL(pt, !conn->waiting_for_pingresp || timer_expired(&conn->t));
 
   conn->waiting_for_pingresp = 0;
 
@@ -767,6 +830,8 @@ static void
 handle_pingresp(struct mqtt_connection *conn)
 {
   PRINTF("MQTT - Got RINGRESP\n");
+
+  conn->waiting_for_pingresp = 0;
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -818,243 +883,208 @@ handle_unsuback(struct mqtt_connection *conn)
 static void
 handle_puback(struct mqtt_connection *conn)
 {
+  uint8_t i;
+
   PRINTF("MQTT - Got PUBACK\n");
 
-  conn->out_packet.qos_state = MQTT_QOS_STATE_GOT_ACK;
   conn->in_packet.mid = (conn->in_packet.payload[0] << 8) |
     (conn->in_packet.payload[1]);
 
+  for(i = 0; i < conn->inflight_count; i++) {
+    if(conn->inflight[i].mid == conn->in_packet.mid) {
+      break;
+    }
+  }
+  if(i < conn->inflight_count) {
+    remove_inflight(conn, i);
+  } else {
+    PRINTF("MQTT - Warning, got PUBACK for unknown MID %u\n",
+           conn->in_packet.mid);
+  }
+
   call_event(conn, MQTT_EVENT_PUBACK, &conn->in_packet.mid);
 }
 /*---------------------------------------------------------------------------*/
 static void
-handle_publish(struct mqtt_connection *conn)
+handle_publish(struct mqtt_connection *conn, const uint8_t *chunk,
+               uint16_t chunk_length)
 {
   PRINTF("MQTT - Got PUBLISH, called once per manageable chunk of message.\n");
   PRINTF("MQTT - Handling publish on topic '%s'\n", conn->in_publish_msg.topic);
 
-  PRINTF("MQTT - This chunk is %i bytes\n", conn->in_packet.payload_pos);
+  PRINTF("MQTT - This chunk is %i bytes\n", chunk_length);
 
-  if(((conn->in_packet.fhdr & 0x09) >> 1) > 0) {
-    PRINTF("MQTT - Error, got incoming PUBLISH with QoS > 0, not supported atm!\n");
-  }
+  conn->in_publish_msg.payload_chunk = chunk;
+  conn->in_publish_msg.payload_chunk_length = chunk_length;
 
   call_event(conn, MQTT_EVENT_PUBLISH, &conn->in_publish_msg);
 
-  if(conn->in_publish_msg.first_chunk == 1) {
-    conn->in_publish_msg.first_chunk = 0;
-  }
-
-  /* If this is the last time handle_publish will be called, reset packet. */
-  if(conn->in_publish_msg.payload_left == 0) {
-
-    /* Check for QoS and initiate the reply, do not rely on the data in the
-     * in_packet being untouched. */
-
-    PRINTF("MQTT - (handle_publish) resetting packet.\n");
-    reset_packet(&conn->in_packet);
-  }
+  conn->in_publish_msg.first_chunk = 0;
 }
 /*---------------------------------------------------------------------------*/
-static void
+/*
+ * Reads the topic and, for QoS > 0, the MID of a PUBLISH. The topic is the
+ * only part of the message that is copied, since the application expects it
+ * as a string. Returns the number of bytes consumed.
+ */
+static int
 parse_publish_vhdr(struct mqtt_connection *conn,
-                   uint32_t *pos,
                    const uint8_t *input_data_ptr,
                    int input_data_len)
 {
+  struct mqtt_in_packet *packet = &conn->in_packet;
+  struct mqtt_message *msg = &conn->in_publish_msg;
+  uint16_t vhdr_length;
   uint16_t copy_bytes;
+  int pos = 0;
 
-  /* Read out topic length */
-  if(conn->in_packet.topic_len_received == 0) {
-    conn->in_packet.topic_len = (input_data_ptr[(*pos)++] << 8);
-    conn->in_packet.byte_counter++;
-    if(*pos >= input_data_len) {
-      return;
-    }
-    conn->in_packet.topic_len |= input_data_ptr[(*pos)++];
-    conn->in_packet.byte_counter++;
-    conn->in_packet.topic_len_received = 1;
-
-    PRINTF("MQTT - Read PUBLISH topic len %i\n", conn->in_packet.topic_len);
-    /* WARNING: Check here if TOPIC fits in payload area, otherwise error */
+  if(packet->remaining_length < MQTT_STRING_LEN_SIZE) {
+    PRINTF("MQTT - Error, PUBLISH without topic\n");
+    call_event(conn, MQTT_EVENT_PROTOCOL_ERROR, NULL);
+    packet->discard = 1;
+    return pos;
   }
 
-  /* Read out topic */
-  if(conn->in_packet.topic_len_received == 1 &&
-     conn->in_packet.topic_received == 0) {
-    copy_bytes = MIN(conn->in_packet.topic_len - conn->in_packet.topic_pos,
-                     input_data_len - *pos);
-    PRINTF("MQTT - topic_pos: %i copy_bytes: %i", conn->in_packet.topic_pos,
-        copy_bytes);
-    memcpy(&conn->in_publish_msg.topic[conn->in_packet.topic_pos],
-           &input_data_ptr[*pos],
-           copy_bytes);
-    (*pos) += copy_bytes;
-    conn->in_packet.byte_counter += copy_bytes;
-    conn->in_packet.topic_pos += copy_bytes;
-
-    if(conn->in_packet.topic_len - conn->in_packet.topic_pos == 0) {
-      PRINTF("MQTT - Got topic '%s'", conn->in_publish_msg.topic);
-      conn->in_packet.topic_received = 1;
-      conn->in_publish_msg.topic[conn->in_packet.topic_pos] = '\0';
-      conn->in_publish_msg.payload_length =
-        conn->in_packet.remaining_length - conn->in_packet.topic_len - 2;
-      conn->in_publish_msg.payload_left = conn->in_publish_msg.payload_length;
+  while(1) {
+    if(packet->byte_counter < MQTT_STRING_LEN_SIZE) {
+      /* Read out topic length */
+      if(pos >= input_data_len) {
+        return pos;
+      }
+      packet->topic_len = (packet->topic_len << 8) | input_data_ptr[pos++];
+      packet->byte_counter++;
+      continue;
     }
 
-    /* Set this once per incomming publish message */
-    conn->in_publish_msg.first_chunk = 1;
-  }
-}
-/*---------------------------------------------------------------------------*/
-static int
-tcp_input(struct tcp_socket *s,
-          void *ptr,
-          const uint8_t *input_data_ptr,
-          int input_data_len)
-{
-  struct mqtt_connection *conn = ptr;
-  uint32_t pos = 0;
-  uint32_t copy_bytes = 0;
-  uint8_t byte;
-
-  if(input_data_len == 0) {
-    return 0;
-  }
-
-  if(conn->in_packet.packet_received) {
-    reset_packet(&conn->in_packet);
-  }
-
-  PRINTF("tcp_input with %i bytes of data:\n", input_data_len);
-
-  /* Read the fixed header field, if we do not have it */
-  if(!conn->in_packet.fhdr) {
-    conn->in_packet.fhdr = input_data_ptr[pos++];
-    conn->in_packet.byte_counter++;
-
-    PRINTF("MQTT - Read VHDR '%02X'\n", conn->in_packet.fhdr);
-
+    vhdr_length = MQTT_STRING_LEN_SIZE + packet->topic_len;
+    if(packet->fhdr & MQTT_FHDR_QOS_MASK) {
+      vhdr_length += MQTT_MID_SIZE;
+    }
+    if(vhdr_length > packet->remaining_length) {
+      PRINTF("MQTT - Error, PUBLISH topic longer than the packet\n");
+      call_event(conn, MQTT_EVENT_PROTOCOL_ERROR, NULL);
+      packet->discard = 1;
+      return pos;
+    }
+    if(packet->byte_counter == vhdr_length) {
+      break;
+    }
     if(pos >= input_data_len) {
-      return 0;
+      return pos;
     }
-  }
-
-  /* Read the Remaining Length field, if we do not have it */
-  if(!conn->in_packet.has_remaining_length) {
-    do {
-      if(pos >= input_data_len) {
-        return 0;
-      }
 
-      byte = input_data_ptr[pos++];
-      conn->in_packet.byte_counter++;
-      conn->in_packet.remaining_length_bytes++;
-      PRINTF("MQTT - Read Remaining Length byte\n");
-
-      if(conn->in_packet.byte_counter > 5) {
-        call_event(conn, MQTT_EVENT_ERROR, NULL);
-        PRINTF("Received more then 4 byte 'remaining lenght'.");
-        return 0;
+    if(packet->topic_pos < packet->topic_len) {
+      /* Read out topic, keeping what fits */
+      copy_bytes = MIN(packet->topic_len - packet->topic_pos,
+                       input_data_len - pos);
+      if(packet->topic_pos < MQTT_MAX_TOPIC_LENGTH) {
+        memcpy(&msg->topic[packet->topic_pos], &input_data_ptr[pos],
+               MIN(copy_bytes, MQTT_MAX_TOPIC_LENGTH - packet->topic_pos));
       }
-
-      conn->in_packet.remaining_length +=
-        (byte & 127) * conn->in_packet.remaining_multiplier;
-      conn->in_packet.remaining_multiplier *= 128;
-    } while((byte & 128) != 0);
-
-    PRINTF("MQTT - Finished reading remaining length byte\n");
-    conn->in_packet.has_remaining_length = 1;
-  }
-
-  /*
-   * Check for unsupported payload length. Will read all incoming data from the
-   * server in any case and then reset the packet.
-   *
-   * TODO: Decide if we, for example, want to disconnect instead.
-   */
-  if((conn->in_packet.remaining_length > MQTT_INPUT_BUFF_SIZE) &&
-     (conn->in_packet.fhdr & 0xF0) != MQTT_FHDR_MSG_TYPE_PUBLISH) {
-
-    PRINTF("MQTT - Error, unsupported payload size for non-PUBLISH message\n");
-
-    conn->in_packet.byte_counter += input_data_len;
-    if(conn->in_packet.byte_counter >=
-       (MQTT_FHDR_SIZE + conn->in_packet.remaining_length)) {
-      conn->in_packet.packet_received = 1;
+      packet->topic_pos += copy_bytes;
+      packet->byte_counter += copy_bytes;
+      pos += copy_bytes;
+    } else {
+      /* Read out MID */
+      packet->mid = (packet->mid << 8) | input_data_ptr[pos++];
+      packet->byte_counter++;
     }
-    return 0;
   }
 
-  /*
-   * Supported payload, reads out both VHDR and Payload of all packets.
-   *
-   * Note: There will always be at least one byte left to read when we enter
-   *       this loop.
-   */
-  while(conn->in_packet.byte_counter <
-        (MQTT_FHDR_SIZE + conn->in_packet.remaining_length)) {
-
-    if((conn->in_packet.fhdr & 0xF0) == MQTT_FHDR_MSG_TYPE_PUBLISH &&
-       conn->in_packet.topic_received == 0) {
-      parse_publish_vhdr(conn, &pos, input_data_ptr, input_data_len);
-    }
+  msg->topic[MIN(packet->topic_len, MQTT_MAX_TOPIC_LENGTH)] = '\0';
+  msg->topic_length = packet->topic_len;
+  msg->mid = packet->mid;
+  msg->payload_length = packet->remaining_length - packet->byte_counter;
+  msg->payload_left = msg->payload_length;
+  msg->first_chunk = 1;
+  packet->topic_received = 1;
 
-    /* Read in as much as we can into the packet payload */
-    copy_bytes = MIN(input_data_len - pos,
-                     MQTT_INPUT_BUFF_SIZE - conn->in_packet.payload_pos);
-    PRINTF("- Copied %lu payload bytes\n", copy_bytes);
-    memcpy(&conn->in_packet.payload[conn->in_packet.payload_pos],
-           &input_data_ptr[pos],
-           copy_bytes);
-    conn->in_packet.byte_counter += copy_bytes;
-    conn->in_packet.payload_pos += copy_bytes;
-    pos += copy_bytes;
-
-    uint8_t i;
-    PRINTF("MQTT - Copied bytes: \n");
-    for(i = 0; i < copy_bytes; i++) {
-      PRINTF("%02X ", conn->in_packet.payload[i]);
-    }
-    PRINTF("\n");
+  PRINTF("MQTT - Got topic '%s'\n", msg->topic);
 
-    /* Full buffer, shall only happen to PUBLISH messages. */
-    if(MQTT_INPUT_BUFF_SIZE - conn->in_packet.payload_pos == 0) {
-      conn->in_publish_msg.payload_chunk = conn->in_packet.payload;
-      conn->in_publish_msg.payload_chunk_length = MQTT_INPUT_BUFF_SIZE;
-      conn->in_publish_msg.payload_left -= MQTT_INPUT_BUFF_SIZE;
-
-      handle_publish(conn);
+  if(packet->fhdr & MQTT_FHDR_QOS_MASK) {
+    PRINTF("MQTT - Error, got incoming PUBLISH with QoS > 0, not supported atm!\n");
+  }
 
-      conn->in_publish_msg.payload_chunk = conn->in_packet.payload;
-      conn->in_packet.payload_pos = 0;
+  if(msg->payload_length == 0) {
+    handle_publish(conn, packet->payload, 0);
+  }
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Passes PUBLISH payload to the application. Payloads that fit the packet
+ * buffer are delivered in one piece, which only requires a copy if they are
+ * split over several TCP segments. Larger payloads are handed over directly
+ * from the TCP input buffer as they arrive. Returns the number of bytes
+ * consumed.
+ */
+static int
+parse_publish_payload(struct mqtt_connection *conn,
+                      const uint8_t *input_data_ptr,
+                      int input_data_len)
+{
+  struct mqtt_in_packet *packet = &conn->in_packet;
+  struct mqtt_message *msg = &conn->in_publish_msg;
+  uint16_t chunk_length;
+
+  chunk_length = MIN(input_data_len, msg->payload_left);
+  msg->payload_left -= chunk_length;
+  packet->byte_counter += chunk_length;
+
+  if(msg->payload_length <= MQTT_INPUT_BUFF_SIZE &&
+     (packet->payload_pos > 0 || msg->payload_left > 0)) {
+    memcpy(&packet->payload[packet->payload_pos], input_data_ptr,
+           chunk_length);
+    packet->payload_pos += chunk_length;
+    if(msg->payload_left == 0) {
+      handle_publish(conn, packet->payload, packet->payload_pos);
     }
-
-    if(pos >= input_data_len &&
-       (conn->in_packet.byte_counter < (MQTT_FHDR_SIZE + conn->in_packet.remaining_length))) {
-      return 0;
+  } else {
+    handle_publish(conn, input_data_ptr, chunk_length);
+  }
+  return chunk_length;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Decodes the fixed header in one go when it is contiguous in the input,
+ * which is the common case. Returns the number of bytes consumed, 0 if the
+ * header is split over several segments, or -1 if it is malformed.
+ */
+static int
+decode_fixed_header(struct mqtt_in_packet *packet,
+                    const uint8_t *input_data_ptr,
+                    int input_data_len)
+{
+  uint32_t remaining_length = 0;
+  int i;
+
+  for(i = 1; i < input_data_len && i <= MQTT_MAX_REMAINING_LENGTH_BYTES; i++) {
+    remaining_length |= (uint32_t)(input_data_ptr[i] & 0x7F) << (7 * (i - 1));
+    if((input_data_ptr[i] & 0x80) == 0) {
+      packet->fhdr = input_data_ptr[0];
+      packet->remaining_length = remaining_length;
+      packet->remaining_length_bytes = i;
+      packet->has_remaining_length = 1;
+      return i + 1;
     }
   }
-
-  /* Debug information */
-  PRINTF("\n");
-  /* Take care of input */
+  return i > MQTT_MAX_REMAINING_LENGTH_BYTES ? -1 : 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_packet(struct mqtt_connection *conn)
+{
   PRINTF("MQTT - Finished reading packet!\n");
-  /* What to return? */
-  PRINTF("MQTT - total data was %i bytes of data. \n",
-      (MQTT_FHDR_SIZE + conn->in_packet.remaining_length));
+  PRINTF("MQTT - total data was %lu bytes of data. \n",
+      (unsigned long)(MQTT_FHDR_SIZE + conn->in_packet.remaining_length_bytes +
+                      conn->in_packet.remaining_length));
 
-  /* Handle packet here. */
   switch(conn->in_packet.fhdr & 0xF0) {
   case MQTT_FHDR_MSG_TYPE_CONNACK:
     handle_connack(conn);
     break;
   case MQTT_FHDR_MSG_TYPE_PUBLISH:
-    /* This is the only or the last chunk of publish payload */
-    conn->in_publish_msg.payload_chunk = conn->in_packet.payload;
-    conn->in_publish_msg.payload_chunk_length = conn->in_packet.payload_pos;
-    conn->in_publish_msg.payload_left = 0;
-    handle_publish(conn);
+    /* The payload has already been handed over */
     break;
   case MQTT_FHDR_MSG_TYPE_PUBACK:
     handle_puback(conn);
@@ -1083,9 +1113,118 @@ tcp_input(struct tcp_socket *s,
     PRINTF("MQTT - Got MQTT Message Type '%i'", (conn->in_packet.fhdr & 0xF0));
     break;
   }
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Parses all packets in a chunk of TCP input. A packet may be split over any
+ * number of calls.
+ */
+static int
+tcp_input(struct tcp_socket *s,
+          void *ptr,
+          const uint8_t *input_data_ptr,
+          int input_data_len)
+{
+  struct mqtt_connection *conn = ptr;
+  struct mqtt_in_packet *packet = &conn->in_packet;
+  uint32_t copy_bytes;
+  int pos = 0;
+  int n;
+  uint8_t byte;
+
+  PRINTF("tcp_input with %i bytes of data:\n", input_data_len);
 
-  conn->in_packet.packet_received = 1;
+  while(pos < input_data_len) {
 
+    /* Read the fixed header and the Remaining Length field */
+    if(!packet->has_remaining_length) {
+      if(!packet->fhdr) {
+        n = decode_fixed_header(packet, &input_data_ptr[pos],
+                                input_data_len - pos);
+        if(n < 0) {
+          goto length_error;
+        }
+        if(n == 0) {
+          /* Split header, fall back to reading a byte at a time */
+          packet->fhdr = input_data_ptr[pos++];
+          packet->remaining_length_bytes = 0;
+        }
+        pos += n;
+      }
+      while(!packet->has_remaining_length && pos < input_data_len) {
+        byte = input_data_ptr[pos++];
+        if(packet->remaining_length_bytes == MQTT_MAX_REMAINING_LENGTH_BYTES) {
+          goto length_error;
+        }
+        packet->remaining_length |=
+          (uint32_t)(byte & 0x7F) << (7 * packet->remaining_length_bytes);
+        packet->remaining_length_bytes++;
+        packet->has_remaining_length = (byte & 0x80) == 0;
+      }
+      if(!packet->has_remaining_length) {
+        return 0;
+      }
+
+      PRINTF("MQTT - Read VHDR '%02X', remaining length %lu\n", packet->fhdr,
+             (unsigned long)packet->remaining_length);
+
+      /*
+       * Check for unsupported payload length. Will read all incoming data
+       * from the server in any case and then reset the packet.
+       *
+       * TODO: Decide if we, for example, want to disconnect instead.
+       */
+      if(packet->remaining_length > MQTT_INPUT_BUFF_SIZE &&
+         (packet->fhdr & 0xF0) != MQTT_FHDR_MSG_TYPE_PUBLISH) {
+        PRINTF("MQTT - Error, unsupported payload size for non-PUBLISH message\n");
+        packet->discard = 1;
+      }
+    }
+
+    /* Read the variable header and the payload */
+    if(packet->discard) {
+      copy_bytes = MIN(input_data_len - pos,
+                       packet->remaining_length - packet->byte_counter);
+      packet->byte_counter += copy_bytes;
+      pos += copy_bytes;
+    } else if((packet->fhdr & 0xF0) == MQTT_FHDR_MSG_TYPE_PUBLISH) {
+      if(!packet->topic_received) {
+        pos += parse_publish_vhdr(conn, &input_data_ptr[pos],
+                                  input_data_len - pos);
+      }
+      if(packet->topic_received && pos < input_data_len &&
+         conn->in_publish_msg.payload_left > 0) {
+        pos += parse_publish_payload(conn, &input_data_ptr[pos],
+                                     input_data_len - pos);
+      }
+    } else {
+      copy_bytes = MIN(input_data_len - pos,
+                       packet->remaining_length - packet->byte_counter);
+      memcpy(&packet->payload[packet->byte_counter], &input_data_ptr[pos],
+             copy_bytes);
+      packet->byte_counter += copy_bytes;
+      pos += copy_bytes;
+    }
+
+    if(packet->byte_counter == packet->remaining_length &&
+       (packet->topic_received ||
+        (packet->fhdr & 0xF0) != MQTT_FHDR_MSG_TYPE_PUBLISH ||
+        packet->discard)) {
+      if(!packet->discard) {
+        handle_packet(conn);
+      }
+      reset_packet(packet);
+    }
+  }
+
+  return 0;
+
+length_error:
+  call_event(conn, MQTT_EVENT_ERROR, NULL);
+  PRINTF("Received more then 4 byte 'remaining lenght'.");
+  /* The stream can not be resynchronised */
+  reset_packet(packet);
+  process_post(&mqtt_process, mqtt_abort_now_event, conn);
   return 0;
 }
 /*---------------------------------------------------------------------------*/
@@ -1240,7 +1379,7 @@ PROCESS_THREAD(mqtt_process, ev, data)
       conn = data;
       PRINTF("MQTT - Got mqtt_do_publish_mqtt_event!\n");
 
-      if(conn->out_buffer_sent == 1 &&
+      if(conn->out_queue_count > 0 &&
          conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
         PT_INIT(&conn->out_proto_thread);
         while(publish_pt(&conn->out_proto_thread, conn) < PT_EXITED &&
@@ -1248,6 +1387,14 @@ PROCESS_THREAD(mqtt_process, ev, data)
           PT_MQTT_WAIT_SEND();
         }
       }
+
+      /* The sender is idle again. Send what was queued during the last
+         write-out. */
+      conn->publish_active = 0;
+      if(conn->out_queue_count > 0 &&
+         conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
+        wake_publish(conn);
+      }
     }
   }
   PROCESS_END();
@@ -1367,7 +1514,7 @@ mqtt_subscribe(struct mqtt_connection *conn, uint16_t *mid, char *topic,
 
   PRINTF("MQTT - Call to mqtt_subscribe...\n");
 
-  /* Currently don't have a queue, so only one item at a time */
+  /* SUBSCRIBE and UNSUBSCRIBE share one packet, so only one at a time */
   if(conn->out_queue_full) {
     PRINTF("MQTT - Not accepted!\n");
     return MQTT_STATUS_OUT_QUEUE_FULL;
@@ -1393,7 +1540,7 @@ mqtt_unsubscribe(struct mqtt_connection *conn, uint16_t *mid, char *topic)
   }
 
   PRINTF("MQTT - Call to mqtt_unsubscribe...\n");
-  /* Currently don't have a queue, so only one item at a time */
+  /* SUBSCRIBE and UNSUBSCRIBE share one packet, so only one at a time */
   if(conn->out_queue_full) {
     PRINTF("MQTT - Not accepted!\n");
     return MQTT_STATUS_OUT_QUEUE_FULL;
@@ -1415,30 +1562,38 @@ mqtt_publish(struct mqtt_connection *conn, uint16_t *mid, char *topic,
              uint8_t *payload, uint32_t payload_size,
              mqtt_qos_level_t qos_level, mqtt_retain_t retain)
 {
+  struct mqtt_out_packet *packet;
+
   if(conn->state != MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
     return MQTT_STATUS_NOT_CONNECTED_ERROR;
   }
 
   PRINTF("MQTT - Call to mqtt_publish...\n");
 
-  /* Currently don't have a queue, so only one item at a time */
-  if(conn->out_queue_full) {
+  if(conn->out_queue_count >= MQTT_PUBLISH_QUEUE_SIZE) {
     PRINTF("MQTT - Not accepted!\n");
     return MQTT_STATUS_OUT_QUEUE_FULL;
   }
-  conn->out_queue_full = 1;
   PRINTF("MQTT - Accepted!\n");
 
-  conn->out_packet.mid = INCREMENT_MID(conn);
-  conn->out_packet.retain = retain;
-  conn->out_packet.topic = topic;
-  conn->out_packet.topic_length = strlen(topic);
-  conn->out_packet.payload = payload;
-  conn->out_packet.payload_size = payload_size;
-  conn->out_packet.qos = qos_level;
-  conn->out_packet.qos_state = MQTT_QOS_STATE_NO_ACK;
+  packet = &conn->out_queue[(conn->out_queue_head + conn->out_queue_count) %
+                            MQTT_PUBLISH_QUEUE_SIZE];
+  packet->mid = INCREMENT_MID(conn);
+  packet->retain = retain;
+  packet->topic = topic;
+  packet->topic_length = strlen(topic);
+  packet->payload = payload;
+  packet->payload_size = payload_size;
+  packet->qos = qos_level;
+  packet->qos_state = MQTT_QOS_STATE_NO_ACK;
+  if(mid != NULL) {
+    *mid = packet->mid;
+  }
+
+  conn->out_queue_count++;
 
-  process_post(&mqtt_process, mqtt_do_publish_event, conn);
+  /* A running publish_pt picks the message up */
+  wake_publish(conn);
   return MQTT_STATUS_OK;
 }
 /*----------------------------------------------------------------------------*/
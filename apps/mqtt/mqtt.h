@@ -108,6 +108,24 @@
 #define MQTT_TCP_INPUT_BUFF_SIZE 512
 #define MQTT_TCP_OUTPUT_BUFF_SIZE 512
 
+/*
+ * Number of PUBLISH messages that mqtt_publish() can queue. Queued messages
+ * are written back to back into the output buffer, so that several small
+ * PUBLISH packets share one TCP segment.
+ */
+#ifdef MQTT_CONF_PUBLISH_QUEUE_SIZE
+#define MQTT_PUBLISH_QUEUE_SIZE MQTT_CONF_PUBLISH_QUEUE_SIZE
+#else
+#define MQTT_PUBLISH_QUEUE_SIZE 4
+#endif
+
+/* Number of QoS 1 PUBLISH messages that may be waiting for their PUBACK */
+#ifdef MQTT_CONF_QOS1_WINDOW
+#define MQTT_QOS1_WINDOW MQTT_CONF_QOS1_WINDOW
+#else
+#define MQTT_QOS1_WINDOW 4
+#endif
+
 #define MQTT_INPUT_BUFF_SIZE 512
 #define MQTT_MAX_TOPIC_LENGTH 64
 #define MQTT_MAX_TOPICS_PER_SUBSCRIBE 1
@@ -151,6 +169,7 @@ typedef enum {
   MQTT_EVENT_UNSUBACK,
   MQTT_EVENT_PUBLISH,
   MQTT_EVENT_PUBACK,
+  MQTT_EVENT_PUBACK_TIMEOUT,
 
   /* Errors */
   MQTT_EVENT_ERROR = 0x80,
@@ -224,17 +243,29 @@ struct mqtt_suback_event {
   mqtt_qos_level_t qos_level;
 };
 
-/* This is the MQTT message that is exposed to the end user. */
+/*
+ * This is the MQTT message that is exposed to the end user.
+ *
+ * The payload is handed over in chunks. A payload of up to
+ * MQTT_INPUT_BUFF_SIZE bytes always arrives as a single chunk. Larger
+ * payloads are passed on as they arrive from TCP, and the chunks then point
+ * directly into the TCP input buffer: they are only valid during the
+ * MQTT_EVENT_PUBLISH callback. payload_length is the length of the whole
+ * payload and is known from the first chunk.
+ */
 struct mqtt_message {
   uint32_t mid;
   char topic[MQTT_MAX_TOPIC_LENGTH + 1]; /* +1 for string termination */
+  /* Length of the topic on the wire. Longer topics than
+   * MQTT_MAX_TOPIC_LENGTH are truncated in topic. */
+  uint16_t topic_length;
 
-  uint8_t *payload_chunk;
+  const uint8_t *payload_chunk;
   uint16_t payload_chunk_length;
 
   uint8_t first_chunk;
-  uint16_t payload_length;
-  uint16_t payload_left;
+  uint32_t payload_length;
+  uint32_t payload_left;
 };
 
 /* This struct represents a packet received from the MQTT server. */
@@ -242,31 +273,29 @@ struct mqtt_in_packet {
   /* Used by the list interface, must be first in the struct. */
   struct mqtt_connection *next;
 
-  /* Total bytes read so far. Compared to the remaining length to to decide when
-   * we've read the payload. */
+  /* Bytes read so far after the fixed header. Compared to the remaining
+   * length to decide when we've read the packet. */
   uint32_t byte_counter;
-  uint8_t packet_received;
+  uint8_t discard;
 
   uint8_t fhdr;
-  uint16_t remaining_length;
+  uint32_t remaining_length;
   uint16_t mid;
 
   /* Helper variables needed to decode the remaining_length */
-  uint8_t remaining_multiplier;
   uint8_t has_remaining_length;
   uint8_t remaining_length_bytes;
 
-  /* Not the same as payload in the MQTT sense, it also contains the variable
-   * header.
-   */
-  uint8_t payload_pos;
-  uint8_t payload[MQTT_INPUT_BUFF_SIZE];
-
   /* Message specific data */
   uint16_t topic_len;
   uint16_t topic_pos;
-  uint8_t topic_len_received;
   uint8_t topic_received;
+
+  /* Not the same as payload in the MQTT sense, it also contains the variable
+   * header. Kept last so that reset_packet() does not need to clear it.
+   */
+  uint16_t payload_pos;
+  uint8_t payload[MQTT_INPUT_BUFF_SIZE];
 };
 
 /* This struct represents a packet sent to the MQTT server. */
@@ -284,6 +313,11 @@ struct mqtt_out_packet {
   mqtt_qos_state_t qos_state;
   mqtt_retain_t retain;
 };
+/* A QoS 1 PUBLISH that has been sent and waits for its PUBACK. */
+struct mqtt_inflight {
+  uint16_t mid;
+  struct timer t;
+};
 /*---------------------------------------------------------------------------*/
 /**
  * \brief           MQTT event callback function
@@ -337,7 +371,7 @@ struct mqtt_connection {
   uint16_t mid_counter;
 
   /* Used for communication between MQTT API and APP */
-  uint8_t out_queue_full;
+  uint8_t out_queue_full; /* SUBSCRIBE or UNSUBSCRIBE pending */
   struct process *app_process;
 
   /* Outgoing data related */
@@ -345,6 +379,12 @@ struct mqtt_connection {
   uint8_t out_buffer[MQTT_TCP_OUTPUT_BUFF_SIZE];
   uint8_t out_buffer_sent;
   struct mqtt_out_packet out_packet;
+  struct mqtt_out_packet out_queue[MQTT_PUBLISH_QUEUE_SIZE];
+  uint8_t out_queue_head;
+  uint8_t out_queue_count;
+  uint8_t publish_active; /* publish_pt is running or about to run */
+  struct mqtt_inflight inflight[MQTT_QOS1_WINDOW];
+  uint8_t inflight_count;
   struct pt out_proto_thread;
   uint32_t out_write_pos;
   uint16_t max_segment_size;
@@ -450,7 +490,14 @@ mqtt_status_t mqtt_unsubscribe(struct mqtt_connection *conn,
  *        subscriptions match its topic name
  * \return MQTT_STATUS_OK or some error status
  *
- * This function publishes to a topic on a MQTT broker.
+ * This function queues a PUBLISH message for a topic on a MQTT broker and
+ * returns MQTT_STATUS_OUT_QUEUE_FULL if MQTT_PUBLISH_QUEUE_SIZE messages are
+ * already waiting. The topic and the payload are not copied and must remain
+ * valid until the message has been sent, which is signalled to the app
+ * process with mqtt_update_event (QoS 0) or MQTT_EVENT_PUBACK (QoS 1). If
+ * no PUBACK arrives in time, the message is given up and the app gets
+ * MQTT_EVENT_PUBACK_TIMEOUT instead. For both events, data points to the
+ * message ID.
  */
 mqtt_status_t mqtt_publish(struct mqtt_connection *conn,
                            uint16_t *mid,
@@ -498,8 +545,10 @@ void mqtt_set_last_will(struct mqtt_connection *conn,
 #define mqtt_connected(conn) \
   ((conn)->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER ? 1 : 0)
 
+/* Connected, and mqtt_publish() has room to queue a message */
 #define mqtt_ready(conn) \
-  (!(conn)->out_queue_full && mqtt_connected((conn)))
+  ((conn)->out_queue_count < MQTT_PUBLISH_QUEUE_SIZE && \
+   mqtt_connected((conn)))
 /*---------------------------------------------------------------------------*/
 #endif /* MQTT_H_ */
 /*---------------------------------------------------------------------------*/
@@ -79,12 +79,47 @@
 #define MAX_OBJECTS 10
 #endif /* LWM2M_ENGINE_CONF_MAX_OBJECTS */
 
+/*
+ * With LWM2M_ENGINE_CONF_INDEX_SIZE set, each registered object gets a
+ * slice of a pool of that many bytes for sorted instance and resource
+ * indexes, so that they are found with binary searches. Objects that do
+ * not fit are searched linearly. An instance that is not found through
+ * the index is also searched linearly, so instances created or deleted
+ * by the application are still found before it calls
+ * lwm2m_engine_update_instances().
+ */
+#ifdef LWM2M_ENGINE_CONF_INDEX_SIZE
+#define INDEX_SIZE LWM2M_ENGINE_CONF_INDEX_SIZE
+#else /* LWM2M_ENGINE_CONF_INDEX_SIZE */
+#define INDEX_SIZE 0
+#endif /* LWM2M_ENGINE_CONF_INDEX_SIZE */
+
 #define REMOTE_PORT        UIP_HTONS(COAP_DEFAULT_PORT)
 #define BS_REMOTE_PORT     UIP_HTONS(5685)
 
+/* The registered objects, sorted by id */
 static const lwm2m_object_t *objects[MAX_OBJECTS];
+static uint8_t object_count;
 static char endpoint[32];
 static char rd_data[128]; /* allocate some data for the RD */
+static int rd_data_len = -1; /* -1 when rd_data must be generated again */
+
+#if INDEX_SIZE
+struct object_index {
+  /* Slots of the used instances, sorted by instance id */
+  uint8_t *instances;
+  uint8_t instance_count;
+  uint8_t instance_slots;
+  /* Order of these resources by resource id. Instances with other
+     resources are searched linearly. */
+  const lwm2m_resource_t *resources;
+  uint16_t resource_count;
+  uint8_t *resource_order;
+};
+static struct object_index object_index[MAX_OBJECTS];
+static uint8_t index_pool[INDEX_SIZE];
+static uint16_t index_pool_used;
+#endif /* INDEX_SIZE */
 
 PROCESS(lwm2m_rd_client, "LWM2M Engine");
 
@@ -245,6 +280,34 @@ update_bootstrap_server(void)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+/* The registration payload only changes with the set of object instances */
+static int
+get_rd_data(void)
+{
+  int pos;
+  int len, i, j;
+
+  if(rd_data_len >= 0) {
+    return rd_data_len;
+  }
+
+  pos = 0;
+  for(i = 0; i < object_count; i++) {
+    for(j = 0; j < objects[i]->count; j++) {
+      if(objects[i]->instances[j].flag & LWM2M_INSTANCE_FLAG_USED) {
+        len = snprintf(&rd_data[pos], sizeof(rd_data) - pos,
+                       "%s<%d/%d>", pos > 0 ? "," : "",
+                       objects[i]->id, objects[i]->instances[j].id);
+        if(len > 0 && len < sizeof(rd_data) - pos) {
+          pos += len;
+        }
+      }
+    }
+  }
+  rd_data_len = pos;
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
 PROCESS_THREAD(lwm2m_rd_client, ev, data)
 {
   static coap_packet_t request[1];      /* This way the packet can be treated as pointer as usual. */
@@ -346,7 +409,6 @@ PROCESS_THREAD(lwm2m_rd_client, ev, data)
       } else if(use_registration && !registered &&
                 update_registration_server()) {
         int pos;
-        int len, i, j;
         registered = 1;
 
         /* prepare request, TID is set by COAP_BLOCKING_REQUEST() */
@@ -354,23 +416,7 @@ PROCESS_THREAD(lwm2m_rd_client, ev, data)
         coap_set_header_uri_path(request, "/rd");
         coap_set_header_uri_query(request, endpoint);
 
-        /* generate the rd data */
-        pos = 0;
-        for(i = 0; i < MAX_OBJECTS; i++) {
-          if(objects[i] != NULL) {
-            for(j = 0; j < objects[i]->count; j++) {
-              if(objects[i]->instances[j].flag & LWM2M_INSTANCE_FLAG_USED) {
-                len = snprintf(&rd_data[pos], sizeof(rd_data) - pos,
-                               "%s<%d/%d>", pos > 0 ? "," : "",
-                               objects[i]->id, objects[i]->instances[j].id);
-                if(len > 0 && len < sizeof(rd_data) - pos) {
-                  pos += len;
-                }
-              }
-            }
-          }
-        }
-
+        pos = get_rd_data();
         coap_set_payload(request, (uint8_t *)rd_data, pos);
 
         printf("Registering with [");
@@ -479,13 +525,29 @@ lwm2m_engine_parse_context(const lwm2m_object_t *object,
                            lwm2m_context_t *context)
 {
   int ret;
+  int len;
   if(context == NULL || object == NULL || path == NULL) {
     return 0;
   }
   memset(context, 0, sizeof(lwm2m_context_t));
   /* get object id */
   ret = 0;
-  ret += parse_next(&path, &path_len, &context->object_id);
+  len = strlen(object->path);
+  if(path_len >= len && strncmp(path, object->path, len) == 0 &&
+     (path_len == len || path[len] == '/')) {
+    /* The REST engine has already matched the object path */
+    context->object_id = object->id;
+    path += len;
+    path_len -= len;
+    if(path_len > 0) {
+      /* Skip the '/' */
+      path++;
+      path_len--;
+    }
+    ret = 1;
+  } else {
+    ret += parse_next(&path, &path_len, &context->object_id);
+  }
   ret += parse_next(&path, &path_len, &context->object_instance_id);
   ret += parse_next(&path, &path_len, &context->resource_id);
 
@@ -496,35 +558,168 @@ lwm2m_engine_parse_context(const lwm2m_object_t *object,
   return ret;
 }
 /*---------------------------------------------------------------------------*/
+/* Returns the position of the first object with an id not less than id */
+static int
+object_position(uint16_t id)
+{
+  int low, high, mid;
+
+  low = 0;
+  high = object_count;
+  while(low < high) {
+    mid = (low + high) / 2;
+    if(objects[mid]->id < id) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+/*---------------------------------------------------------------------------*/
 const lwm2m_object_t *
 lwm2m_engine_get_object(uint16_t id)
 {
   int i;
-  for(i = 0; i < MAX_OBJECTS; i++) {
-    if(objects[i] != NULL && objects[i]->id == id) {
-      return objects[i];
+
+  i = object_position(id);
+  if(i < object_count && objects[i]->id == id) {
+    return objects[i];
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+#if INDEX_SIZE
+static struct object_index *
+get_object_index(const lwm2m_object_t *object)
+{
+  int i;
+
+  for(i = object_position(object->id);
+      i < object_count && objects[i]->id == object->id; i++) {
+    if(objects[i] == object) {
+      return object_index[i].instances != NULL ? &object_index[i] : NULL;
     }
   }
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+/* Inserts instance slot i into the sorted index */
+static void
+index_add_instance(struct object_index *index, const lwm2m_object_t *object,
+                   int i)
+{
+  int j;
+
+  if(i >= index->instance_slots) {
+    /* The object has grown since it was registered */
+    return;
+  }
+  /* After the instances with the same id, as a linear search finds the
+     first slot */
+  for(j = index->instance_count;
+      j > 0 && (object->instances[index->instances[j - 1]].id >
+                object->instances[i].id ||
+                (object->instances[index->instances[j - 1]].id ==
+                 object->instances[i].id && index->instances[j - 1] > i));
+      j--) {
+    index->instances[j] = index->instances[j - 1];
+  }
+  index->instances[j] = i;
+  index->instance_count++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_instances(struct object_index *index, const lwm2m_object_t *object)
+{
+  int i;
+
+  index->instance_count = 0;
+  for(i = 0; i < object->count; i++) {
+    if(object->instances[i].flag & LWM2M_INSTANCE_FLAG_USED) {
+      index_add_instance(index, object, i);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_object(struct object_index *index, const lwm2m_object_t *object)
+{
+  const lwm2m_resource_t *resources;
+  int i, j, count;
+
+  memset(index, 0, sizeof(struct object_index));
+  if(object->count == 0 || object->count > 255) {
+    return;
+  }
+
+  resources = object->instances[0].resources;
+  count = object->instances[0].count;
+  if(count > 256 || index_pool_used + object->count + count > INDEX_SIZE) {
+    PRINTF("lwm2m: no index for object %u\n", object->id);
+    return;
+  }
+
+  index->instances = &index_pool[index_pool_used];
+  index->instance_slots = object->count;
+  index_pool_used += object->count;
+  index_instances(index, object);
+
+  index->resources = resources;
+  index->resource_count = count;
+  index->resource_order = &index_pool[index_pool_used];
+  index_pool_used += count;
+  for(i = 0; i < count; i++) {
+    /* Stable insertion, so that the first of equal ids is found */
+    for(j = i; j > 0 &&
+          resources[index->resource_order[j - 1]].id > resources[i].id; j--) {
+      index->resource_order[j] = index->resource_order[j - 1];
+    }
+    index->resource_order[j] = i;
+  }
+}
+#endif /* INDEX_SIZE */
+/*---------------------------------------------------------------------------*/
 int
 lwm2m_engine_register_object(const lwm2m_object_t *object)
 {
   int i;
   int found = 0;
-  for(i = 0; i < MAX_OBJECTS; i++) {
-    if(objects[i] == NULL) {
-      objects[i] = object;
-      found = 1;
-      break;
-    }
+
+  if(object_count < MAX_OBJECTS) {
+    /* Keep the objects sorted by id, after any object with the same id */
+    i = object->id == 0xffff ? object_count : object_position(object->id + 1);
+    memmove(&objects[i + 1], &objects[i],
+            (object_count - i) * sizeof(objects[0]));
+#if INDEX_SIZE
+    memmove(&object_index[i + 1], &object_index[i],
+            (object_count - i) * sizeof(object_index[0]));
+    index_object(&object_index[i], object);
+#endif /* INDEX_SIZE */
+    objects[i] = object;
+    object_count++;
+    rd_data_len = -1;
+    found = 1;
   }
   rest_activate_resource(lwm2m_object_get_coap_resource(object),
                          (char *)object->path);
   return found;
 }
 /*---------------------------------------------------------------------------*/
+void
+lwm2m_engine_update_instances(const lwm2m_object_t *object)
+{
+#if INDEX_SIZE
+  struct object_index *index;
+
+  index = get_object_index(object);
+  if(index != NULL) {
+    index_instances(index, object);
+  }
+#endif /* INDEX_SIZE */
+  rd_data_len = -1;
+}
+/*---------------------------------------------------------------------------*/
 static const lwm2m_instance_t *
 get_first_instance_of_object(uint16_t id, lwm2m_context_t *context)
 {
@@ -555,8 +750,39 @@ static const lwm2m_instance_t *
 get_instance(const lwm2m_object_t *object, lwm2m_context_t *context, int depth)
 {
   int i;
+#if INDEX_SIZE
+  struct object_index *index;
+  int low, high, mid;
+#endif /* INDEX_SIZE */
+
   if(depth > 1) {
     PRINTF("lwm2m: searching for instance %u\n", context->object_instance_id);
+#if INDEX_SIZE
+    index = get_object_index(object);
+    if(index != NULL) {
+      low = 0;
+      high = index->instance_count;
+      while(low < high) {
+        mid = (low + high) / 2;
+        if(object->instances[index->instances[mid]].id <
+           context->object_instance_id) {
+          low = mid + 1;
+        } else {
+          high = mid;
+        }
+      }
+      if(low < index->instance_count &&
+         object->instances[index->instances[low]].id ==
+         context->object_instance_id &&
+         object->instances[index->instances[low]].flag &
+         LWM2M_INSTANCE_FLAG_USED) {
+        i = index->instances[low];
+        context->object_instance_index = i;
+        return &object->instances[i];
+      }
+      /* Changed by the application: search linearly */
+    }
+#endif /* INDEX_SIZE */
     for(i = 0; i < object->count; i++) {
       PRINTF("  Instance %d -> %u (used: %d)\n", i, object->instances[i].id,
              (object->instances[i].flag & LWM2M_INSTANCE_FLAG_USED) != 0);
@@ -574,8 +800,40 @@ static const lwm2m_resource_t *
 get_resource(const lwm2m_instance_t *instance, lwm2m_context_t *context)
 {
   int i;
+#if INDEX_SIZE
+  const lwm2m_object_t *object;
+  struct object_index *index;
+  int low, high, mid;
+#endif /* INDEX_SIZE */
+
   if(instance != NULL) {
     PRINTF("lwm2m: searching for resource %u\n", context->resource_id);
+#if INDEX_SIZE
+    object = lwm2m_engine_get_object(context->object_id);
+    index = object != NULL ? get_object_index(object) : NULL;
+    if(index != NULL && index->resources == instance->resources &&
+       index->resource_count == instance->count) {
+      low = 0;
+      high = index->resource_count;
+      while(low < high) {
+        mid = (low + high) / 2;
+        if(instance->resources[index->resource_order[mid]].id <
+           context->resource_id) {
+          low = mid + 1;
+        } else {
+          high = mid;
+        }
+      }
+      if(low < index->resource_count &&
+         instance->resources[index->resource_order[low]].id ==
+         context->resource_id) {
+        i = index->resource_order[low];
+        context->resource_index = i;
+        return &instance->resources[i];
+      }
+      return NULL;
+    }
+#endif /* INDEX_SIZE */
     for(i = 0; i < instance->count; i++) {
       PRINTF("  Resource %d -> %u\n", i, instance->resources[i].id);
       if(instance->resources[i].id == context->resource_id) {
@@ -593,7 +851,7 @@ write_rd_link_data(const lwm2m_object_t *object,
                    char *buffer, size_t size)
 {
   const lwm2m_resource_t *resource;
-  int len, rdlen, i;
+  int len, rdlen, plen, i;
 
   PRINTF("<%d/%d>", object->id, instance->id);
   rdlen = snprintf(buffer, size, "<%d/%d>",
@@ -602,12 +860,20 @@ write_rd_link_data(const lwm2m_object_t *object,
     return -1;
   }
 
+  /* Every resource link starts with the "<object/instance" prefix that
+     has just been written */
+  plen = rdlen - 1;
   for(i = 0; i < instance->count; i++) {
     resource = &instance->resources[i];
     PRINTF(",<%d/%d/%d>", object->id, instance->id, resource->id);
 
-    len = snprintf(&buffer[rdlen], size - rdlen,
-                   ",<%d/%d/%d>", object->id, instance->id, resource->id);
+    if(rdlen + 1 + plen >= size) {
+      return -1;
+    }
+    buffer[rdlen++] = ',';
+    memcpy(&buffer[rdlen], buffer, plen);
+    rdlen += plen;
+    len = snprintf(&buffer[rdlen], size - rdlen, "/%d>", resource->id);
     rdlen += len;
     if(len < 0 || rdlen >= size) {
       return -1;
@@ -854,6 +1120,7 @@ lwm2m_engine_handler(const lwm2m_object_t *object,
           object->instances[i].flag |= LWM2M_INSTANCE_FLAG_USED;
           object->instances[i].id = context.object_instance_id;
           context.object_instance_index = i;
+          lwm2m_engine_update_instances(object);
           PRINTF("Created instance: %d\n", context.object_instance_id);
           REST.set_response_status(response, CREATED_2_01);
           instance = &object->instances[i];
@@ -68,6 +68,10 @@ const lwm2m_object_t *lwm2m_engine_get_object(uint16_t id);
 
 int lwm2m_engine_register_object(const lwm2m_object_t *object);
 
+/* To be called after instances of a registered object are created,
+   deleted or given new ids other than by a POST to the engine */
+void lwm2m_engine_update_instances(const lwm2m_object_t *object);
+
 void lwm2m_engine_handler(const lwm2m_object_t *object,
                           void *request, void *response,
                           uint8_t *buffer, uint16_t preferred_size,
@@ -59,6 +59,67 @@ PROCESS(rest_engine_process, "REST Engine");
 LIST(restful_services);
 LIST(restful_periodic_services);
 /*---------------------------------------------------------------------------*/
+#if REST_ENGINE_INDEX_SIZE
+#if REST_ENGINE_INDEX_SIZE & (REST_ENGINE_INDEX_SIZE - 1)
+#error "REST_ENGINE_CONF_INDEX_SIZE must be a power of two"
+#endif
+
+/* Open addressing with linear probing, keyed by the full resource URL. */
+static resource_t *resource_index[REST_ENGINE_INDEX_SIZE];
+static unsigned int index_count;
+/* Cleared when a resource did not fit, so that lookups scan the list. */
+static uint8_t index_complete = 1;
+/*---------------------------------------------------------------------------*/
+static unsigned int
+url_hash(const char *url, int len)
+{
+  unsigned int hash = 5381;
+
+  while(len-- > 0) {
+    hash = (hash << 5) + hash + (uint8_t)*url++;
+  }
+  return hash;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_insert(resource_t *resource)
+{
+  unsigned int i;
+
+  if(index_count >= REST_ENGINE_INDEX_SIZE * 3 / 4) {
+    PRINTF("Resource index full, falling back to list scans\n");
+    index_complete = 0;
+    return;
+  }
+
+  for(i = url_hash(resource->url, strlen(resource->url))
+        & (REST_ENGINE_INDEX_SIZE - 1);
+      resource_index[i] != NULL;
+      i = (i + 1) & (REST_ENGINE_INDEX_SIZE - 1));
+  /* Resources sharing a URL keep their activation order along the probe
+     sequence, so lookups pick the same one as a scan of the list. */
+  resource_index[i] = resource;
+  index_count++;
+}
+/*---------------------------------------------------------------------------*/
+static resource_t *
+index_find(const char *url, int len, rest_resource_flags_t flags)
+{
+  unsigned int i;
+  resource_t *resource;
+
+  for(i = url_hash(url, len) & (REST_ENGINE_INDEX_SIZE - 1);
+      (resource = resource_index[i]) != NULL;
+      i = (i + 1) & (REST_ENGINE_INDEX_SIZE - 1)) {
+    if((resource->flags & flags) == flags
+       && strncmp(resource->url, url, len) == 0 && resource->url[len] == '\0') {
+      return resource;
+    }
+  }
+  return NULL;
+}
+#endif /* REST_ENGINE_INDEX_SIZE */
+/*---------------------------------------------------------------------------*/
 /*- REST Engine API ---------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
 /**
@@ -104,6 +165,9 @@ rest_activate_resource(resource_t *resource, char *path)
 {
   resource->url = path;
   list_add(restful_services, resource);
+#if REST_ENGINE_INDEX_SIZE
+  index_insert(resource);
+#endif /* REST_ENGINE_INDEX_SIZE */
 
   PRINTF("Activating: %s\n", resource->url);
 
@@ -124,6 +188,58 @@ rest_get_resources(void)
   return restful_services;
 }
 /*---------------------------------------------------------------------------*/
+resource_t *
+rest_find_resource(const char *url, int url_len)
+{
+  resource_t *resource;
+  resource_t *best = NULL;
+  int res_url_len;
+  int best_len = -1;
+
+#if REST_ENGINE_INDEX_SIZE
+  if(index_complete) {
+    int len = url_len;
+
+    resource = index_find(url, len, NO_FLAGS);
+    if(resource != NULL) {
+      return resource;
+    }
+    /* Try the parent paths, longest first. */
+    while(len > 0) {
+      do {
+        --len;
+      } while(len > 0 && url[len] != '/');
+      if(len == 0) {
+        break;
+      }
+      resource = index_find(url, len, HAS_SUB_RESOURCES);
+      if(resource != NULL) {
+        return resource;
+      }
+    }
+    return NULL;
+  }
+#endif /* REST_ENGINE_INDEX_SIZE */
+
+  for(resource = (resource_t *)list_head(restful_services);
+      resource; resource = resource->next) {
+    res_url_len = strlen(resource->url);
+    if(res_url_len > best_len
+       && (url_len == res_url_len
+           || (url_len > res_url_len
+               && (resource->flags & HAS_SUB_RESOURCES)
+               && url[res_url_len] == '/'))
+       && strncmp(resource->url, url, res_url_len) == 0) {
+      best = resource;
+      best_len = res_url_len;
+      if(res_url_len == url_len) {
+        break;
+      }
+    }
+  }
+  return best;
+}
+/*---------------------------------------------------------------------------*/
 int
 rest_invoke_restful_service(void *request, void *response, uint8_t *buffer,
                             uint16_t buffer_size, int32_t *offset)
@@ -133,44 +249,34 @@ rest_invoke_restful_service(void *request, void *response, uint8_t *buffer,
 
   resource_t *resource = NULL;
   const char *url = NULL;
-  int url_len, res_url_len;
+  int url_len;
 
   url_len = REST.get_url(request, &url);
-  for(resource = (resource_t *)list_head(restful_services);
-      resource; resource = resource->next) {
+  resource = rest_find_resource(url, url_len);
+  if(resource != NULL) {
+    found = 1;
+    rest_resource_flags_t method = REST.get_method_type(request);
 
-    /* if the web service handles that kind of requests and urls matches */
-    res_url_len = strlen(resource->url);
-    if((url_len == res_url_len
-        || (url_len > res_url_len
-            && (resource->flags & HAS_SUB_RESOURCES)
-            && url[res_url_len] == '/'))
-       && strncmp(resource->url, url, res_url_len) == 0) {
-      found = 1;
-      rest_resource_flags_t method = REST.get_method_type(request);
-
-      PRINTF("/%s, method %u, resource->flags %u\n", resource->url,
-             (uint16_t)method, resource->flags);
-
-      if((method & METHOD_GET) && resource->get_handler != NULL) {
-        /* call handler function */
-        resource->get_handler(request, response, buffer, buffer_size, offset);
-      } else if((method & METHOD_POST) && resource->post_handler != NULL) {
-        /* call handler function */
-        resource->post_handler(request, response, buffer, buffer_size,
+    PRINTF("/%s, method %u, resource->flags %u\n", resource->url,
+           (uint16_t)method, resource->flags);
+
+    if((method & METHOD_GET) && resource->get_handler != NULL) {
+      /* call handler function */
+      resource->get_handler(request, response, buffer, buffer_size, offset);
+    } else if((method & METHOD_POST) && resource->post_handler != NULL) {
+      /* call handler function */
+      resource->post_handler(request, response, buffer, buffer_size,
+                             offset);
+    } else if((method & METHOD_PUT) && resource->put_handler != NULL) {
+      /* call handler function */
+      resource->put_handler(request, response, buffer, buffer_size, offset);
+    } else if((method & METHOD_DELETE) && resource->delete_handler != NULL) {
+      /* call handler function */
+      resource->delete_handler(request, response, buffer, buffer_size,
                                offset);
-      } else if((method & METHOD_PUT) && resource->put_handler != NULL) {
-        /* call handler function */
-        resource->put_handler(request, response, buffer, buffer_size, offset);
-      } else if((method & METHOD_DELETE) && resource->delete_handler != NULL) {
-        /* call handler function */
-        resource->delete_handler(request, response, buffer, buffer_size,
-                                 offset);
-      } else {
-        allowed = 0;
-        REST.set_response_status(response, REST.status.METHOD_NOT_ALLOWED);
-      }
-      break;
+    } else {
+      allowed = 0;
+      REST.set_response_status(response, REST.status.METHOD_NOT_ALLOWED);
     }
   }
   if(!found) {
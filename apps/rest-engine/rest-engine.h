@@ -62,6 +62,16 @@
 #define REST_MAX_CHUNK_SIZE     64
 #endif
 
+/*
+ * Number of slots (a power of two) in the hash index over resource URLs.
+ * Without the index, every request scans the list of resources.
+ */
+#ifdef REST_ENGINE_CONF_INDEX_SIZE
+#define REST_ENGINE_INDEX_SIZE REST_ENGINE_CONF_INDEX_SIZE
+#else
+#define REST_ENGINE_INDEX_SIZE 0
+#endif
+
 struct resource_s;
 struct periodic_resource_s;
 
@@ -254,5 +264,17 @@ void rest_activate_resource(resource_t *resource, char *path);
  */
 list_t rest_get_resources(void);
 /*---------------------------------------------------------------------------*/
+/**
+ * \brief      Finds the resource that handles a URI path.
+ * \param url
+ *             The URI path, not necessarily null-terminated.
+ * \param url_len
+ *             The length of the URI path.
+ * \return     The resource with exactly this path or, failing that, the
+ *             resource with HAS_SUB_RESOURCES and the longest path that is
+ *             a prefix of it. NULL if there is none.
+ */
+resource_t *rest_find_resource(const char *url, int url_len);
+/*---------------------------------------------------------------------------*/
 
 #endif /*REST_ENGINE_H_ */
@@ -90,6 +90,27 @@
 #define COFFEE_EXTENDED_WEAR_LEVELLING  1
 #endif
 
+/*
+ * Keep an index of all files in RAM, mapping a hash of the file name
+ * to the first page of the file and caching the file end. The index
+ * is built at the first file lookup and lets Coffee open files that
+ * are not cached in coffee_files without scanning the storage. The
+ * value is the number of index slots; the index covers at most three
+ * quarters of this number of files before lookups of unknown names
+ * fall back to scanning the storage.
+ */
+#ifndef COFFEE_INDEX_SIZE
+#define COFFEE_INDEX_SIZE 0
+#endif
+
+/*
+ * Ports whose storage is mapped into memory, holding the same bits
+ * that COFFEE_READ would return, can define COFFEE_MAP(offset) to
+ * return a pointer to the byte at that storage offset. Coffee then
+ * scans file extents in place, and cfs_coffee_map() can return
+ * pointers to file data.
+ */
+
 #if COFFEE_START & (COFFEE_SECTOR_SIZE - 1)
 #error COFFEE_START must point to the first byte in a sector.
 #endif
@@ -169,6 +190,9 @@ struct file {
   int16_t record_count;
   uint8_t references;
   uint8_t flags;
+#if COFFEE_INDEX_SIZE > 0
+  uint16_t name_hash;
+#endif
 };
 
 /* The file descriptor structure. */
@@ -193,6 +217,19 @@ struct file_header {
   char name[COFFEE_NAME_LENGTH];
 };
 
+#if COFFEE_INDEX_SIZE > 0
+/* An entry of the in-RAM file index. */
+struct index_entry {
+  cfs_offset_t end;
+  coffee_page_t page;
+  uint16_t name_hash;
+};
+
+#define INDEX_NONE     0 /* The index has not been built yet. */
+#define INDEX_PARTIAL  1 /* Some files did not fit in the index. */
+#define INDEX_COMPLETE 2 /* All files are in the index. */
+#endif /* COFFEE_INDEX_SIZE > 0 */
+
 /* This is needed because of a buggy compiler. */
 struct log_param {
   cfs_offset_t offset;
@@ -208,6 +245,11 @@ static struct file coffee_files[COFFEE_MAX_OPEN_FILES];
 static struct file_desc coffee_fd_set[COFFEE_FD_SET_SIZE];
 static coffee_page_t next_free;
 static char gc_wait;
+#if COFFEE_INDEX_SIZE > 0
+static struct index_entry coffee_index[COFFEE_INDEX_SIZE];
+static uint16_t index_count;
+static uint8_t index_state;
+#endif
 
 /*---------------------------------------------------------------------------*/
 static void
@@ -418,6 +460,143 @@ next_file(coffee_page_t page, struct file_header *hdr)
   return page + hdr->max_pages;
 }
 /*---------------------------------------------------------------------------*/
+#if COFFEE_INDEX_SIZE > 0
+static uint16_t
+name_hash(const char *name)
+{
+  uint16_t hash;
+  int i;
+
+  /* Only hash the part of the name that is stored in file headers. */
+  hash = 5381;
+  for(i = 0; i < COFFEE_NAME_LENGTH - 1 && name[i] != '\0'; i++) {
+    hash = hash * 33 + (unsigned char)name[i];
+  }
+  return hash;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_reset(void)
+{
+  int i;
+
+  for(i = 0; i < COFFEE_INDEX_SIZE; i++) {
+    coffee_index[i].page = INVALID_PAGE;
+  }
+  index_count = 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+index_find(coffee_page_t page, uint16_t hash)
+{
+  int slot;
+
+  if(index_state == INDEX_NONE) {
+    return -1;
+  }
+
+  for(slot = hash % COFFEE_INDEX_SIZE;
+      coffee_index[slot].page != INVALID_PAGE;
+      slot = (slot + 1) % COFFEE_INDEX_SIZE) {
+    if(coffee_index[slot].page == page) {
+      return slot;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_insert(coffee_page_t page, uint16_t hash)
+{
+  int slot;
+
+  if(index_state == INDEX_NONE) {
+    /* The file will be found when the index is built. */
+    return;
+  }
+
+  if(index_count >= COFFEE_INDEX_SIZE * 3 / 4) {
+    index_state = INDEX_PARTIAL;
+    return;
+  }
+
+  for(slot = hash % COFFEE_INDEX_SIZE;
+      coffee_index[slot].page != INVALID_PAGE;
+      slot = (slot + 1) % COFFEE_INDEX_SIZE);
+  coffee_index[slot].page = page;
+  coffee_index[slot].name_hash = hash;
+  coffee_index[slot].end = UNKNOWN_OFFSET;
+  index_count++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_remove(coffee_page_t page, uint16_t hash)
+{
+  int hole, slot, home;
+
+  if(index_state == INDEX_PARTIAL) {
+    /* Rebuild the index at the next lookup, as the files that
+       did not fit before may fit now. */
+    index_state = INDEX_NONE;
+    return;
+  }
+
+  hole = index_find(page, hash);
+  if(hole < 0) {
+    return;
+  }
+
+  /* Shift back the following entries of the probe sequence instead
+     of leaving a deleted marker. */
+  slot = hole;
+  for(;;) {
+    slot = (slot + 1) % COFFEE_INDEX_SIZE;
+    if(coffee_index[slot].page == INVALID_PAGE) {
+      break;
+    }
+    home = coffee_index[slot].name_hash % COFFEE_INDEX_SIZE;
+    if((hole <= slot) ? (home <= hole || home > slot)
+                      : (home <= hole && home > slot)) {
+      coffee_index[hole] = coffee_index[slot];
+      hole = slot;
+    }
+  }
+  coffee_index[hole].page = INVALID_PAGE;
+  index_count--;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_build(void)
+{
+  struct file_header hdr;
+  coffee_page_t page;
+
+  PRINTF("Coffee: Building the file index\n");
+
+  index_reset();
+  index_state = INDEX_COMPLETE;
+  for(page = 0; page < COFFEE_PAGE_COUNT; page = next_file(page, &hdr)) {
+    read_header(&hdr, page);
+    if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr)) {
+      index_insert(page, name_hash(hdr.name));
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_save_end(struct file *file)
+{
+  int slot;
+
+  if(file->end != UNKNOWN_OFFSET) {
+    slot = index_find(file->page, file->name_hash);
+    if(slot >= 0) {
+      coffee_index[slot].end = file->end;
+    }
+  }
+}
+#endif /* COFFEE_INDEX_SIZE > 0 */
+/*---------------------------------------------------------------------------*/
 static struct file *
 load_file(coffee_page_t start, struct file_header *hdr)
 {
@@ -441,6 +620,10 @@ load_file(coffee_page_t start, struct file_header *hdr)
   if(free == -1) {
     if(unreferenced != -1) {
       i = unreferenced;
+#if COFFEE_INDEX_SIZE > 0
+      /* Keep the end of the evicted file for its next load. */
+      index_save_end(&coffee_files[i]);
+#endif
     } else {
       return NULL;
     }
@@ -449,6 +632,13 @@ load_file(coffee_page_t start, struct file_header *hdr)
   file = &coffee_files[i];
   file->page = start;
   file->end = UNKNOWN_OFFSET;
+#if COFFEE_INDEX_SIZE > 0
+  file->name_hash = name_hash(hdr->name);
+  i = index_find(start, file->name_hash);
+  if(i >= 0) {
+    file->end = coffee_index[i].end;
+  }
+#endif
   file->max_pages = hdr->max_pages;
   file->flags = 0;
   if(HDR_MODIFIED(*hdr)) {
@@ -466,6 +656,38 @@ find_file(const char *name)
   int i;
   struct file_header hdr;
   coffee_page_t page;
+#if COFFEE_INDEX_SIZE > 0
+  uint16_t hash;
+
+  if(index_state == INDEX_NONE) {
+    index_build();
+  }
+
+  /* Look up the file in the index, and check the name in the file
+     header only when the name hashes match. */
+  hash = name_hash(name);
+  for(i = hash % COFFEE_INDEX_SIZE;
+      coffee_index[i].page != INVALID_PAGE;
+      i = (i + 1) % COFFEE_INDEX_SIZE) {
+    if(coffee_index[i].name_hash != hash) {
+      continue;
+    }
+    page = coffee_index[i].page;
+    read_header(&hdr, page);
+    if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr) && strcmp(name, hdr.name) == 0) {
+      for(i = 0; i < COFFEE_MAX_OPEN_FILES; i++) {
+        if(!FILE_FREE(&coffee_files[i]) && coffee_files[i].page == page) {
+          return &coffee_files[i];
+        }
+      }
+      return load_file(page, &hdr);
+    }
+  }
+
+  if(index_state == INDEX_COMPLETE) {
+    return NULL;
+  }
+#endif /* COFFEE_INDEX_SIZE > 0 */
 
   /* First check if the file metadata is cached. */
   for(i = 0; i < COFFEE_MAX_OPEN_FILES; i++) {
@@ -490,12 +712,37 @@ find_file(const char *name)
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+static int
+last_nonzero(const unsigned char *buf, int len)
+{
+  unsigned long word;
+  int i;
+
+  /* Skip zeroes a word at a time, and find the byte within the
+     first word from the end that has any bit set. */
+  for(i = len - 1; i + 1 >= (int)sizeof(word); i -= sizeof(word)) {
+    memcpy(&word, &buf[i + 1 - sizeof(word)], sizeof(word));
+    if(word != 0) {
+      break;
+    }
+  }
+  for(; i >= 0; i--) {
+    if(buf[i] != 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
 static cfs_offset_t
 file_end(coffee_page_t start)
 {
   struct file_header hdr;
+#ifndef COFFEE_MAP
   unsigned char buf[COFFEE_PAGE_SIZE];
   coffee_page_t page;
+#endif
+  cfs_offset_t end;
   int i;
 
   read_header(&hdr, start);
@@ -508,20 +755,52 @@ file_end(coffee_page_t start)
    * are zeroes, then these are skipped from the calculation.
    */
 
+#ifdef COFFEE_MAP
+  i = last_nonzero(COFFEE_MAP(start * COFFEE_PAGE_SIZE),
+                   hdr.max_pages * COFFEE_PAGE_SIZE);
+  end = i + 1 - (cfs_offset_t)sizeof(hdr);
+  return end < 0 ? 0 : end;
+#else
   for(page = hdr.max_pages - 1; page >= 0; page--) {
     COFFEE_READ(buf, sizeof(buf), (start + page) * COFFEE_PAGE_SIZE);
-    for(i = COFFEE_PAGE_SIZE - 1; i >= 0; i--) {
-      if(buf[i] != 0) {
-        if(page == 0 && i < sizeof(hdr)) {
-          return 0;
-        }
-        return 1 + i + (page * COFFEE_PAGE_SIZE) - sizeof(hdr);
-      }
+    i = last_nonzero(buf, sizeof(buf));
+    if(i >= 0) {
+      end = 1 + i + (page * COFFEE_PAGE_SIZE) - (cfs_offset_t)sizeof(hdr);
+      return end < 0 ? 0 : end;
     }
   }
 
   /* All bytes are writable. */
   return 0;
+#endif /* COFFEE_MAP */
+}
+/*---------------------------------------------------------------------------*/
+static cfs_offset_t
+known_file_end(coffee_page_t page, struct file_header *hdr)
+{
+  int i;
+#if COFFEE_INDEX_SIZE > 0
+  int slot;
+#endif
+
+  for(i = 0; i < COFFEE_MAX_OPEN_FILES; i++) {
+    if(!FILE_FREE(&coffee_files[i]) && coffee_files[i].page == page &&
+       coffee_files[i].end != UNKNOWN_OFFSET) {
+      return coffee_files[i].end;
+    }
+  }
+
+#if COFFEE_INDEX_SIZE > 0
+  slot = index_find(page, name_hash(hdr->name));
+  if(slot >= 0) {
+    if(coffee_index[slot].end == UNKNOWN_OFFSET) {
+      coffee_index[slot].end = file_end(page);
+    }
+    return coffee_index[slot].end;
+  }
+#endif
+
+  return file_end(page);
 }
 /*---------------------------------------------------------------------------*/
 static coffee_page_t
@@ -581,6 +860,12 @@ remove_by_page(coffee_page_t page, int remove_log, int close_fds,
   hdr.flags |= HDR_FLAG_OBSOLETE;
   write_header(&hdr, page);
 
+#if COFFEE_INDEX_SIZE > 0
+  if(!HDR_LOG(hdr)) {
+    index_remove(page, name_hash(hdr.name));
+  }
+#endif
+
   gc_wait = 0;
 
   /* Close all file descriptors that reference the removed file. */
@@ -646,6 +931,11 @@ reserve(const char *name, coffee_page_t pages,
   hdr.max_pages = pages;
   hdr.flags = HDR_FLAG_ALLOCATED | flags;
   write_header(&hdr, page);
+#if COFFEE_INDEX_SIZE > 0
+  if(!HDR_LOG(hdr)) {
+    index_insert(page, name_hash(hdr.name));
+  }
+#endif
 
   PRINTF("Coffee: Reserved %u pages starting from %u for file %s\n",
          (unsigned)pages, (unsigned)page, name);
@@ -1152,6 +1442,29 @@ cfs_read(int fd, void *buf, unsigned size)
   return size;
 }
 /*---------------------------------------------------------------------------*/
+const void *
+cfs_coffee_map(int fd, unsigned size)
+{
+#ifdef COFFEE_MAP
+  struct file_desc *fdp;
+
+  if(!(FD_VALID(fd) && FD_READABLE(fd))) {
+    return NULL;
+  }
+
+  fdp = &coffee_fd_set[fd];
+
+  /* The data of a modified file may be spread over its log. */
+  if(FILE_MODIFIED(fdp->file) || fdp->offset + size > fdp->file->end) {
+    return NULL;
+  }
+
+  return COFFEE_MAP(absolute_offset(fdp->file->page, fdp->offset));
+#else
+  return NULL;
+#endif /* COFFEE_MAP */
+}
+/*---------------------------------------------------------------------------*/
 int
 cfs_write(int fd, const void *buf, unsigned size)
 {
@@ -1280,7 +1593,7 @@ cfs_readdir(struct cfs_dir *dir, struct cfs_dirent *record)
     if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr)) {
       memcpy(record->name, hdr.name, sizeof(record->name));
       record->name[sizeof(record->name) - 1] = '\0';
-      record->size = file_end(page);
+      record->size = known_file_end(page, &hdr);
 
       next_page = next_file(page, &hdr);
       memcpy(dir->dummy_space, &next_page, sizeof(coffee_page_t));
@@ -1365,6 +1678,10 @@ cfs_coffee_format(void)
   memset(&coffee_fd_set, 0, sizeof(coffee_fd_set));
   next_free = 0;
   gc_wait = 1;
+#if COFFEE_INDEX_SIZE > 0
+  index_reset();
+  index_state = INDEX_COMPLETE;
+#endif
 
   PRINTF(" done!\n");
 
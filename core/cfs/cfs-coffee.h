@@ -125,6 +125,22 @@ int cfs_coffee_configure_log(const char *file, unsigned log_size,
  */
 int cfs_coffee_set_io_semantics(int fd, unsigned flags);
 
+/**
+ * \brief Get a pointer to file data in the storage.
+ * \param fd The file descriptor through which the file is read.
+ * \param size The number of bytes that will be accessed.
+ * \return A pointer to the data at the current file offset, or NULL.
+ *
+ * On ports where the storage is mapped into memory, file data can be
+ * accessed in place instead of being copied with cfs_read(). The
+ * pointer is valid until the file is written to, removed, or
+ * reformatted, and the file offset is not moved. NULL is returned
+ * if the port does not map its storage, if the file has been
+ * modified through a micro log, or if fewer than size bytes remain
+ * in the file.
+ */
+const void *cfs_coffee_map(int fd, unsigned size);
+
 /**
  * \brief Format the storage area assigned to Coffee.
  * \return 0 on success, -1 on failure.
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Header file for the hash function used by hash tables
+ */
+
+/** \addtogroup lib
+ * @{ */
+
+/**
+ * \defgroup hash Hash function for hash tables
+ *
+ * FNV-1a followed by the murmur3 finalizer. The final mixing makes
+ * the low bits of the hash depend on all bytes of the key, so that
+ * they can be used as the index into a table whose size is a power
+ * of two, even when keys, such as addresses, differ only in their
+ * last bytes.
+ *
+ * @{
+ */
+
+#ifndef HASH_H_
+#define HASH_H_
+
+#include "contiki-conf.h"
+
+/** The initial value of an accumulated hash. */
+#define HASH_INIT 2166136261UL
+
+#define HASH_FILL_(x, s) ((x) | ((x) >> (s)))
+/**
+ * The smallest power of two that is at least twice n, for n in 1 to
+ * 32768. This is a constant expression, so that it can be used as
+ * the size of a hash table that is to be at most half full.
+ */
+#define HASH_TABLE_SIZE(n) (HASH_FILL_(HASH_FILL_(HASH_FILL_(HASH_FILL_( \
+      HASH_FILL_(2UL * (n) - 1, 1), 2), 4), 8), 16) + 1)
+
+/**
+ * \brief      Add data to an accumulated hash.
+ * \param data Pointer to the data
+ * \param len  The length of the data
+ * \param acc  The accumulated hash, or HASH_INIT.
+ * \return     The updated hash.
+ */
+uint32_t hash_data(const void *data, int len, uint32_t acc);
+
+/**
+ * \brief      Mix an accumulated hash into its final value.
+ * \param acc  The accumulated hash.
+ * \return     The final hash. Its low bits are used as a table index.
+ */
+uint32_t hash_finish(uint32_t acc);
+
+#endif /* HASH_H_ */
+
+/** @} */
+/** @} */
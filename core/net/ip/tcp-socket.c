@@ -64,12 +64,30 @@ senddata(struct tcp_socket *s)
     len = MIN(s->output_senddata_len, len);
     s->output_data_send_nxt = len;
     uip_send(s->output_data_ptr, len);
+#if UIP_TCP_SEND_WINDOW
+    /* uIP keeps the data in the send window from here on, so the
+       output buffer can be reused right away. */
+    if(uip_window_used() && len > 0) {
+      memmove(&s->output_data_ptr[0], &s->output_data_ptr[len],
+              s->output_data_len - len);
+      s->output_data_len -= len;
+      s->output_senddata_len = s->output_data_len;
+      s->output_data_send_nxt = 0;
+      call_event(s, TCP_SOCKET_DATA_SENT);
+    }
+#endif /* UIP_TCP_SEND_WINDOW */
   }
 }
 /*---------------------------------------------------------------------------*/
 static void
 acked(struct tcp_socket *s)
 {
+#if UIP_TCP_SEND_WINDOW
+  if(uip_window_used()) {
+    /* The data was already consumed when it was handed to uIP. */
+    return;
+  }
+#endif /* UIP_TCP_SEND_WINDOW */
   if(s->output_senddata_len > 0) {
     /* Copy the data in the outputbuf down and update outputbufptr and
        outputbuf_lastsent */
@@ -162,6 +180,9 @@ appcall(void *state)
 	   s->listen_port == uip_htons(uip_conn->lport)) {
 	  s->flags &= ~TCP_SOCKET_FLAGS_LISTENING;
           s->output_data_max_seg = uip_mss();
+#if UIP_TCP_SEND_WINDOW
+          uip_use_window();
+#endif /* UIP_TCP_SEND_WINDOW */
 	  tcp_markconn(uip_conn, s);
 	  call_event(s, TCP_SOCKET_CONNECTED);
 	  break;
@@ -169,6 +190,9 @@ appcall(void *state)
       }
     } else {
       s->output_data_max_seg = uip_mss();
+#if UIP_TCP_SEND_WINDOW
+      uip_use_window();
+#endif /* UIP_TCP_SEND_WINDOW */
       call_event(s, TCP_SOCKET_CONNECTED);
     }
 
@@ -187,6 +187,21 @@ check_for_tcp_syn(void)
 #endif /* UIP_TCP || UIP_CONF_IP_FORWARD */
 }
 /*---------------------------------------------------------------------------*/
+#if UIP_TCP && UIP_TCP_SEND_WINDOW
+/* Sends one segment at a time for as long as uip_process() reports
+   that a connection has room left in its send window. */
+static void
+tcp_send_more(void)
+{
+  while(uip_tcp_more != NULL) {
+    uip_poll_conn(uip_tcp_more);
+    tcpip_ipv6_output();
+  }
+}
+#else /* UIP_TCP && UIP_TCP_SEND_WINDOW */
+#define tcp_send_more()
+#endif /* UIP_TCP && UIP_TCP_SEND_WINDOW */
+/*---------------------------------------------------------------------------*/
 static void
 packet_input(void)
 {
@@ -209,6 +224,7 @@ packet_input(void)
 #else /* UIP_CONF_TCP_SPLIT */
 #if NETSTACK_CONF_WITH_IPV6
       tcpip_ipv6_output();
+      tcp_send_more();
 #else /* NETSTACK_CONF_WITH_IPV6 */
       PRINTF("tcpip packet_input output len %d\n", uip_len);
       tcpip_output();
@@ -429,6 +445,7 @@ eventhandler(process_event_t ev, process_data_t data)
           uip_periodic(i);
 #if NETSTACK_CONF_WITH_IPV6
           tcpip_ipv6_output();
+          tcp_send_more();
 #else
           if(uip_len > 0) {
             PRINTF("tcpip_output from periodic len %d\n", uip_len);
@@ -486,6 +503,7 @@ eventhandler(process_event_t ev, process_data_t data)
       uip_poll_conn(data);
 #if NETSTACK_CONF_WITH_IPV6
       tcpip_ipv6_output();
+      tcp_send_more();
 #else /* NETSTACK_CONF_WITH_IPV6 */
       if(uip_len > 0) {
         PRINTF("tcpip_output from tcp poll len %d\n", uip_len);
@@ -525,12 +543,112 @@ tcpip_input(void)
   uip_clear_buf();
 }
 /*---------------------------------------------------------------------------*/
+#if NETSTACK_CONF_WITH_IPV6 && TCPIP_DEST_CACHE_SIZE
+#if !UIP_DS6_NOTIFICATIONS
+#error "TCPIP_CONF_DEST_CACHE_SIZE needs UIP_DS6_NOTIFICATIONS"
+#endif /* !UIP_DS6_NOTIFICATIONS */
+
+/* A cached destination resolves to nbr, whose ipaddr is the next hop,
+   through route, or through no route for on-link destinations and the
+   default route. Entries with nbr == NULL are unused. */
+struct dest_cache_entry {
+  uip_ipaddr_t ipaddr;
+  uip_ds6_nbr_t *nbr;
+  uip_ds6_route_t *route;
+};
+
+static struct dest_cache_entry dest_cache[TCPIP_DEST_CACHE_SIZE];
+static uint8_t dest_cache_victim;
+static struct uip_ds6_notification dest_cache_notification;
+
+struct tcpip_dest_cache_stats tcpip_dest_cache_stats;
+/*---------------------------------------------------------------------------*/
+void
+tcpip_dest_cache_flush(void)
+{
+  uint8_t i;
+
+  for(i = 0; i < TCPIP_DEST_CACHE_SIZE; i++) {
+    dest_cache[i].nbr = NULL;
+  }
+  tcpip_dest_cache_stats.flushes++;
+}
+/*---------------------------------------------------------------------------*/
+void
+tcpip_dest_cache_nbr_rm(const struct uip_ds6_nbr *nbr)
+{
+  uint8_t i;
+
+  for(i = 0; i < TCPIP_DEST_CACHE_SIZE; i++) {
+    if(dest_cache[i].nbr == nbr) {
+      dest_cache[i].nbr = NULL;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+dest_cache_route_changed(int event, uip_ipaddr_t *route,
+                         uip_ipaddr_t *nexthop, int num_routes)
+{
+  tcpip_dest_cache_flush();
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_nbr_t *
+dest_cache_lookup(const uip_ipaddr_t *ipaddr)
+{
+  uint8_t i;
+
+  for(i = 0; i < TCPIP_DEST_CACHE_SIZE; i++) {
+    if(dest_cache[i].nbr != NULL &&
+       uip_ipaddr_cmp(&dest_cache[i].ipaddr, ipaddr)) {
+      tcpip_dest_cache_stats.hits++;
+      if(dest_cache[i].route != NULL) {
+        /* Keep the route as recently used as without the cache */
+        uip_ds6_route_touch(dest_cache[i].route);
+      }
+      return dest_cache[i].nbr;
+    }
+  }
+  tcpip_dest_cache_stats.misses++;
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+dest_cache_add(const uip_ipaddr_t *ipaddr, uip_ds6_nbr_t *nbr,
+               uip_ds6_route_t *route)
+{
+  uint8_t i;
+
+  /* Only cache neighbors that have completed address resolution, since
+     uip_ds6_defrt_choose() prefers routers that are not INCOMPLETE. */
+  if(nbr->state == NBR_INCOMPLETE) {
+    return;
+  }
+  for(i = 0; i < TCPIP_DEST_CACHE_SIZE; i++) {
+    if(dest_cache[i].nbr == NULL) {
+      break;
+    }
+  }
+  if(i == TCPIP_DEST_CACHE_SIZE) {
+    i = dest_cache_victim;
+    dest_cache_victim = (dest_cache_victim + 1) % TCPIP_DEST_CACHE_SIZE;
+  }
+  uip_ipaddr_copy(&dest_cache[i].ipaddr, ipaddr);
+  dest_cache[i].nbr = nbr;
+  dest_cache[i].route = route;
+}
+#endif /* NETSTACK_CONF_WITH_IPV6 && TCPIP_DEST_CACHE_SIZE */
+/*---------------------------------------------------------------------------*/
 #if NETSTACK_CONF_WITH_IPV6
 void
 tcpip_ipv6_output(void)
 {
   uip_ds6_nbr_t *nbr = NULL;
   uip_ipaddr_t *nexthop = NULL;
+  uip_ds6_route_t *route = NULL;
+#if TCPIP_DEST_CACHE_SIZE
+  uint8_t cacheable = 0;
+#endif /* TCPIP_DEST_CACHE_SIZE */
 
   if(uip_len == 0) {
     return;
@@ -561,6 +679,19 @@ tcpip_ipv6_output(void)
 
     nbr = NULL;
 
+#if TCPIP_DEST_CACHE_SIZE
+    /* Packets to a recently used destination reuse its next hop
+       neighbor. Source routed packets bypass the cache. */
+    if(nexthop == NULL) {
+      nbr = dest_cache_lookup(&UIP_IP_BUF->destipaddr);
+      if(nbr != NULL) {
+        nexthop = &nbr->ipaddr;
+      } else {
+        cacheable = 1;
+      }
+    }
+#endif /* TCPIP_DEST_CACHE_SIZE */
+
     /* We first check if the destination address is on our immediate
        link. If so, we simply use the destination address as our
        nexthop address. */
@@ -569,7 +700,6 @@ tcpip_ipv6_output(void)
     }
 
     if(nexthop == NULL) {
-      uip_ds6_route_t *route;
       /* Check if we have a route to the destination address. */
       route = uip_ds6_route_lookup(&UIP_IP_BUF->destipaddr);
 
@@ -657,7 +787,14 @@ tcpip_ipv6_output(void)
       return;
     }
 #endif /* UIP_CONF_IPV6_RPL */
-    nbr = uip_ds6_nbr_lookup(nexthop);
+    if(nbr == NULL) {
+      nbr = uip_ds6_nbr_lookup(nexthop);
+#if TCPIP_DEST_CACHE_SIZE
+      if(nbr != NULL && cacheable) {
+        dest_cache_add(&UIP_IP_BUF->destipaddr, nbr, route);
+      }
+#endif /* TCPIP_DEST_CACHE_SIZE */
+    }
     if(nbr == NULL) {
 #if UIP_ND6_SEND_NA
       if((nbr = uip_ds6_nbr_add(nexthop, NULL, 0, NBR_INCOMPLETE, NBR_TABLE_REASON_IPV6_ND, NULL)) == NULL) {
@@ -828,6 +965,9 @@ PROCESS_THREAD(tcpip_process, ev, data)
   etimer_set(&periodic, CLOCK_SECOND / 2);
 
   uip_init();
+#if NETSTACK_CONF_WITH_IPV6 && TCPIP_DEST_CACHE_SIZE
+  uip_ds6_notification_add(&dest_cache_notification, dest_cache_route_changed);
+#endif /* NETSTACK_CONF_WITH_IPV6 && TCPIP_DEST_CACHE_SIZE */
 #ifdef UIP_FALLBACK_INTERFACE
   UIP_FALLBACK_INTERFACE.init();
 #endif
@@ -355,6 +355,45 @@ void tcpip_set_outputfunc(uint8_t (* f)(void));
 void tcpip_ipv6_output(void);
 #endif
 
+/**
+ * \brief Number of destinations for which tcpip_ipv6_output() keeps
+ * the resolved next-hop neighbor, so that repeated packets to the same
+ * destination skip the on-link, route, default router and neighbor
+ * lookups. 0 disables the cache.
+ */
+#ifdef TCPIP_CONF_DEST_CACHE_SIZE
+#define TCPIP_DEST_CACHE_SIZE TCPIP_CONF_DEST_CACHE_SIZE
+#else /* TCPIP_CONF_DEST_CACHE_SIZE */
+#define TCPIP_DEST_CACHE_SIZE 0
+#endif /* TCPIP_CONF_DEST_CACHE_SIZE */
+
+#if NETSTACK_CONF_WITH_IPV6 && TCPIP_DEST_CACHE_SIZE
+struct uip_ds6_nbr;
+
+/* Destination cache counters. */
+struct tcpip_dest_cache_stats {
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t flushes;
+};
+extern struct tcpip_dest_cache_stats tcpip_dest_cache_stats;
+
+/**
+ * \brief Forget all cached next hops. Called when the set of on-link
+ * prefixes, routes or default routers changes.
+ */
+void tcpip_dest_cache_flush(void);
+
+/**
+ * \brief Forget the cached next hops that resolve to a neighbor that
+ * is about to be removed from the neighbor table.
+ */
+void tcpip_dest_cache_nbr_rm(const struct uip_ds6_nbr *nbr);
+#else /* NETSTACK_CONF_WITH_IPV6 && TCPIP_DEST_CACHE_SIZE */
+#define tcpip_dest_cache_flush()
+#define tcpip_dest_cache_nbr_rm(nbr)
+#endif /* NETSTACK_CONF_WITH_IPV6 && TCPIP_DEST_CACHE_SIZE */
+
 /**
  * \brief Is forwarding generally enabled?
  */
@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \addtogroup uip
+ * @{
+ */
+
+/**
+ * \file
+ *         Internet checksum (RFC 1071) shared by uIP and ip64
+ */
+
+#include "net/ip/uip.h"
+#include "net/ip/uip-chksum.h"
+
+#include <string.h>
+
+/* The vector kernels only pay off when the compiler keeps the
+   intrinsics in registers, which it does not do without optimization. */
+#if UIP_CHKSUM_SIMD && defined(__OPTIMIZE__)
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define VECTOR_BYTES 32
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define VECTOR_BYTES 16
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define VECTOR_BYTES 16
+#endif
+#endif /* UIP_CHKSUM_SIMD && __OPTIMIZE__ */
+
+/*---------------------------------------------------------------------------*/
+/*
+ * The ones-complement sum does not depend on the byte order of the
+ * words it adds (RFC 1071, section 2(B)), so the kernels add
+ * native-order words and the result is swapped into host order once,
+ * after folding. A packet is at most 65535 bytes, so neither the
+ * 32-bit vector lanes nor the 64-bit accumulator can overflow.
+ */
+#ifdef VECTOR_BYTES
+static uint64_t
+sum_lanes(const uint32_t *lanes, int n)
+{
+  uint64_t acc;
+
+  acc = 0;
+  while(n-- > 0) {
+    acc += *lanes++;
+  }
+  return acc;
+}
+/*---------------------------------------------------------------------------*/
+static uint64_t
+vector_sum(const uint8_t *data, uint16_t blocks)
+{
+#if defined(__AVX2__)
+  const __m256i mask = _mm256_set1_epi32(0xffff);
+  __m256i lo = _mm256_setzero_si256();
+  __m256i hi = _mm256_setzero_si256();
+  __m256i v;
+  uint32_t lanes[16];
+
+  /* Split each 32-bit word into its two 16-bit halves, which go into
+     separate accumulators. */
+  while(blocks-- > 0) {
+    v = _mm256_loadu_si256((const __m256i *)data);
+    lo = _mm256_add_epi32(lo, _mm256_and_si256(v, mask));
+    hi = _mm256_add_epi32(hi, _mm256_srli_epi32(v, 16));
+    data += VECTOR_BYTES;
+  }
+  _mm256_storeu_si256((__m256i *)&lanes[0], lo);
+  _mm256_storeu_si256((__m256i *)&lanes[8], hi);
+#elif defined(__SSE2__)
+  const __m128i mask = _mm_set1_epi32(0xffff);
+  __m128i lo = _mm_setzero_si128();
+  __m128i hi = _mm_setzero_si128();
+  __m128i v;
+  uint32_t lanes[8];
+
+  /* Split each 32-bit word into its two 16-bit halves, which go into
+     separate accumulators. */
+  while(blocks-- > 0) {
+    v = _mm_loadu_si128((const __m128i *)data);
+    lo = _mm_add_epi32(lo, _mm_and_si128(v, mask));
+    hi = _mm_add_epi32(hi, _mm_srli_epi32(v, 16));
+    data += VECTOR_BYTES;
+  }
+  _mm_storeu_si128((__m128i *)&lanes[0], lo);
+  _mm_storeu_si128((__m128i *)&lanes[4], hi);
+#else /* NEON */
+  uint32x4_t acc = vdupq_n_u32(0);
+  uint32_t lanes[4];
+
+  /* Add pairs of adjacent 16-bit words into 32-bit lanes. */
+  while(blocks-- > 0) {
+    acc = vpadalq_u16(acc, vreinterpretq_u16_u8(vld1q_u8(data)));
+    data += VECTOR_BYTES;
+  }
+  vst1q_u32(lanes, acc);
+#endif
+  return sum_lanes(lanes, sizeof(lanes) / sizeof(lanes[0]));
+}
+#endif /* VECTOR_BYTES */
+/*---------------------------------------------------------------------------*/
+uint16_t
+uip_chksum_add(uint16_t sum, const uint8_t *data, uint16_t len)
+{
+  uint64_t acc;
+  uint32_t w[4];
+  uint16_t t;
+
+  acc = 0;
+
+#ifdef VECTOR_BYTES
+  if(len >= VECTOR_BYTES) {
+    acc = vector_sum(data, len / VECTOR_BYTES);
+    data += len & ~(VECTOR_BYTES - 1);
+    len &= VECTOR_BYTES - 1;
+  }
+#endif /* VECTOR_BYTES */
+
+  while(len >= sizeof(w)) {
+    memcpy(w, data, sizeof(w));
+    acc += (uint64_t)w[0] + w[1] + w[2] + w[3];
+    data += sizeof(w);
+    len -= sizeof(w);
+  }
+  while(len >= 4) {
+    memcpy(w, data, 4);
+    acc += w[0];
+    data += 4;
+    len -= 4;
+  }
+  if(len >= 2) {
+    memcpy(&t, data, 2);
+    acc += t;
+    data += 2;
+    len -= 2;
+  }
+  if(len > 0) {
+    /* Pad the odd trailing byte with a zero byte. */
+    t = 0;
+    memcpy(&t, data, 1);
+    acc += t;
+  }
+
+  acc = (acc & 0xffffffff) + (acc >> 32);
+  acc = (acc & 0xffffffff) + (acc >> 32);
+  while(acc >> 16) {
+    acc = (acc & 0xffff) + (acc >> 16);
+  }
+
+  t = uip_ntohs((uint16_t)acc);
+  sum += t;
+  if(sum < t) {
+    sum++;      /* carry */
+  }
+
+  /* Return sum in host byte order. */
+  return sum;
+}
+/*---------------------------------------------------------------------------*/
+
+/** @} */
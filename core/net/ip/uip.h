@@ -713,6 +713,29 @@ CCIF void uip_send(const void *data, int len);
     uip_conn->tcpstateflags &= ~UIP_STOPPED;                    \
   } while(0)
 
+#if UIP_TCP_SEND_WINDOW
+/**
+ * Let the current connection keep several segments in flight.
+ *
+ * This should be called when the connection is established, i.e.,
+ * when uip_connected() is true. After this call, data passed to
+ * uip_send() is kept in the connection's send window until it is
+ * acknowledged, and uIP retransmits it by itself. The application may
+ * send again as soon as uip_mss() is non-zero, without waiting for
+ * uip_acked(), and is never called with uip_rexmit() set.
+ *
+ * \hideinitializer
+ */
+#define uip_use_window()      (uip_conn->wndflags |= UIP_WND_ENABLED)
+
+/**
+ * Find out if the current connection uses a send window.
+ *
+ * \hideinitializer
+ */
+#define uip_window_used()     (uip_conn->wndflags & UIP_WND_ENABLED)
+#endif /* UIP_TCP_SEND_WINDOW */
+
 
 /* uIP tests that can be made to determine in what state the current
    connection is, and what the application function should do. */
@@ -1370,6 +1393,18 @@ struct uip_conn {
   uint8_t timer;         /**< The retransmission timer. */
   uint8_t nrtx;          /**< The number of retransmissions for the last
                               segment sent. */
+#if UIP_TCP_SEND_WINDOW
+  uint16_t snd_wnd;      /**< The window advertised by the remote host. */
+  uint16_t sent;         /**< Bytes of snd_buf that have been sent since
+                              the last retransmission time-out. */
+  uint16_t rtt_len;      /**< Bytes up to the end of the segment that is
+                              timed for RTT estimation, or 0. */
+  uint8_t rtt_ticks;     /**< Timer ticks since the timed segment was sent. */
+  uint8_t dupacks;       /**< Number of duplicate ACKs received in a row. */
+  uint8_t wndflags;      /**< Send window flags. */
+  uint8_t snd_buf[UIP_TCP_SEND_WINDOW]; /**< Unacknowledged data,
+                                             starting at snd_nxt. */
+#endif /* UIP_TCP_SEND_WINDOW */
 
   uip_tcp_appstate_t appstate; /** The application state. */
 };
@@ -1387,6 +1422,12 @@ CCIF extern struct uip_conn *uip_conn;
 /* The array containing all uIP connections. */
 CCIF extern struct uip_conn uip_conns[UIP_CONNS];
 #endif
+#if UIP_TCP_SEND_WINDOW
+/* A connection that may send another segment right away, or NULL. Set
+   by uip_process() after it has sent data on a connection with a send
+   window; the caller should poll the connection until this is NULL. */
+extern struct uip_conn *uip_tcp_more;
+#endif /* UIP_TCP_SEND_WINDOW */
 
 /**
  * \addtogroup uiparch
@@ -1617,6 +1658,10 @@ void uip_process(uint8_t flag);
 
 #define UIP_STOPPED      16
 
+/* The flags used in the uip_conn->wndflags. */
+#define UIP_WND_ENABLED  1
+#define UIP_WND_CLOSING  2
+
 /* The TCP and IP headers. */
 struct uip_tcpip_hdr {
 #if NETSTACK_CONF_WITH_IPV6
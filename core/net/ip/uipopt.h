@@ -500,6 +500,25 @@ void uip_log(char *msg);
 #define UIP_RECEIVE_WINDOW (UIP_CONF_RECEIVE_WINDOW)
 #endif
 
+/**
+ * The size of the per-connection send window, in bytes.
+ *
+ * When set to a non-zero value, every TCP connection gets a
+ * retransmission buffer of this size, and connections that enable it
+ * with uip_use_window() may have several segments in flight. uIP then
+ * retransmits lost data from the buffer by itself, so the application
+ * never sees UIP_REXMIT. When zero (the default), uIP keeps at most
+ * one unacknowledged segment per connection. Only supported with
+ * IPv6.
+ *
+ * \hideinitializer
+ */
+#if defined(UIP_CONF_TCP_SEND_WINDOW) && NETSTACK_CONF_WITH_IPV6
+#define UIP_TCP_SEND_WINDOW (UIP_CONF_TCP_SEND_WINDOW)
+#else
+#define UIP_TCP_SEND_WINDOW 0
+#endif
+
 /**
  * How long a connection should stay in the TIME_WAIT state.
  *
@@ -619,6 +638,22 @@ void uip_log(char *msg);
 #define UIP_BYTE_ORDER     (UIP_LITTLE_ENDIAN)
 #endif /* UIP_CONF_BYTE_ORDER */
 
+/**
+ * Use SSE2, AVX2 or NEON in the Internet checksum of uip-chksum.c when
+ * the compiler targets them.
+ *
+ * The checksums computed by uIP and ip64 otherwise accumulate 32 bits
+ * at a time into a 64-bit sum. Platforms that set UIP_ARCH_CHKSUM
+ * provide their own uip_*chksum() functions and are not affected.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_CHKSUM_SIMD
+#define UIP_CHKSUM_SIMD (UIP_CONF_CHKSUM_SIMD)
+#else /* UIP_CONF_CHKSUM_SIMD */
+#define UIP_CHKSUM_SIMD 1
+#endif /* UIP_CONF_CHKSUM_SIMD */
+
 /** @} */
 /*------------------------------------------------------------------------------*/
 
@@ -38,6 +38,7 @@
 
 #include "lib/random.h"
 
+#include <stddef.h>
 #include <string.h>
 
 #ifdef IP64_ADDRMAP_CONF_ENTRIES
@@ -46,15 +47,40 @@
 #define NUM_ENTRIES 32
 #endif /* IP64_ADDRMAP_CONF_ENTRIES */
 
+/* Number of buckets in each of the two hash indexes: one keyed by the
+   full session tuple, one keyed by the mapped port. */
+#ifdef IP64_ADDRMAP_CONF_HASH_SIZE
+#define HASH_SIZE IP64_ADDRMAP_CONF_HASH_SIZE
+#else /* IP64_ADDRMAP_CONF_HASH_SIZE */
+#define HASH_SIZE NUM_ENTRIES
+#endif /* IP64_ADDRMAP_CONF_HASH_SIZE */
+
+/* The expiry wheel has one slot per WHEEL_TICK. Entries that expire
+   further away than the wheel spans are parked in its last slot and
+   looked at again when that slot comes around. */
+#ifdef IP64_ADDRMAP_CONF_WHEEL_SLOTS
+#define WHEEL_SLOTS IP64_ADDRMAP_CONF_WHEEL_SLOTS
+#else /* IP64_ADDRMAP_CONF_WHEEL_SLOTS */
+#define WHEEL_SLOTS 32
+#endif /* IP64_ADDRMAP_CONF_WHEEL_SLOTS */
+
+#define WHEEL_TICK CLOCK_SECOND
+
 MEMB(entrymemb, struct ip64_addrmap_entry, NUM_ENTRIES);
 LIST(entrylist);
 
+static struct ip64_addrmap_entry *tuple_hash[HASH_SIZE];
+static struct ip64_addrmap_entry *port_hash[HASH_SIZE];
+static struct ip64_addrmap_entry *wheel[WHEEL_SLOTS];
+static uint8_t wheel_slot;
+static clock_time_t wheel_time;
+
+struct ip64_addrmap_stats ip64_addrmap_stats;
+
 #define FIRST_MAPPED_PORT 10000
 #define LAST_MAPPED_PORT  20000
 static uint16_t mapped_port = FIRST_MAPPED_PORT;
 
-#define printf(...)
-
 /*---------------------------------------------------------------------------*/
 struct ip64_addrmap_entry *
 ip64_addrmap_list(void)
@@ -67,37 +93,157 @@ ip64_addrmap_init(void)
 {
   memb_init(&entrymemb);
   list_init(entrylist);
+  memset(tuple_hash, 0, sizeof(tuple_hash));
+  memset(port_hash, 0, sizeof(port_hash));
+  memset(wheel, 0, sizeof(wheel));
+  wheel_slot = 0;
+  wheel_time = clock_time();
+  memset(&ip64_addrmap_stats, 0, sizeof(ip64_addrmap_stats));
   mapped_port = FIRST_MAPPED_PORT;
 }
 /*---------------------------------------------------------------------------*/
+static unsigned
+tuple_bucket(const uip_ip6addr_t *ip6addr, uint16_t ip6port,
+             const uip_ip4addr_t *ip4addr, uint16_t ip4port,
+             uint8_t protocol)
+{
+  uint32_t h;
+  int i;
+
+  h = protocol;
+  for(i = 0; i < 8; i++) {
+    h = h * 31 + ip6addr->u16[i];
+  }
+  h = h * 31 + ip4addr->u16[0];
+  h = h * 31 + ip4addr->u16[1];
+  h = h * 31 + ip6port;
+  h = h * 31 + ip4port;
+  return (h ^ (h >> 16)) % HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+#define PORT_BUCKET(port) ((port) % HASH_SIZE)
+/*---------------------------------------------------------------------------*/
 static void
-check_age(void)
+chain_remove(struct ip64_addrmap_entry **head, struct ip64_addrmap_entry *m,
+       int offset)
 {
-  struct ip64_addrmap_entry *m;
+  /* Remove m from the singly linked chain starting at head, whose
+     next pointers are at the given offset in each entry. */
+  struct ip64_addrmap_entry **p;
+
+  for(p = head; *p != NULL;
+      p = (struct ip64_addrmap_entry **)((char *)*p + offset)) {
+    if(*p == m) {
+      *p = *(struct ip64_addrmap_entry **)((char *)m + offset);
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+wheel_offset(struct ip64_addrmap_entry *m)
+{
+  clock_time_t remaining;
+
+  if(timer_expired(&m->timer)) {
+    return 1;
+  }
+  remaining = m->timer.start + m->timer.interval - wheel_time;
+  remaining = (remaining + WHEEL_TICK - 1) / WHEEL_TICK;
+  if(remaining < 1) {
+    return 1;
+  }
+  if(remaining > WHEEL_SLOTS - 1) {
+    return WHEEL_SLOTS - 1;
+  }
+  return remaining;
+}
+/*---------------------------------------------------------------------------*/
+static void
+wheel_insert(struct ip64_addrmap_entry *m, uint8_t offset)
+{
+  m->wheel_slot = (wheel_slot + offset) % WHEEL_SLOTS;
+  m->wheel_next = wheel[m->wheel_slot];
+  wheel[m->wheel_slot] = m;
+}
+/*---------------------------------------------------------------------------*/
+static void
+free_entry(struct ip64_addrmap_entry *m)
+{
+  chain_remove(&tuple_hash[tuple_bucket(&m->ip6addr, m->ip6port,
+                                        &m->ip4addr, m->ip4port,
+                                        m->protocol)],
+               m, offsetof(struct ip64_addrmap_entry, tuple_next));
+  chain_remove(&port_hash[PORT_BUCKET(m->mapped_port)],
+               m, offsetof(struct ip64_addrmap_entry, port_next));
+  list_remove(entrylist, m);
+  memb_free(&entrymemb, m);
+  ip64_addrmap_stats.active--;
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_entry(struct ip64_addrmap_entry *m)
+{
+  chain_remove(&wheel[m->wheel_slot],
+               m, offsetof(struct ip64_addrmap_entry, wheel_next));
+  free_entry(m);
+}
+/*---------------------------------------------------------------------------*/
+static void
+check_slot(uint8_t slot)
+{
+  struct ip64_addrmap_entry *m, *next;
 
-  /* Walk through the list of address mappings, throw away the ones
-     that are too old. */
-  m = list_head(entrylist);
-  while(m != NULL) {
+  /* Throw away the mappings in the slot that have expired, and move
+     the ones that have had their lifetime extended to a later slot. */
+  m = wheel[slot];
+  wheel[slot] = NULL;
+  for(; m != NULL; m = next) {
+    next = m->wheel_next;
     if(timer_expired(&m->timer)) {
-      list_remove(entrylist, m);
-      memb_free(&entrymemb, m);
-      m = list_head(entrylist);
+      free_entry(m);
+      ip64_addrmap_stats.expired++;
     } else {
-      m = list_item_next(m);
+      wheel_insert(m, wheel_offset(m));
     }
   }
 }
 /*---------------------------------------------------------------------------*/
+static void
+check_age(void)
+{
+  int n;
+
+  /* Advance the wheel to the current time, one slot per elapsed
+     tick. After a long idle period every slot is checked once. */
+  for(n = 0;
+      n < WHEEL_SLOTS && clock_time() - wheel_time >= WHEEL_TICK;
+      n++) {
+    wheel_time += WHEEL_TICK;
+    wheel_slot = (wheel_slot + 1) % WHEEL_SLOTS;
+    check_slot(wheel_slot);
+  }
+  if(n == WHEEL_SLOTS) {
+    wheel_time = clock_time();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+check_all(void)
+{
+  uint8_t i;
+
+  for(i = 0; i < WHEEL_SLOTS; i++) {
+    check_slot(i);
+  }
+}
+/*---------------------------------------------------------------------------*/
 static int
 recycle(void)
 {
   /* Find the oldest recyclable mapping and remove it. */
   struct ip64_addrmap_entry *m, *oldest;
 
-  /* Walk through the list of address mappings, throw away the ones
-     that are too old. */
-
   oldest = NULL;
   for(m = list_head(entrylist);
       m != NULL;
@@ -117,8 +263,8 @@ recycle(void)
   /* If we found an oldest recyclable entry, remove it and return
      non-zero. */
   if(oldest != NULL) {
-    list_remove(entrylist, oldest);
-    memb_free(&entrymemb, oldest);
+    remove_entry(oldest);
+    ip64_addrmap_stats.recycled++;
     return 1;
   }
 
@@ -134,21 +280,20 @@ ip64_addrmap_lookup(const uip_ip6addr_t *ip6addr,
 {
   struct ip64_addrmap_entry *m;
 
-  printf("lookup ip4port %d ip6port %d\n", uip_htons(ip4port),
-	 uip_htons(ip6port));
   check_age();
-  for(m = list_head(entrylist); m != NULL; m = list_item_next(m)) {
-    printf("protocol %d %d, ip4port %d %d, ip6port %d %d, ip4 %d ip6 %d\n",
-	   m->protocol, protocol,
-	   m->ip4port, ip4port,
-	   m->ip6port, ip6port,
-	   uip_ip4addr_cmp(&m->ip4addr, ip4addr),
-	   uip_ip6addr_cmp(&m->ip6addr, ip6addr));
+  for(m = tuple_hash[tuple_bucket(ip6addr, ip6port,
+                                  ip4addr, ip4port, protocol)];
+      m != NULL; m = m->tuple_next) {
     if(m->protocol == protocol &&
        m->ip4port == ip4port &&
        m->ip6port == ip6port &&
        uip_ip4addr_cmp(&m->ip4addr, ip4addr) &&
        uip_ip6addr_cmp(&m->ip6addr, ip6addr)) {
+      if(timer_expired(&m->timer)) {
+        remove_entry(m);
+        ip64_addrmap_stats.expired++;
+        return NULL;
+      }
       m->ip6to4++;
       return m;
     }
@@ -156,25 +301,40 @@ ip64_addrmap_lookup(const uip_ip6addr_t *ip6addr,
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
-struct ip64_addrmap_entry *
-ip64_addrmap_lookup_port(uint16_t mapped_port, uint8_t protocol)
+/* Protocol 0 matches a mapping of any protocol. */
+static struct ip64_addrmap_entry *
+lookup_port(uint16_t mapped_port, uint8_t protocol)
 {
   struct ip64_addrmap_entry *m;
 
-  check_age();
-  for(m = list_head(entrylist); m != NULL; m = list_item_next(m)) {
-    printf("mapped port %d %d, protocol %d %d\n",
-	   m->mapped_port, mapped_port,
-	   m->protocol, protocol);
+  for(m = port_hash[PORT_BUCKET(mapped_port)];
+      m != NULL; m = m->port_next) {
     if(m->mapped_port == mapped_port &&
-       m->protocol == protocol) {
-      m->ip4to6++;
+       (m->protocol == protocol || protocol == 0)) {
       return m;
     }
   }
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+struct ip64_addrmap_entry *
+ip64_addrmap_lookup_port(uint16_t mapped_port, uint8_t protocol)
+{
+  struct ip64_addrmap_entry *m;
+
+  check_age();
+  m = lookup_port(mapped_port, protocol);
+  if(m != NULL) {
+    if(timer_expired(&m->timer)) {
+      remove_entry(m);
+      ip64_addrmap_stats.expired++;
+      return NULL;
+    }
+    m->ip4to6++;
+  }
+  return m;
+}
+/*---------------------------------------------------------------------------*/
 static void
 increase_mapped_port(void)
 {
@@ -194,9 +354,12 @@ ip64_addrmap_create(const uip_ip6addr_t *ip6addr,
   check_age();
   m = memb_alloc(&entrymemb);
   if(m == NULL) {
-    /* We could not allocate an entry, try to recycle one and try to
-       allocate again. */
-    if(recycle()) {
+    /* We could not allocate an entry. Throw away all expired entries,
+       not just the ones whose wheel slot has come around, and if that
+       does not help, try to recycle one and try to allocate again. */
+    check_all();
+    m = memb_alloc(&entrymemb);
+    if(m == NULL && recycle()) {
       m = memb_alloc(&entrymemb);
     }
   }
@@ -211,27 +374,29 @@ ip64_addrmap_create(const uip_ip6addr_t *ip6addr,
     m->ip4to6 = 0;
     timer_set(&m->timer, 0);
 
-    /* Pick a new, unused local port. First make sure that the
-       mapped_port number does not belong to any active connection. If
-       so, we keep increasing the mapped_port until we're free. */
-    {
-      struct ip64_addrmap_entry *n;
-      n = list_head(entrylist);
-      while(n != NULL) {
-	if(n->mapped_port == mapped_port) {
-	  increase_mapped_port();
-	  n = list_head(entrylist);
-	} else {
-	  n = list_item_next(m);
-	}
-      }
+    /* Pick a new, unused local port. The mapped port index makes each
+       check for a collision with an active mapping, of any protocol,
+       a single bucket lookup. */
+    while(lookup_port(mapped_port, 0) != NULL) {
+      increase_mapped_port();
     }
     m->mapped_port = mapped_port;
     increase_mapped_port();
 
     list_add(entrylist, m);
+    m->tuple_next = tuple_hash[tuple_bucket(ip6addr, ip6port,
+                                            ip4addr, ip4port, protocol)];
+    tuple_hash[tuple_bucket(ip6addr, ip6port,
+                            ip4addr, ip4port, protocol)] = m;
+    m->port_next = port_hash[PORT_BUCKET(m->mapped_port)];
+    port_hash[PORT_BUCKET(m->mapped_port)] = m;
+    wheel_insert(m, wheel_offset(m));
+
+    ip64_addrmap_stats.created++;
+    ip64_addrmap_stats.active++;
     return m;
   }
+  ip64_addrmap_stats.create_failed++;
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
@@ -239,8 +404,19 @@ void
 ip64_addrmap_set_lifetime(struct ip64_addrmap_entry *e,
                           clock_time_t time)
 {
+  uint8_t offset;
+
   if(e != NULL) {
     timer_set(&e->timer, time);
+
+    /* A longer lifetime is picked up when the entry's current slot
+       comes around. Only a shorter one needs to move the entry. */
+    offset = wheel_offset(e);
+    if(offset < (e->wheel_slot - wheel_slot + WHEEL_SLOTS) % WHEEL_SLOTS) {
+      chain_remove(&wheel[e->wheel_slot],
+             e, offsetof(struct ip64_addrmap_entry, wheel_next));
+      wheel_insert(e, offset);
+    }
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -38,6 +38,7 @@
 
 struct ip64_addrmap_entry {
   struct ip64_addrmap_entry *next;
+  struct ip64_addrmap_entry *tuple_next, *port_next, *wheel_next;
   struct timer timer;
   uip_ip6addr_t ip6addr;
   uip_ip4addr_t ip4addr;
@@ -47,8 +48,19 @@ struct ip64_addrmap_entry {
   uint16_t ip4port;
   uint8_t protocol;
   uint8_t flags;
+  uint8_t wheel_slot;
 };
 
+/* Session counters, for monitoring. */
+struct ip64_addrmap_stats {
+  uint32_t created;
+  uint32_t expired;
+  uint32_t recycled;
+  uint32_t create_failed;
+  uint16_t active;
+};
+extern struct ip64_addrmap_stats ip64_addrmap_stats;
+
 #define FLAGS_NONE       0
 #define FLAGS_RECYCLABLE 1
 
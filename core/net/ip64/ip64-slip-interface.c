@@ -131,13 +131,13 @@ output(void)
   if(uip_ipaddr_cmp(&last_sender, &UIP_IP_BUF->srcipaddr)) {
     PRINTF("ip64-interface: output, not sending bounced message\n");
   } else {
+    /* Translate the packet in place and send the IPv4 packet from
+       where it ends up in uip_buf. */
     len = ip64_6to4(&uip_buf[UIP_LLH_LEN], uip_len,
-		    ip64_packet_buffer);
+		    &uip_buf[UIP_LLH_LEN + IP64_6TO4_INPLACE_OFFSET]);
     PRINTF("ip64-interface: output len %d\n", len);
     if(len > 0) {
-      memcpy(&uip_buf[UIP_LLH_LEN], ip64_packet_buffer, len);
-      uip_len = len;
-      slip_send();
+      slip_write(&uip_buf[UIP_LLH_LEN + IP64_6TO4_INPLACE_OFFSET], len);
       return len;
     }
   }
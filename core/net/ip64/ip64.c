@@ -63,6 +63,7 @@
 #include "net/ipv6/uip-ds6.h"
 #include "ip64-ipv4-dhcp.h"
 #include "contiki-net.h"
+#include "net/ip/uip-chksum.h"
 
 #include "net/ip/uip-debug.h"
 
@@ -185,6 +186,7 @@ ip64_init(void)
 
   uip_ipaddr(&ipv4_broadcast_addr, 255,255,255,255);
   ip64_hostaddr_configured = 0;
+  ip64_addrmap_init();
 
   PRINTF("ip64_init\n");
   IP64_ETH_DRIVER.init();
@@ -268,35 +270,35 @@ ip64_set_ipv6_address(const uip_ip6addr_t *addr)
 #endif /* DEBUG */
 }
 /*---------------------------------------------------------------------------*/
-static uint16_t
-chksum(uint16_t sum, const uint8_t *data, uint16_t len)
+/* Updates a transport layer checksum after header words summing to
+   old_sum have been replaced by words summing to new_sum, without
+   looking at the rest of the packet (RFC 1624, eqn. 3). */
+static void
+chksum_update(uint16_t *chksum_field, uint16_t old_sum, uint16_t new_sum)
 {
-  uint16_t t;
-  const uint8_t *dataptr;
-  const uint8_t *last_byte;
-
-  dataptr = data;
-  last_byte = data + len - 1;
-
-  while(dataptr < last_byte) {	/* At least two more bytes */
-    t = (dataptr[0] << 8) + dataptr[1];
-    sum += t;
-    if(sum < t) {
-      sum++;		/* carry */
-    }
-    dataptr += 2;
-  }
+  uint16_t sum;
 
-  if(dataptr == last_byte) {
-    t = (dataptr[0] << 8) + 0;
-    sum += t;
-    if(sum < t) {
-      sum++;		/* carry */
-    }
+  sum = ~uip_ntohs(*chksum_field);
+  sum += (uint16_t)~old_sum;
+  if(sum < (uint16_t)~old_sum) {
+    sum++;
+  }
+  sum += new_sum;
+  if(sum < new_sum) {
+    sum++;
   }
+  *chksum_field = uip_htons(~sum);
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+ipv6_pseudo_sum(const struct ipv6_hdr *hdr, uint16_t len, uint8_t proto)
+{
+  uint16_t sum;
 
-  /* Return sum in host byte order. */
-  return sum;
+  /* IP protocol and length fields. This addition cannot carry. */
+  sum = len + proto;
+  return uip_chksum_add(sum, (uint8_t *)&hdr->srcipaddr,
+                        2 * sizeof(uip_ip6addr_t));
 }
 /*---------------------------------------------------------------------------*/
 static uint16_t
@@ -304,7 +306,7 @@ ipv4_checksum(struct ipv4_hdr *hdr)
 {
   uint16_t sum;
 
-  sum = chksum(0, (uint8_t *)hdr, IPV4_HDRLEN);
+  sum = uip_chksum_add(0, (uint8_t *)hdr, IPV4_HDRLEN);
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
 /*---------------------------------------------------------------------------*/
@@ -323,14 +325,15 @@ ipv4_transport_checksum(const uint8_t *packet, uint16_t len, uint8_t proto)
     /* IP protocol and length fields. This addition cannot carry. */
     sum = transport_layer_len + proto;
     /* Sum IP source and destination addresses. */
-    sum = chksum(sum, (uint8_t *)&v4hdr->srcipaddr, 2 * sizeof(uip_ip4addr_t));
+    sum = uip_chksum_add(sum, (uint8_t *)&v4hdr->srcipaddr,
+                         2 * sizeof(uip_ip4addr_t));
   } else {
     /* ping replies' checksums are calculated over the icmp-part only */
     sum = 0;
   }
 
   /* Sum transport layer header and data. */
-  sum = chksum(sum, &packet[IPV4_HDRLEN], transport_layer_len);
+  sum = uip_chksum_add(sum, &packet[IPV4_HDRLEN], transport_layer_len);
 
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
@@ -349,11 +352,13 @@ ipv6_transport_checksum(const uint8_t *packet, uint16_t len, uint8_t proto)
   /* IP protocol and length fields. This addition cannot carry. */
   sum = transport_layer_len + proto;
   /* Sum IP source and destination addresses. */
-  sum = chksum(sum, (uint8_t *)&v6hdr->srcipaddr, sizeof(uip_ip6addr_t));
-  sum = chksum(sum, (uint8_t *)&v6hdr->destipaddr, sizeof(uip_ip6addr_t));
+  sum = uip_chksum_add(sum, (uint8_t *)&v6hdr->srcipaddr,
+                       sizeof(uip_ip6addr_t));
+  sum = uip_chksum_add(sum, (uint8_t *)&v6hdr->destipaddr,
+                       sizeof(uip_ip6addr_t));
 
   /* Sum transport layer header and data. */
-  sum = chksum(sum, &packet[IPV6_HDRLEN], transport_layer_len);
+  sum = uip_chksum_add(sum, &packet[IPV6_HDRLEN], transport_layer_len);
 
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
@@ -370,8 +375,13 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
   struct icmpv6_hdr *icmpv6hdr;
   uint16_t ipv6len, ipv4len;
   struct ip64_addrmap_entry *m;
+  struct ipv6_hdr v6hdr_copy;
+  uint16_t old_sum, new_sum;
 
-  v6hdr = (struct ipv6_hdr *)ipv6packet;
+  /* Work on a copy of the IPv6 header, since the IPv4 header may be
+     written on top of it. */
+  memcpy(&v6hdr_copy, ipv6packet, IPV6_HDRLEN);
+  v6hdr = &v6hdr_copy;
   v4hdr = (struct ipv4_hdr *)resultpacket;
 
   if((v6hdr->len[0] << 8) + v6hdr->len[1] <= ipv6packet_len) {
@@ -381,11 +391,32 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
     return 0;
   }
 
+  if(ipv6len - IPV6_HDRLEN < sizeof(struct icmpv4_hdr)) {
+    return 0;
+  }
+
+  /* Sum the parts of the packet that the translation will change: the
+     addresses and ports for TCP and UDP, whose pseudo-header length
+     and protocol stay the same, and the pseudo-header and message type
+     for ICMP. The transport checksum is then updated from the
+     difference, without summing the payload. */
+  if(v6hdr->nxthdr == IP_PROTO_ICMPV6) {
+    old_sum = ipv6_pseudo_sum(v6hdr, ipv6len - IPV6_HDRLEN, IP_PROTO_ICMPV6);
+    old_sum = uip_chksum_add(old_sum, &ipv6packet[IPV6_HDRLEN], 2);
+  } else {
+    old_sum = uip_chksum_add(0, (uint8_t *)&v6hdr->srcipaddr,
+                             2 * sizeof(uip_ip6addr_t));
+    old_sum = uip_chksum_add(old_sum, &ipv6packet[IPV6_HDRLEN], 4);
+  }
+
   /* We copy the data from the IPv6 packet into the IPv4 packet. We do
-     not modify the data in any way. */
-  memcpy(&resultpacket[IPV4_HDRLEN],
-	 &ipv6packet[IPV6_HDRLEN],
-	 ipv6len - IPV6_HDRLEN);
+     not modify the data in any way. When translating in place, the
+     data already is where it should be. */
+  if(resultpacket + IPV4_HDRLEN != ipv6packet + IPV6_HDRLEN) {
+    memcpy(&resultpacket[IPV4_HDRLEN],
+           &ipv6packet[IPV6_HDRLEN],
+           ipv6len - IPV6_HDRLEN);
+  }
 
   udphdr = (struct udp_hdr *)&resultpacket[IPV4_HDRLEN];
   tcphdr = (struct tcp_hdr *)&resultpacket[IPV4_HDRLEN];
@@ -424,15 +455,6 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
   case IP_PROTO_TCP:
     PRINTF("ip64_6to4: TCP header\n");
     v4hdr->proto = IP_PROTO_TCP;
-
-    /* Compute and check the TCP checksum - since we're going to
-       recompute it ourselves, we must ensure that it was correct in
-       the first place. */
-    if(ipv6_transport_checksum(ipv6packet, ipv6len,
-                               IP_PROTO_TCP) != 0xffff) {
-      PRINTF("Bad TCP checksum, dropping packet\n");
-    }
-
     break;
 
   case IP_PROTO_UDP:
@@ -442,17 +464,10 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
     /* Check if this is a DNS request. If so, we should rewrite it
        with the DNS64 module. */
     if(udphdr->destport == UIP_HTONS(DNS_PORT)) {
-      ip64_dns64_6to4((uint8_t *)v6hdr + IPV6_HDRLEN + sizeof(struct udp_hdr),
+      ip64_dns64_6to4(ipv6packet + IPV6_HDRLEN + sizeof(struct udp_hdr),
                       ipv6len - IPV6_HDRLEN - sizeof(struct udp_hdr),
                       (uint8_t *)udphdr + sizeof(struct udp_hdr),
-                      BUFSIZE - IPV4_HDRLEN - sizeof(struct udp_hdr));
-    }
-    /* Compute and check the UDP checksum - since we're going to
-       recompute it ourselves, we must ensure that it was correct in
-       the first place. */
-    if(ipv6_transport_checksum(ipv6packet, ipv6len,
-                               IP_PROTO_UDP) != 0xffff) {
-      PRINTF("Bad UDP checksum, dropping packet\n");
+                      ipv6len - IPV6_HDRLEN - sizeof(struct udp_hdr));
     }
     break;
 
@@ -614,27 +629,38 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
 
 
 
+  if(v4hdr->proto == IP_PROTO_ICMPV4) {
+    new_sum = uip_chksum_add(0, &resultpacket[IPV4_HDRLEN], 2);
+  } else {
+    new_sum = uip_chksum_add(0, (uint8_t *)&v4hdr->srcipaddr,
+                             2 * sizeof(uip_ip4addr_t));
+    new_sum = uip_chksum_add(new_sum, &resultpacket[IPV4_HDRLEN], 4);
+  }
+
   /* The checksum is in different places in the different protocol
      headers, so we need to be sure that we update the correct
-     field. */
+     field. Since the update does not look at the payload, a packet
+     that arrived with a bad checksum still has one after the
+     translation. */
   switch(v4hdr->proto) {
   case IP_PROTO_TCP:
-    tcphdr->tcpchksum = 0;
-    tcphdr->tcpchksum = ~(ipv4_transport_checksum(resultpacket, ipv4len,
-						  IP_PROTO_TCP));
+    chksum_update(&tcphdr->tcpchksum, old_sum, new_sum);
     break;
   case IP_PROTO_UDP:
-    udphdr->udpchksum = 0;
-    udphdr->udpchksum = ~(ipv4_transport_checksum(resultpacket, ipv4len,
-						  IP_PROTO_UDP));
+    if(udphdr->destport == UIP_HTONS(DNS_PORT)) {
+      /* The DNS64 module may have rewritten the payload. */
+      udphdr->udpchksum = 0;
+      udphdr->udpchksum = ~(ipv4_transport_checksum(resultpacket, ipv4len,
+                                                    IP_PROTO_UDP));
+    } else {
+      chksum_update(&udphdr->udpchksum, old_sum, new_sum);
+    }
     if(udphdr->udpchksum == 0) {
       udphdr->udpchksum = 0xffff;
     }
     break;
   case IP_PROTO_ICMPV4:
-    icmpv4hdr->icmpchksum = 0;
-    icmpv4hdr->icmpchksum = ~(ipv4_transport_checksum(resultpacket, ipv4len,
-						      IP_PROTO_ICMPV4));
+    chksum_update(&icmpv4hdr->icmpchksum, old_sum, new_sum);
     break;
 
   default:
@@ -659,6 +685,7 @@ ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4packet_len,
   struct icmpv6_hdr *icmpv6hdr;
   uint16_t ipv4len, ipv6len, ipv6_packet_len;
   struct ip64_addrmap_entry *m;
+  uint16_t old_sum, new_sum;
 
   v6hdr = (struct ipv6_hdr *)resultpacket;
   v4hdr = (struct ipv4_hdr *)ipv4packet;
@@ -670,7 +697,7 @@ ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4packet_len,
     return 0;
   }
 
-  if(ipv4len <= IPV4_HDRLEN) {
+  if(ipv4len < IPV4_HDRLEN + sizeof(struct icmpv4_hdr)) {
     return 0;
   }
 
@@ -680,6 +707,16 @@ ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4packet_len,
     PRINTF("ip64_4to6: packet too big to fit in buffer, dropping\n");
     return 0;
   }
+  /* Sum the parts of the packet that the translation will change, as
+     in ip64_6to4(). */
+  if(v4hdr->proto == IP_PROTO_ICMPV4) {
+    old_sum = uip_chksum_add(0, &ipv4packet[IPV4_HDRLEN], 2);
+  } else {
+    old_sum = uip_chksum_add(0, (uint8_t *)&v4hdr->srcipaddr,
+                             2 * sizeof(uip_ip4addr_t));
+    old_sum = uip_chksum_add(old_sum, &ipv4packet[IPV4_HDRLEN], 4);
+  }
+
   /* We copy the data from the IPv4 packet into the IPv6 packet. */
   memcpy(&resultpacket[IPV6_HDRLEN],
 	 &ipv4packet[IPV4_HDRLEN],
@@ -849,31 +886,40 @@ ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4packet_len,
     }
   }
 
+  if(v6hdr->nxthdr == IP_PROTO_ICMPV6) {
+    new_sum = ipv6_pseudo_sum(v6hdr, ipv6_packet_len, IP_PROTO_ICMPV6);
+    new_sum = uip_chksum_add(new_sum, &resultpacket[IPV6_HDRLEN], 2);
+  } else {
+    new_sum = uip_chksum_add(0, (uint8_t *)&v6hdr->srcipaddr,
+                             2 * sizeof(uip_ip6addr_t));
+    new_sum = uip_chksum_add(new_sum, &resultpacket[IPV6_HDRLEN], 4);
+  }
+
   /* The checksum is in different places in the different protocol
      headers, so we need to be sure that we update the correct
      field. */
   switch(v6hdr->nxthdr) {
   case IP_PROTO_TCP:
-    tcphdr->tcpchksum = 0;
-    tcphdr->tcpchksum = ~(ipv6_transport_checksum(resultpacket,
-						  ipv6len,
-						  IP_PROTO_TCP));
+    chksum_update(&tcphdr->tcpchksum, old_sum, new_sum);
     break;
   case IP_PROTO_UDP:
-    udphdr->udpchksum = 0;
-    udphdr->udpchksum = ~(ipv6_transport_checksum(resultpacket,
-						  ipv6len,
-						  IP_PROTO_UDP));
+    if(udphdr->srcport == UIP_HTONS(DNS_PORT) || udphdr->udpchksum == 0) {
+      /* The DNS64 module may have rewritten the payload, and IPv4 UDP
+         packets may come without a checksum, which IPv6 requires. */
+      udphdr->udpchksum = 0;
+      udphdr->udpchksum = ~(ipv6_transport_checksum(resultpacket,
+                                                    ipv6len,
+                                                    IP_PROTO_UDP));
+    } else {
+      chksum_update(&udphdr->udpchksum, old_sum, new_sum);
+    }
     if(udphdr->udpchksum == 0) {
       udphdr->udpchksum = 0xffff;
     }
     break;
 
   case IP_PROTO_ICMPV6:
-    icmpv6hdr->icmpchksum = 0;
-    icmpv6hdr->icmpchksum = ~(ipv6_transport_checksum(resultpacket,
-                                                ipv6len,
-                                                IP_PROTO_ICMPV6));
+    chksum_update(&icmpv6hdr->icmpchksum, old_sum, new_sum);
     break;
   default:
     PRINTF("ip64_4to6: transport protocol %d not implemented\n", v4hdr->proto);
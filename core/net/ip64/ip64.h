@@ -37,6 +37,12 @@
 void ip64_init(void);
 int ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6len,
               uint8_t *resultpacket);
+
+/* ip64_6to4() translates a packet in place, without moving its
+   payload, when resultpacket is ipv6packet + IP64_6TO4_INPLACE_OFFSET:
+   the IPv4 header then replaces the tail of the IPv6 header. */
+#define IP64_6TO4_INPLACE_OFFSET (40 - 20)
+
 int ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4len,
               uint8_t *resultpacket);
 
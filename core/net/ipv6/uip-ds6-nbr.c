@@ -51,6 +51,7 @@
 #include "net/linkaddr.h"
 #include "net/packetbuf.h"
 #include "net/ipv6/uip-ds6-nbr.h"
+#include "net/ip/tcpip.h"
 
 #define DEBUG DEBUG_NONE
 #include "net/ip/uip-debug.h"
@@ -127,6 +128,7 @@ uip_ds6_nbr_rm(uip_ds6_nbr_t *nbr)
     uip_packetqueue_free(&nbr->packethandle);
 #endif /* UIP_CONF_IPV6_QUEUE_PKT */
     NEIGHBOR_STATE_CHANGED(nbr);
+    tcpip_dest_cache_nbr_rm(nbr);
     return nbr_table_remove(ds6_neighbors, nbr);
   }
   return 0;
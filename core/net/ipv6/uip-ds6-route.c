@@ -43,6 +43,7 @@
 
 #include "lib/list.h"
 #include "lib/memb.h"
+#include "lib/hash.h"
 #include "net/nbr-table.h"
 
 #include <string.h>
@@ -75,6 +76,32 @@ MEMB(routememb, uip_ds6_route_t, UIP_DS6_ROUTE_NB);
 static int num_routes = 0;
 static void rm_routelist_callback(nbr_table_item_t *ptr);
 
+#if UIP_DS6_ROUTE_HASH
+/* All routes, keyed by prefix length and the prefix bytes that
+   uip_ipaddr_prefixcmp() compares, in an open-addressing hash table
+   with linear probing. The table size is the smallest power of two
+   that is at least twice the number of routes. */
+#define ROUTE_HASH_SIZE HASH_TABLE_SIZE(UIP_DS6_ROUTE_NB)
+#define ROUTE_HASH_MASK (ROUTE_HASH_SIZE - 1)
+static uip_ds6_route_t *route_hash[ROUTE_HASH_SIZE];
+/* Number of routes for each prefix length, and the prefix lengths in
+   use sorted from longest to shortest. */
+static uint16_t length_count[129];
+static uint8_t lengths[129];
+static uint8_t num_lengths;
+/* The last route on the route list, which is also linked backwards
+   through prev. */
+static uip_ds6_route_t *routelist_last;
+
+static void routelist_push(uip_ds6_route_t *r);
+static void routelist_remove(uip_ds6_route_t *r);
+#define routelist_tail() routelist_last
+#else /* UIP_DS6_ROUTE_HASH */
+#define routelist_push(r) list_push(routelist, r)
+#define routelist_remove(r) list_remove(routelist, r)
+#define routelist_tail() list_tail(routelist)
+#endif /* UIP_DS6_ROUTE_HASH */
+
 #endif /* (UIP_CONF_MAX_ROUTES != 0) */
 
 /* Default routes are held on the defaultrouterlist and their
@@ -156,12 +183,143 @@ uip_ds6_notification_rm(struct uip_ds6_notification *n)
 }
 #endif
 /*---------------------------------------------------------------------------*/
+#if (UIP_CONF_MAX_ROUTES != 0) && UIP_DS6_ROUTE_HASH
+static unsigned
+route_hash_key(const uip_ipaddr_t *addr, uint8_t length)
+{
+  uint32_t h;
+
+  h = hash_data(&length, 1, HASH_INIT);
+  h = hash_data(addr->u8, length >> 3, h);
+  return (unsigned)hash_finish(h) & ROUTE_HASH_MASK;
+}
+/*---------------------------------------------------------------------------*/
+static void
+route_hash_insert(uip_ds6_route_t *r)
+{
+  unsigned slot;
+  int i;
+
+  slot = route_hash_key(&r->ipaddr, r->length);
+  while(route_hash[slot] != NULL) {
+    slot = (slot + 1) & ROUTE_HASH_MASK;
+  }
+  route_hash[slot] = r;
+
+  if(length_count[r->length]++ == 0) {
+    /* Keep the lengths sorted, longest first. */
+    for(i = num_lengths; i > 0 && lengths[i - 1] < r->length; i--) {
+      lengths[i] = lengths[i - 1];
+    }
+    lengths[i] = r->length;
+    num_lengths++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+route_hash_remove(uip_ds6_route_t *r)
+{
+  unsigned hole, slot, home;
+  int i;
+
+  hole = route_hash_key(&r->ipaddr, r->length);
+  while(route_hash[hole] != r) {
+    if(route_hash[hole] == NULL) {
+      return;
+    }
+    hole = (hole + 1) & ROUTE_HASH_MASK;
+  }
+
+  /* Shift back the following entries of the probe sequence, so that
+     no tombstones are needed. */
+  slot = hole;
+  while(1) {
+    slot = (slot + 1) & ROUTE_HASH_MASK;
+    if(route_hash[slot] == NULL) {
+      break;
+    }
+    home = route_hash_key(&route_hash[slot]->ipaddr, route_hash[slot]->length);
+    /* Move the entry unless its home lies cyclically in (hole, slot] */
+    if((hole <= slot) ? (home <= hole || home > slot)
+                      : (home <= hole && home > slot)) {
+      route_hash[hole] = route_hash[slot];
+      hole = slot;
+    }
+  }
+  route_hash[hole] = NULL;
+
+  if(--length_count[r->length] == 0) {
+    for(i = 0; i < num_lengths && lengths[i] != r->length; i++);
+    for(; i + 1 < num_lengths; i++) {
+      lengths[i] = lengths[i + 1];
+    }
+    num_lengths--;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_route_t *
+route_hash_lookup(const uip_ipaddr_t *addr)
+{
+  uip_ds6_route_t *r;
+  unsigned slot;
+  uint8_t length;
+  int i;
+
+  for(i = 0; i < num_lengths; i++) {
+    length = lengths[i];
+    slot = route_hash_key(addr, length);
+    while((r = route_hash[slot]) != NULL) {
+      if(r->length == length && uip_ipaddr_prefixcmp(addr, &r->ipaddr, length)) {
+        return r;
+      }
+      slot = (slot + 1) & ROUTE_HASH_MASK;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+routelist_push(uip_ds6_route_t *r)
+{
+  r->prev = NULL;
+  r->next = list_head(routelist);
+  if(r->next != NULL) {
+    r->next->prev = r;
+  } else {
+    routelist_last = r;
+  }
+  *routelist = r;
+}
+/*---------------------------------------------------------------------------*/
+static void
+routelist_remove(uip_ds6_route_t *r)
+{
+  if(r->prev != NULL) {
+    r->prev->next = r->next;
+  } else {
+    *routelist = r->next;
+  }
+  if(r->next != NULL) {
+    r->next->prev = r->prev;
+  } else {
+    routelist_last = r->prev;
+  }
+  r->next = r->prev = NULL;
+}
+#endif /* (UIP_CONF_MAX_ROUTES != 0) && UIP_DS6_ROUTE_HASH */
+/*---------------------------------------------------------------------------*/
 void
 uip_ds6_route_init(void)
 {
 #if (UIP_CONF_MAX_ROUTES != 0)
   memb_init(&routememb);
   list_init(routelist);
+#if UIP_DS6_ROUTE_HASH
+  memset(route_hash, 0, sizeof(route_hash));
+  memset(length_count, 0, sizeof(length_count));
+  num_lengths = 0;
+  routelist_last = NULL;
+#endif /* UIP_DS6_ROUTE_HASH */
   nbr_table_register(nbr_routes,
                      (nbr_table_callback *)rm_routelist_callback);
 #endif /* (UIP_CONF_MAX_ROUTES != 0) */
@@ -254,15 +412,20 @@ uip_ds6_route_t *
 uip_ds6_route_lookup(uip_ipaddr_t *addr)
 {
 #if (UIP_CONF_MAX_ROUTES != 0)
-  uip_ds6_route_t *r;
   uip_ds6_route_t *found_route;
+#if !UIP_DS6_ROUTE_HASH
+  uip_ds6_route_t *r;
   uint8_t longestmatch;
+#endif /* !UIP_DS6_ROUTE_HASH */
 
   PRINTF("uip-ds6-route: Looking up route for ");
   PRINT6ADDR(addr);
   PRINTF("\n");
 
 
+#if UIP_DS6_ROUTE_HASH
+  found_route = route_hash_lookup(addr);
+#else /* UIP_DS6_ROUTE_HASH */
   found_route = NULL;
   longestmatch = 0;
   for(r = uip_ds6_route_head();
@@ -278,6 +441,7 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
       }
     }
   }
+#endif /* UIP_DS6_ROUTE_HASH */
 
   if(found_route != NULL) {
     PRINTF("uip-ds6-route: Found route: ");
@@ -289,14 +453,8 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
     PRINTF("uip-ds6-route: No route found\n");
   }
 
-  if(found_route != NULL && found_route != list_head(routelist)) {
-    /* If we found a route, we put it at the start of the routeslist
-       list. The list is ordered by how recently we looked them up:
-       the least recently used route will be at the end of the
-       list - for fast lookups (assuming multiple packets to the same node). */
-
-    list_remove(routelist, found_route);
-    list_push(routelist, found_route);
+  if(found_route != NULL) {
+    uip_ds6_route_touch(found_route);
   }
 
   return found_route;
@@ -305,6 +463,22 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
 #endif /* (UIP_CONF_MAX_ROUTES != 0) */
 }
 /*---------------------------------------------------------------------------*/
+void
+uip_ds6_route_touch(uip_ds6_route_t *route)
+{
+#if (UIP_CONF_MAX_ROUTES != 0)
+  if(route != list_head(routelist)) {
+    /* We put the route at the start of the routeslist list. The list
+       is ordered by how recently we looked them up: the least recently
+       used route will be at the end of the list - for fast lookups
+       (assuming multiple packets to the same node). */
+
+    routelist_remove(route);
+    routelist_push(route);
+  }
+#endif /* (UIP_CONF_MAX_ROUTES != 0) */
+}
+/*---------------------------------------------------------------------------*/
 uip_ds6_route_t *
 uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
 		  uip_ipaddr_t *nexthop)
@@ -355,7 +529,7 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
 #if UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED
       /* Removing the oldest route entry from the route table. The
          least recently used route is the first route on the list. */
-      oldest = list_tail(routelist);
+      oldest = routelist_tail();
 #endif
       if(oldest == NULL) {
         return NULL;
@@ -411,7 +585,7 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
 
     /* add new routes first - assuming that there is a reason to add this
        and that there is a packet coming soon. */
-    list_push(routelist, r);
+    routelist_push(r);
 
     nbrr = memb_alloc(&neighborroutememb);
     if(nbrr == NULL) {
@@ -436,6 +610,9 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
 
   uip_ipaddr_copy(&(r->ipaddr), ipaddr);
   r->length = length;
+#if UIP_DS6_ROUTE_HASH
+  route_hash_insert(r);
+#endif /* UIP_DS6_ROUTE_HASH */
 
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   memset(&r->state, 0, sizeof(UIP_DS6_ROUTE_STATE_TYPE));
@@ -478,7 +655,10 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
     PRINTF("\n");
 
     /* Remove the route from the route list */
-    list_remove(routelist, route);
+    routelist_remove(route);
+#if UIP_DS6_ROUTE_HASH
+    route_hash_remove(route);
+#endif /* UIP_DS6_ROUTE_HASH */
 
     /* Find the corresponding neighbor_route and remove it. */
     for(neighbor_route = list_head(route->neighbor_routes->route_list);
@@ -92,6 +92,18 @@ void uip_ds6_notification_rm(struct uip_ds6_notification *n);
 #define UIP_DS6_ROUTE_NB UIP_CONF_MAX_ROUTES
 #endif /* UIP_CONF_MAX_ROUTES */
 
+/** \brief Index routes in one hash table per prefix length, so that
+ *  uip_ds6_route_lookup() costs one probe sequence per prefix length
+ *  in use instead of a scan of the whole route list. The route list
+ *  is then also linked backwards, so that moving a route to the front
+ *  on lookup, removing it, and finding the least recently used route
+ *  take constant time. */
+#ifdef UIP_DS6_ROUTE_CONF_HASH
+#define UIP_DS6_ROUTE_HASH UIP_DS6_ROUTE_CONF_HASH
+#else /* UIP_DS6_ROUTE_CONF_HASH */
+#define UIP_DS6_ROUTE_HASH 0
+#endif /* UIP_DS6_ROUTE_CONF_HASH */
+
 /** \brief define some additional RPL related route state and
  *  neighbor callback for RPL - if not a DS6_ROUTE_STATE is already set */
 #ifndef UIP_DS6_ROUTE_STATE_TYPE
@@ -151,6 +163,9 @@ struct uip_ds6_route_neighbor_routes {
 /** \brief An entry in the routing table */
 typedef struct uip_ds6_route {
   struct uip_ds6_route *next;
+#if UIP_DS6_ROUTE_HASH
+  struct uip_ds6_route *prev;
+#endif /* UIP_DS6_ROUTE_HASH */
   /* Each route entry belongs to a specific neighbor. That neighbor
      holds a list of all routing entries that go through it. The
      routes field point to the uip_ds6_route_neighbor_routes that
@@ -194,6 +209,8 @@ void uip_ds6_defrt_periodic(void);
 /** \name Routing Table basic routines */
 /** @{ */
 uip_ds6_route_t *uip_ds6_route_lookup(uip_ipaddr_t *destipaddr);
+/* Marks a route as used, as a lookup that finds it does */
+void uip_ds6_route_touch(uip_ds6_route_t *route);
 uip_ds6_route_t *uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
                                    uip_ipaddr_t *next_hop);
 void uip_ds6_route_rm(uip_ds6_route_t *route);
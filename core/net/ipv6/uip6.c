@@ -74,6 +74,7 @@
 #include "sys/cc.h"
 #include "net/ip/uip.h"
 #include "net/ip/uipopt.h"
+#include "net/ip/uip-chksum.h"
 #include "net/ipv6/uip-icmp6.h"
 #include "net/ipv6/uip-nd6.h"
 #include "net/ipv6/uip-ds6.h"
@@ -252,6 +253,20 @@ static uint8_t iss[4];
 
 /* Temporary variables. */
 uint8_t uip_acc32[4];
+
+#if UIP_TCP_SEND_WINDOW
+struct uip_conn *uip_tcp_more;
+
+/* Offset of the outgoing segment in the send window, or -1 for the
+   next unsent byte. */
+static int tcp_seq_off;
+
+/* Set when three duplicate ACKs asked for a fast retransmit. */
+static uint8_t tcp_fast_rexmit;
+
+#define TCP_WINDOWED(conn) (((conn)->wndflags & UIP_WND_ENABLED) && \
+                            ((conn)->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED)
+#endif /* UIP_TCP_SEND_WINDOW */
 #endif /* UIP_TCP */
 /** @} */
 
@@ -317,41 +332,10 @@ uip_add32(uint8_t *op32, uint16_t op16)
 
 #if ! UIP_ARCH_CHKSUM
 /*---------------------------------------------------------------------------*/
-static uint16_t
-chksum(uint16_t sum, const uint8_t *data, uint16_t len)
-{
-  uint16_t t;
-  const uint8_t *dataptr;
-  const uint8_t *last_byte;
-
-  dataptr = data;
-  last_byte = data + len - 1;
-
-  while(dataptr < last_byte) {   /* At least two more bytes */
-    t = (dataptr[0] << 8) + dataptr[1];
-    sum += t;
-    if(sum < t) {
-      sum++;      /* carry */
-    }
-    dataptr += 2;
-  }
-
-  if(dataptr == last_byte) {
-    t = (dataptr[0] << 8) + 0;
-    sum += t;
-    if(sum < t) {
-      sum++;      /* carry */
-    }
-  }
-
-  /* Return sum in host byte order. */
-  return sum;
-}
-/*---------------------------------------------------------------------------*/
 uint16_t
 uip_chksum(uint16_t *data, uint16_t len)
 {
-  return uip_htons(chksum(0, (uint8_t *)data, len));
+  return uip_htons(uip_chksum_add(0, (uint8_t *)data, len));
 }
 /*---------------------------------------------------------------------------*/
 #ifndef UIP_ARCH_IPCHKSUM
@@ -360,7 +344,7 @@ uip_ipchksum(void)
 {
   uint16_t sum;
 
-  sum = chksum(0, &uip_buf[UIP_LLH_LEN], UIP_IPH_LEN);
+  sum = uip_chksum_add(0, &uip_buf[UIP_LLH_LEN], UIP_IPH_LEN);
   PRINTF("uip_ipchksum: sum 0x%04x\n", sum);
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
@@ -390,11 +374,12 @@ upper_layer_chksum(uint8_t proto)
   /* IP protocol and length fields. This addition cannot carry. */
   sum = upper_layer_len + proto;
   /* Sum IP source and destination addresses. */
-  sum = chksum(sum, (uint8_t *)&UIP_IP_BUF->srcipaddr, 2 * sizeof(uip_ipaddr_t));
+  sum = uip_chksum_add(sum, (uint8_t *)&UIP_IP_BUF->srcipaddr,
+                       2 * sizeof(uip_ipaddr_t));
 
   /* Sum TCP header and data. */
-  sum = chksum(sum, &uip_buf[UIP_IPH_LEN + UIP_LLH_LEN + uip_ext_len],
-               upper_layer_len);
+  sum = uip_chksum_add(sum, &uip_buf[UIP_IPH_LEN + UIP_LLH_LEN + uip_ext_len],
+                       upper_layer_len);
 
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
@@ -520,6 +505,12 @@ uip_connect(const uip_ipaddr_t *ripaddr, uint16_t rport)
   conn->rto = UIP_RTO;
   conn->sa = 0;
   conn->sv = 16;   /* Initial value of the RTT variance. */
+#if UIP_TCP_SEND_WINDOW
+  conn->wndflags = 0;
+  conn->sent = 0;
+  conn->rtt_len = 0;
+  conn->dupacks = 0;
+#endif /* UIP_TCP_SEND_WINDOW */
   conn->lport = uip_htons(lastport);
   conn->rport = rport;
   uip_ipaddr_copy(&conn->ripaddr, ripaddr);
@@ -849,8 +840,125 @@ uip_add_rcv_nxt(uint16_t n)
   uip_conn->rcv_nxt[2] = uip_acc32[2];
   uip_conn->rcv_nxt[3] = uip_acc32[3];
 }
+/*---------------------------------------------------------------------------*/
+static void
+tcp_update_rto(struct uip_conn *conn, signed char m)
+{
+  /* This is taken directly from VJs original code in his paper */
+  m = m - (conn->sa >> 3);
+  conn->sa += m;
+  if(m < 0) {
+    m = -m;
+  }
+  m = m - (conn->sv >> 2);
+  conn->sv += m;
+  conn->rto = (conn->sa >> 3) + conn->sv;
+}
 #endif
 /*---------------------------------------------------------------------------*/
+#if UIP_TCP && UIP_TCP_SEND_WINDOW
+static uint32_t
+tcp_seq32(const uint8_t *seq)
+{
+  return ((uint32_t)seq[0] << 24) | ((uint32_t)seq[1] << 16) |
+    ((uint32_t)seq[2] << 8) | seq[3];
+}
+/*---------------------------------------------------------------------------*/
+/* Sets the mss of a windowed connection to the amount of new data the
+   application may send now: nothing while buffered data waits to be
+   resent, otherwise what fits in both windows, at most one segment.
+   To avoid the silly window syndrome, a partial segment is only
+   allowed when nothing is in flight. */
+static void
+tcp_window_room(struct uip_conn *conn)
+{
+  uint16_t wnd;
+
+  if(!TCP_WINDOWED(conn)) {
+    return;
+  }
+  wnd = MIN(conn->snd_wnd, UIP_TCP_SEND_WINDOW);
+  if(conn->sent < conn->len || wnd <= conn->len) {
+    conn->mss = 0;
+  } else {
+    conn->mss = MIN(wnd - conn->len, conn->initialmss);
+    if(conn->mss < conn->initialmss && conn->len > 0) {
+      conn->mss = 0;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Takes the peer's window from the segment that established the
+   connection. A zero window is treated as one segment, as with mss. */
+static void
+tcp_window_init(struct uip_conn *conn)
+{
+  conn->snd_wnd = ((uint16_t)UIP_TCP_BUF->wnd[0] << 8) + UIP_TCP_BUF->wnd[1];
+  if(conn->snd_wnd == 0) {
+    conn->snd_wnd = conn->initialmss;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Processes a cumulative ACK on a windowed connection. */
+static void
+tcp_window_ack(struct uip_conn *conn)
+{
+  uint32_t acked;
+  uint16_t wnd;
+
+  acked = tcp_seq32(UIP_TCP_BUF->ackno) - tcp_seq32(conn->snd_nxt);
+  wnd = ((uint16_t)UIP_TCP_BUF->wnd[0] << 8) + (uint16_t)UIP_TCP_BUF->wnd[1];
+
+  if(acked > 0 && acked <= conn->len) {
+    /* Karn's algorithm: only segments that were not retransmitted are
+       timed, and rtt_len is cleared on retransmission. */
+    if(conn->rtt_len > 0) {
+      if(acked >= conn->rtt_len) {
+        tcp_update_rto(conn, conn->rtt_ticks);
+        conn->rtt_len = 0;
+      } else {
+        conn->rtt_len -= acked;
+      }
+    }
+
+    memmove(conn->snd_buf, conn->snd_buf + acked, conn->len - acked);
+    conn->len -= acked;
+    conn->sent = conn->sent > acked ? conn->sent - acked : 0;
+    uip_add32(conn->snd_nxt, acked);
+    memcpy(conn->snd_nxt, uip_acc32, 4);
+
+    conn->dupacks = 0;
+    conn->nrtx = 0;
+    conn->timer = conn->rto;
+    uip_flags = UIP_ACKDATA;
+  } else if(acked == 0 && uip_len == 0 &&
+            (UIP_TCP_BUF->flags & (TCP_SYN | TCP_FIN)) == 0 &&
+            wnd == conn->snd_wnd && conn->sent > 0) {
+    /* A duplicate ACK: the peer got a segment past a hole. */
+    if(++conn->dupacks == 3) {
+      conn->rtt_len = 0;
+      tcp_fast_rexmit = 1;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Calls the application, unless it has closed a windowed connection
+   that still drains its send window. The FIN is sent once all data is
+   acknowledged. */
+static void
+tcp_window_appcall(void)
+{
+  if(uip_conn->wndflags & UIP_WND_CLOSING) {
+    uip_flags = uip_conn->len == 0 ? UIP_CLOSE : (uip_flags & UIP_NEWDATA);
+  } else {
+    UIP_APPCALL();
+  }
+}
+#define TCP_APPCALL() tcp_window_appcall()
+#else /* UIP_TCP && UIP_TCP_SEND_WINDOW */
+#define TCP_APPCALL() UIP_APPCALL()
+#endif /* UIP_TCP && UIP_TCP_SEND_WINDOW */
+/*---------------------------------------------------------------------------*/
 
 /**
  * \brief Process the options in Destination and Hop By Hop extension headers
@@ -944,6 +1052,11 @@ uip_process(uint8_t flag)
   uint16_t tmp16;
   uint8_t opt;
   register struct uip_conn *uip_connr = uip_conn;
+#if UIP_TCP_SEND_WINDOW
+  uip_tcp_more = NULL;
+  tcp_seq_off = -1;
+  tcp_fast_rexmit = 0;
+#endif /* UIP_TCP_SEND_WINDOW */
 #endif /* UIP_TCP */
 #if UIP_UDP
   if(flag == UIP_UDP_SEND_CONN) {
@@ -956,6 +1069,20 @@ uip_process(uint8_t flag)
      particular connection. */
   if(flag == UIP_POLL_REQUEST) {
 #if UIP_TCP
+#if UIP_TCP_SEND_WINDOW
+    /* A connection with a send window may add data while earlier
+       segments are still in flight. */
+    if(TCP_WINDOWED(uip_connr)) {
+      tcp_window_room(uip_connr);
+      if(uip_connr->mss > 0) {
+        uip_slen = 0;
+        uip_flags = UIP_POLL;
+        TCP_APPCALL();
+        goto appsend;
+      }
+      goto drop;
+    }
+#endif /* UIP_TCP_SEND_WINDOW */
     if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
        !uip_outstanding(uip_connr)) {
       uip_flags = UIP_POLL;
@@ -999,6 +1126,11 @@ uip_process(uint8_t flag)
         uip_connr->tcpstateflags = UIP_CLOSED;
       }
     } else if(uip_connr->tcpstateflags != UIP_CLOSED) {
+#if UIP_TCP_SEND_WINDOW
+      if(uip_connr->rtt_len > 0 && uip_connr->rtt_ticks < 127) {
+        ++(uip_connr->rtt_ticks);
+      }
+#endif /* UIP_TCP_SEND_WINDOW */
       /*
        * If the connection has outstanding data, we increase the
        * connection's timer and see if it has reached the RTO value
@@ -1053,6 +1185,20 @@ uip_process(uint8_t flag)
 #endif /* UIP_ACTIVE_OPEN */
 
           case UIP_ESTABLISHED:
+#if UIP_TCP_SEND_WINDOW
+            /*
+             * With a send window, we go back to the first
+             * unacknowledged byte and resend from the buffer. The
+             * rest follows as ACKs come in.
+             */
+            if(TCP_WINDOWED(uip_connr)) {
+              uip_connr->sent = 0;
+              uip_connr->rtt_len = 0;
+              uip_connr->dupacks = 0;
+              tcp_seq_off = 0;
+              goto tcp_send_window;
+            }
+#endif /* UIP_TCP_SEND_WINDOW */
             /*
              * In the ESTABLISHED state, we call upon the application
              * to do the actual retransmit after which we jump into
@@ -1075,8 +1221,11 @@ uip_process(uint8_t flag)
          * If there was no need for a retransmission, we poll the
          * application for new data.
          */
+#if UIP_TCP_SEND_WINDOW
+        tcp_window_room(uip_connr);
+#endif /* UIP_TCP_SEND_WINDOW */
         uip_flags = UIP_POLL;
-        UIP_APPCALL();
+        TCP_APPCALL();
         goto appsend;
       }
     }
@@ -1739,6 +1888,12 @@ uip_process(uint8_t flag)
   uip_connr->sa = 0;
   uip_connr->sv = 4;
   uip_connr->nrtx = 0;
+#if UIP_TCP_SEND_WINDOW
+  uip_connr->wndflags = 0;
+  uip_connr->sent = 0;
+  uip_connr->rtt_len = 0;
+  uip_connr->dupacks = 0;
+#endif /* UIP_TCP_SEND_WINDOW */
   uip_connr->lport = UIP_TCP_BUF->destport;
   uip_connr->rport = UIP_TCP_BUF->srcport;
   uip_ipaddr_copy(&uip_connr->ripaddr, &UIP_IP_BUF->srcipaddr);
@@ -1866,6 +2021,12 @@ uip_process(uint8_t flag)
      data. If so, we update the sequence number, reset the length of
      the outstanding data, calculate RTT estimations, and reset the
      retransmission timer. */
+#if UIP_TCP_SEND_WINDOW
+  if((UIP_TCP_BUF->flags & TCP_ACK) && uip_outstanding(uip_connr) &&
+     TCP_WINDOWED(uip_connr)) {
+    tcp_window_ack(uip_connr);
+  } else
+#endif /* UIP_TCP_SEND_WINDOW */
   if((UIP_TCP_BUF->flags & TCP_ACK) && uip_outstanding(uip_connr)) {
     uip_add32(uip_connr->snd_nxt, uip_connr->len);
 
@@ -1881,18 +2042,7 @@ uip_process(uint8_t flag)
 
       /* Do RTT estimation, unless we have done retransmissions. */
       if(uip_connr->nrtx == 0) {
-        signed char m;
-        m = uip_connr->rto - uip_connr->timer;
-        /* This is taken directly from VJs original code in his paper */
-        m = m - (uip_connr->sa >> 3);
-        uip_connr->sa += m;
-        if(m < 0) {
-          m = -m;
-        }
-        m = m - (uip_connr->sv >> 2);
-        uip_connr->sv += m;
-        uip_connr->rto = (uip_connr->sa >> 3) + uip_connr->sv;
-
+        tcp_update_rto(uip_connr, uip_connr->rto - uip_connr->timer);
       }
       /* Set the acknowledged flag. */
       uip_flags = UIP_ACKDATA;
@@ -1920,6 +2070,9 @@ uip_process(uint8_t flag)
       uip_connr->tcpstateflags = UIP_ESTABLISHED;
       uip_flags = UIP_CONNECTED;
       uip_connr->len = 0;
+#if UIP_TCP_SEND_WINDOW
+      tcp_window_init(uip_connr);
+#endif /* UIP_TCP_SEND_WINDOW */
       if(uip_len > 0) {
         uip_flags |= UIP_NEWDATA;
         uip_add_rcv_nxt(uip_len);
@@ -1982,6 +2135,9 @@ uip_process(uint8_t flag)
       uip_add_rcv_nxt(1);
       uip_flags = UIP_CONNECTED | UIP_NEWDATA;
       uip_connr->len = 0;
+#if UIP_TCP_SEND_WINDOW
+      tcp_window_init(uip_connr);
+#endif /* UIP_TCP_SEND_WINDOW */
       uip_clear_buf();
       uip_slen = 0;
       UIP_APPCALL();
@@ -2069,11 +2225,21 @@ uip_process(uint8_t flag)
          "persistent timer" and uses the retransmission mechanim.
      */
     tmp16 = ((uint16_t)UIP_TCP_BUF->wnd[0] << 8) + (uint16_t)UIP_TCP_BUF->wnd[1];
-    if(tmp16 > uip_connr->initialmss ||
-        tmp16 == 0) {
-      tmp16 = uip_connr->initialmss;
+#if UIP_TCP_SEND_WINDOW
+    if(TCP_WINDOWED(uip_connr)) {
+      /* Only a zero window is raised to the initial MSS here; the
+         rest of the window may be filled with more segments. */
+      uip_connr->snd_wnd = tmp16 == 0 ? uip_connr->initialmss : tmp16;
+      tcp_window_room(uip_connr);
+    } else
+#endif /* UIP_TCP_SEND_WINDOW */
+    {
+      if(tmp16 > uip_connr->initialmss ||
+         tmp16 == 0) {
+        tmp16 = uip_connr->initialmss;
+      }
+      uip_connr->mss = tmp16;
     }
-    uip_connr->mss = tmp16;
 
     /* If this packet constitutes an ACK for outstanding data (flagged
          by the UIP_ACKDATA flag, we should call the application since it
@@ -2093,7 +2259,7 @@ uip_process(uint8_t flag)
          send, uip_len must be set to 0. */
     if(uip_flags & (UIP_NEWDATA | UIP_ACKDATA)) {
       uip_slen = 0;
-      UIP_APPCALL();
+      TCP_APPCALL();
 
       appsend:
 
@@ -2104,6 +2270,17 @@ uip_process(uint8_t flag)
         goto tcp_send_nodata;
       }
 
+#if UIP_TCP_SEND_WINDOW
+      /* With data in the send window, or data sent along with the
+         close, the FIN has to wait until everything has been
+         acknowledged. */
+      if((uip_flags & UIP_CLOSE) && TCP_WINDOWED(uip_connr) &&
+         (uip_outstanding(uip_connr) || uip_slen > 0)) {
+        uip_connr->wndflags |= UIP_WND_CLOSING;
+        uip_flags = 0;
+      }
+#endif /* UIP_TCP_SEND_WINDOW */
+
       if(uip_flags & UIP_CLOSE) {
         uip_slen = 0;
         uip_connr->len = 1;
@@ -2114,6 +2291,26 @@ uip_process(uint8_t flag)
       }
 
       /* If uip_slen > 0, the application has data to be sent. */
+#if UIP_TCP_SEND_WINDOW
+      if(uip_slen > 0 && TCP_WINDOWED(uip_connr)) {
+        /* Append the data to the send window. It is sent right away,
+           and kept until it has been acknowledged. */
+        if(uip_slen > uip_connr->mss) {
+          uip_slen = uip_connr->mss;
+        }
+        memcpy(&uip_connr->snd_buf[uip_connr->len], uip_sappdata, uip_slen);
+        tcp_seq_off = uip_connr->len;
+        if(uip_connr->rtt_len == 0) {
+          uip_connr->rtt_len = uip_connr->len + uip_slen;
+          uip_connr->rtt_ticks = 0;
+        }
+        if(uip_connr->len == 0) {
+          uip_connr->timer = uip_connr->rto;
+        }
+        uip_connr->len += uip_slen;
+        uip_connr->sent = uip_connr->len;
+      } else
+#endif /* UIP_TCP_SEND_WINDOW */
       if(uip_slen > 0) {
 
         /* If the connection has acknowledged data, the contents of
@@ -2145,10 +2342,46 @@ uip_process(uint8_t flag)
           uip_slen = uip_connr->len;
         }
       }
+#if UIP_TCP_SEND_WINDOW
+      /* With a send window, nrtx is reset when new data is acked. */
+      if(!TCP_WINDOWED(uip_connr)) {
+        uip_connr->nrtx = 0;
+      }
+#else /* UIP_TCP_SEND_WINDOW */
       uip_connr->nrtx = 0;
+#endif /* UIP_TCP_SEND_WINDOW */
       apprexmit:
       uip_appdata = uip_sappdata;
 
+#if UIP_TCP_SEND_WINDOW
+      if(TCP_WINDOWED(uip_connr)) {
+        if(uip_slen > 0) {
+          uip_len = uip_slen + UIP_TCPIP_HLEN;
+          UIP_TCP_BUF->flags = TCP_ACK | TCP_PSH;
+          /* Let the caller poll us again if the window has room for
+             another segment. */
+          tcp_window_room(uip_connr);
+          if(uip_connr->mss > 0) {
+            uip_tcp_more = uip_connr;
+          }
+          goto tcp_send_noopts;
+        }
+        if(uip_connr->sent < uip_connr->len) {
+          /* Continue resending after a retransmission time-out, one
+             segment per incoming ACK. */
+          tcp_seq_off = uip_connr->sent;
+          tcp_send_window:
+          uip_slen = MIN(uip_connr->len - tcp_seq_off, uip_connr->initialmss);
+          memcpy(uip_sappdata, &uip_connr->snd_buf[tcp_seq_off], uip_slen);
+          if(tcp_seq_off == uip_connr->sent) {
+            uip_connr->sent += uip_slen;
+          }
+          uip_len = uip_slen + UIP_TCPIP_HLEN;
+          UIP_TCP_BUF->flags = TCP_ACK | TCP_PSH;
+          goto tcp_send_noopts;
+        }
+      } else
+#endif /* UIP_TCP_SEND_WINDOW */
       /* If the application has data to be sent, or if the incoming
            packet had new data in it, we must send out a packet. */
       if(uip_slen > 0 && uip_connr->len > 0) {
@@ -2167,6 +2400,15 @@ uip_process(uint8_t flag)
         goto tcp_send_noopts;
       }
     }
+#if UIP_TCP_SEND_WINDOW
+    if(tcp_fast_rexmit) {
+      /* Three duplicate ACKs: resend the first unacknowledged segment
+         without waiting for the retransmission timer. */
+      UIP_STAT(++uip_stat.tcp.rexmit);
+      tcp_seq_off = 0;
+      goto tcp_send_window;
+    }
+#endif /* UIP_TCP_SEND_WINDOW */
     goto drop;
   case UIP_LAST_ACK:
     /* We can close this connection if the peer has acknowledged our
@@ -2258,10 +2500,21 @@ uip_process(uint8_t flag)
   UIP_TCP_BUF->ackno[2] = uip_connr->rcv_nxt[2];
   UIP_TCP_BUF->ackno[3] = uip_connr->rcv_nxt[3];
 
-  UIP_TCP_BUF->seqno[0] = uip_connr->snd_nxt[0];
-  UIP_TCP_BUF->seqno[1] = uip_connr->snd_nxt[1];
-  UIP_TCP_BUF->seqno[2] = uip_connr->snd_nxt[2];
-  UIP_TCP_BUF->seqno[3] = uip_connr->snd_nxt[3];
+#if UIP_TCP_SEND_WINDOW
+  if(TCP_WINDOWED(uip_connr)) {
+    /* Segments without data carry the sequence number of the next
+       unsent byte. */
+    uip_add32(uip_connr->snd_nxt,
+              tcp_seq_off >= 0 ? tcp_seq_off : uip_connr->sent);
+    memcpy(UIP_TCP_BUF->seqno, uip_acc32, 4);
+  } else
+#endif /* UIP_TCP_SEND_WINDOW */
+  {
+    UIP_TCP_BUF->seqno[0] = uip_connr->snd_nxt[0];
+    UIP_TCP_BUF->seqno[1] = uip_connr->snd_nxt[1];
+    UIP_TCP_BUF->seqno[2] = uip_connr->snd_nxt[2];
+    UIP_TCP_BUF->seqno[3] = uip_connr->snd_nxt[3];
+  }
 
   UIP_TCP_BUF->srcport  = uip_connr->lport;
   UIP_TCP_BUF->destport = uip_connr->rport;
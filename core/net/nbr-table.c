@@ -38,6 +38,7 @@
 #include <string.h>
 #include "lib/memb.h"
 #include "lib/list.h"
+#include "lib/hash.h"
 #include "net/nbr-table.h"
 
 #define DEBUG 0
@@ -83,6 +84,27 @@ static unsigned num_tables;
 MEMB(neighbor_addr_mem, nbr_table_key_t, NBR_TABLE_MAX_NEIGHBORS);
 LIST(nbr_table_keys);
 
+#if NBR_TABLE_HASH
+/* Open-addressing hash index from link-layer address to neighbor
+ * index, with linear probing. A slot holds the neighbor index + 1,
+ * or 0 when empty. The table size is the smallest power of two that
+ * is at least twice the number of neighbors. */
+#define HASH_SIZE HASH_TABLE_SIZE(NBR_TABLE_MAX_NEIGHBORS)
+#define HASH_MASK (HASH_SIZE - 1)
+static uint16_t hash_slots[HASH_SIZE];
+
+/* Eviction candidates: unlocked neighbors, kept in one doubly-linked
+ * list per number of tables using them, least recently used first. */
+#define LRU_NONE  NBR_TABLE_MAX_NEIGHBORS
+#define LRU_UNLINKED 0xff
+static uint16_t lru_prev[NBR_TABLE_MAX_NEIGHBORS];
+static uint16_t lru_next[NBR_TABLE_MAX_NEIGHBORS];
+static uint8_t lru_bucket[NBR_TABLE_MAX_NEIGHBORS];
+static uint16_t lru_head[MAX_NUM_TABLES + 1];
+static uint16_t lru_tail[MAX_NUM_TABLES + 1];
+static uint8_t lru_initialized;
+#endif /* NBR_TABLE_HASH */
+
 /*---------------------------------------------------------------------------*/
 /* Get a key from a neighbor index */
 static nbr_table_key_t *
@@ -126,16 +148,187 @@ key_from_item(nbr_table_t *table, const nbr_table_item_t *item)
   return key_from_index(index_from_item(table, item));
 }
 /*---------------------------------------------------------------------------*/
+#if NBR_TABLE_HASH
+static unsigned
+hash_lladdr(const linkaddr_t *lladdr)
+{
+  return (unsigned)hash_finish(hash_data(lladdr->u8, LINKADDR_SIZE,
+                                         HASH_INIT)) & HASH_MASK;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_insert(int index)
+{
+  unsigned slot;
+
+  slot = hash_lladdr(&key_from_index(index)->lladdr);
+  while(hash_slots[slot] != 0) {
+    slot = (slot + 1) & HASH_MASK;
+  }
+  hash_slots[slot] = index + 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+hash_lookup(const linkaddr_t *lladdr)
+{
+  unsigned slot;
+  int index;
+
+  slot = hash_lladdr(lladdr);
+  while(hash_slots[slot] != 0) {
+    index = hash_slots[slot] - 1;
+    if(linkaddr_cmp(lladdr, &key_from_index(index)->lladdr)) {
+      return index;
+    }
+    slot = (slot + 1) & HASH_MASK;
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_remove(int index)
+{
+  unsigned hole, slot, home;
+
+  hole = hash_lladdr(&key_from_index(index)->lladdr);
+  while(hash_slots[hole] != index + 1) {
+    if(hash_slots[hole] == 0) {
+      return;
+    }
+    hole = (hole + 1) & HASH_MASK;
+  }
+
+  /* Shift back the following entries of the probe sequence, so that
+     no tombstones are needed. */
+  slot = hole;
+  while(1) {
+    slot = (slot + 1) & HASH_MASK;
+    if(hash_slots[slot] == 0) {
+      break;
+    }
+    home = hash_lladdr(&key_from_index(hash_slots[slot] - 1)->lladdr);
+    /* Move the entry unless its home lies cyclically in (hole, slot] */
+    if((hole <= slot) ? (home <= hole || home > slot)
+                      : (home <= hole && home > slot)) {
+      hash_slots[hole] = hash_slots[slot];
+      hole = slot;
+    }
+  }
+  hash_slots[hole] = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+lru_init(void)
+{
+  int i;
+
+  for(i = 0; i < NBR_TABLE_MAX_NEIGHBORS; i++) {
+    lru_bucket[i] = LRU_UNLINKED;
+  }
+  for(i = 0; i <= MAX_NUM_TABLES; i++) {
+    lru_head[i] = lru_tail[i] = LRU_NONE;
+  }
+  lru_initialized = 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+lru_unlink(int index)
+{
+  uint8_t b = lru_bucket[index];
+
+  if(b == LRU_UNLINKED) {
+    return;
+  }
+  if(lru_prev[index] != LRU_NONE) {
+    lru_next[lru_prev[index]] = lru_next[index];
+  } else {
+    lru_head[b] = lru_next[index];
+  }
+  if(lru_next[index] != LRU_NONE) {
+    lru_prev[lru_next[index]] = lru_prev[index];
+  } else {
+    lru_tail[b] = lru_prev[index];
+  }
+  lru_bucket[index] = LRU_UNLINKED;
+}
+/*---------------------------------------------------------------------------*/
+static void
+lru_append(int index, uint8_t b)
+{
+  lru_bucket[index] = b;
+  lru_next[index] = LRU_NONE;
+  lru_prev[index] = lru_tail[b];
+  if(lru_tail[b] != LRU_NONE) {
+    lru_next[lru_tail[b]] = index;
+  } else {
+    lru_head[b] = index;
+  }
+  lru_tail[b] = index;
+}
+/*---------------------------------------------------------------------------*/
+/* Put a neighbor in the list matching its lock and usage state */
+static void
+lru_update(int index)
+{
+  static const uint8_t popcount4[16] = {
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+  };
+  uint8_t b;
+
+  if(locked_map[index]) {
+    lru_unlink(index);
+    return;
+  }
+  b = popcount4[used_map[index] & 0x0f] + popcount4[used_map[index] >> 4];
+  if(lru_bucket[index] != b) {
+    lru_unlink(index);
+    lru_append(index, b);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Mark a neighbor as the most recently used in its list */
+static void
+lru_touch(int index)
+{
+  uint8_t b = lru_bucket[index];
+
+  if(b != LRU_UNLINKED && lru_tail[b] != index) {
+    lru_unlink(index);
+    lru_append(index, b);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Get the unlocked neighbor used by fewest tables, least recently used
+ * first */
+static nbr_table_key_t *
+lru_evictable(void)
+{
+  int b;
+
+  for(b = 0; b <= MAX_NUM_TABLES; b++) {
+    if(lru_head[b] != LRU_NONE) {
+      return key_from_index(lru_head[b]);
+    }
+  }
+  return NULL;
+}
+#endif /* NBR_TABLE_HASH */
+/*---------------------------------------------------------------------------*/
 /* Get the index of a neighbor from its link-layer address */
 static int
 index_from_lladdr(const linkaddr_t *lladdr)
 {
+#if !NBR_TABLE_HASH
   nbr_table_key_t *key;
+#endif /* !NBR_TABLE_HASH */
   /* Allow lladdr-free insertion, useful e.g. for IPv6 ND.
    * Only one such entry is possible at a time, indexed by linkaddr_null. */
   if(lladdr == NULL) {
     lladdr = &linkaddr_null;
   }
+#if NBR_TABLE_HASH
+  return hash_lookup(lladdr);
+#else /* NBR_TABLE_HASH */
   key = list_head(nbr_table_keys);
   while(key != NULL) {
     if(lladdr && linkaddr_cmp(lladdr, &key->lladdr)) {
@@ -144,6 +337,7 @@ index_from_lladdr(const linkaddr_t *lladdr)
     key = list_item_next(key);
   }
   return -1;
+#endif /* NBR_TABLE_HASH */
 }
 /*---------------------------------------------------------------------------*/
 /* Get bit from "used" or "locked" bitmap */
@@ -171,6 +365,9 @@ nbr_set_bit(uint8_t *bitmap, nbr_table_t *table, nbr_table_item_t *item, int val
     } else {
       bitmap[item_index] &= ~(1 << table->index);
     }
+#if NBR_TABLE_HASH
+    lru_update(item_index);
+#endif /* NBR_TABLE_HASH */
     return 1;
   } else {
     return 0;
@@ -193,6 +390,10 @@ remove_key(nbr_table_key_t *least_used_key)
   }
   /* Empty used map */
   used_map[index_from_key(least_used_key)] = 0;
+#if NBR_TABLE_HASH
+  hash_remove(index_from_key(least_used_key));
+  lru_unlink(index_from_key(least_used_key));
+#endif /* NBR_TABLE_HASH */
   /* Remove neighbor from list */
   list_remove(nbr_table_keys, least_used_key);
 }
@@ -201,7 +402,9 @@ static nbr_table_key_t *
 nbr_table_allocate(nbr_table_reason_t reason, void *data)
 {
   nbr_table_key_t *key;
+#if !NBR_TABLE_HASH
   int least_used_count = 0;
+#endif /* !NBR_TABLE_HASH */
   nbr_table_key_t *least_used_key = NULL;
 
   key = memb_alloc(&neighbor_addr_mem);
@@ -231,6 +434,11 @@ nbr_table_allocate(nbr_table_reason_t reason, void *data)
     }
 #endif /* NBR_TABLE_FIND_REMOVABLE */
 
+#if NBR_TABLE_HASH
+    if(least_used_key == NULL) {
+      least_used_key = lru_evictable();
+    }
+#else /* NBR_TABLE_HASH */
     if(least_used_key == NULL) {
       /* No more space, try to free a neighbor.
        * The replacement policy is the following: remove neighbor that is:
@@ -266,6 +474,7 @@ nbr_table_allocate(nbr_table_reason_t reason, void *data)
         key = list_item_next(key);
       }
     }
+#endif /* NBR_TABLE_HASH */
 
     if(least_used_key == NULL) {
       /* We haven't found any unlocked item, allocation fails */
@@ -290,6 +499,11 @@ nbr_table_register(nbr_table_t *table, nbr_table_callback *callback)
     ctimer_set(&periodic_timer, CLOCK_SECOND * 60, handle_periodic_timer, NULL);
   }
 #endif
+#if NBR_TABLE_HASH
+  if(!lru_initialized) {
+    lru_init();
+  }
+#endif /* NBR_TABLE_HASH */
   if(num_tables < MAX_NUM_TABLES) {
     table->index = num_tables++;
     table->callback = callback;
@@ -359,6 +573,9 @@ nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr, nbr_table_rea
 
     /* Set link-layer address */
     linkaddr_copy(&key->lladdr, lladdr);
+#if NBR_TABLE_HASH
+    hash_insert(index);
+#endif /* NBR_TABLE_HASH */
   }
 
   /* Get item in the current table */
@@ -367,6 +584,9 @@ nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr, nbr_table_rea
   /* Initialize item data and set "used" bit */
   memset(item, 0, table->item_size);
   nbr_set_bit(used_map, table, item, 1);
+#if NBR_TABLE_HASH
+  lru_touch(index);
+#endif /* NBR_TABLE_HASH */
 
 #if DEBUG
   print_table();
@@ -378,8 +598,15 @@ nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr, nbr_table_rea
 void *
 nbr_table_get_from_lladdr(nbr_table_t *table, const linkaddr_t *lladdr)
 {
-  void *item = item_from_index(table, index_from_lladdr(lladdr));
-  return nbr_get_bit(used_map, table, item) ? item : NULL;
+  int index = index_from_lladdr(lladdr);
+  void *item = item_from_index(table, index);
+  if(nbr_get_bit(used_map, table, item)) {
+#if NBR_TABLE_HASH
+    lru_touch(index);
+#endif /* NBR_TABLE_HASH */
+    return item;
+  }
+  return NULL;
 }
 /*---------------------------------------------------------------------------*/
 /* Removes a neighbor from the current table (unset "used" bit) */
@@ -446,11 +673,17 @@ nbr_table_update_lladdr(const linkaddr_t *old_addr, const linkaddr_t *new_addr,
     return 0;
   }
   key = key_from_index(index);
+#if NBR_TABLE_HASH
+  hash_remove(index);
+#endif /* NBR_TABLE_HASH */
   /**
    * Copy the new lladdr into the key - since we know that there is no
    * conflicting entry.
    */
   memcpy(&key->lladdr, new_addr, sizeof(linkaddr_t));
+#if NBR_TABLE_HASH
+  hash_insert(index);
+#endif /* NBR_TABLE_HASH */
   return 1;
 }
 /*---------------------------------------------------------------------------*/
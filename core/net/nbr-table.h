@@ -46,6 +46,18 @@
 #define NBR_TABLE_MAX_NEIGHBORS 8
 #endif /* NBR_TABLE_CONF_MAX_NEIGHBORS */
 
+/* Index neighbors by link-layer address in an open-addressing hash
+ * table and keep eviction candidates in per-usage LRU lists, so that
+ * lookups and evictions do not walk the neighbor list. Useful with
+ * large values of NBR_TABLE_CONF_MAX_NEIGHBORS. Among unlocked
+ * neighbors used by equally few tables, the least recently added or
+ * looked up one is evicted, rather than the oldest. */
+#ifdef NBR_TABLE_CONF_HASH
+#define NBR_TABLE_HASH NBR_TABLE_CONF_HASH
+#else /* NBR_TABLE_CONF_HASH */
+#define NBR_TABLE_HASH 0
+#endif /* NBR_TABLE_CONF_HASH */
+
 /* An item in a neighbor table */
 typedef void nbr_table_item_t;
 
@@ -46,6 +46,8 @@
 #include "contiki.h"
 #include "lib/list.h"
 
+#include <stddef.h>
+
 LIST(ctimer_list);
 
 static char initialized;
@@ -63,14 +65,38 @@ PROCESS(ctimer_process, "Ctimer process");
 PROCESS_THREAD(ctimer_process, ev, data)
 {
   struct ctimer *c;
+#if ETIMER_CONF_HEAP
+  struct etimer *t;
+#endif /* ETIMER_CONF_HEAP */
   PROCESS_BEGIN();
 
+#if ETIMER_CONF_HEAP
+  /* Expired timers are handed to this process by the event timer
+     library instead of being posted, so a ctimer that is stopped after
+     it has expired is never called. The list is only used for timers
+     set before initialization. */
+  etimer_collect(&ctimer_process);
+#endif /* ETIMER_CONF_HEAP */
   for(c = list_head(ctimer_list); c != NULL; c = c->next) {
     etimer_set(&c->etimer, c->etimer.timer.interval);
   }
   initialized = 1;
+#if ETIMER_CONF_HEAP
+  list_init(ctimer_list);
+#endif /* ETIMER_CONF_HEAP */
 
   while(1) {
+#if ETIMER_CONF_HEAP
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+    while((t = etimer_next_collected()) != NULL) {
+      c = (struct ctimer *)((char *)t - offsetof(struct ctimer, etimer));
+      PROCESS_CONTEXT_BEGIN(c->p);
+      if(c->f != NULL) {
+        c->f(c->ptr);
+      }
+      PROCESS_CONTEXT_END(c->p);
+    }
+#else /* ETIMER_CONF_HEAP */
     PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_TIMER);
     for(c = list_head(ctimer_list); c != NULL; c = c->next) {
       if(&c->etimer == data) {
@@ -83,6 +109,7 @@ PROCESS_THREAD(ctimer_process, ev, data)
 	break;
       }
     }
+#endif /* ETIMER_CONF_HEAP */
   }
   PROCESS_END();
 }
@@ -114,6 +141,9 @@ ctimer_set_with_process(struct ctimer *c, clock_time_t t,
     PROCESS_CONTEXT_BEGIN(&ctimer_process);
     etimer_set(&c->etimer, t);
     PROCESS_CONTEXT_END(&ctimer_process);
+#if ETIMER_CONF_HEAP
+    return;
+#endif /* ETIMER_CONF_HEAP */
   } else {
     c->etimer.timer.interval = t;
   }
@@ -128,6 +158,9 @@ ctimer_reset(struct ctimer *c)
     PROCESS_CONTEXT_BEGIN(&ctimer_process);
     etimer_reset(&c->etimer);
     PROCESS_CONTEXT_END(&ctimer_process);
+#if ETIMER_CONF_HEAP
+    return;
+#endif /* ETIMER_CONF_HEAP */
   }
 
   list_add(ctimer_list, c);
@@ -140,6 +173,9 @@ ctimer_restart(struct ctimer *c)
     PROCESS_CONTEXT_BEGIN(&ctimer_process);
     etimer_restart(&c->etimer);
     PROCESS_CONTEXT_END(&ctimer_process);
+#if ETIMER_CONF_HEAP
+    return;
+#endif /* ETIMER_CONF_HEAP */
   }
 
   list_add(ctimer_list, c);
@@ -148,6 +184,12 @@ ctimer_restart(struct ctimer *c)
 void
 ctimer_stop(struct ctimer *c)
 {
+#if ETIMER_CONF_HEAP
+  if(initialized) {
+    etimer_stop(&c->etimer);
+    return;
+  }
+#endif /* ETIMER_CONF_HEAP */
   if(initialized) {
     etimer_stop(&c->etimer);
   } else {
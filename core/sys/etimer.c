@@ -49,10 +49,323 @@
 #include "sys/etimer.h"
 #include "sys/process.h"
 
+PROCESS(etimer_process, "Event timer");
+
+#if ETIMER_CONF_HEAP
+/*
+ * Pending timers are kept in a pairing heap. Each node links to its
+ * first child and to its next sibling (through the next field); the
+ * prev field points to the left sibling, or to the parent for a first
+ * child, and is NULL for the root.
+ */
+static struct etimer *root;
+
+/* Expired timers of the collecting process, oldest first, linked
+   through next and prev. */
+static struct process *collector;
+static struct etimer *collected_head, *collected_tail;
+
+/* The queue field of a timer tells which of the two it is on. */
+#define QUEUE_NONE      0
+#define QUEUE_HEAP      1
+#define QUEUE_COLLECTED 2
+
+/* Expiration times are compared with wrap-around, which is correct as
+   long as no two pending timers are more than half the clock range
+   apart. */
+#define EXPIRATION(t) ((t)->timer.start + (t)->timer.interval)
+#define BEFORE(a, b) ((clock_time_t)((a) - (b)) >= \
+                      ((clock_time_t)1 << (sizeof(clock_time_t) * 8 - 1)))
+/*---------------------------------------------------------------------------*/
+static struct etimer *
+meld(struct etimer *a, struct etimer *b)
+{
+  struct etimer *tmp;
+
+  if(BEFORE(EXPIRATION(b), EXPIRATION(a))) {
+    tmp = a;
+    a = b;
+    b = tmp;
+  }
+
+  /* Make b the first child of a. */
+  b->prev = a;
+  b->next = a->child;
+  if(a->child != NULL) {
+    a->child->prev = b;
+  }
+  a->child = b;
+  a->next = NULL;
+  a->prev = NULL;
+  return a;
+}
+/*---------------------------------------------------------------------------*/
+static struct etimer *
+merge_pairs(struct etimer *first)
+{
+  struct etimer *a, *b, *rest, *paired, *result;
+
+  /* First pass: meld siblings pairwise from left to right, collecting
+     the results in reverse order. */
+  paired = NULL;
+  while(first != NULL) {
+    a = first;
+    b = a->next;
+    if(b == NULL) {
+      a->prev = NULL;
+      a->next = paired;
+      paired = a;
+      break;
+    }
+    rest = b->next;
+    a = meld(a, b);
+    a->next = paired;
+    paired = a;
+    first = rest;
+  }
+
+  /* Second pass: meld the pairs from right to left. */
+  result = NULL;
+  while(paired != NULL) {
+    a = paired;
+    paired = a->next;
+    a->next = NULL;
+    result = result == NULL ? a : meld(result, a);
+  }
+  return result;
+}
+/*---------------------------------------------------------------------------*/
+static void
+collected_remove(struct etimer *t)
+{
+  if(t->prev != NULL) {
+    t->prev->next = t->next;
+  } else {
+    collected_head = t->next;
+  }
+  if(t->next != NULL) {
+    t->next->prev = t->prev;
+  } else {
+    collected_tail = t->prev;
+  }
+  t->next = t->prev = NULL;
+  t->queue = QUEUE_NONE;
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_insert(struct etimer *t)
+{
+  t->child = t->next = t->prev = NULL;
+  t->queue = QUEUE_HEAP;
+  root = root == NULL ? t : meld(root, t);
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_remove(struct etimer *t)
+{
+  struct etimer *sub;
+
+  /* The children of t are merged and take its place. They expire no
+     earlier than t, so the heap stays ordered, and no other part of
+     the heap is touched. */
+  sub = merge_pairs(t->child);
+  if(t == root) {
+    root = sub;
+  } else {
+    if(sub == NULL) {
+      sub = t->next;
+    } else {
+      sub->next = t->next;
+      if(t->next != NULL) {
+        t->next->prev = sub;
+      }
+    }
+    if(sub != NULL) {
+      sub->prev = t->prev;
+    }
+    if(t->prev->child == t) {
+      t->prev->child = sub;
+    } else {
+      t->prev->next = sub;
+    }
+  }
+  t->child = t->next = t->prev = NULL;
+  t->queue = QUEUE_NONE;
+}
+/*---------------------------------------------------------------------------*/
+static struct etimer *
+first_in_postorder(struct etimer *t)
+{
+  while(t != NULL) {
+    if(t->child != NULL) {
+      t = t->child;
+    } else if(t->next != NULL) {
+      t = t->next;
+    } else {
+      break;
+    }
+  }
+  return t;
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_process_timers(struct process *p)
+{
+  struct etimer *t, *up;
+  int first_child;
+
+  /* Walk the heap in post-order, seen as a binary tree with child and
+     next as the two branches and prev as the parent. Both branches of
+     a timer have been walked when it is reached, and heap_remove()
+     only rearranges its children, so the walk can go on from its
+     parent. */
+  t = first_in_postorder(root);
+  while(t != NULL) {
+    up = t->prev;
+    first_child = up != NULL && up->child == t;
+    if(t->p == p) {
+      heap_remove(t);
+      t->p = PROCESS_NONE;
+    }
+    if(first_child && up->next != NULL) {
+      t = first_in_postorder(up->next);
+    } else {
+      t = up;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(etimer_process, ev, data)
+{
+  struct etimer *t;
+
+  PROCESS_BEGIN();
+
+  root = NULL;
+
+  while(1) {
+    PROCESS_YIELD();
+
+    if(ev == PROCESS_EVENT_EXITED) {
+      remove_process_timers(data);
+      continue;
+    } else if(ev != PROCESS_EVENT_POLL) {
+      continue;
+    }
+
+    while(root != NULL && timer_expired(&root->timer)) {
+      t = root;
+      if(t->p != PROCESS_BROADCAST && !process_is_running(t->p)) {
+        /* The process that set the timer has exited. */
+        heap_remove(t);
+        t->p = PROCESS_NONE;
+      } else if(collector != NULL && t->p == collector) {
+        heap_remove(t);
+        t->p = PROCESS_NONE;
+        t->queue = QUEUE_COLLECTED;
+        t->prev = collected_tail;
+        if(collected_tail != NULL) {
+          collected_tail->next = t;
+        } else {
+          collected_head = t;
+        }
+        collected_tail = t;
+        process_poll(collector);
+      } else if(process_post(t->p, PROCESS_EVENT_TIMER, t) == PROCESS_ERR_OK) {
+        heap_remove(t);
+        /* Reset the process ID of the event timer, to signal that the
+           etimer has expired. This is later checked in the
+           etimer_expired() function. */
+        t->p = PROCESS_NONE;
+      } else {
+        etimer_request_poll();
+        break;
+      }
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+etimer_request_poll(void)
+{
+  process_poll(&etimer_process);
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_timer(struct etimer *timer)
+{
+  etimer_request_poll();
+
+  if(timer->queue == QUEUE_HEAP) {
+    /* The expiration time has changed, so the timer must be moved. */
+    heap_remove(timer);
+  } else if(timer->queue == QUEUE_COLLECTED) {
+    collected_remove(timer);
+  }
+  timer->p = PROCESS_CURRENT();
+  heap_insert(timer);
+}
+/*---------------------------------------------------------------------------*/
+void
+etimer_adjust(struct etimer *et, int timediff)
+{
+  if(et->queue == QUEUE_HEAP) {
+    heap_remove(et);
+    et->timer.start += timediff;
+    heap_insert(et);
+  } else {
+    et->timer.start += timediff;
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+etimer_pending(void)
+{
+  return root != NULL;
+}
+/*---------------------------------------------------------------------------*/
+clock_time_t
+etimer_next_expiration_time(void)
+{
+  return root != NULL ? EXPIRATION(root) : 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+etimer_stop(struct etimer *et)
+{
+  if(et->queue == QUEUE_HEAP) {
+    heap_remove(et);
+  } else if(et->queue == QUEUE_COLLECTED) {
+    collected_remove(et);
+  }
+  et->next = NULL;
+  /* Set the timer as expired */
+  et->p = PROCESS_NONE;
+}
+/*---------------------------------------------------------------------------*/
+void
+etimer_collect(struct process *p)
+{
+  collector = p;
+}
+/*---------------------------------------------------------------------------*/
+struct etimer *
+etimer_next_collected(void)
+{
+  struct etimer *t;
+
+  t = collected_head;
+  if(t != NULL) {
+    collected_remove(t);
+  }
+  return t;
+}
+/*---------------------------------------------------------------------------*/
+#else /* ETIMER_CONF_HEAP */
 static struct etimer *timerlist;
 static clock_time_t next_expiration;
-
-PROCESS(etimer_process, "Event timer");
 /*---------------------------------------------------------------------------*/
 static void
 update_time(void)
@@ -174,35 +487,6 @@ add_timer(struct etimer *timer)
 }
 /*---------------------------------------------------------------------------*/
 void
-etimer_set(struct etimer *et, clock_time_t interval)
-{
-  timer_set(&et->timer, interval);
-  add_timer(et);
-}
-/*---------------------------------------------------------------------------*/
-void
-etimer_reset_with_new_interval(struct etimer *et, clock_time_t interval)
-{
-  timer_reset(&et->timer);
-  et->timer.interval = interval;
-  add_timer(et);
-}
-/*---------------------------------------------------------------------------*/
-void
-etimer_reset(struct etimer *et)
-{
-  timer_reset(&et->timer);
-  add_timer(et);
-}
-/*---------------------------------------------------------------------------*/
-void
-etimer_restart(struct etimer *et)
-{
-  timer_restart(&et->timer);
-  add_timer(et);
-}
-/*---------------------------------------------------------------------------*/
-void
 etimer_adjust(struct etimer *et, int timediff)
 {
   et->timer.start += timediff;
@@ -210,24 +494,6 @@ etimer_adjust(struct etimer *et, int timediff)
 }
 /*---------------------------------------------------------------------------*/
 int
-etimer_expired(struct etimer *et)
-{
-  return et->p == PROCESS_NONE;
-}
-/*---------------------------------------------------------------------------*/
-clock_time_t
-etimer_expiration_time(struct etimer *et)
-{
-  return et->timer.start + et->timer.interval;
-}
-/*---------------------------------------------------------------------------*/
-clock_time_t
-etimer_start_time(struct etimer *et)
-{
-  return et->timer.start;
-}
-/*---------------------------------------------------------------------------*/
-int
 etimer_pending(void)
 {
   return timerlist != NULL;
@@ -268,5 +534,53 @@ etimer_stop(struct etimer *et)
   /* Set the timer as expired */
   et->p = PROCESS_NONE;
 }
+#endif /* ETIMER_CONF_HEAP */
+/*---------------------------------------------------------------------------*/
+void
+etimer_set(struct etimer *et, clock_time_t interval)
+{
+  timer_set(&et->timer, interval);
+  add_timer(et);
+}
+/*---------------------------------------------------------------------------*/
+void
+etimer_reset_with_new_interval(struct etimer *et, clock_time_t interval)
+{
+  timer_reset(&et->timer);
+  et->timer.interval = interval;
+  add_timer(et);
+}
+/*---------------------------------------------------------------------------*/
+void
+etimer_reset(struct etimer *et)
+{
+  timer_reset(&et->timer);
+  add_timer(et);
+}
+/*---------------------------------------------------------------------------*/
+void
+etimer_restart(struct etimer *et)
+{
+  timer_restart(&et->timer);
+  add_timer(et);
+}
+/*---------------------------------------------------------------------------*/
+int
+etimer_expired(struct etimer *et)
+{
+  return et->p == PROCESS_NONE;
+}
+/*---------------------------------------------------------------------------*/
+clock_time_t
+etimer_expiration_time(struct etimer *et)
+{
+  return et->timer.start + et->timer.interval;
+}
+/*---------------------------------------------------------------------------*/
+clock_time_t
+etimer_start_time(struct etimer *et)
+{
+  return et->timer.start;
+}
 /*---------------------------------------------------------------------------*/
 /** @} */
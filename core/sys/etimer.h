@@ -65,6 +65,20 @@
 #include "sys/timer.h"
 #include "sys/process.h"
 
+/**
+ * When ETIMER_CONF_HEAP is set, pending event timers are kept in a
+ * pairing heap ordered by expiration time instead of an unsorted
+ * list. Setting and stopping a timer then takes O(log n) amortized
+ * time, finding the next expiration time takes O(1) time, and each
+ * expiry is handled without rescanning the remaining timers.
+ *
+ * The timers of a process that exits are removed from the heap when
+ * the process exits, as they are removed from the list otherwise.
+ */
+#ifndef ETIMER_CONF_HEAP
+#define ETIMER_CONF_HEAP 0
+#endif /* ETIMER_CONF_HEAP */
+
 /**
  * A timer.
  *
@@ -77,6 +91,10 @@ struct etimer {
   struct timer timer;
   struct etimer *next;
   struct process *p;
+#if ETIMER_CONF_HEAP
+  struct etimer *child, *prev;
+  uint8_t queue;
+#endif /* ETIMER_CONF_HEAP */
 };
 
 /**
@@ -245,6 +263,27 @@ int etimer_pending(void);
  */
 clock_time_t etimer_next_expiration_time(void);
 
+#if ETIMER_CONF_HEAP
+/**
+ * \brief      Collect the expired timers of a process.
+ * \param p    The process.
+ *
+ *             Expired event timers of the process are not posted
+ *             with PROCESS_EVENT_TIMER. They are queued, and the
+ *             process is polled and takes them with
+ *             etimer_next_collected(). A queued timer that is set
+ *             again or stopped is removed from the queue, so the
+ *             process is never handed a timer that has been stopped
+ *             after it expired. This is used by the ctimer library.
+ */
+void etimer_collect(struct process *p);
+
+/**
+ * \brief      Take the next collected expired timer.
+ * \return     The timer that expired first, or NULL if there is none.
+ */
+struct etimer *etimer_next_collected(void);
+#endif /* ETIMER_CONF_HEAP */
 
 /** @} */
 
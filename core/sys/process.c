@@ -63,10 +63,38 @@ struct event_data {
   process_event_t ev;
   process_data_t data;
   struct process *p;
+#if PROCESS_CONF_FAST_DISPATCH && PROCESS_CONF_STATS
+  clock_time_t posted;
+#endif
+};
+
+#if PROCESS_CONF_FAST_DISPATCH
+/*
+ * One event ring per priority level. The ready bitmap has bit n set
+ * when the queue for priority n is non-empty, and processes that
+ * have requested a poll are kept in a FIFO linked through their
+ * nextpoll field.
+ */
+struct event_queue {
+  process_num_events_t nevents, fevent;
+  struct event_data events[PROCESS_CONF_NUMEVENTS];
 };
 
+static struct event_queue queues[PROCESS_NUM_PRIORITIES];
+static unsigned char ready;
+static unsigned short nevents;
+static struct process *poll_head, *poll_tail;
+/* Processes taken off the poll FIFO by the current do_poll() round. */
+static struct process *poll_run;
+
+/* Index of the most significant bit set in a nibble. */
+static const unsigned char msb4[16] = {
+  0, 0, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3
+};
+#else /* PROCESS_CONF_FAST_DISPATCH */
 static process_num_events_t nevents, fevent;
 static struct event_data events[PROCESS_CONF_NUMEVENTS];
+#endif /* PROCESS_CONF_FAST_DISPATCH */
 
 #if PROCESS_CONF_STATS
 process_num_events_t process_maxevents;
@@ -79,6 +107,9 @@ static volatile unsigned char poll_requested;
 #define PROCESS_STATE_CALLED      2
 
 static void call_process(struct process *p, process_event_t ev, process_data_t data);
+#if PROCESS_CONF_FAST_DISPATCH
+static void poll_unlink(struct process *p);
+#endif /* PROCESS_CONF_FAST_DISPATCH */
 
 #define DEBUG 0
 #if DEBUG
@@ -139,6 +170,15 @@ exit_process(struct process *p, struct process *fromprocess)
     /* Process was running */
     p->state = PROCESS_STATE_NONE;
 
+#if PROCESS_CONF_FAST_DISPATCH
+    /* Drop a pending poll request, so that the poll handler does not
+       call the process after it has exited. */
+    if(p->needspoll) {
+      poll_unlink(p);
+    }
+#endif /* PROCESS_CONF_FAST_DISPATCH */
+    p->needspoll = 0;
+
     /*
      * Post a synchronous event to all processes to inform them that
      * this process is about to exit. This will allow services to
@@ -209,7 +249,19 @@ process_init(void)
 {
   lastevent = PROCESS_EVENT_MAX;
 
+#if PROCESS_CONF_FAST_DISPATCH
+  {
+    int i;
+    for(i = 0; i < PROCESS_NUM_PRIORITIES; i++) {
+      queues[i].nevents = queues[i].fevent = 0;
+    }
+  }
+  ready = 0;
+  nevents = 0;
+  poll_head = poll_tail = poll_run = NULL;
+#else /* PROCESS_CONF_FAST_DISPATCH */
   nevents = fevent = 0;
+#endif /* PROCESS_CONF_FAST_DISPATCH */
 #if PROCESS_CONF_STATS
   process_maxevents = 0;
 #endif /* PROCESS_CONF_STATS */
@@ -217,10 +269,98 @@ process_init(void)
   process_current = process_list = NULL;
 }
 /*---------------------------------------------------------------------------*/
+#if PROCESS_CONF_FAST_DISPATCH
+void
+process_set_priority(struct process *p, unsigned char priority)
+{
+  if(priority > PROCESS_PRIORITY_HIGHEST) {
+    priority = PROCESS_PRIORITY_HIGHEST;
+  }
+  p->priority = priority;
+}
+/*---------------------------------------------------------------------------*/
+#if PROCESS_CONF_STATS
+static void
+account_latency(struct process *p, clock_time_t since)
+{
+  clock_time_t latency;
+
+  latency = clock_time() - since;
+  p->dispatched++;
+  p->latency_total += latency;
+  if(latency > p->latency_max) {
+    p->latency_max = latency;
+  }
+}
+/*---------------------------------------------------------------------------*/
+clock_time_t
+process_avg_latency(struct process *p)
+{
+  if(p->dispatched == 0) {
+    return 0;
+  }
+  return (clock_time_t)(p->latency_total / p->dispatched);
+}
+#endif /* PROCESS_CONF_STATS */
+#endif /* PROCESS_CONF_FAST_DISPATCH */
+/*---------------------------------------------------------------------------*/
 /*
  * Call each process' poll handler.
  */
 /*---------------------------------------------------------------------------*/
+#if PROCESS_CONF_FAST_DISPATCH
+static void
+poll_unlink(struct process *p)
+{
+  struct process **pp, *prev;
+
+  /* A process with a pending poll is on exactly one of the lists. */
+  for(pp = &poll_run; *pp != NULL; pp = &(*pp)->nextpoll) {
+    if(*pp == p) {
+      *pp = p->nextpoll;
+      p->nextpoll = NULL;
+      return;
+    }
+  }
+  prev = NULL;
+  for(pp = &poll_head; *pp != NULL; pp = &(*pp)->nextpoll) {
+    if(*pp == p) {
+      *pp = p->nextpoll;
+      if(poll_tail == p) {
+        poll_tail = prev;
+      }
+      p->nextpoll = NULL;
+      return;
+    }
+    prev = *pp;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+do_poll(void)
+{
+  struct process *p;
+
+  /* Detach the current poll list, so that processes that poll
+     themselves are called again only in the next round. */
+  poll_run = poll_head;
+  poll_head = poll_tail = NULL;
+  poll_requested = 0;
+
+  while((p = poll_run) != NULL) {
+    poll_run = p->nextpoll;
+    p->nextpoll = NULL;
+    p->needspoll = 0;
+    if(p->state != PROCESS_STATE_RUNNING) {
+      continue;
+    }
+#if PROCESS_CONF_STATS
+    account_latency(p, p->polltime);
+#endif /* PROCESS_CONF_STATS */
+    call_process(p, PROCESS_EVENT_POLL, NULL);
+  }
+}
+#else /* PROCESS_CONF_FAST_DISPATCH */
 static void
 do_poll(void)
 {
@@ -236,12 +376,78 @@ do_poll(void)
     }
   }
 }
+#endif /* PROCESS_CONF_FAST_DISPATCH */
 /*---------------------------------------------------------------------------*/
 /*
  * Process the next event in the event queue and deliver it to
  * listening processes.
  */
 /*---------------------------------------------------------------------------*/
+#if PROCESS_CONF_FAST_DISPATCH
+static void
+deliver_event(struct event_data *e)
+{
+  struct process *p;
+
+  /* If this is a broadcast event, we deliver it to all events, in
+     order of their priority. */
+  if(e->p == PROCESS_BROADCAST) {
+    for(p = process_list; p != NULL; p = p->next) {
+
+      /* If we have been requested to poll a process, we do this in
+	 between processing the broadcast event. */
+      if(poll_requested) {
+	do_poll();
+      }
+#if PROCESS_CONF_STATS
+      account_latency(p, e->posted);
+#endif /* PROCESS_CONF_STATS */
+      call_process(p, e->ev, e->data);
+    }
+  } else {
+    /* If the event was an INIT event, we should also update the
+       state of the process. */
+    if(e->ev == PROCESS_EVENT_INIT) {
+      e->p->state = PROCESS_STATE_RUNNING;
+    }
+#if PROCESS_CONF_STATS
+    account_latency(e->p, e->posted);
+#endif /* PROCESS_CONF_STATS */
+    call_process(e->p, e->ev, e->data);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+do_event(void)
+{
+  struct event_queue *q;
+  struct event_data e;
+  unsigned char prio;
+
+  if(ready == 0) {
+    return;
+  }
+
+  /* Pick the highest priority queue that has events pending. */
+  if(ready & 0xf0) {
+    prio = 4 + msb4[ready >> 4];
+  } else {
+    prio = msb4[ready];
+  }
+  q = &queues[prio];
+
+  /* Copy the event out before delivering it, since the receiver may
+     post new events into the same queue. */
+  e = q->events[q->fevent];
+  q->fevent = (q->fevent + 1) % PROCESS_CONF_NUMEVENTS;
+  if(--q->nevents == 0) {
+    ready &= ~(1 << prio);
+  }
+  --nevents;
+
+  deliver_event(&e);
+}
+#else /* PROCESS_CONF_FAST_DISPATCH */
 static void
 do_event(void)
 {
@@ -297,6 +503,7 @@ do_event(void)
     }
   }
 }
+#endif /* PROCESS_CONF_FAST_DISPATCH */
 /*---------------------------------------------------------------------------*/
 int
 process_run(void)
@@ -332,6 +539,38 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
 	   p == PROCESS_BROADCAST? "<broadcast>": PROCESS_NAME_STRING(p), nevents);
   }
   
+#if PROCESS_CONF_FAST_DISPATCH
+  {
+    struct event_queue *q;
+    unsigned char prio;
+
+    prio = p == PROCESS_BROADCAST ? PROCESS_PRIORITY_NORMAL : p->priority;
+    q = &queues[prio];
+
+    if(q->nevents == PROCESS_CONF_NUMEVENTS) {
+      PRINTF("soft panic: event queue %d is full when event %d was posted\n",
+             prio, ev);
+      return PROCESS_ERR_FULL;
+    }
+
+    snum = (process_num_events_t)(q->fevent + q->nevents) % PROCESS_CONF_NUMEVENTS;
+    q->events[snum].ev = ev;
+    q->events[snum].data = data;
+    q->events[snum].p = p;
+#if PROCESS_CONF_STATS
+    q->events[snum].posted = clock_time();
+#endif /* PROCESS_CONF_STATS */
+    ++q->nevents;
+    ++nevents;
+    ready |= 1 << prio;
+
+#if PROCESS_CONF_STATS
+    if(q->nevents > process_maxevents) {
+      process_maxevents = q->nevents;
+    }
+#endif /* PROCESS_CONF_STATS */
+  }
+#else /* PROCESS_CONF_FAST_DISPATCH */
   if(nevents == PROCESS_CONF_NUMEVENTS) {
 #if DEBUG
     if(p == PROCESS_BROADCAST) {
@@ -354,6 +593,7 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
     process_maxevents = nevents;
   }
 #endif /* PROCESS_CONF_STATS */
+#endif /* PROCESS_CONF_FAST_DISPATCH */
   
   return PROCESS_ERR_OK;
 }
@@ -373,8 +613,25 @@ process_poll(struct process *p)
   if(p != NULL) {
     if(p->state == PROCESS_STATE_RUNNING ||
        p->state == PROCESS_STATE_CALLED) {
+#if PROCESS_CONF_FAST_DISPATCH
+      if(!p->needspoll) {
+        p->nextpoll = NULL;
+        if(poll_tail == NULL) {
+          poll_head = p;
+        } else {
+          poll_tail->nextpoll = p;
+        }
+        poll_tail = p;
+#if PROCESS_CONF_STATS
+        p->polltime = clock_time();
+#endif /* PROCESS_CONF_STATS */
+      }
+#endif /* PROCESS_CONF_FAST_DISPATCH */
       p->needspoll = 1;
       poll_requested = 1;
+#ifdef PROCESS_CONF_POLL_HOOK
+      PROCESS_CONF_POLL_HOOK();
+#endif /* PROCESS_CONF_POLL_HOOK */
     }
   }
 }
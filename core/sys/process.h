@@ -88,6 +88,45 @@ typedef unsigned char process_num_events_t;
 #define PROCESS_CONF_NUMEVENTS 32
 #endif /* PROCESS_CONF_NUMEVENTS */
 
+/**
+ * \name Priority dispatch
+ *
+ * When PROCESS_CONF_FAST_DISPATCH is set, the kernel keeps one event
+ * queue per priority level together with a bitmap of non-empty
+ * queues, and polled processes are linked into an intrusive poll
+ * list. Neither event dispatch nor polling then walks the process
+ * list, so their cost does not grow with the number of processes.
+ * Each priority queue holds PROCESS_CONF_NUMEVENTS events.
+ *
+ * In this mode, process_poll() should be called from the main
+ * thread of execution rather than from interrupt context.
+ * @{
+ */
+#ifndef PROCESS_CONF_FAST_DISPATCH
+#define PROCESS_CONF_FAST_DISPATCH 0
+#endif /* PROCESS_CONF_FAST_DISPATCH */
+
+#ifdef PROCESS_CONF_NUM_PRIORITIES
+#define PROCESS_NUM_PRIORITIES PROCESS_CONF_NUM_PRIORITIES
+#else
+#define PROCESS_NUM_PRIORITIES 4
+#endif /* PROCESS_CONF_NUM_PRIORITIES */
+
+#if PROCESS_NUM_PRIORITIES < 1 || PROCESS_NUM_PRIORITIES > 8
+#error "PROCESS_CONF_NUM_PRIORITIES must be between 1 and 8"
+#endif
+
+/** The default priority of a process. Events posted to processes
+    with a higher priority value are delivered first. */
+#define PROCESS_PRIORITY_NORMAL 0
+/** The highest priority that can be given to a process. */
+#define PROCESS_PRIORITY_HIGHEST (PROCESS_NUM_PRIORITIES - 1)
+/** @} */
+
+#if PROCESS_CONF_FAST_DISPATCH && PROCESS_CONF_STATS
+#include "sys/clock.h"
+#endif
+
 #define PROCESS_EVENT_NONE            0x80
 #define PROCESS_EVENT_INIT            0x81
 #define PROCESS_EVENT_POLL            0x82
@@ -323,6 +362,16 @@ struct process {
   PT_THREAD((* thread)(struct pt *, process_event_t, process_data_t));
   struct pt pt;
   unsigned char state, needspoll;
+#if PROCESS_CONF_FAST_DISPATCH
+  struct process *nextpoll;
+  unsigned char priority;
+#if PROCESS_CONF_STATS
+  clock_time_t polltime;
+  unsigned long dispatched;
+  clock_time_t latency_max;
+  unsigned long latency_total;
+#endif /* PROCESS_CONF_STATS */
+#endif /* PROCESS_CONF_FAST_DISPATCH */
 };
 
 /**
@@ -463,7 +512,9 @@ CCIF process_event_t process_alloc_event(void);
  * Request a process to be polled.
  *
  * This function typically is called from an interrupt handler to
- * cause a process to be polled.
+ * cause a process to be polled. A platform can define
+ * PROCESS_CONF_POLL_HOOK() to be notified of each poll request, for
+ * example to wake up a sleeping main loop.
  *
  * \param p A pointer to the process' process structure.
  */
@@ -471,6 +522,39 @@ CCIF void process_poll(struct process *p);
 
 /** @} */
 
+#if PROCESS_CONF_FAST_DISPATCH
+/**
+ * Set the dispatch priority of a process.
+ *
+ * Events posted to a process are queued at the priority the process
+ * has when the event is posted. Broadcast events are always queued
+ * at PROCESS_PRIORITY_NORMAL.
+ *
+ * \param p A pointer to the process' process structure.
+ *
+ * \param priority The new priority, between PROCESS_PRIORITY_NORMAL
+ * and PROCESS_PRIORITY_HIGHEST.
+ */
+CCIF void process_set_priority(struct process *p, unsigned char priority);
+
+#if PROCESS_CONF_STATS
+/**
+ * Get the average dispatch latency of a process.
+ *
+ * The dispatch latency is the time between an event being posted to,
+ * or a poll being requested for, a process and the process being
+ * called with it. The per-process maximum is kept in the latency_max
+ * field of the process structure.
+ *
+ * \param p A pointer to the process' process structure.
+ *
+ * \return The average latency, in clock ticks, or zero if nothing
+ * has been dispatched to the process.
+ */
+clock_time_t process_avg_latency(struct process *p);
+#endif /* PROCESS_CONF_STATS */
+#endif /* PROCESS_CONF_FAST_DISPATCH */
+
 /**
  * \name Functions called by the system and boot-up code
  * @{
@@ -59,10 +59,8 @@ tapdev_output(void)
 #endif
 /*---------------------------------------------------------------------------*/
 static void
-pollhandler(void)
+input(void)
 {
-  uip_len = tapdev_poll();
-
   if(uip_len > 0) {
 #if NETSTACK_CONF_WITH_IPV6
     if(BUF->type == uip_htons(UIP_ETHTYPE_IPV6)) {
@@ -88,6 +86,29 @@ pollhandler(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+static void
+pollhandler(void)
+{
+#if NETSTACK_CONF_WITH_IPV6 && TAPDEV_BATCH > 1
+  int n;
+
+  /* Feed all pending frames to the stack back-to-back. */
+  n = tapdev_batch_begin();
+  while((uip_len = tapdev_poll()) > 0) {
+    input();
+  }
+  tapdev_batch_end();
+
+  if(n == TAPDEV_BATCH) {
+    /* The batch was full, so more frames may be waiting. */
+    process_poll(&tapdev_process);
+  }
+#else /* NETSTACK_CONF_WITH_IPV6 && TAPDEV_BATCH > 1 */
+  uip_len = tapdev_poll();
+  input();
+#endif /* NETSTACK_CONF_WITH_IPV6 && TAPDEV_BATCH > 1 */
+}
+/*---------------------------------------------------------------------------*/
 PROCESS_THREAD(tapdev_process, ev, data)
 {
   PROCESS_POLLHANDLER(pollhandler());
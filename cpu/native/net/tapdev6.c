@@ -55,6 +55,7 @@
 #include <sys/ioctl.h>
 #include <linux/if.h>
 #include <linux/if_tun.h>
+#include <linux/virtio_net.h>
 #define DEVTAP "/dev/net/tun"
 #else  /* linux */
 #define DEVTAP "/dev/tap0"
@@ -74,6 +75,13 @@
 
 #include "tapdev6.h"
 #include "contiki-net.h"
+#include "net/ip/uip-chksum.h"
+
+#include <errno.h>
+
+#if TAPDEV_VNET_HDR && !defined(linux)
+#error "TAPDEV_CONF_VNET_HDR is only supported on Linux"
+#endif
 
 #define DROP 0
 
@@ -83,6 +91,25 @@ static int drop = 0;
 
 static int fd = -1;
 
+#if TAPDEV_VNET_HDR
+/* Set if the kernel accepted IFF_VNET_HDR. */
+static int vnet_hdr;
+#endif /* TAPDEV_VNET_HDR */
+
+#if TAPDEV_BATCH > 1
+struct frame {
+  uint16_t len;
+  uint8_t data[UIP_BUFSIZE];
+};
+
+/* Frames read in the current batch, and those to send at its end. */
+static struct frame rx_frames[TAPDEV_BATCH];
+static int rx_next, rx_count;
+static struct frame tx_frames[TAPDEV_BATCH];
+static int tx_count;
+static int in_batch;
+#endif /* TAPDEV_BATCH > 1 */
+
 static unsigned long lasttime;
 
 #define BUF ((struct uip_eth_hdr *)&uip_buf[0])
@@ -106,15 +133,139 @@ tapdev_fd(void)
 {
   return fd;
 }
+/*---------------------------------------------------------------------------*/
+#if TAPDEV_VNET_HDR
+/* Fills in the checksum of a packet that the kernel handed over with
+   only the pseudo-header sum in its checksum field. */
+static void
+complete_chksum(uint8_t *frame, int len, uint16_t start, uint16_t offset)
+{
+  uint16_t sum;
+
+  if(start + offset + 2 > len) {
+    return;
+  }
+  sum = ~uip_chksum_add(0, &frame[start], len - start);
+  if(sum == 0) {
+    sum = 0xffff;
+  }
+  frame[start + offset] = sum >> 8;
+  frame[start + offset + 1] = sum & 0xff;
+}
+#endif /* TAPDEV_VNET_HDR */
+/*---------------------------------------------------------------------------*/
+static int
+frame_read(uint8_t *frame)
+{
+#if TAPDEV_VNET_HDR
+  struct virtio_net_hdr hdr;
+  struct iovec iov[2];
+  int ret;
+
+  if(vnet_hdr) {
+    iov[0].iov_base = &hdr;
+    iov[0].iov_len = sizeof(hdr);
+    iov[1].iov_base = frame;
+    iov[1].iov_len = UIP_BUFSIZE;
+    ret = readv(fd, iov, 2);
+    if(ret < (int)sizeof(hdr)) {
+      return ret < 0 ? ret : 0;
+    }
+    ret -= sizeof(hdr);
+    if(hdr.flags & VIRTIO_NET_HDR_F_NEEDS_CSUM) {
+      complete_chksum(frame, ret, hdr.csum_start, hdr.csum_offset);
+    }
+    return ret;
+  }
+#endif /* TAPDEV_VNET_HDR */
+  return read(fd, frame, UIP_BUFSIZE);
+}
+/*---------------------------------------------------------------------------*/
+static void
+frame_write(const uint8_t *frame, int len)
+{
+  int ret;
+#if TAPDEV_VNET_HDR
+  struct virtio_net_hdr hdr;
+  struct iovec iov[2];
+
+  if(vnet_hdr) {
+    memset(&hdr, 0, sizeof(hdr));
+    iov[0].iov_base = &hdr;
+    iov[0].iov_len = sizeof(hdr);
+    iov[1].iov_base = (void *)frame;
+    iov[1].iov_len = len;
+    ret = writev(fd, iov, 2);
+  } else {
+    ret = write(fd, frame, len);
+  }
+#else /* TAPDEV_VNET_HDR */
+  ret = write(fd, frame, len);
+#endif /* TAPDEV_VNET_HDR */
+
+  if(ret == -1) {
+    perror("tap_dev: tapdev_send: writev");
+    exit(1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if TAPDEV_BATCH > 1
+int
+tapdev_batch_begin(void)
+{
+  int ret;
 
+  /* The device is non-blocking, so read until it has no more frames
+     or the batch is full. */
+  rx_next = rx_count = 0;
+  while(rx_count < TAPDEV_BATCH) {
+    ret = frame_read(rx_frames[rx_count].data);
+    if(ret <= 0) {
+      if(ret == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        perror("tapdev_batch_begin: read");
+      }
+      break;
+    }
+    rx_frames[rx_count].len = ret;
+    rx_count++;
+  }
+  PRINTF("tapdev6: read %d frames\n", rx_count);
+
+  in_batch = 1;
+  return rx_count;
+}
+/*---------------------------------------------------------------------------*/
+void
+tapdev_batch_end(void)
+{
+  int i;
 
+  in_batch = 0;
+  for(i = 0; i < tx_count; i++) {
+    frame_write(tx_frames[i].data, tx_frames[i].len);
+  }
+  tx_count = 0;
+}
+#endif /* TAPDEV_BATCH > 1 */
+/*---------------------------------------------------------------------------*/
 uint16_t
 tapdev_poll(void)
 {
+#if TAPDEV_BATCH > 1
+  uint16_t len;
+
+  if(rx_next == rx_count) {
+    return 0;
+  }
+  len = rx_frames[rx_next].len;
+  memcpy(uip_buf, rx_frames[rx_next].data, len);
+  rx_next++;
+  return len;
+#else /* TAPDEV_BATCH > 1 */
   fd_set fdset;
   struct timeval tv;
   int ret;
-  
+
   tv.tv_sec = 0;
   tv.tv_usec = 0;
   
@@ -128,7 +279,7 @@ tapdev_poll(void)
   if(ret == 0) {
     return 0;
   }
-  ret = read(fd, uip_buf, UIP_BUFSIZE);
+  ret = frame_read(uip_buf);
 
   PRINTF("tapdev6: read %d bytes (max %d)\n", ret, UIP_BUFSIZE);
   
@@ -136,6 +287,7 @@ tapdev_poll(void)
     perror("tapdev_poll: read");
   }
   return ret;
+#endif /* TAPDEV_BATCH > 1 */
 }
 /*---------------------------------------------------------------------------*/
 #if defined(__APPLE__)
@@ -307,13 +459,35 @@ tapdev_init(void)
     struct ifreq ifr;
     memset(&ifr, 0, sizeof(ifr));
     ifr.ifr_flags = IFF_TAP|IFF_NO_PI;
-    if (ioctl(fd, TUNSETIFF, (void *) &ifr) < 0) {
+#if TAPDEV_VNET_HDR
+    ifr.ifr_flags |= IFF_VNET_HDR;
+    if(ioctl(fd, TUNSETIFF, (void *) &ifr) < 0) {
+      /* Fall back to plain frames. */
+      ifr.ifr_flags &= ~IFF_VNET_HDR;
+    } else {
+      vnet_hdr = 1;
+      /* Let the kernel hand over packets whose checksum it has not
+         computed; frame_read() completes them. */
+      if(ioctl(fd, TUNSETOFFLOAD, TUN_F_CSUM) < 0) {
+        perror("tapdev: TUNSETOFFLOAD");
+      }
+    }
+#endif /* TAPDEV_VNET_HDR */
+    if(!(ifr.ifr_flags & IFF_VNET_HDR) &&
+       ioctl(fd, TUNSETIFF, (void *) &ifr) < 0) {
       perror(buf);
       exit(1);
     }
   }
 #endif /* Linux */
 
+#if TAPDEV_BATCH > 1
+  if(fcntl(fd, F_SETFL, O_NONBLOCK) == -1) {
+    perror("tapdev: fcntl");
+    exit(1);
+  }
+#endif /* TAPDEV_BATCH > 1 */
+
 #ifdef __APPLE__
   tapdev_init_darwin_routes();
 #endif
@@ -349,8 +523,6 @@ tapdev_init(void)
 static void
 do_send(void)
 {
-  int ret;
-
   if(fd <= 0) {
     return;
   }
@@ -366,12 +538,21 @@ do_send(void)
   }
 #endif /* DROP */
 
-  ret = write(fd, uip_buf, uip_len);
-
-  if(ret == -1) {
-    perror("tap_dev: tapdev_send: writev");
-    exit(1);
+#if TAPDEV_BATCH > 1
+  if(in_batch) {
+    /* Sent together at the end of the batch. */
+    if(tx_count == TAPDEV_BATCH) {
+      tapdev_batch_end();
+      in_batch = 1;
+    }
+    memcpy(tx_frames[tx_count].data, uip_buf, uip_len);
+    tx_frames[tx_count].len = uip_len;
+    tx_count++;
+    return;
   }
+#endif /* TAPDEV_BATCH > 1 */
+
+  frame_write(uip_buf, uip_len);
 }
 /*---------------------------------------------------------------------------*/
 uint8_t
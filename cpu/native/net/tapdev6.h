@@ -38,9 +38,30 @@
 
 #include "contiki-net.h"
 
+/* Number of frames read from the tap device per wakeup. With more than
+   one, the frames are fed to the stack back-to-back and the packets
+   sent meanwhile are written out together afterwards. */
+#ifdef TAPDEV_CONF_BATCH
+#define TAPDEV_BATCH TAPDEV_CONF_BATCH
+#else /* TAPDEV_CONF_BATCH */
+#define TAPDEV_BATCH 1
+#endif /* TAPDEV_CONF_BATCH */
+
+/* Exchange frames with a virtio-net header on Linux, so that the
+   kernel may hand over packets with only a partial checksum. */
+#ifdef TAPDEV_CONF_VNET_HDR
+#define TAPDEV_VNET_HDR TAPDEV_CONF_VNET_HDR
+#else /* TAPDEV_CONF_VNET_HDR */
+#define TAPDEV_VNET_HDR 0
+#endif /* TAPDEV_CONF_VNET_HDR */
+
 void tapdev_init(void);
 uint8_t tapdev_send(const uip_lladdr_t *lladdr);
 uint16_t tapdev_poll(void);
 void tapdev_do_send(void);
+#if TAPDEV_BATCH > 1
+int tapdev_batch_begin(void);
+void tapdev_batch_end(void);
+#endif /* TAPDEV_BATCH > 1 */
 void tapdev_exit(void); //math
 #endif /* TAPDEV_H_ */
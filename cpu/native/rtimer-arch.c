@@ -46,6 +46,15 @@
 #include "sys/rtimer.h"
 #include "sys/clock.h"
 
+#if RTIMER_CONF_TIMERFD
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#endif /* RTIMER_CONF_TIMERFD */
+
 #define DEBUG 0
 #if DEBUG
 #include <stdio.h>
@@ -54,6 +63,87 @@
 #define PRINTF(...)
 #endif
 
+#if RTIMER_CONF_TIMERFD
+static int timer_fd = -1;
+/*---------------------------------------------------------------------------*/
+static uint64_t
+monotonic_usec(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+/*---------------------------------------------------------------------------*/
+rtimer_clock_t
+rtimer_arch_now(void)
+{
+  return (rtimer_clock_t)monotonic_usec();
+}
+/*---------------------------------------------------------------------------*/
+static int
+set_fd(fd_set *rset, fd_set *wset)
+{
+  FD_SET(timer_fd, rset);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_fd(fd_set *rset, fd_set *wset)
+{
+  uint64_t expirations;
+
+  if(FD_ISSET(timer_fd, rset)) {
+    if(read(timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+      rtimer_run_next();
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static const struct select_callback timer_callback = { set_fd, handle_fd };
+/*---------------------------------------------------------------------------*/
+void
+rtimer_arch_init(void)
+{
+  timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if(timer_fd < 0) {
+    perror("timerfd_create");
+    exit(1);
+  }
+  if(!select_set_callback(timer_fd, &timer_callback)) {
+    fprintf(stderr, "rtimer: timerfd %d exceeds SELECT_CONF_MAX\n", timer_fd);
+    exit(1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_arch_schedule(rtimer_clock_t t)
+{
+  struct itimerspec val;
+  uint64_t now, deadline;
+  int32_t diff;
+
+  now = monotonic_usec();
+
+  /* Extend the 32-bit target time to the 64-bit monotonic time base.
+     A target in the past fires as soon as possible. */
+  diff = RTIMER_CLOCK_DIFF(t, (rtimer_clock_t)now);
+  deadline = diff > 0 ? now + diff : now;
+
+  PRINTF("rtimer_arch_schedule time %lu in %ld usec\n",
+         (unsigned long)t, (long)diff);
+
+  val.it_value.tv_sec = deadline / 1000000;
+  val.it_value.tv_nsec = (deadline % 1000000) * 1000;
+  if(val.it_value.tv_sec == 0 && val.it_value.tv_nsec == 0) {
+    /* An all-zero value would disarm the timer. */
+    val.it_value.tv_nsec = 1;
+  }
+  val.it_interval.tv_sec = val.it_interval.tv_nsec = 0;
+  timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &val, NULL);
+}
+/*---------------------------------------------------------------------------*/
+#else /* RTIMER_CONF_TIMERFD */
 /*---------------------------------------------------------------------------*/
 static void
 interrupt(int sig)
@@ -90,3 +180,4 @@ rtimer_arch_schedule(rtimer_clock_t t)
 #endif /* !_WIN32 */
 }
 /*---------------------------------------------------------------------------*/
+#endif /* RTIMER_CONF_TIMERFD */
@@ -42,8 +42,14 @@
 
 #include "contiki-conf.h"
 
+#if RTIMER_CONF_TIMERFD
+#define RTIMER_ARCH_SECOND 1000000UL
+
+rtimer_clock_t rtimer_arch_now(void);
+#else /* RTIMER_CONF_TIMERFD */
 #define RTIMER_ARCH_SECOND CLOCK_CONF_SECOND
 
 #define rtimer_arch_now() clock_time()
+#endif /* RTIMER_CONF_TIMERFD */
 
 #endif /* RTIMER_ARCH_H_ */
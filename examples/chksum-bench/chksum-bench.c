@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Test and benchmark for the Internet checksum in uip-chksum.c
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ip/uip-chksum.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_LEN       1500
+#define MAX_OFFSET    32
+#define NUM_RANDOM    1000
+#define BENCH_BYTES   2000000000UL
+#define PACKET_LEN    1280
+
+#define UIP_IP_BUF    ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+static uint8_t buf[MAX_LEN + MAX_OFFSET];
+
+PROCESS(chksum_bench_process, "Checksum benchmark");
+AUTOSTART_PROCESSES(&chksum_bench_process);
+/*---------------------------------------------------------------------------*/
+/* The 16-bit loop that uIP used before uip-chksum.c. */
+static uint16_t
+reference_chksum(uint16_t sum, const uint8_t *data, uint16_t len)
+{
+  uint16_t t;
+  const uint8_t *dataptr;
+  const uint8_t *last_byte;
+
+  dataptr = data;
+  last_byte = data + len - 1;
+
+  while(dataptr < last_byte) {
+    t = (dataptr[0] << 8) + dataptr[1];
+    sum += t;
+    if(sum < t) {
+      sum++;
+    }
+    dataptr += 2;
+  }
+
+  if(dataptr == last_byte) {
+    t = (dataptr[0] << 8) + 0;
+    sum += t;
+    if(sum < t) {
+      sum++;
+    }
+  }
+  return sum;
+}
+/*---------------------------------------------------------------------------*/
+static void
+fill(int pattern)
+{
+  int i;
+
+  for(i = 0; i < sizeof(buf); i++) {
+    switch(pattern) {
+    case 0:
+      buf[i] = rand();
+      break;
+    case 1:
+      /* Maximizes the carries. */
+      buf[i] = 0xff;
+      break;
+    default:
+      buf[i] = 0;
+      break;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+check(int pattern)
+{
+  int errors;
+  uint16_t len, offset, sum;
+
+  errors = 0;
+  fill(pattern);
+  for(len = 0; len <= MAX_LEN; len++) {
+    for(offset = 0; offset < MAX_OFFSET; offset++) {
+      sum = offset == 0 ? 0 : rand();
+      if(uip_chksum_add(sum, &buf[offset], len) !=
+         reference_chksum(sum, &buf[offset], len)) {
+        if(errors++ < 10) {
+          printf("mismatch: pattern %d, len %u, offset %u, sum 0x%04x\n",
+                 pattern, len, offset, sum);
+        }
+      }
+    }
+  }
+  return errors;
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_random(void)
+{
+  int errors;
+  int i;
+  uint16_t len, offset, sum;
+
+  errors = 0;
+  for(i = 0; i < NUM_RANDOM; i++) {
+    fill(0);
+    len = rand() % (MAX_LEN + 1);
+    offset = rand() % MAX_OFFSET;
+    sum = rand();
+    if(uip_chksum_add(sum, &buf[offset], len) !=
+       reference_chksum(sum, &buf[offset], len)) {
+      errors++;
+    }
+  }
+  return errors;
+}
+/*---------------------------------------------------------------------------*/
+static void
+report(const char *what, uint16_t len, unsigned long count,
+       clock_time_t start)
+{
+  clock_time_t elapsed = clock_time() - start;
+
+  printf("%-10s %4u bytes %9lu ops in %5lu ms", what, len, count,
+         (unsigned long)(elapsed * 1000 / CLOCK_SECOND));
+  if(elapsed > 0) {
+    printf(" (%lu MB/s)",
+           (unsigned long)((double)count * len * CLOCK_SECOND / elapsed / 1e6));
+  }
+  printf("\n");
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+bench(uint16_t len)
+{
+  static const uint16_t offset = 2;
+  volatile uint16_t sink;
+  unsigned long count, i;
+  clock_time_t start;
+
+  count = BENCH_BYTES / len;
+  sink = 0;
+
+  start = clock_time();
+  for(i = 0; i < count / 8; i++) {
+    sink += reference_chksum(sink, &buf[offset], len);
+  }
+  report("reference", len, count / 8, start);
+
+  start = clock_time();
+  for(i = 0; i < count; i++) {
+    sink += uip_chksum_add(sink, &buf[offset], len);
+  }
+  report("uip", len, count, start);
+
+  return sink;
+}
+/*---------------------------------------------------------------------------*/
+static int
+bench_icmp6(void)
+{
+  uint16_t payload_len, sum;
+  unsigned long count, i;
+  clock_time_t start;
+
+  payload_len = PACKET_LEN - UIP_IPH_LEN;
+  memset(uip_buf, 0, UIP_LLH_LEN + UIP_IPH_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->len[0] = payload_len >> 8;
+  UIP_IP_BUF->len[1] = payload_len & 0xff;
+  UIP_IP_BUF->proto = UIP_PROTO_ICMP6;
+  UIP_IP_BUF->ttl = 64;
+  uip_ip6addr(&UIP_IP_BUF->srcipaddr, 0xfd00, 0, 0, 0, 0, 0, 0, 1);
+  uip_ip6addr(&UIP_IP_BUF->destipaddr, 0xfd00, 0, 0, 0, 0, 0, 0, 2);
+  for(i = 0; i < payload_len; i++) {
+    uip_buf[UIP_LLH_LEN + UIP_IPH_LEN + i] = rand();
+  }
+  uip_ext_len = 0;
+
+  sum = payload_len + UIP_PROTO_ICMP6;
+  sum = reference_chksum(sum, (uint8_t *)&UIP_IP_BUF->srcipaddr,
+                         2 * sizeof(uip_ipaddr_t));
+  sum = reference_chksum(sum, &uip_buf[UIP_LLH_LEN + UIP_IPH_LEN],
+                         payload_len);
+  sum = (sum == 0) ? 0xffff : uip_htons(sum);
+  if(uip_icmp6chksum() != sum) {
+    printf("uip_icmp6chksum mismatch\n");
+    return 1;
+  }
+
+  count = BENCH_BYTES / PACKET_LEN;
+  start = clock_time();
+  for(i = 0; i < count; i++) {
+    sum += uip_icmp6chksum();
+  }
+  report("icmp6", PACKET_LEN, count, start);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(chksum_bench_process, ev, data)
+{
+  static const uint16_t lens[] = { 20, 40, 64, 576, 1280, 1500 };
+  int errors;
+  int i;
+
+  PROCESS_BEGIN();
+
+  srand(1);
+  errors = check(0) + check(1) + check(2) + check_random();
+
+  fill(0);
+  for(i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+    bench(lens[i]);
+  }
+  errors += bench_icmp6();
+
+  printf("%d errors\n", errors);
+  exit(errors != 0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
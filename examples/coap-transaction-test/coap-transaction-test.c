@@ -0,0 +1,347 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Randomized test of the CoAP transaction store: the MID and
+ *         token lookups, the retransmission heap and timeouts.
+ *
+ *         The transaction store is compiled into the test, so that
+ *         its clock can be driven by the test and its heap checked.
+ */
+
+#include "contiki.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static clock_time_t test_clock;
+
+#define clock_time() test_clock
+#include "er-coap-transactions.c"
+#undef clock_time
+
+#define NUM_OPS     200000
+#define NUM_CLIENTS 4
+
+PROCESS(coap_transaction_test_process, "CoAP transaction test");
+AUTOSTART_PROCESSES(&coap_transaction_test_process);
+
+/* The transactions that are expected to be open. */
+static struct expected {
+  coap_transaction_t *t;
+  uint16_t mid;
+  uint8_t token[COAP_TOKEN_LEN];
+  uint8_t token_len;
+  uint8_t client;
+  uint8_t con;
+  uint8_t sent;
+} expected[COAP_MAX_OPEN_TRANSACTIONS];
+static int num_expected;
+
+static uip_ipaddr_t clients[NUM_CLIENTS];
+static unsigned long messages_sent, timeouts, cleared;
+static int errors;
+
+#define CHECK(cond) do {                                         \
+    if(!(cond)) {                                                \
+      if(errors++ < 10) {                                        \
+        printf("FAIL line %d: %s\n", __LINE__, #cond);           \
+      }                                                          \
+    }                                                            \
+  } while(0)
+/*---------------------------------------------------------------------------*/
+void
+coap_send_message(uip_ipaddr_t *addr, uint16_t port, uint8_t *data,
+                  uint16_t length)
+{
+  messages_sent++;
+}
+/*---------------------------------------------------------------------------*/
+int
+coap_remove_observer_by_client(uip_ipaddr_t *addr, uint16_t port)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+forget(struct expected *e)
+{
+  *e = expected[--num_expected];
+}
+/*---------------------------------------------------------------------------*/
+static void
+timeout_callback(void *data, void *response)
+{
+  coap_transaction_t *t = data;
+  int i;
+
+  CHECK(response == NULL);
+  for(i = 0; i < num_expected; i++) {
+    if(expected[i].t == t) {
+      CHECK(expected[i].sent);
+      forget(&expected[i]);
+      timeouts++;
+      return;
+    }
+  }
+  CHECK(!"timeout of a transaction that is not open");
+}
+/*---------------------------------------------------------------------------*/
+static void
+check_store(void)
+{
+  int i, kept;
+
+  /* Heap order, back links, and no overdue transactions after a
+     check. */
+  for(i = 0; i < heap_size; i++) {
+    CHECK(retrans_heap[i]->heap_index == i);
+    if(i > 0) {
+      CHECK(!DEADLINE_BEFORE(retrans_heap[i]->retrans_deadline,
+                             retrans_heap[(i - 1) / 2]->retrans_deadline));
+    }
+  }
+  kept = 0;
+  for(i = 0; i < num_expected; i++) {
+    if(expected[i].sent) {
+      kept++;
+      CHECK(expected[i].t->heap_index < heap_size);
+    } else {
+      CHECK(expected[i].t->heap_index == HEAP_NONE);
+    }
+  }
+  CHECK(kept == heap_size);
+  CHECK(stats.in_flight == num_expected);
+}
+/*---------------------------------------------------------------------------*/
+static void
+check_mid_lookup(uint16_t mid)
+{
+  coap_transaction_t *t;
+  int i, found;
+
+  found = 0;
+  for(i = 0; i < num_expected; i++) {
+    found |= expected[i].mid == mid;
+  }
+  t = coap_get_transaction_by_mid(mid);
+  CHECK((t != NULL) == found);
+  if(t != NULL) {
+    CHECK(t->mid == mid);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+check_token_lookup(int client, const uint8_t *token, int token_len)
+{
+  coap_transaction_t *t;
+  int i, found;
+
+  /* Only sent transactions have a serialized token. */
+  found = 0;
+  for(i = 0; i < num_expected; i++) {
+    found |= expected[i].sent && expected[i].client == client
+      && expected[i].token_len == token_len
+      && memcmp(expected[i].token, token, token_len) == 0;
+  }
+  t = coap_get_transaction_by_token(&clients[client], COAP_DEFAULT_PORT,
+                                    token, token_len);
+  CHECK((t != NULL) == found);
+  if(t != NULL) {
+    CHECK(memcmp(t->packet + COAP_HEADER_LEN, token, token_len) == 0);
+    CHECK(uip_ipaddr_cmp(&t->addr, &clients[client]));
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+send(struct expected *e)
+{
+  coap_transaction_t *t = e->t;
+
+  /* Serialize just before sending, as the REST engine does. */
+  t->packet[0] = (1 << COAP_HEADER_VERSION_POSITION)
+    | ((e->con ? COAP_TYPE_CON : COAP_TYPE_NON) << COAP_HEADER_TYPE_POSITION)
+    | e->token_len;
+  t->packet[1] = COAP_GET;
+  t->packet[2] = e->mid >> 8;
+  t->packet[3] = e->mid;
+  memcpy(t->packet + COAP_HEADER_LEN, e->token, e->token_len);
+  t->packet_len = COAP_HEADER_LEN + e->token_len;
+
+  coap_send_transaction(t);
+  if(e->con) {
+    e->sent = 1;
+  } else {
+    /* NON messages are not kept. */
+    forget(e);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+create(int send_now)
+{
+  struct expected *e;
+  coap_transaction_t *t;
+  int k;
+
+  e = &expected[num_expected];
+  e->mid = rand();
+  e->client = rand() % NUM_CLIENTS;
+  /* Few short tokens, so that tokens collide. */
+  e->token_len = rand() % 3;
+  for(k = 0; k < e->token_len; k++) {
+    e->token[k] = rand() % 4;
+  }
+  e->con = rand() % 4 != 0;
+  e->sent = 0;
+
+  t = coap_new_transaction(e->mid, &clients[e->client], COAP_DEFAULT_PORT);
+  CHECK((t != NULL) == (num_expected < COAP_MAX_OPEN_TRANSACTIONS));
+  if(t == NULL) {
+    return;
+  }
+  e->t = t;
+  num_expected++;
+
+  t->callback = timeout_callback;
+  t->callback_data = t;
+
+  if(send_now) {
+    send(e);
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(coap_transaction_test_process, ev, data)
+{
+  static int op;
+  uint8_t token[COAP_TOKEN_LEN];
+  coap_transaction_t *t;
+  int i, k;
+
+  PROCESS_BEGIN();
+
+  printf("CoAP transaction store of %d, index %s\n",
+         COAP_MAX_OPEN_TRANSACTIONS, COAP_TRANSACTION_INDEX ? "on" : "off");
+
+  for(i = 0; i < NUM_CLIENTS; i++) {
+    uip_ip6addr(&clients[i], 0xfd00, 0, 0, 0, 0, 0, 0, i + 1);
+  }
+  memb_init(&transactions_memb);
+  coap_register_as_transaction_handler();
+  srand(1);
+
+  /* Start just before the clock wraps around. */
+  test_clock = (clock_time_t)0 - 60 * CLOCK_SECOND;
+
+  for(op = 0; op < NUM_OPS; op++) {
+    switch(rand() % 10) {
+    case 0:
+    case 1:
+    case 2:
+      create(rand() % 8 != 0);
+      break;
+    case 3:
+      /* Send a transaction that was created earlier. */
+      for(i = 0; i < num_expected && expected[i].sent; i++);
+      if(i < num_expected) {
+        send(&expected[i]);
+      }
+      break;
+    case 4:
+      if(num_expected > 0) {
+        i = rand() % num_expected;
+        t = expected[i].t;
+        forget(&expected[i]);
+        coap_clear_transaction(t);
+        cleared++;
+      }
+      break;
+    case 5:
+      if(num_expected > 0 && rand() % 2) {
+        check_mid_lookup(expected[rand() % num_expected].mid);
+      } else {
+        check_mid_lookup(rand());
+      }
+      break;
+    case 6:
+      if(num_expected > 0 && rand() % 2) {
+        i = rand() % num_expected;
+        check_token_lookup(expected[i].client, expected[i].token,
+                           expected[i].token_len);
+      } else {
+        k = rand() % 3;
+        for(i = 0; i < k; i++) {
+          token[i] = rand() % 4;
+        }
+        check_token_lookup(rand() % NUM_CLIENTS, token, k);
+      }
+      break;
+    default:
+      test_clock += rand() % (2 * CLOCK_SECOND);
+      coap_check_transactions();
+      for(i = 0; i < heap_size; i++) {
+        CHECK(DEADLINE_BEFORE(test_clock, retrans_heap[i]->retrans_deadline));
+      }
+      break;
+    }
+    check_store();
+  }
+
+  /* Every transaction that is still kept must time out. */
+  for(i = 0; i < num_expected; i++) {
+    if(!expected[i].sent) {
+      t = expected[i].t;
+      forget(&expected[i]);
+      coap_clear_transaction(t);
+      i--;
+    }
+  }
+  for(i = 0; i < 1000 && heap_size > 0; i++) {
+    test_clock += CLOCK_SECOND;
+    coap_check_transactions();
+    check_store();
+  }
+  CHECK(num_expected == 0);
+  CHECK(stats.in_flight == 0);
+  CHECK(stats.timed_out == timeouts);
+
+  printf("%lu messages sent, %lu retransmitted, %lu timed out, %lu cleared\n",
+         messages_sent, (unsigned long)stats.retransmitted, timeouts, cleared);
+  printf("%d errors\n", errors);
+  exit(errors != 0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Randomized test of the Coffee file index against a model of
+ *         the expected files, followed by a cold open benchmark.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "cfs/cfs-coffee.h"
+#include "cfs-coffee-arch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* More names than fit in three quarters of the index, so that both a
+   complete and a partial index are exercised. */
+#define NUM_NAMES      150
+#define RESERVE_SIZE   1024
+#define MAX_LENGTH     700
+#define NUM_OPS        20000
+#define NUM_OPENS      20000
+
+PROCESS(coffee_index_test_process, "Coffee index test");
+AUTOSTART_PROCESSES(&coffee_index_test_process);
+
+/* The expected state of each file. The contents of a file follow
+   from its name, its generation and the offset. */
+static struct {
+  uint8_t exists;
+  uint8_t generation;
+  uint16_t length;
+} model[NUM_NAMES];
+
+static int errors;
+
+#define CHECK(cond) do {                                         \
+    if(!(cond)) {                                                \
+      if(errors++ < 10) {                                        \
+        printf("FAIL line %d: %s\n", __LINE__, #cond);           \
+      }                                                          \
+    }                                                            \
+  } while(0)
+/*---------------------------------------------------------------------------*/
+static const char *
+file_name(int i)
+{
+  static char name[8];
+
+  snprintf(name, sizeof(name), "f%03d", i);
+  return name;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+file_byte(int i, unsigned offset)
+{
+  /* Never zero, since Coffee finds the end of a file by its last
+     non-zero byte. */
+  return 1 + (i * 31 + model[i].generation * 17 + offset * 7) % 255;
+}
+/*---------------------------------------------------------------------------*/
+static void
+create_file(int i)
+{
+  int ret;
+
+  ret = cfs_coffee_reserve(file_name(i), RESERVE_SIZE);
+  CHECK((ret == 0) == !model[i].exists);
+  if(ret == 0) {
+    model[i].exists = 1;
+    model[i].generation++;
+    model[i].length = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+append_file(int i)
+{
+  uint8_t buf[100];
+  unsigned n, k;
+  int fd;
+
+  n = 1 + rand() % sizeof(buf);
+  if(model[i].length + n > MAX_LENGTH) {
+    n = MAX_LENGTH - model[i].length;
+  }
+  for(k = 0; k < n; k++) {
+    buf[k] = file_byte(i, model[i].length + k);
+  }
+  fd = cfs_open(file_name(i), CFS_WRITE | CFS_APPEND);
+  CHECK(fd >= 0);
+  if(fd >= 0) {
+    CHECK(cfs_write(fd, buf, n) == n);
+    cfs_close(fd);
+    model[i].length += n;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+verify_file(int i)
+{
+  uint8_t buf[MAX_LENGTH + 1];
+  unsigned k;
+  int fd, n;
+
+  fd = cfs_open(file_name(i), CFS_READ);
+  CHECK((fd >= 0) == model[i].exists);
+  if(fd < 0) {
+    return;
+  }
+  n = cfs_read(fd, buf, sizeof(buf));
+  cfs_close(fd);
+  CHECK(n == model[i].length);
+  for(k = 0; k < n && k < model[i].length; k++) {
+    if(buf[k] != file_byte(i, k)) {
+      CHECK(buf[k] == file_byte(i, k));
+      break;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_file(int i)
+{
+  int ret;
+
+  ret = cfs_remove(file_name(i));
+  CHECK((ret == 0) == model[i].exists);
+  model[i].exists = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+verify_dir(void)
+{
+  static uint8_t seen[NUM_NAMES];
+  struct cfs_dir dir;
+  struct cfs_dirent dirent;
+  int i;
+
+  memset(seen, 0, sizeof(seen));
+  CHECK(cfs_opendir(&dir, "/") == 0);
+  while(cfs_readdir(&dir, &dirent) == 0) {
+    i = atoi(dirent.name + 1);
+    CHECK(i >= 0 && i < NUM_NAMES && strcmp(dirent.name, file_name(i)) == 0);
+    if(i < 0 || i >= NUM_NAMES) {
+      continue;
+    }
+    CHECK(model[i].exists && !seen[i]);
+    CHECK(dirent.size == model[i].length);
+    seen[i] = 1;
+  }
+  cfs_closedir(&dir);
+  for(i = 0; i < NUM_NAMES; i++) {
+    CHECK(seen[i] == model[i].exists);
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(coffee_index_test_process, ev, data)
+{
+  clock_time_t start;
+  int i, op, existing, fd;
+
+  PROCESS_BEGIN();
+
+  printf("Coffee index of %d slots, %d names\n", COFFEE_INDEX_SIZE, NUM_NAMES);
+  cfs_coffee_format();
+  srand(1);
+
+  for(op = 0; op < NUM_OPS; op++) {
+    i = rand() % NUM_NAMES;
+    switch(rand() % 8) {
+    case 0:
+    case 1:
+      create_file(i);
+      break;
+    case 2:
+    case 3:
+      if(model[i].exists && model[i].length < MAX_LENGTH) {
+        append_file(i);
+      }
+      break;
+    case 4:
+    case 5:
+      verify_file(i);
+      break;
+    case 6:
+      remove_file(i);
+      break;
+    default:
+      if(op % 64 == 0) {
+        verify_dir();
+      }
+      break;
+    }
+  }
+  for(i = 0; i < NUM_NAMES; i++) {
+    verify_file(i);
+  }
+  verify_dir();
+
+  /* Open files at random, more than Coffee caches, so that most opens
+     have to find the file on the storage. */
+  existing = 0;
+  for(i = 0; i < NUM_NAMES; i++) {
+    existing += model[i].exists;
+  }
+  start = clock_time();
+  for(op = 0; op < NUM_OPENS; op++) {
+    i = rand() % NUM_NAMES;
+    fd = cfs_open(file_name(i), CFS_READ);
+    CHECK((fd >= 0) == model[i].exists);
+    cfs_close(fd);
+  }
+  printf("%d cold opens with %d files in %lu ms\n", NUM_OPENS, existing,
+         (unsigned long)((clock_time() - start) * 1000 / CLOCK_SECOND));
+
+  printf("%d errors\n", errors);
+  exit(errors != 0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,411 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for the ip64 address mapping table and translator
+ */
+
+#include "contiki.h"
+#include "ip64.h"
+#include "ip64-addrmap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_SESSIONS  1000
+#define NUM_LOOKUPS   1000000
+#define LIFETIME      (CLOCK_SECOND * 60)
+#define SHORT_LIFETIME (CLOCK_SECOND * 2)
+
+#define NUM_PACKETS   200000
+#define PAYLOAD_LEN   1024
+
+#define IPV6_HDRLEN   40
+#define IPV4_HDRLEN   20
+#define PROTO_ICMPV4  1
+#define PROTO_TCP     6
+#define PROTO_UDP     17
+#define PROTO_ICMPV6  58
+
+static struct ip64_addrmap_entry *sessions[NUM_SESSIONS];
+
+static uint8_t template6[IPV6_HDRLEN + PAYLOAD_LEN];
+static uint8_t packet6[IPV6_HDRLEN + PAYLOAD_LEN];
+static uint8_t packet4[IPV6_HDRLEN + PAYLOAD_LEN];
+
+PROCESS(ip64_bench_process, "ip64 benchmark");
+AUTOSTART_PROCESSES(&ip64_bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+session_tuple(int i, uip_ip6addr_t *ip6addr, uint16_t *ip6port,
+              uip_ip4addr_t *ip4addr, uint16_t *ip4port)
+{
+  /* 50 nodes with 20 sessions each to a handful of servers. */
+  uip_ip6addr(ip6addr, 0xfd00, 0, 0, 0, 0, 0, 0, i / 20 + 1);
+  *ip6port = 1024 + i;
+  uip_ipaddr(ip4addr, 192, 168, 1, i % 4 + 1);
+  *ip4port = i % 2 ? 80 : 5683;
+}
+/*---------------------------------------------------------------------------*/
+static void
+report(const char *what, int count, clock_time_t start)
+{
+  clock_time_t elapsed = clock_time() - start;
+
+  printf("%-14s %7d ops in %5lu ms", what, count,
+         (unsigned long)(elapsed * 1000 / CLOCK_SECOND));
+  if(elapsed > 0) {
+    printf(" (%lu ops/s)", (unsigned long)(count * CLOCK_SECOND / elapsed));
+  }
+  printf("\n");
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_stats(void)
+{
+  printf("%u active, %lu created, %lu expired, %lu recycled, %lu failed\n",
+         ip64_addrmap_stats.active,
+         (unsigned long)ip64_addrmap_stats.created,
+         (unsigned long)ip64_addrmap_stats.expired,
+         (unsigned long)ip64_addrmap_stats.recycled,
+         (unsigned long)ip64_addrmap_stats.create_failed);
+}
+/*---------------------------------------------------------------------------*/
+/* A plain byte-wise Internet checksum, to check the translator's. */
+static uint16_t
+ref_sum(uint32_t sum, const uint8_t *data, int len)
+{
+  int i;
+
+  for(i = 0; i + 1 < len; i += 2) {
+    sum += (data[i] << 8) | data[i + 1];
+  }
+  if(i < len) {
+    sum += data[i] << 8;
+  }
+  while(sum >> 16) {
+    sum = (sum & 0xffff) + (sum >> 16);
+  }
+  return sum;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+ref_chksum6(const uint8_t *p, int len)
+{
+  uint32_t sum;
+
+  sum = ref_sum(len - IPV6_HDRLEN + p[6], &p[8], 32);
+  return ref_sum(sum, &p[IPV6_HDRLEN], len - IPV6_HDRLEN);
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+ref_chksum4(const uint8_t *p, int len)
+{
+  uint32_t sum;
+
+  sum = 0;
+  if(p[9] != PROTO_ICMPV4) {
+    sum = ref_sum(len - IPV4_HDRLEN + p[9], &p[12], 8);
+  }
+  return ref_sum(sum, &p[IPV4_HDRLEN], len - IPV4_HDRLEN);
+}
+/*---------------------------------------------------------------------------*/
+static int
+chksum_offset(uint8_t proto)
+{
+  return proto == PROTO_TCP ? 16 : proto == PROTO_UDP ? 6 : 2;
+}
+/*---------------------------------------------------------------------------*/
+/* Builds an IPv6 packet from fd00::1 port 5000 to 192.168.1.1 port
+   5683 through the translator. */
+static int
+build6(uint8_t *p, uint8_t proto, int payload_len)
+{
+  int len, i;
+  uint16_t sum;
+  uint8_t *t;
+
+  memset(p, 0, IPV6_HDRLEN);
+  p[0] = 0x60;
+  p[4] = payload_len >> 8;
+  p[5] = payload_len & 0xff;
+  p[6] = proto;
+  p[7] = 64;
+  p[8] = 0xfd;
+  p[23] = 1;
+  p[34] = p[35] = 0xff;
+  p[36] = 192;
+  p[37] = 168;
+  p[38] = 1;
+  p[39] = 1;
+  t = &p[IPV6_HDRLEN];
+  for(i = 0; i < payload_len; i++) {
+    t[i] = i * 7;
+  }
+  if(proto == PROTO_ICMPV6) {
+    t[0] = 129;
+    t[1] = 0;
+  } else {
+    t[0] = 5000 >> 8;
+    t[1] = 5000 & 0xff;
+    t[2] = 5683 >> 8;
+    t[3] = 5683 & 0xff;
+    if(proto == PROTO_UDP) {
+      t[4] = payload_len >> 8;
+      t[5] = payload_len & 0xff;
+    } else {
+      t[12] = 5 << 4;
+    }
+  }
+  len = IPV6_HDRLEN + payload_len;
+  t[chksum_offset(proto)] = t[chksum_offset(proto) + 1] = 0;
+  sum = ~ref_chksum6(p, len);
+  t[chksum_offset(proto)] = sum >> 8;
+  t[chksum_offset(proto) + 1] = sum & 0xff;
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+/* Turns a translated IPv4 packet into the reply from 192.168.1.1. */
+static void
+reply4(uint8_t *p, int len, int with_chksum)
+{
+  uint8_t addr[4], port[2];
+  uint8_t *t;
+  uint16_t sum;
+
+  memcpy(addr, &p[12], 4);
+  memcpy(&p[12], &p[16], 4);
+  memcpy(&p[16], addr, 4);
+  t = &p[IPV4_HDRLEN];
+  if(p[9] == PROTO_ICMPV4) {
+    t[0] = 8;
+  } else {
+    memcpy(port, &t[0], 2);
+    memcpy(&t[0], &t[2], 2);
+    memcpy(&t[2], port, 2);
+  }
+  t[chksum_offset(p[9])] = t[chksum_offset(p[9]) + 1] = 0;
+  if(with_chksum) {
+    sum = ~ref_chksum4(p, len);
+    t[chksum_offset(p[9])] = sum >> 8;
+    t[chksum_offset(p[9]) + 1] = sum & 0xff;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+check4(const uint8_t *p, int len)
+{
+  return len > IPV4_HDRLEN && ref_sum(0, p, IPV4_HDRLEN) == 0xffff &&
+    ref_chksum4(p, len) == 0xffff;
+}
+/*---------------------------------------------------------------------------*/
+static int
+check6(const uint8_t *p, int len)
+{
+  /* Echo requests go to the translator's own IPv6 address, the rest
+     back to the sender. */
+  return len > IPV6_HDRLEN && ref_chksum6(p, len) == 0xffff &&
+    (p[6] == PROTO_ICMPV6 || (p[24] == 0xfd && p[39] == 1));
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_translation(void)
+{
+  static const uint8_t protos[] = { PROTO_UDP, PROTO_TCP, PROTO_ICMPV6 };
+  int errors, i, len6, len4;
+
+  errors = 0;
+  for(i = 0; i < sizeof(protos) * 2; i++) {
+    len6 = build6(template6, protos[i / 2], i % 2 ? 33 : 200);
+    len4 = ip64_6to4(template6, len6, packet4);
+    if(!check4(packet4, len4)) {
+      printf("6to4 failed for protocol %u\n", protos[i / 2]);
+      errors++;
+      continue;
+    }
+
+    /* The same, in place. */
+    memcpy(packet6, template6, len6);
+    len4 = ip64_6to4(packet6, len6, packet6 + IP64_6TO4_INPLACE_OFFSET);
+    if(!check4(packet6 + IP64_6TO4_INPLACE_OFFSET, len4)) {
+      printf("in-place 6to4 failed for protocol %u\n", protos[i / 2]);
+      errors++;
+    }
+
+    /* The reply, with and without an IPv4 UDP checksum. */
+    reply4(packet4, len4, i % 2 == 0 || protos[i / 2] != PROTO_UDP);
+    len6 = ip64_4to6(packet4, len4, packet6);
+    if(!check6(packet6, len6)) {
+      printf("4to6 failed for protocol %u\n", protos[i / 2]);
+      errors++;
+    }
+  }
+  return errors;
+}
+/*---------------------------------------------------------------------------*/
+static int
+translation_bench(void)
+{
+  clock_time_t start;
+  int errors, i, len6, len4;
+
+  errors = check_translation();
+
+  len6 = build6(template6, PROTO_UDP, PAYLOAD_LEN);
+  printf("Translating %d byte UDP packets\n", len6);
+
+  start = clock_time();
+  for(i = 0; i < NUM_PACKETS; i++) {
+    len4 = ip64_6to4(template6, len6, packet4);
+  }
+  report("6to4", NUM_PACKETS, start);
+  errors += !check4(packet4, len4);
+
+  /* Only the IPv6 and UDP headers need to be restored between
+     packets. */
+  memcpy(packet6, template6, len6);
+  start = clock_time();
+  for(i = 0; i < NUM_PACKETS; i++) {
+    memcpy(packet6, template6, IPV6_HDRLEN + 8);
+    len4 = ip64_6to4(packet6, len6, packet6 + IP64_6TO4_INPLACE_OFFSET);
+  }
+  report("6to4 in place", NUM_PACKETS, start);
+  errors += !check4(packet6 + IP64_6TO4_INPLACE_OFFSET, len4);
+
+  len4 = ip64_6to4(template6, len6, packet4);
+  reply4(packet4, len4, 1);
+  start = clock_time();
+  for(i = 0; i < NUM_PACKETS; i++) {
+    len6 = ip64_4to6(packet4, len4, packet6);
+  }
+  report("4to6", NUM_PACKETS, start);
+  errors += !check6(packet6, len6);
+
+  return errors;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(ip64_bench_process, ev, data)
+{
+  static struct etimer et;
+  static int errors;
+  struct ip64_addrmap_entry *m;
+  uip_ip6addr_t ip6addr;
+  uip_ip4addr_t ip4addr;
+  uint16_t ip6port, ip4port;
+  clock_time_t start;
+  int i, k;
+
+  PROCESS_BEGIN();
+
+  ip64_addrmap_init();
+
+  start = clock_time();
+  for(i = 0; i < NUM_SESSIONS; i++) {
+    session_tuple(i, &ip6addr, &ip6port, &ip4addr, &ip4port);
+    sessions[i] = ip64_addrmap_create(&ip6addr, ip6port, &ip4addr, ip4port,
+                                      i % 3 ? 6 : 17);
+    if(sessions[i] == NULL) {
+      errors++;
+      continue;
+    }
+    ip64_addrmap_set_lifetime(sessions[i], LIFETIME);
+  }
+  report("create", NUM_SESSIONS, start);
+
+  /* Every mapped port must be unique. */
+  for(i = 0; i < NUM_SESSIONS; i++) {
+    for(k = i + 1; k < NUM_SESSIONS; k++) {
+      if(sessions[i]->mapped_port == sessions[k]->mapped_port) {
+        errors++;
+      }
+    }
+  }
+
+  /* Alternate outbound and inbound packets of random sessions. */
+  srand(1);
+  start = clock_time();
+  for(i = 0; i < NUM_LOOKUPS; i++) {
+    k = rand() % NUM_SESSIONS;
+    if(i % 2) {
+      session_tuple(k, &ip6addr, &ip6port, &ip4addr, &ip4port);
+      m = ip64_addrmap_lookup(&ip6addr, ip6port, &ip4addr, ip4port,
+                              k % 3 ? 6 : 17);
+      ip64_addrmap_set_lifetime(m, LIFETIME);
+    } else {
+      m = ip64_addrmap_lookup_port(sessions[k]->mapped_port, k % 3 ? 6 : 17);
+    }
+    if(m != sessions[k]) {
+      errors++;
+    }
+  }
+  report("lookup", NUM_LOOKUPS, start);
+
+  /* Inbound packets for a protocol without a mapping are not
+     matched. */
+  if(ip64_addrmap_lookup_port(sessions[0]->mapped_port, 6) != NULL) {
+    errors++;
+  }
+  print_stats();
+
+  /* Let half of the sessions time out. */
+  for(i = 0; i < NUM_SESSIONS; i += 2) {
+    ip64_addrmap_set_lifetime(sessions[i], SHORT_LIFETIME);
+  }
+  etimer_set(&et, SHORT_LIFETIME + CLOCK_SECOND);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  for(i = 1; i < NUM_SESSIONS; i += 2) {
+    if(ip64_addrmap_lookup_port(sessions[i]->mapped_port,
+                                i % 3 ? 6 : 17) != sessions[i]) {
+      errors++;
+    }
+  }
+  if(ip64_addrmap_stats.expired != NUM_SESSIONS / 2 ||
+     ip64_addrmap_stats.active != NUM_SESSIONS / 2) {
+    errors++;
+  }
+  print_stats();
+
+  ip64_init();
+  uip_ipaddr(&ip4addr, 10, 0, 0, 2);
+  ip64_set_hostaddr(&ip4addr);
+  errors += translation_bench();
+
+  printf("%d errors\n", errors);
+  exit(errors != 0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
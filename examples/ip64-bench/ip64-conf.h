@@ -0,0 +1,14 @@
+#ifndef IP64_CONF_H
+#define IP64_CONF_H
+
+#include "ip64-null-driver.h"
+#include "ip64-eth-interface.h"
+
+/* The benchmark calls the translator directly, so the Ethernet side
+   only needs to link. */
+#define IP64_CONF_UIP_FALLBACK_INTERFACE    ip64_eth_interface
+#define IP64_CONF_INPUT                     ip64_eth_interface_input
+#define IP64_CONF_ETH_DRIVER                ip64_null_driver
+#define IP64_CONF_DHCP                      0
+
+#endif /* IP64_CONF_H */
@@ -0,0 +1,10 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+#define IP64_ADDRMAP_CONF_ENTRIES 1024
+#define IP64_ADDRMAP_CONF_HASH_SIZE 1024
+
+#undef UIP_CONF_BUFFER_SIZE
+#define UIP_CONF_BUFFER_SIZE 1280
+
+#endif /* PROJECT_CONF_H_ */
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for the next-hop determination in tcpip_ipv6_output()
+ */
+
+#include "contiki.h"
+#include "contiki-net.h"
+#include "net/ipv6/uip-ds6.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_NBRS      24
+#define NUM_ROUTES    (UIP_DS6_ROUTE_NB)
+#define NUM_HOT       12
+#define NUM_ONLINK    4
+#define NUM_PACKETS   1000000
+
+#define UIP_IP_BUF ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+static uip_ipaddr_t nbr_addrs[NUM_NBRS];
+static int sent;
+static int sent_to;
+
+PROCESS(dest_cache_bench_process, "Destination cache benchmark");
+AUTOSTART_PROCESSES(&dest_cache_bench_process);
+/*---------------------------------------------------------------------------*/
+static uint8_t
+output(const uip_lladdr_t *lladdr)
+{
+  sent++;
+  sent_to = lladdr == NULL ? -1 : lladdr->addr[sizeof(lladdr->addr) - 1] - 1;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+host_addr(uip_ipaddr_t *addr, int i)
+{
+  uip_ip6addr(addr, 0xfd00, 0, 0, 0, 0, 0, 0, i);
+}
+/*---------------------------------------------------------------------------*/
+/* Sends a small UDP packet to addr and returns the index of the
+   neighbor it went to, -1 for none. */
+static int
+send_to(const uip_ipaddr_t *addr)
+{
+  memset(UIP_IP_BUF, 0, UIP_IPUDPH_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->proto = UIP_PROTO_UDP;
+  UIP_IP_BUF->ttl = 64;
+  UIP_IP_BUF->len[1] = UIP_UDPH_LEN;
+  uip_ipaddr_copy(&UIP_IP_BUF->srcipaddr, &uip_ds6_get_link_local(-1)->ipaddr);
+  uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, addr);
+  uip_len = UIP_IPUDPH_LEN;
+
+  sent = 0;
+  tcpip_ipv6_output();
+  return sent == 0 ? -1 : sent_to;
+}
+/*---------------------------------------------------------------------------*/
+static void
+report(const char *what, int count, clock_time_t start)
+{
+  clock_time_t elapsed = clock_time() - start;
+
+  printf("%-8s %6d packets in %5lu ms", what, count,
+         (unsigned long)(elapsed * 1000 / CLOCK_SECOND));
+  if(elapsed > 0) {
+    printf(" (%lu packets/s)", (unsigned long)(count * CLOCK_SECOND / elapsed));
+  }
+  printf("\n");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(dest_cache_bench_process, ev, data)
+{
+  static uip_ipaddr_t addr;
+  uip_lladdr_t lladdr;
+  clock_time_t start;
+  int i, k, errors;
+
+  PROCESS_BEGIN();
+
+  printf("%d routes over %d neighbors, destination cache size %d\n",
+         NUM_ROUTES, NUM_NBRS, TCPIP_DEST_CACHE_SIZE);
+
+  tcpip_set_outputfunc(output);
+
+  for(i = 0; i < NUM_NBRS; i++) {
+    uip_ip6addr(&nbr_addrs[i], 0xfe80, 0, 0, 0, 0, 0, 0, i + 1);
+    memset(&lladdr, 0, sizeof(lladdr));
+    lladdr.addr[sizeof(lladdr.addr) - 1] = i + 1;
+    uip_ds6_nbr_add(&nbr_addrs[i], &lladdr, 1, NBR_REACHABLE,
+                    NBR_TABLE_REASON_UNDEFINED, NULL);
+  }
+  for(i = 0; i < NUM_ROUTES; i++) {
+    host_addr(&addr, i);
+    uip_ds6_route_add(&addr, 128, &nbr_addrs[i % NUM_NBRS]);
+  }
+
+  /* Forward to the last installed routes, which are furthest down the
+     route list, and to a few on-link neighbors. */
+  errors = 0;
+  start = clock_time();
+  for(i = 0; i < NUM_PACKETS; i++) {
+    if(i % 8 == 0) {
+      k = NUM_NBRS - 1 - (i / 8) % NUM_ONLINK;
+      if(send_to(&nbr_addrs[k]) != k) {
+        errors++;
+      }
+    } else {
+      k = NUM_ROUTES - 1 - i % NUM_HOT;
+      host_addr(&addr, k);
+      if(send_to(&addr) != k % NUM_NBRS) {
+        errors++;
+      }
+    }
+  }
+  report("forward", NUM_PACKETS, start);
+
+  /* A destination found in the cache moves its route to the front of
+     the route list, as a route lookup does. */
+  for(i = 0; i < 2; i++) {
+    k = NUM_ROUTES - 1 - i;
+    host_addr(&addr, k);
+    if(send_to(&addr) != k % NUM_NBRS ||
+       !uip_ipaddr_cmp(&uip_ds6_route_head()->ipaddr, &addr)) {
+      errors++;
+    }
+  }
+
+  /* A route that moves to another next hop is followed. */
+  k = NUM_ROUTES - 1;
+  host_addr(&addr, k);
+  uip_ds6_route_rm(uip_ds6_route_lookup(&addr));
+  uip_ds6_route_add(&addr, 128, &nbr_addrs[0]);
+  if(send_to(&addr) != 0) {
+    errors++;
+  }
+
+  /* A removed route without a default router leaves the destination
+     unreachable. */
+  uip_ds6_route_rm(uip_ds6_route_lookup(&addr));
+  if(send_to(&addr) != -1) {
+    errors++;
+  }
+
+  /* A removed neighbor is no longer used as next hop, and takes its
+     routes with it. */
+  k = NUM_ROUTES - 2;
+  host_addr(&addr, k);
+  if(send_to(&addr) != k % NUM_NBRS) {
+    errors++;
+  }
+  uip_ds6_nbr_rm(uip_ds6_nbr_lookup(&nbr_addrs[k % NUM_NBRS]));
+  if(send_to(&addr) != -1) {
+    errors++;
+  }
+
+#if TCPIP_DEST_CACHE_SIZE
+  printf("%lu hits, %lu misses, %lu flushes\n",
+         (unsigned long)tcpip_dest_cache_stats.hits,
+         (unsigned long)tcpip_dest_cache_stats.misses,
+         (unsigned long)tcpip_dest_cache_stats.flushes);
+#endif /* TCPIP_DEST_CACHE_SIZE */
+
+  printf("%d errors\n", errors);
+  exit(errors != 0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
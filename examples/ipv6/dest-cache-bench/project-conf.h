@@ -0,0 +1,13 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+#undef UIP_CONF_MAX_ROUTES
+#define UIP_CONF_MAX_ROUTES 1000
+
+/* Build with DEFINES=TCPIP_CONF_DEST_CACHE_SIZE=0 to measure the
+   uncached next-hop determination. */
+#ifndef TCPIP_CONF_DEST_CACHE_SIZE
+#define TCPIP_CONF_DEST_CACHE_SIZE 16
+#endif
+
+#endif /* PROJECT_CONF_H_ */
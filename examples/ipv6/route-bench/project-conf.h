@@ -0,0 +1,16 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+#undef UIP_CONF_MAX_ROUTES
+#define UIP_CONF_MAX_ROUTES 10000
+
+/* Evict the least recently used route when the table is full. */
+#define UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED 1
+
+/* Build with DEFINES=UIP_DS6_ROUTE_CONF_HASH=0 to measure the linear
+   route list. */
+#ifndef UIP_DS6_ROUTE_CONF_HASH
+#define UIP_DS6_ROUTE_CONF_HASH 1
+#endif
+
+#endif /* PROJECT_CONF_H_ */
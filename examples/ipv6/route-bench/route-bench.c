@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for the IPv6 route table
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_NEXTHOPS  4
+#define NUM_HOSTS     (UIP_DS6_ROUTE_NB - NUM_PREFIXES)
+#define NUM_PREFIXES  16
+#define NUM_LOOKUPS   100000
+
+static uip_ipaddr_t nexthops[NUM_NEXTHOPS];
+
+PROCESS(route_bench_process, "Route benchmark");
+AUTOSTART_PROCESSES(&route_bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+host_addr(uip_ipaddr_t *addr, int i)
+{
+  uip_ip6addr(addr, 0xfd00, 0, 0, 0, 0, 0, i >> 16, i & 0xffff);
+}
+/*---------------------------------------------------------------------------*/
+static void
+prefix_addr(uip_ipaddr_t *addr, int i, int host)
+{
+  uip_ip6addr(addr, 0xfd01, i, 0, 0, 0, 0, 0, host);
+}
+/*---------------------------------------------------------------------------*/
+static void
+report(const char *what, int count, clock_time_t start)
+{
+  clock_time_t elapsed = clock_time() - start;
+
+  printf("%-8s %6d ops in %5lu ms", what, count,
+         (unsigned long)(elapsed * 1000 / CLOCK_SECOND));
+  if(elapsed > 0) {
+    printf(" (%lu ops/s)", (unsigned long)(count * CLOCK_SECOND / elapsed));
+  }
+  printf("\n");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(route_bench_process, ev, data)
+{
+  static uip_ipaddr_t addr;
+  uip_lladdr_t lladdr;
+  uip_ds6_route_t *r;
+  clock_time_t start;
+  int i, k, errors;
+
+  PROCESS_BEGIN();
+
+  printf("Route table size %d, hashed index %s\n", UIP_DS6_ROUTE_NB,
+         UIP_DS6_ROUTE_HASH ? "on" : "off");
+
+  for(i = 0; i < NUM_NEXTHOPS; i++) {
+    uip_ip6addr(&nexthops[i], 0xfe80, 0, 0, 0, 0, 0, 0, i + 1);
+    memset(&lladdr, 0, sizeof(lladdr));
+    lladdr.addr[sizeof(lladdr.addr) - 1] = i + 1;
+    uip_ds6_nbr_add(&nexthops[i], &lladdr, 1, NBR_REACHABLE,
+                    NBR_TABLE_REASON_UNDEFINED, NULL);
+  }
+
+  start = clock_time();
+  for(i = 0; i < NUM_HOSTS; i++) {
+    host_addr(&addr, i);
+    uip_ds6_route_add(&addr, 128, &nexthops[i % NUM_NEXTHOPS]);
+  }
+  for(i = 0; i < NUM_PREFIXES; i++) {
+    prefix_addr(&addr, i, 0);
+    uip_ds6_route_add(&addr, 32, &nexthops[i % NUM_NEXTHOPS]);
+  }
+  report("add", NUM_HOSTS + NUM_PREFIXES, start);
+  printf("%d routes installed\n", uip_ds6_route_num_routes());
+
+  /* Look up a mix of host routes, addresses covered by a shorter
+     prefix, and addresses without a route. */
+  errors = 0;
+  srand(1);
+  start = clock_time();
+  for(i = 0; i < NUM_LOOKUPS; i++) {
+    k = rand();
+    switch(i % 4) {
+    case 0:
+    case 1:
+      host_addr(&addr, k % NUM_HOSTS);
+      r = uip_ds6_route_lookup(&addr);
+      if(r == NULL || r->length != 128 || !uip_ipaddr_cmp(&r->ipaddr, &addr)) {
+        errors++;
+      }
+      break;
+    case 2:
+      prefix_addr(&addr, k % NUM_PREFIXES, k);
+      r = uip_ds6_route_lookup(&addr);
+      if(r == NULL || r->length != 32) {
+        errors++;
+      }
+      break;
+    default:
+      uip_ip6addr(&addr, 0xfd02, 0, 0, 0, 0, 0, 0, k);
+      if(uip_ds6_route_lookup(&addr) != NULL) {
+        errors++;
+      }
+      break;
+    }
+  }
+  report("lookup", NUM_LOOKUPS, start);
+
+#if UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED
+  /* Use host 1 first and then every other route, so that host 1 is
+     the least recently used route and is evicted when a route is
+     added to the full table. */
+  host_addr(&addr, 1);
+  uip_ds6_route_lookup(&addr);
+  for(i = 0; i < NUM_PREFIXES; i++) {
+    prefix_addr(&addr, i, 0);
+    uip_ds6_route_lookup(&addr);
+  }
+  for(i = 0; i < NUM_HOSTS; i++) {
+    if(i != 1) {
+      host_addr(&addr, i);
+      uip_ds6_route_lookup(&addr);
+    }
+  }
+  uip_ip6addr(&addr, 0xfd03, 0, 0, 0, 0, 0, 0, 1);
+  if(uip_ds6_route_add(&addr, 128, &nexthops[0]) == NULL) {
+    errors++;
+  }
+  host_addr(&addr, 1);
+  if(uip_ds6_route_lookup(&addr) != NULL) {
+    printf("least recently used route not evicted\n");
+    errors++;
+  }
+  host_addr(&addr, 0);
+  if(uip_ds6_route_lookup(&addr) == NULL) {
+    errors++;
+  }
+  host_addr(&addr, 1);
+  uip_ds6_route_add(&addr, 128, &nexthops[1]);
+#endif /* UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED */
+
+  start = clock_time();
+  for(i = 0; i < NUM_NEXTHOPS; i++) {
+    uip_ds6_route_rm_by_nexthop(&nexthops[i]);
+  }
+  report("remove", NUM_HOSTS + NUM_PREFIXES, start);
+  if(uip_ds6_route_num_routes() != 0) {
+    errors++;
+  }
+
+  printf("%d errors\n", errors);
+  exit(errors != 0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
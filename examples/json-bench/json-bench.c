@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for the JSON parser
+ */
+
+#include "contiki.h"
+#include "jsonparse.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NUM_PARSES    10000
+#define NUM_ROUNDS    50
+#define TAPE_SIZE     512
+
+/* An LWM2M JSON (SenML) read response */
+static const char lwm2m[] =
+  "{\"bn\":\"/3303/0/\",\"e\":["
+  "{\"n\":\"5700\",\"v\":24.5},{\"n\":\"5601\",\"v\":18.25},"
+  "{\"n\":\"5602\",\"v\":31.0},{\"n\":\"5701\",\"sv\":\"Cel\"},"
+  "{\"n\":\"5750\",\"sv\":\"Temperature sensor in the north wing\"},"
+  "{\"n\":\"5603\",\"v\":-40},{\"n\":\"5604\",\"v\":125},"
+  "{\"n\":\"5605\",\"bv\":false},{\"n\":\"5606\",\"bv\":true}]}";
+
+/* A Ubidots style request with long variable labels and context */
+static const char ubidots[] =
+  "{\"temperature\":{\"value\":24.5,\"timestamp\":1476892800000,"
+  "\"context\":{\"location\":\"building 7, second floor, room 2.14\","
+  "\"firmware\":\"contiki-3.x-gateway-build-20161019\"}},"
+  "\"humidity\":{\"value\":41.25,\"timestamp\":1476892800000,"
+  "\"context\":{\"location\":\"building 7, second floor, room 2.14\","
+  "\"firmware\":\"contiki-3.x-gateway-build-20161019\"}},"
+  "\"status\":{\"value\":1,\"context\":{\"message\":"
+  "\"all sensors reporting, battery at 87 percent, next calibration "
+  "scheduled for the first week of november\"}}}";
+
+/* An indented configuration document */
+static const char config[] =
+  "{\n"
+  "    \"name\": \"gateway\",\n"
+  "    \"interfaces\": [\n"
+  "        {\n"
+  "            \"name\": \"eth0\",\n"
+  "            \"mtu\": 1500,\n"
+  "            \"addresses\": [\"fd00::1\", \"fd00::2\"]\n"
+  "        },\n"
+  "        {\n"
+  "            \"name\": \"tun0\",\n"
+  "            \"mtu\": 1280,\n"
+  "            \"addresses\": [\"fd01::1\"]\n"
+  "        }\n"
+  "    ],\n"
+  "    \"log\": {\n"
+  "        \"level\": 3,\n"
+  "        \"file\": \"/var/log/contiki-gateway.log\"\n"
+  "    }\n"
+  "}\n";
+
+static const struct {
+  const char *name;
+  const char *json;
+} inputs[] = {
+  { "lwm2m", lwm2m },
+  { "ubidots", ubidots },
+  { "config", config },
+};
+
+static struct jsonparse_token tape[TAPE_SIZE];
+
+PROCESS(json_bench_process, "JSON benchmark");
+AUTOSTART_PROCESSES(&json_bench_process);
+/*---------------------------------------------------------------------------*/
+/* Walks all tokens and copies out every value, like a typical handler */
+static int
+walk(struct jsonparse_state *state)
+{
+  char buf[64];
+  int type, n;
+
+  n = 0;
+  while((type = jsonparse_next(state)) != 0) {
+    if(type == JSON_TYPE_PAIR_NAME || type == JSON_TYPE_STRING ||
+       type == JSON_TYPE_NUMBER) {
+      jsonparse_copy_value(state, buf, sizeof(buf));
+    }
+    n++;
+  }
+  return state->error == JSON_ERROR_OK ? n : -1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+report(const char *what, int len, clock_t elapsed)
+{
+  printf("  %-6s %6lu ns per parse", what,
+         (unsigned long)((unsigned long long)elapsed * 1000000000 /
+                         CLOCKS_PER_SEC / NUM_PARSES));
+  if(elapsed > 0) {
+    printf(" (%lu parses/s, %lu kB/s)",
+           (unsigned long)((unsigned long long)NUM_PARSES *
+                           CLOCKS_PER_SEC / elapsed),
+           (unsigned long)((unsigned long long)NUM_PARSES * len *
+                           CLOCKS_PER_SEC / elapsed / 1000));
+  }
+  printf("\n");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(json_bench_process, ev, data)
+{
+  struct jsonparse_state state;
+  static const char *const modes[] = { "setup", "tape", "rewalk" };
+  clock_t start, elapsed, best[3];
+  int i, k, m, r, len, tokens, errors;
+
+  PROCESS_BEGIN();
+
+#if defined(__AVX2__)
+  printf("Block scan: AVX2\n");
+#elif defined(__SSE2__)
+  printf("Block scan: SSE2\n");
+#else
+  printf("Block scan: scalar\n");
+#endif
+
+  errors = 0;
+  for(i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+    len = strlen(inputs[i].json);
+    jsonparse_setup(&state, inputs[i].json, len);
+    tokens = walk(&state);
+    printf("%s: %d bytes, %d tokens\n", inputs[i].name, len, tokens);
+
+    /* Processor time rather than clock_time(), so that time the host
+       gives to others is not counted. The modes take turns, and the
+       fastest round of each is reported. */
+    for(r = 0; r < NUM_ROUNDS; r++) {
+      for(m = 0; m < 3; m++) {
+        start = clock();
+        for(k = 0; k < NUM_PARSES; k++) {
+          if(m == 0) {
+            jsonparse_setup(&state, inputs[i].json, len);
+          } else if(m == 1) {
+            if(!jsonparse_setup_tape(&state, inputs[i].json, len,
+                                     tape, TAPE_SIZE)) {
+              errors++;
+            }
+          } else {
+            /* A tape can be walked again without parsing */
+            state.tape_pos = -1;
+          }
+          if(walk(&state) != tokens) {
+            errors++;
+          }
+        }
+        elapsed = clock() - start;
+        if(r == 0 || elapsed < best[m]) {
+          best[m] = elapsed;
+        }
+      }
+    }
+    for(m = 0; m < 3; m++) {
+      report(modes[m], len, best[m]);
+    }
+  }
+
+  printf("%d errors\n", errors);
+  exit(errors != 0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
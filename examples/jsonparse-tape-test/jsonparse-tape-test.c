@@ -0,0 +1,291 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Differential test of the jsonparse token tape. Random documents,
+ *         and truncated and corrupted copies of them, are walked with
+ *         jsonparse_setup() and with jsonparse_setup_tape(), and every
+ *         result and the parser state after it must be the same.
+ */
+
+#include "contiki.h"
+#include "jsonparse.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_DOCUMENTS   20000
+#define NUM_VARIANTS    4
+#define MAX_DOC_SIZE    2048
+#define MAX_TOKENS      1024
+#define MAX_NESTING     5
+
+PROCESS(jsonparse_tape_test_process, "jsonparse tape test");
+AUTOSTART_PROCESSES(&jsonparse_tape_test_process);
+
+static int errors;
+
+#define CHECK(cond) do {                                         \
+    if(!(cond)) {                                                \
+      if(errors++ < 10) {                                        \
+        printf("FAIL line %d: %s\n", __LINE__, #cond);           \
+      }                                                          \
+    }                                                            \
+  } while(0)
+
+/* The parser reads the NUL after the input, and one more byte after a
+   trailing backslash */
+static char doc[MAX_DOC_SIZE + 2];
+static int doc_len;
+static struct jsonparse_token tape[MAX_TOKENS];
+/*---------------------------------------------------------------------------*/
+static void
+put(const char *s)
+{
+  while(*s != 0 && doc_len < MAX_DOC_SIZE) {
+    doc[doc_len++] = *s++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Mostly nothing, sometimes a run long enough to cross a scan block */
+static void
+put_spaces(void)
+{
+  int n;
+
+  switch(random_rand() % 8) {
+  case 0:
+    put(" ");
+    break;
+  case 1:
+    put("\n    ");
+    break;
+  case 2:
+    for(n = random_rand() % 80; n > 0; n--) {
+      put(random_rand() % 4 ? " " : "\n");
+    }
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+put_string(void)
+{
+  static const char *const escapes[] = {
+    "\\\"", "\\\\", "\\/", "\\n", "\\t", "\\u00e9"
+  };
+  char c[2];
+  int n;
+
+  put("\"");
+  n = random_rand() % 4 ? random_rand() % 8 : random_rand() % 150;
+  for(; n > 0; n--) {
+    if(random_rand() % 16 == 0) {
+      put(escapes[random_rand() % (sizeof(escapes) / sizeof(escapes[0]))]);
+    } else {
+      c[0] = ' ' + random_rand() % ('~' - ' ');
+      c[1] = 0;
+      put(c[0] == '"' || c[0] == '\\' ? "x" : c);
+    }
+  }
+  put("\"");
+}
+/*---------------------------------------------------------------------------*/
+static void
+put_value(int depth)
+{
+  static const char *const atoms[] = {
+    "0", "-40", "24.5", "1476892800000", "true", "false", "null"
+  };
+  int n;
+
+  switch(depth < MAX_NESTING ? random_rand() % 6 : 2 + random_rand() % 4) {
+  case 0:
+    put("{");
+    for(n = random_rand() % 6; n > 0; n--) {
+      put_spaces();
+      put_string();
+      put_spaces();
+      put(":");
+      put_spaces();
+      put_value(depth + 1);
+      put_spaces();
+      if(n > 1) {
+        put(",");
+      }
+    }
+    put("}");
+    break;
+  case 1:
+    put("[");
+    for(n = random_rand() % 6; n > 0; n--) {
+      put_spaces();
+      put_value(depth + 1);
+      put_spaces();
+      if(n > 1) {
+        put(",");
+      }
+    }
+    put("]");
+    break;
+  case 2:
+  case 3:
+    put_string();
+    break;
+  default:
+    put(atoms[random_rand() % (sizeof(atoms) / sizeof(atoms[0]))]);
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Truncates the document or replaces some of its bytes */
+static void
+corrupt(void)
+{
+  static const char bytes[] = "{}[]:,\"\\ \n0-.ntfx";
+  int n;
+
+  if(doc_len == 0) {
+    return;
+  }
+  if(random_rand() % 2) {
+    doc_len = random_rand() % doc_len;
+  } else {
+    for(n = 1 + random_rand() % 3; n > 0; n--) {
+      /* sizeof(bytes) includes the NUL */
+      doc[random_rand() % doc_len] = bytes[random_rand() % sizeof(bytes)];
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Walks the document with both parsers and compares every step */
+static void
+compare(void)
+{
+  struct jsonparse_state plain, taped;
+  char plain_value[MAX_DOC_SIZE + 1], taped_value[MAX_DOC_SIZE + 1];
+  int type;
+
+  memset(&doc[doc_len], 0, sizeof(doc) - doc_len);
+  memset(&plain, 0, sizeof(plain));
+  memset(&taped, 0, sizeof(taped));
+  jsonparse_setup(&plain, doc, doc_len);
+  if(!jsonparse_setup_tape(&taped, doc, doc_len, tape, MAX_TOKENS)) {
+    /* Does not happen with MAX_DOC_SIZE */
+    CHECK(0);
+    return;
+  }
+
+  do {
+    type = jsonparse_next(&plain);
+    CHECK(jsonparse_next(&taped) == type);
+    CHECK(taped.pos == plain.pos);
+    CHECK(taped.depth == plain.depth);
+    CHECK(taped.vtype == plain.vtype);
+    CHECK(taped.vstart == plain.vstart);
+    CHECK(taped.vlen == plain.vlen);
+    CHECK(taped.error == plain.error);
+    CHECK(jsonparse_get_type(&taped) == jsonparse_get_type(&plain));
+    CHECK(jsonparse_copy_value(&taped, taped_value, sizeof(taped_value)) ==
+          jsonparse_copy_value(&plain, plain_value, sizeof(plain_value)));
+    CHECK(strcmp(taped_value, plain_value) == 0);
+  } while(type != JSON_TYPE_ERROR && errors == 0);
+
+  /* The tape stays at the end, where the plain parser would go on */
+  CHECK(jsonparse_next(&taped) == JSON_TYPE_ERROR);
+  CHECK(taped.pos == plain.pos);
+  CHECK(taped.error == plain.error);
+}
+/*---------------------------------------------------------------------------*/
+/* A tape one token too small must fall back to jsonparse_setup() */
+static void
+check_small_tape(void)
+{
+  struct jsonparse_state state;
+  int n;
+
+  for(n = 0; n < MAX_TOKENS - 1; n++) {
+    if(jsonparse_setup_tape(&state, doc, doc_len, tape, n)) {
+      break;
+    }
+  }
+  CHECK(n > 0);
+  CHECK(tape[n - 1].type == JSON_TYPE_ERROR);
+  CHECK(state.tape != NULL);
+
+  jsonparse_setup_tape(&state, doc, doc_len, tape, n - 1);
+  CHECK(state.tape == NULL);
+  while(jsonparse_next(&state) != JSON_TYPE_ERROR);
+  CHECK(state.error == tape[n - 1].error);
+  CHECK(state.pos == tape[n - 1].pos);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(jsonparse_tape_test_process, ev, data)
+{
+  static int i, k;
+
+  PROCESS_BEGIN();
+
+#if defined(__AVX2__)
+  printf("Block scan: AVX2\n");
+#elif defined(__SSE2__)
+  printf("Block scan: SSE2\n");
+#else
+  printf("Block scan: scalar\n");
+#endif
+
+  for(i = 0; i < NUM_DOCUMENTS; i++) {
+    doc_len = 0;
+    put_spaces();
+    put_value(0);
+    put_spaces();
+    compare();
+    if(i % 100 == 0) {
+      check_small_tape();
+    }
+    for(k = 0; k < NUM_VARIANTS; k++) {
+      corrupt();
+      compare();
+    }
+  }
+
+  printf("%d documents, %d errors\n", NUM_DOCUMENTS * (1 + NUM_VARIANTS),
+         errors);
+  exit(errors != 0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
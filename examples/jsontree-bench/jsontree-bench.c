@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark for the JSON output generator
+ */
+
+#include "contiki.h"
+#include "jsontree.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define NUM_OUTPUTS   2000
+#define NUM_ROUNDS    20
+#define NUM_SENSORS   16
+#define BLOCK_SIZE    64
+
+static char out[2048];
+static int out_len;
+
+static struct jsontree_string node = JSONTREE_STRING("gateway-7");
+static struct jsontree_string unit = JSONTREE_STRING("Cel");
+static struct jsontree_int temperature = { JSON_TYPE_INT, -2150 };
+static struct jsontree_uint timestamp = { JSON_TYPE_UINT, 1476892800 };
+static uint16_t humidity = 4125;
+static struct jsontree_ptr humidity_ptr = { JSON_TYPE_U16PTR, &humidity };
+
+JSONTREE_OBJECT(sensor,
+                JSONTREE_PAIR("temperature", &temperature),
+                JSONTREE_PAIR("timestamp", &timestamp),
+                JSONTREE_PAIR("unit", &unit),
+                JSONTREE_PAIR("humidity", &humidity_ptr));
+JSONTREE_ARRAY(sensors, NUM_SENSORS);
+JSONTREE_OBJECT(root,
+                JSONTREE_PAIR("node", &node),
+                JSONTREE_PAIR("sensors", &sensors));
+
+PROCESS(jsontree_bench_process, "jsontree benchmark");
+AUTOSTART_PROCESSES(&jsontree_bench_process);
+/*---------------------------------------------------------------------------*/
+static int
+out_putchar(int c)
+{
+  if(out_len < sizeof(out)) {
+    out[out_len++] = c;
+  }
+  return c;
+}
+/*---------------------------------------------------------------------------*/
+/* Outputs the tree once and returns its length */
+static int
+output(int mode)
+{
+  struct jsontree_context js_ctx;
+  struct jsontree_buffer buffer;
+  int n, pos;
+
+  if(mode == 0) {
+    out_len = 0;
+    jsontree_setup(&js_ctx, (struct jsontree_value *)&root, out_putchar);
+    while(jsontree_print_next(&js_ctx));
+    return out_len;
+  }
+  jsontree_setup_buffer(&js_ctx, (struct jsontree_value *)&root, &buffer);
+  if(mode == 1) {
+    return jsontree_print_block(&js_ctx, 0, out, sizeof(out));
+  }
+  /* As for a CoAP Block2 response, into the same packet buffer */
+  pos = 0;
+  while((n = jsontree_print_block(&js_ctx, pos, out, BLOCK_SIZE)) ==
+        BLOCK_SIZE) {
+    pos += n;
+  }
+  return pos + n;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(jsontree_bench_process, ev, data)
+{
+  static const char *const modes[] = { "putchar", "buffer", "blocks" };
+  clock_t start, elapsed, best[3];
+  int i, k, m, r, len, errors;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < NUM_SENSORS; i++) {
+    sensors.values[i] = (struct jsontree_value *)&sensor;
+  }
+
+  errors = 0;
+  len = output(0);
+  printf("%d sensors: %d bytes\n", NUM_SENSORS, len);
+
+  /* Processor time, with the modes taking turns and the fastest round
+     of each reported */
+  for(r = 0; r < NUM_ROUNDS; r++) {
+    for(m = 0; m < 3; m++) {
+      start = clock();
+      for(k = 0; k < NUM_OUTPUTS; k++) {
+        if(output(m) != len) {
+          errors++;
+        }
+      }
+      elapsed = clock() - start;
+      if(r == 0 || elapsed < best[m]) {
+        best[m] = elapsed;
+      }
+    }
+  }
+  for(m = 0; m < 3; m++) {
+    printf("  %-8s %6lu ns per output\n", modes[m],
+           (unsigned long)((unsigned long long)best[m] * 1000000000 /
+                           CLOCKS_PER_SEC / NUM_OUTPUTS));
+  }
+
+  printf("%d errors\n", errors);
+  exit(errors != 0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Test of jsontree_print_block(). The output of every block size,
+ *         and of blocks at random offsets, must be the same as the output
+ *         of jsontree_print_next() with a putchar function.
+ */
+
+#include "contiki.h"
+#include "jsontree.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_OUTPUT      1024
+#define NUM_RANDOM      20000
+#define MAX_RANDOM_SIZE 40
+
+PROCESS(jsontree_block_test_process, "jsontree block test");
+AUTOSTART_PROCESSES(&jsontree_block_test_process);
+
+static int errors;
+
+#define CHECK(cond) do {                                         \
+    if(!(cond)) {                                                \
+      if(errors++ < 10) {                                        \
+        printf("FAIL line %d: %s\n", __LINE__, #cond);           \
+      }                                                          \
+    }                                                            \
+  } while(0)
+
+static char ref[MAX_OUTPUT];
+static int ref_len;
+static char out[MAX_OUTPUT];
+
+/* Each call of the callback writes the next number, so a callback that
+   is run again for the same output shows up as a wrong number */
+static int counting;
+static int count;
+
+/* Changed between blocks to a value of the same length */
+static int16_t sensor = 1111;
+/*---------------------------------------------------------------------------*/
+static int
+ref_putchar(int c)
+{
+  if(ref_len < MAX_OUTPUT) {
+    ref[ref_len++] = c;
+  }
+  return c;
+}
+/*---------------------------------------------------------------------------*/
+static int
+output_counter(struct jsontree_context *js_ctx)
+{
+  char buf[16];
+
+  snprintf(buf, sizeof(buf), "%d", counting ? count++ : 7);
+  jsontree_write_atom(js_ctx, buf);
+  if(js_ctx->callback_state++ < 3) {
+    jsontree_write_atom(js_ctx, ",");
+    return 1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static struct jsontree_callback counter_callback =
+  JSONTREE_CALLBACK(output_counter, NULL);
+static struct jsontree_string quoted = JSONTREE_STRING("he said \"hi\" \"");
+/* Longer than the carry, so it is generated again in the next block */
+static struct jsontree_string long_text = JSONTREE_STRING(
+  "a string that is too long to fit in the carry of a block, and is "
+  "therefore written again from the start in the next block");
+static struct jsontree_int min_int = { JSON_TYPE_INT, -2147483647 - 1 };
+static struct jsontree_uint max_uint = { JSON_TYPE_UINT, 4294967295u };
+static struct jsontree_ptr sensor_ptr = { JSON_TYPE_S16PTR, &sensor };
+
+JSONTREE_OBJECT(inner,
+                JSONTREE_PAIR("a", &min_int),
+                JSONTREE_PAIR("b\"q", &max_uint),
+                JSONTREE_PAIR("cb", &counter_callback));
+JSONTREE_OBJECT(empty);
+JSONTREE_OBJECT(root,
+                JSONTREE_PAIR("s", &quoted),
+                JSONTREE_PAIR("inner", &inner),
+                JSONTREE_PAIR("sensor", &sensor_ptr),
+                JSONTREE_PAIR("long", &long_text),
+                JSONTREE_PAIR("e", &empty),
+                JSONTREE_PAIR("inner2", &inner));
+/*---------------------------------------------------------------------------*/
+/* Outputs the tree in blocks of one size and compares with ref */
+static void
+check_size(int size)
+{
+  struct jsontree_context js_ctx;
+  struct jsontree_buffer buffer;
+  char *p;
+  int n, pos, sensor_pos;
+
+  count = 0;
+  sensor = 1111;
+  jsontree_setup_buffer(&js_ctx, (struct jsontree_value *)&root, &buffer);
+  pos = 0;
+  do {
+    n = jsontree_print_block(&js_ctx, pos, out + pos, size);
+    pos += n;
+    /* The value must be read once, not once for each block */
+    sensor = sensor == 1111 ? 2222 : 1111;
+  } while(n == size && pos + size <= MAX_OUTPUT);
+
+  CHECK(pos == ref_len);
+  if(pos != ref_len) {
+    return;
+  }
+  p = strstr(ref, "1111");
+  sensor_pos = p - ref;
+  CHECK(memcmp(out, ref, sensor_pos) == 0);
+  CHECK(memcmp(&out[sensor_pos], "1111", 4) == 0 ||
+        memcmp(&out[sensor_pos], "2222", 4) == 0);
+  CHECK(memcmp(&out[sensor_pos + 4], &ref[sensor_pos + 4],
+               ref_len - sensor_pos - 4) == 0);
+}
+/*---------------------------------------------------------------------------*/
+/* Requests blocks at random offsets, in and out of order */
+static void
+check_random(void)
+{
+  struct jsontree_context js_ctx;
+  struct jsontree_buffer buffer;
+  int i, n, size, offset, expect;
+
+  jsontree_setup_buffer(&js_ctx, (struct jsontree_value *)&root, &buffer);
+  for(i = 0; i < NUM_RANDOM; i++) {
+    size = 1 + random_rand() % MAX_RANDOM_SIZE;
+    offset = size * (random_rand() % (ref_len / size + 2));
+    n = jsontree_print_block(&js_ctx, offset, out, size);
+    expect = offset >= ref_len ? 0 :
+      (ref_len - offset < size ? ref_len - offset : size);
+    CHECK(n == expect);
+    CHECK(memcmp(out, &ref[offset], n) == 0);
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(jsontree_block_test_process, ev, data)
+{
+  struct jsontree_context js_ctx;
+  static int size;
+
+  PROCESS_BEGIN();
+
+  counting = 1;
+  count = 0;
+  jsontree_setup(&js_ctx, (struct jsontree_value *)&root, ref_putchar);
+  while(jsontree_print_next(&js_ctx));
+  printf("%d bytes: %.*s\n", ref_len, ref_len, ref);
+
+  for(size = 1; size <= ref_len + 1; size++) {
+    check_size(size);
+  }
+
+  /* Earlier blocks are generated again, so the output must not change */
+  counting = 0;
+  sensor = 1111;
+  ref_len = 0;
+  jsontree_setup(&js_ctx, (struct jsontree_value *)&root, ref_putchar);
+  while(jsontree_print_next(&js_ctx));
+  check_random();
+
+  printf("%d errors\n", errors);
+  exit(errors != 0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Test of the LWM2M engine instance lookup. Instances are created
+ *         with POST requests and created, deleted and renumbered by the
+ *         application, and every GET must find the same instance as a
+ *         linear search.
+ */
+
+#include "contiki.h"
+#include "lwm2m-engine.h"
+#include "lwm2m-object.h"
+#include "er-coap.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_SLOTS       16
+#define NUM_IDS         24
+#define NUM_OPERATIONS  20000
+
+PROCESS(lwm2m_index_test_process, "LWM2M index test");
+AUTOSTART_PROCESSES(&lwm2m_index_test_process);
+
+static int errors;
+
+#define CHECK(cond) do {                                         \
+    if(!(cond)) {                                                \
+      if(errors++ < 10) {                                        \
+        printf("FAIL line %d: %s\n", __LINE__, #cond);           \
+      }                                                          \
+    }                                                            \
+  } while(0)
+
+/* Each slot has a resource with the number of the slot, so that a read
+   tells which slot was found */
+#define SLOT_RESOURCES(n)                                       \
+  LWM2M_RESOURCES(slot_resources_##n,                           \
+                  LWM2M_RESOURCE_INTEGER(5700, n),              \
+                  LWM2M_RESOURCE_STRING(5701, "Cel"))
+SLOT_RESOURCES(0); SLOT_RESOURCES(1); SLOT_RESOURCES(2); SLOT_RESOURCES(3);
+SLOT_RESOURCES(4); SLOT_RESOURCES(5); SLOT_RESOURCES(6); SLOT_RESOURCES(7);
+SLOT_RESOURCES(8); SLOT_RESOURCES(9); SLOT_RESOURCES(10); SLOT_RESOURCES(11);
+SLOT_RESOURCES(12); SLOT_RESOURCES(13); SLOT_RESOURCES(14); SLOT_RESOURCES(15);
+
+LWM2M_INSTANCES(sensor_instances,
+                LWM2M_INSTANCE(30, slot_resources_0),
+                LWM2M_INSTANCE(10, slot_resources_1),
+                LWM2M_INSTANCE(20, slot_resources_2),
+                LWM2M_INSTANCE_UNUSED(0, slot_resources_3),
+                LWM2M_INSTANCE(5, slot_resources_4),
+                LWM2M_INSTANCE_UNUSED(0, slot_resources_5),
+                LWM2M_INSTANCE_UNUSED(0, slot_resources_6),
+                LWM2M_INSTANCE_UNUSED(0, slot_resources_7),
+                LWM2M_INSTANCE_UNUSED(0, slot_resources_8),
+                LWM2M_INSTANCE_UNUSED(0, slot_resources_9),
+                LWM2M_INSTANCE_UNUSED(0, slot_resources_10),
+                LWM2M_INSTANCE_UNUSED(0, slot_resources_11),
+                LWM2M_INSTANCE_UNUSED(0, slot_resources_12),
+                LWM2M_INSTANCE_UNUSED(0, slot_resources_13),
+                LWM2M_INSTANCE_UNUSED(0, slot_resources_14),
+                LWM2M_INSTANCE_UNUSED(0, slot_resources_15));
+LWM2M_OBJECT(sensor, 3303, sensor_instances);
+/*---------------------------------------------------------------------------*/
+/* Sends a request for /3303/id/5700 and returns the response code. The
+   slot that was read is returned in slot. */
+static int
+request(coap_method_t method, int id, int *slot)
+{
+  static coap_packet_t req[1], resp[1];
+  uint8_t buffer[64];
+  char path[32];
+  const uint8_t *payload;
+  int32_t offset;
+  int len;
+
+  if(method == COAP_POST) {
+    snprintf(path, sizeof(path), "3303/%d", id);
+  } else {
+    snprintf(path, sizeof(path), "3303/%d/5700", id);
+  }
+  coap_init_message(req, COAP_TYPE_CON, method, 0x1234);
+  coap_set_header_uri_path(req, path);
+  coap_init_message(resp, COAP_TYPE_ACK, CONTENT_2_05, 0x1234);
+  offset = 0;
+  lwm2m_engine_handler(&sensor, req, resp, buffer, sizeof(buffer), &offset);
+
+  *slot = -1;
+  len = coap_get_payload(resp, &payload);
+  if(resp->code == CONTENT_2_05 && len > 0 && len < 8) {
+    memcpy(path, payload, len);
+    path[len] = '\0';
+    *slot = atoi(path);
+  }
+  return resp->code;
+}
+/*---------------------------------------------------------------------------*/
+/* The first used slot with the id, as the engine searches without an
+   index */
+static int
+find_slot(int id)
+{
+  int i;
+
+  for(i = 0; i < NUM_SLOTS; i++) {
+    if(sensor_instances[i].id == id &&
+       (sensor_instances[i].flag & LWM2M_INSTANCE_FLAG_USED)) {
+      return i;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+check_lookup(int id)
+{
+  int code, slot, expect;
+
+  expect = find_slot(id);
+  code = request(COAP_GET, id, &slot);
+  if(expect < 0) {
+    CHECK(code == NOT_FOUND_4_04);
+  } else {
+    CHECK(code == CONTENT_2_05);
+    CHECK(slot == expect);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+check_all(void)
+{
+  int id;
+
+  for(id = 0; id < NUM_IDS; id++) {
+    check_lookup(id);
+  }
+  check_lookup(30);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(lwm2m_index_test_process, ev, data)
+{
+  static int i, k;
+  int code, slot, id;
+
+  PROCESS_BEGIN();
+
+  lwm2m_engine_register_object(&sensor);
+  check_all();
+
+  /* Created by POST */
+  code = request(COAP_POST, 7, &slot);
+  CHECK(code == CREATED_2_01);
+  CHECK(find_slot(7) == 3);
+  check_all();
+
+  /* Deleted, created and renumbered by the application, first without
+     telling the engine */
+  sensor_instances[2].flag &= ~LWM2M_INSTANCE_FLAG_USED;
+  sensor_instances[5].id = 15;
+  sensor_instances[5].flag |= LWM2M_INSTANCE_FLAG_USED;
+  sensor_instances[0].id = 3;
+  check_all();
+  lwm2m_engine_update_instances(&sensor);
+  check_all();
+
+  /* Random changes that keep the ids unique, telling the engine about
+     some of them */
+  for(i = 0; i < NUM_OPERATIONS; i++) {
+    k = random_rand() % NUM_SLOTS;
+    id = random_rand() % NUM_IDS;
+    switch(random_rand() % 4) {
+    case 0:
+      if(find_slot(id) < 0) {
+        code = request(COAP_POST, id, &slot);
+        CHECK(code == (find_slot(id) < 0 ? NOT_ACCEPTABLE_4_06 :
+                       CREATED_2_01));
+      }
+      break;
+    case 1:
+      if(sensor_instances[k].flag & LWM2M_INSTANCE_FLAG_USED) {
+        sensor_instances[k].flag &= ~LWM2M_INSTANCE_FLAG_USED;
+      } else if(find_slot(sensor_instances[k].id) < 0) {
+        sensor_instances[k].flag |= LWM2M_INSTANCE_FLAG_USED;
+      }
+      break;
+    case 2:
+      if(find_slot(id) < 0) {
+        sensor_instances[k].id = id;
+      }
+      break;
+    default:
+      lwm2m_engine_update_instances(&sensor);
+      break;
+    }
+    check_lookup(random_rand() % NUM_IDS);
+  }
+  lwm2m_engine_update_instances(&sensor);
+  check_all();
+
+  printf("%d operations, %d errors\n", NUM_OPERATIONS, errors);
+  exit(errors != 0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,300 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Stand-in for tcp-socket and an MQTT broker, used to benchmark the
+ *         MQTT client without a network. As with uIP, segments of at most
+ *         the socket's maximum segment size are sent while no more than
+ *         UIP_TCP_SEND_WINDOW bytes (one segment without a send window)
+ *         are unacknowledged. Each segment is acknowledged one round-trip
+ *         time after it was sent. The broker answers CONNECT with CONNACK
+ *         and QoS 1 PUBLISH with PUBACK.
+ */
+
+#include "contiki.h"
+#include "net/ip/tcp-socket.h"
+#include "broker-stub.h"
+
+#include <string.h>
+
+#define MQTT_CONNECT    0x10
+#define MQTT_PUBLISH    0x30
+#define MQTT_PINGREQ    0xc0
+
+/* Bytes of each packet kept to find the MID of a PUBLISH */
+#define HEADER_MAX      128
+
+#if UIP_TCP_SEND_WINDOW
+#define WINDOW          UIP_TCP_SEND_WINDOW
+#else
+#define WINDOW          UIP_TCP_MSS
+#endif
+#define MAX_SEGMENTS    16
+
+static struct tcp_socket *sock;
+static struct ctimer connect_timer;
+
+/* Unacknowledged segments, oldest first */
+static struct segment {
+  struct ctimer timer;
+  uint16_t len;
+} segments[MAX_SEGMENTS];
+static uint8_t segments_head;
+static uint8_t segments_count;
+static uint16_t bytes_in_flight;
+
+/* Broker side packet parser */
+static uint8_t header[HEADER_MAX];
+static uint8_t fixed_header;
+static uint32_t remaining;
+static uint32_t received;
+static uint8_t length_bytes;
+static uint32_t length_multiplier;
+
+static struct broker_stub_stats stats;
+/*---------------------------------------------------------------------------*/
+static void
+reply(const uint8_t *data, int len)
+{
+  /* One packet per call: the client parses one packet per input chunk */
+  if(sock != NULL && sock->input_callback != NULL) {
+    sock->input_callback(sock, sock->ptr, data, len);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+packet_done(void)
+{
+  static const uint8_t connack[] = { 0x20, 2, 0, 0 };
+  static const uint8_t pingresp[] = { 0xd0, 0 };
+  uint8_t puback[] = { 0x40, 2, 0, 0 };
+  uint16_t topic_len;
+
+  switch(fixed_header & 0xf0) {
+  case MQTT_CONNECT:
+    reply(connack, sizeof(connack));
+    break;
+  case MQTT_PINGREQ:
+    reply(pingresp, sizeof(pingresp));
+    break;
+  case MQTT_PUBLISH:
+    stats.publishes++;
+    if(fixed_header & 0x06) {
+      topic_len = (header[0] << 8) | header[1];
+      if(topic_len + 4 <= HEADER_MAX) {
+        puback[2] = header[topic_len + 2];
+        puback[3] = header[topic_len + 3];
+      }
+      reply(puback, sizeof(puback));
+    }
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+broker_input(const uint8_t *data, int len)
+{
+  int i;
+
+  for(i = 0; i < len; i++) {
+    if(length_bytes == 0) {
+      fixed_header = data[i];
+      remaining = 0;
+      received = 0;
+      length_multiplier = 1;
+      length_bytes = 1;
+    } else if(length_bytes < 0x80) {
+      remaining += (data[i] & 0x7f) * length_multiplier;
+      length_multiplier <<= 7;
+      length_bytes = (data[i] & 0x80) ? length_bytes + 1 : 0x80;
+      if(length_bytes == 0x80 && remaining == 0) {
+        packet_done();
+        length_bytes = 0;
+      }
+    } else {
+      if(received < HEADER_MAX) {
+        header[received] = data[i];
+      }
+      if(++received == remaining) {
+        packet_done();
+        length_bytes = 0;
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void send_segments(void);
+
+static void
+segment_acked(void *ptr)
+{
+  struct tcp_socket *s = ptr;
+  uint16_t len;
+
+  if(sock != s) {
+    return;
+  }
+
+  /* All segments take one round-trip time, so the oldest one is acked */
+  len = segments[segments_head].len;
+  segments_head = (segments_head + 1) % MAX_SEGMENTS;
+  segments_count--;
+  bytes_in_flight -= len;
+
+  /* The broker sees the segment and its answers arrive with the ACK */
+  broker_input(s->output_data_ptr, len);
+
+  memmove(s->output_data_ptr, &s->output_data_ptr[len],
+          s->output_data_len - len);
+  s->output_data_len -= len;
+
+  if(s->event_callback != NULL) {
+    s->event_callback(s, s->ptr, TCP_SOCKET_DATA_SENT);
+  }
+  send_segments();
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_segments(void)
+{
+  struct segment *seg;
+  uint16_t mss;
+
+  if(sock == NULL) {
+    return;
+  }
+  mss = sock->output_data_max_seg;
+  if(mss == 0 || mss > UIP_TCP_MSS) {
+    mss = UIP_TCP_MSS;
+  }
+  while(segments_count < MAX_SEGMENTS &&
+        sock->output_data_len > bytes_in_flight &&
+        bytes_in_flight + mss <= WINDOW) {
+    seg = &segments[(segments_head + segments_count) % MAX_SEGMENTS];
+    seg->len = MIN(sock->output_data_len - bytes_in_flight, mss);
+    segments_count++;
+    bytes_in_flight += seg->len;
+    stats.segments++;
+    stats.bytes += seg->len;
+    ctimer_set(&seg->timer, BROKER_STUB_RTT, segment_acked, sock);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+connected(void *ptr)
+{
+  struct tcp_socket *s = ptr;
+
+  if(sock == s && s->event_callback != NULL) {
+    s->event_callback(s, s->ptr, TCP_SOCKET_CONNECTED);
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+tcp_socket_register(struct tcp_socket *s, void *ptr,
+                    uint8_t *input_databuf, int input_databuf_len,
+                    uint8_t *output_databuf, int output_databuf_len,
+                    tcp_socket_data_callback_t input_callback,
+                    tcp_socket_event_callback_t event_callback)
+{
+  memset(s, 0, sizeof(*s));
+  s->ptr = ptr;
+  s->input_data_ptr = input_databuf;
+  s->input_data_maxlen = input_databuf_len;
+  s->output_data_ptr = output_databuf;
+  s->output_data_maxlen = output_databuf_len;
+  s->input_callback = input_callback;
+  s->event_callback = event_callback;
+  s->p = PROCESS_CURRENT();
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+tcp_socket_connect(struct tcp_socket *s, const uip_ipaddr_t *ipaddr,
+                   uint16_t port)
+{
+  sock = s;
+  segments_head = 0;
+  segments_count = 0;
+  bytes_in_flight = 0;
+  length_bytes = 0;
+  ctimer_set(&connect_timer, BROKER_STUB_RTT, connected, s);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+tcp_socket_send(struct tcp_socket *s, const uint8_t *data, int datalen)
+{
+  int len;
+
+  len = MIN(datalen, s->output_data_maxlen - s->output_data_len);
+  memmove(&s->output_data_ptr[s->output_data_len], data, len);
+  s->output_data_len += len;
+  send_segments();
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+int
+tcp_socket_close(struct tcp_socket *s)
+{
+  int i;
+
+  if(sock == s) {
+    sock = NULL;
+    ctimer_stop(&connect_timer);
+    for(i = 0; i < MAX_SEGMENTS; i++) {
+      ctimer_stop(&segments[i].timer);
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+tcp_socket_unregister(struct tcp_socket *s)
+{
+  return tcp_socket_close(s);
+}
+/*---------------------------------------------------------------------------*/
+void
+broker_stub_get_stats(struct broker_stub_stats *s)
+{
+  *s = stats;
+}
+/*---------------------------------------------------------------------------*/
+void
+broker_stub_reset_stats(void)
+{
+  memset(&stats, 0, sizeof(stats));
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Throughput benchmark for the MQTT client
+ */
+
+#include "contiki.h"
+#include "mqtt.h"
+#include "broker-stub.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_MESSAGES  500
+#define PAYLOAD_SIZE  16
+
+static struct mqtt_connection conn;
+static char topic[] = "bench/data";
+static uint8_t payload[PAYLOAD_SIZE];
+static struct etimer et;
+
+static int queued;
+static int acked;
+static int timed_out;
+
+PROCESS(mqtt_bench_process, "MQTT benchmark");
+AUTOSTART_PROCESSES(&mqtt_bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+mqtt_event(struct mqtt_connection *m, mqtt_event_t event, void *data)
+{
+  if(event == MQTT_EVENT_PUBACK) {
+    acked++;
+  } else if(event == MQTT_EVENT_PUBACK_TIMEOUT) {
+    timed_out++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+fill(mqtt_qos_level_t qos)
+{
+  while(queued < NUM_MESSAGES &&
+        mqtt_publish(&conn, NULL, topic, payload, sizeof(payload), qos,
+                     MQTT_RETAIN_OFF) == MQTT_STATUS_OK) {
+    queued++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+done(mqtt_qos_level_t qos)
+{
+  struct broker_stub_stats stats;
+
+  if(qos == MQTT_QOS_LEVEL_1) {
+    return acked + timed_out == NUM_MESSAGES;
+  }
+  broker_stub_get_stats(&stats);
+  return stats.publishes == NUM_MESSAGES;
+}
+/*---------------------------------------------------------------------------*/
+static void
+report(mqtt_qos_level_t qos, clock_time_t start)
+{
+  struct broker_stub_stats stats;
+  clock_time_t elapsed = clock_time() - start;
+
+  broker_stub_get_stats(&stats);
+  printf("QoS %d: %lu messages in %5lu ms, %5lu segments",
+         qos, stats.publishes,
+         (unsigned long)(elapsed * 1000 / CLOCK_SECOND), stats.segments);
+  if(elapsed > 0) {
+    printf(" (%lu msg/s)",
+           (unsigned long)(stats.publishes * CLOCK_SECOND / elapsed));
+  }
+  printf("\n");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(mqtt_bench_process, ev, data)
+{
+  static mqtt_qos_level_t qos;
+  static clock_time_t start;
+
+  PROCESS_BEGIN();
+
+  printf("Publish queue %d, QoS 1 window %d, RTT %lu ms\n",
+         MQTT_PUBLISH_QUEUE_SIZE, MQTT_QOS1_WINDOW,
+         (unsigned long)(BROKER_STUB_RTT * 1000 / CLOCK_SECOND));
+
+  mqtt_register(&conn, &mqtt_bench_process, "bench", mqtt_event,
+                MQTT_TCP_OUTPUT_BUFF_SIZE);
+  mqtt_connect(&conn, "::1", 1883, 60);
+  PROCESS_WAIT_UNTIL(mqtt_connected(&conn));
+
+  for(qos = MQTT_QOS_LEVEL_0; qos <= MQTT_QOS_LEVEL_1; qos++) {
+    queued = 0;
+    acked = 0;
+    timed_out = 0;
+    broker_stub_reset_stats();
+    start = clock_time();
+
+    /* Messages leave the queue on mqtt_update_event (QoS 0) and on
+       PUBACK; the timer catches the end of a run. */
+    etimer_set(&et, CLOCK_SECOND / 100);
+    while(!done(qos)) {
+      fill(qos);
+      PROCESS_WAIT_EVENT();
+      if(etimer_expired(&et)) {
+        etimer_restart(&et);
+      }
+    }
+    etimer_stop(&et);
+    report(qos, start);
+  }
+
+  printf("%d PUBACK timeouts\n", timed_out);
+  exit(timed_out != 0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
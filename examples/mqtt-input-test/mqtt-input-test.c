@@ -0,0 +1,311 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Randomized test of the MQTT receive path. Random streams of
+ *         PUBLISH, PUBACK, SUBACK and PINGRESP packets, and oversized
+ *         packets that must be skipped, are fed to the client in random
+ *         slices, and the events it raises are checked against the
+ *         stream.
+ *
+ *         The MQTT client is compiled into the test, so that its TCP
+ *         input callback can be called directly.
+ */
+
+#include "contiki.h"
+#include "mqtt.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_ROUNDS        300
+#define STREAM_SIZE       (24 * 1024)
+#define MAX_TOPIC_LENGTH  150
+#define MAX_PAYLOAD_SIZE  2500
+#define MAX_SLICE         MQTT_TCP_INPUT_BUFF_SIZE
+#define MAX_EVENTS        (STREAM_SIZE / 4)
+
+PROCESS(mqtt_input_test_process, "MQTT input test");
+AUTOSTART_PROCESSES(&mqtt_input_test_process);
+
+static int errors;
+
+#define CHECK(cond) do {                                         \
+    if(!(cond)) {                                                \
+      if(errors++ < 10) {                                        \
+        printf("FAIL line %d: %s\n", __LINE__, #cond);           \
+      }                                                          \
+    }                                                            \
+  } while(0)
+
+static struct mqtt_connection conn;
+static uint8_t stream[STREAM_SIZE];
+static int stream_len;
+
+/* The events that the stream should raise, in order */
+static struct expected {
+  mqtt_event_t event;
+  uint16_t mid;
+  uint8_t qos;
+  const uint8_t *topic;
+  uint16_t topic_length;
+  const uint8_t *payload;
+  uint32_t payload_length;
+} expected[MAX_EVENTS];
+static int num_expected;
+static int next_expected;
+static uint32_t payload_received;
+
+static unsigned long publishes, chunks, slices, skipped;
+/*---------------------------------------------------------------------------*/
+static void
+event_callback(struct mqtt_connection *m, mqtt_event_t event, void *data)
+{
+  struct expected *e = &expected[next_expected];
+  struct mqtt_message *msg;
+  struct mqtt_suback_event *suback;
+
+  if(next_expected >= num_expected || e->event != event) {
+    CHECK(!"unexpected event");
+    return;
+  }
+
+  switch(event) {
+  case MQTT_EVENT_PUBLISH:
+    msg = data;
+    chunks++;
+    CHECK(msg->first_chunk == (payload_received == 0));
+    if(msg->first_chunk) {
+      CHECK(msg->topic_length == e->topic_length);
+      CHECK(strlen(msg->topic) == MIN(e->topic_length, MQTT_MAX_TOPIC_LENGTH));
+      CHECK(memcmp(msg->topic, e->topic, strlen(msg->topic)) == 0);
+      CHECK(msg->payload_length == e->payload_length);
+      if(e->qos) {
+        CHECK(msg->mid == e->mid);
+      }
+      if(e->payload_length <= MQTT_INPUT_BUFF_SIZE) {
+        /* Small payloads arrive in one piece */
+        CHECK(msg->payload_chunk_length == e->payload_length);
+      }
+    }
+    if(payload_received + msg->payload_chunk_length > e->payload_length) {
+      CHECK(!"payload too long");
+      return;
+    }
+    CHECK(memcmp(msg->payload_chunk, e->payload + payload_received,
+                 msg->payload_chunk_length) == 0);
+    payload_received += msg->payload_chunk_length;
+    CHECK(msg->payload_left == e->payload_length - payload_received);
+    if(payload_received < e->payload_length) {
+      return;
+    }
+    payload_received = 0;
+    publishes++;
+    break;
+  case MQTT_EVENT_PUBACK:
+    CHECK(*(uint16_t *)data == e->mid);
+    break;
+  case MQTT_EVENT_SUBACK:
+    suback = data;
+    CHECK(suback->mid == e->mid);
+    CHECK(suback->qos_level == e->qos);
+    break;
+  default:
+    break;
+  }
+  next_expected++;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t *
+put_header(uint8_t fhdr, uint32_t remaining_length)
+{
+  uint8_t *p = &stream[stream_len];
+
+  *p++ = fhdr;
+  do {
+    *p = remaining_length & 0x7f;
+    remaining_length >>= 7;
+    if(remaining_length > 0) {
+      *p |= 0x80;
+    }
+    p++;
+  } while(remaining_length > 0);
+  return p;
+}
+/*---------------------------------------------------------------------------*/
+static struct expected *
+expect(mqtt_event_t event)
+{
+  struct expected *e = &expected[num_expected++];
+
+  memset(e, 0, sizeof(*e));
+  e->event = event;
+  return e;
+}
+/*---------------------------------------------------------------------------*/
+static int
+add_packet(void)
+{
+  struct expected *e;
+  uint16_t topic_length, mid;
+  uint32_t payload_length, len;
+  uint8_t qos;
+  uint8_t *p;
+  int i;
+
+  if(stream_len + 16 + MAX_TOPIC_LENGTH + MAX_PAYLOAD_SIZE > STREAM_SIZE ||
+     num_expected == MAX_EVENTS) {
+    return 0;
+  }
+  mid = random_rand();
+
+  switch(random_rand() % 8) {
+  case 0:
+    e = expect(MQTT_EVENT_PUBACK);
+    e->mid = mid;
+    p = put_header(MQTT_FHDR_MSG_TYPE_PUBACK, 2);
+    *p++ = mid >> 8;
+    *p++ = mid;
+    break;
+  case 1:
+    e = expect(MQTT_EVENT_SUBACK);
+    e->mid = mid;
+    e->qos = random_rand() % 2;
+    p = put_header(MQTT_FHDR_MSG_TYPE_SUBACK, 3);
+    *p++ = mid >> 8;
+    *p++ = mid;
+    *p++ = e->qos;
+    break;
+  case 2:
+    p = put_header(MQTT_FHDR_MSG_TYPE_PINGRESP, 0);
+    break;
+  case 3:
+    /* Too long for anything but PUBLISH, skipped without an event */
+    len = MQTT_INPUT_BUFF_SIZE + 1 + random_rand() % 1000;
+    p = put_header(MQTT_FHDR_MSG_TYPE_SUBACK, len);
+    for(i = 0; i < len; i++) {
+      *p++ = random_rand();
+    }
+    skipped++;
+    break;
+  default:
+    /* Mostly short topics and payloads, with some that are split */
+    if(random_rand() % 4) {
+      topic_length = random_rand() % (MQTT_MAX_TOPIC_LENGTH + 1);
+      payload_length = random_rand() % 64;
+    } else {
+      topic_length = random_rand() % (MAX_TOPIC_LENGTH + 1);
+      payload_length = random_rand() % (MAX_PAYLOAD_SIZE + 1);
+    }
+    qos = random_rand() % 2;
+    len = MQTT_STRING_LEN_SIZE + topic_length + payload_length;
+    if(qos) {
+      len += MQTT_MID_SIZE;
+    }
+    e = expect(MQTT_EVENT_PUBLISH);
+    e->mid = mid;
+    e->qos = qos;
+    e->topic_length = topic_length;
+    e->payload_length = payload_length;
+
+    p = put_header(MQTT_FHDR_MSG_TYPE_PUBLISH | qos << 1, len);
+    *p++ = topic_length >> 8;
+    *p++ = topic_length;
+    e->topic = p;
+    for(i = 0; i < topic_length; i++) {
+      *p++ = 'a' + random_rand() % 26;
+    }
+    if(qos) {
+      *p++ = mid >> 8;
+      *p++ = mid;
+    }
+    e->payload = p;
+    for(i = 0; i < payload_length; i++) {
+      *p++ = random_rand();
+    }
+    break;
+  }
+  stream_len = p - stream;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(mqtt_input_test_process, ev, data)
+{
+  static int round;
+  uint8_t *slice;
+  int pos, len;
+
+  PROCESS_BEGIN();
+
+  mqtt_register(&conn, PROCESS_CURRENT(), "test", event_callback, 0);
+  conn.state = MQTT_CONN_STATE_CONNECTED_TO_BROKER;
+  random_init(1);
+
+  for(round = 0; round < NUM_ROUNDS; round++) {
+    stream_len = 0;
+    num_expected = 0;
+    next_expected = 0;
+    while(add_packet());
+
+    /* Each slice is copied to a buffer of its own size, so that reads
+       past its end show up under AddressSanitizer. */
+    for(pos = 0; pos < stream_len; pos += len) {
+      len = 1 + random_rand() % MAX_SLICE;
+      len = MIN(len, stream_len - pos);
+      slice = malloc(len);
+      memcpy(slice, &stream[pos], len);
+      tcp_input(&conn.socket, &conn, slice, len);
+      free(slice);
+      slices++;
+    }
+    CHECK(next_expected == num_expected);
+    CHECK(payload_received == 0);
+
+    /* Drop the update events, which fill the event queue. A poll does
+       not need a slot in the queue. */
+    do {
+      process_poll(PROCESS_CURRENT());
+      PROCESS_WAIT_EVENT();
+    } while(process_nevents() > 0);
+  }
+
+  printf("%lu PUBLISH in %lu chunks, %lu skipped, %lu slices\n",
+         publishes, chunks, skipped, slices);
+  printf("%d errors\n", errors);
+  exit(errors != 0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
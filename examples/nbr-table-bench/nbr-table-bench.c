@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Test and benchmark for the neighbor table
+ */
+
+#include "contiki.h"
+#include "net/nbr-table.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_NEIGHBORS  NBR_TABLE_MAX_NEIGHBORS
+#define NUM_LOOKUPS    100000
+#define NUM_EVICTIONS  (NUM_NEIGHBORS / 4)
+
+/* The first quarter of the neighbors is used by both tables, the
+   second quarter is locked and the second half can be evicted. */
+#define SHARED_END     (NUM_NEIGHBORS / 4)
+#define LOCKED_END     (NUM_NEIGHBORS / 2)
+
+struct entry {
+  int id;
+};
+
+NBR_TABLE(struct entry, table_a);
+NBR_TABLE(struct entry, table_b);
+
+PROCESS(nbr_table_bench_process, "Neighbor table benchmark");
+AUTOSTART_PROCESSES(&nbr_table_bench_process);
+/*---------------------------------------------------------------------------*/
+/* Link-layer addresses that share a prefix and differ only in their
+   last two bytes, as the addresses of neighbors in a network often do */
+static void
+make_lladdr(linkaddr_t *addr, int i)
+{
+  memset(addr, 0, sizeof(*addr));
+  addr->u8[0] = 0x00;
+  addr->u8[1] = 0x12;
+  addr->u8[LINKADDR_SIZE - 2] = i >> 8;
+  addr->u8[LINKADDR_SIZE - 1] = i & 0xff;
+}
+/*---------------------------------------------------------------------------*/
+static int
+lookup(nbr_table_t *table, int i)
+{
+  linkaddr_t addr;
+  struct entry *e;
+
+  make_lladdr(&addr, i);
+  e = nbr_table_get_from_lladdr(table, &addr);
+  return e != NULL && e->id == i;
+}
+/*---------------------------------------------------------------------------*/
+static struct entry *
+add(nbr_table_t *table, int i)
+{
+  linkaddr_t addr;
+  struct entry *e;
+
+  make_lladdr(&addr, i);
+  e = nbr_table_add_lladdr(table, &addr, NBR_TABLE_REASON_UNDEFINED, NULL);
+  if(e != NULL) {
+    e->id = i;
+  }
+  return e;
+}
+/*---------------------------------------------------------------------------*/
+static void
+report(const char *what, int count, clock_time_t start)
+{
+  clock_time_t elapsed = clock_time() - start;
+
+  printf("%-8s %6d ops in %5lu ms", what, count,
+         (unsigned long)(elapsed * 1000 / CLOCK_SECOND));
+  if(elapsed > 0) {
+    printf(" (%lu ops/s)", (unsigned long)(count * CLOCK_SECOND / elapsed));
+  }
+  printf("\n");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(nbr_table_bench_process, ev, data)
+{
+  struct entry *e;
+  linkaddr_t addr;
+  clock_time_t start;
+  int i, k, errors;
+
+  PROCESS_BEGIN();
+
+  printf("Neighbor table size %d, hashed index %s\n", NUM_NEIGHBORS,
+         NBR_TABLE_HASH ? "on" : "off");
+
+  nbr_table_register(table_a, NULL);
+  nbr_table_register(table_b, NULL);
+  errors = 0;
+
+  start = clock_time();
+  for(i = 0; i < NUM_NEIGHBORS; i++) {
+    if(add(table_a, i) == NULL) {
+      errors++;
+    }
+  }
+  report("add", NUM_NEIGHBORS, start);
+
+  for(i = 0; i < SHARED_END; i++) {
+    if(add(table_b, i) == NULL) {
+      errors++;
+    }
+  }
+  for(i = SHARED_END; i < LOCKED_END; i++) {
+    make_lladdr(&addr, i);
+    nbr_table_lock(table_a, nbr_table_get_from_lladdr(table_a, &addr));
+  }
+
+  /* Look up a mix of present and absent neighbors. */
+  srand(1);
+  start = clock_time();
+  for(i = 0; i < NUM_LOOKUPS; i++) {
+    k = rand();
+    if(i % 4 == 3) {
+      if(lookup(table_a, NUM_NEIGHBORS + k % NUM_NEIGHBORS)) {
+        errors++;
+      }
+    } else if(!lookup(table_a, k % NUM_NEIGHBORS)) {
+      errors++;
+    }
+  }
+  report("lookup", NUM_LOOKUPS, start);
+
+  /* Touch the evictable neighbors in order, so that the least recently
+     used one is also the oldest, and add new neighbors to a full
+     table. */
+  for(i = LOCKED_END; i < NUM_NEIGHBORS; i++) {
+    lookup(table_a, i);
+  }
+  start = clock_time();
+  for(i = 0; i < NUM_EVICTIONS; i++) {
+    if(add(table_a, NUM_NEIGHBORS + i) == NULL) {
+      errors++;
+    }
+  }
+  report("evict", NUM_EVICTIONS, start);
+
+  for(i = 0; i < NUM_NEIGHBORS + NUM_EVICTIONS; i++) {
+    if(lookup(table_a, i) ==
+       (i >= LOCKED_END && i < LOCKED_END + NUM_EVICTIONS)) {
+      printf("neighbor %d %s\n", i, lookup(table_a, i) ? "kept" : "evicted");
+      errors++;
+    }
+  }
+  for(i = 0; i < SHARED_END; i++) {
+    if(!lookup(table_b, i)) {
+      errors++;
+    }
+  }
+
+  start = clock_time();
+  k = 0;
+  for(e = nbr_table_head(table_a); e != NULL; e = nbr_table_next(table_a, e)) {
+    nbr_table_remove(table_a, e);
+    k++;
+  }
+  report("remove", k, start);
+  for(e = nbr_table_head(table_b); e != NULL; e = nbr_table_next(table_b, e)) {
+    nbr_table_remove(table_b, e);
+  }
+  if(k != NUM_NEIGHBORS || nbr_table_head(table_a) != NULL ||
+     nbr_table_head(table_b) != NULL) {
+    errors++;
+  }
+
+  /* All neighbors are unused now, so each new one replaces one. */
+  start = clock_time();
+  for(i = 0; i < NUM_NEIGHBORS; i++) {
+    if(add(table_a, 2 * NUM_NEIGHBORS + i) == NULL) {
+      errors++;
+    }
+  }
+  report("replace", NUM_NEIGHBORS, start);
+  for(i = 0; i < NUM_NEIGHBORS; i++) {
+    if(!lookup(table_a, 2 * NUM_NEIGHBORS + i)) {
+      errors++;
+    }
+  }
+
+  printf("%d errors\n", errors);
+  exit(errors != 0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
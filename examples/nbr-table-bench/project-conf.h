@@ -0,0 +1,13 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+#undef NBR_TABLE_CONF_MAX_NEIGHBORS
+#define NBR_TABLE_CONF_MAX_NEIGHBORS 1000
+
+/* Build with DEFINES=NBR_TABLE_CONF_HASH=0 to measure the neighbor
+   list. */
+#ifndef NBR_TABLE_CONF_HASH
+#define NBR_TABLE_CONF_HASH 1
+#endif
+
+#endif /* PROJECT_CONF_H_ */
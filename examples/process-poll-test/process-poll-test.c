@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Regression test for poll requests of processes that exit
+ *         before the poll handler runs.
+ */
+
+#include "contiki.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+PROCESS(test_process, "Poll test");
+PROCESS(worker_a, "Worker A");
+PROCESS(worker_b, "Worker B");
+PROCESS(worker_c, "Worker C");
+PROCESS(self_exit_process, "Self exit");
+AUTOSTART_PROCESSES(&test_process);
+
+static int polls_a, polls_b, polls_c, polls_self;
+static int restart_b;
+static int errors;
+
+#define CHECK(cond) do {                                     \
+    if(!(cond)) {                                            \
+      printf("FAIL line %d: %s\n", __LINE__, #cond);         \
+      errors++;                                              \
+    }                                                        \
+  } while(0)
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(worker_a, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+    polls_a++;
+    /* Exit worker B while it is queued behind us in the same round. */
+    process_exit(&worker_b);
+    if(restart_b) {
+      process_start(&worker_b, NULL);
+      process_poll(&worker_b);
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(worker_b, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+    polls_b++;
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(worker_c, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+    polls_c++;
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(self_exit_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  process_poll(PROCESS_CURRENT());
+  if(ev == PROCESS_EVENT_POLL) {
+    polls_self++;
+  }
+  PROCESS_EXIT();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  /* Polled by another process, then exited. */
+  process_start(&worker_b, NULL);
+  process_poll(&worker_b);
+  process_exit(&worker_b);
+  PROCESS_PAUSE();
+  CHECK(polls_b == 0);
+  CHECK(!process_is_running(&worker_b));
+
+  /* Polls itself, then exits. */
+  process_start(&self_exit_process, NULL);
+  PROCESS_PAUSE();
+  CHECK(polls_self == 0);
+  CHECK(!process_is_running(&self_exit_process));
+
+  /* Exited by a process that is polled before it in the same round.
+     The processes are started in reverse, so that the default
+     dispatcher, which walks the process list, polls them in the same
+     order as the poll FIFO. */
+  process_start(&worker_c, NULL);
+  process_start(&worker_b, NULL);
+  process_start(&worker_a, NULL);
+  process_poll(&worker_a);
+  process_poll(&worker_b);
+  process_poll(&worker_c);
+  PROCESS_PAUSE();
+  CHECK(polls_a == 1);
+  CHECK(polls_b == 0);
+  CHECK(polls_c == 1);
+  CHECK(!process_is_running(&worker_b));
+
+  /* Exited, restarted and polled again within the same round. The
+     processes queued behind it must still be polled. */
+  restart_b = 1;
+  process_exit(&worker_a);
+  process_start(&worker_b, NULL);
+  process_start(&worker_a, NULL);
+  process_poll(&worker_a);
+  process_poll(&worker_b);
+  process_poll(&worker_c);
+  PROCESS_PAUSE();
+  PROCESS_PAUSE();
+  CHECK(polls_a == 2);
+  CHECK(polls_b == 1);
+  CHECK(polls_c == 2);
+  CHECK(process_is_running(&worker_b));
+
+  printf("%d errors\n", errors);
+  exit(errors != 0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
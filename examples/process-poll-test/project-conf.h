@@ -0,0 +1,10 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+/* Test the priority-queue dispatcher. Build with
+   DEFINES=PROCESS_CONF_FAST_DISPATCH=0 to test the default one. */
+#ifndef PROCESS_CONF_FAST_DISPATCH
+#define PROCESS_CONF_FAST_DISPATCH 1
+#endif
+
+#endif /* PROJECT_CONF_H_ */
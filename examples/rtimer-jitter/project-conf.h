@@ -0,0 +1,10 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+/* Measure the timerfd rtimer backend on native. Build with
+   DEFINES=RTIMER_CONF_TIMERFD=0 to measure the SIGALRM backend. */
+#ifndef RTIMER_CONF_TIMERFD
+#define RTIMER_CONF_TIMERFD 1
+#endif
+
+#endif /* PROJECT_CONF_H_ */
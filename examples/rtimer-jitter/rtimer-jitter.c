@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures rtimer callback jitter
+ */
+
+#include "contiki.h"
+#include "sys/rtimer.h"
+
+#include <stdio.h>
+
+/* The interval between two rtimer callbacks. */
+#ifndef JITTER_PERIOD
+#define JITTER_PERIOD (RTIMER_SECOND / 100)
+#endif
+
+#ifndef JITTER_SAMPLES
+#define JITTER_SAMPLES 500
+#endif
+
+/* Histogram bucket width, in microseconds. */
+#define BUCKET_USEC 50
+#define BUCKETS     20
+
+static struct rtimer timer;
+static rtimer_clock_t expected;
+static int samples;
+static long min_late, max_late, sum_late;
+static unsigned histogram[BUCKETS + 1];
+
+PROCESS(rtimer_jitter_process, "Rtimer jitter");
+AUTOSTART_PROCESSES(&rtimer_jitter_process);
+/*---------------------------------------------------------------------------*/
+static long
+ticks_to_usec(long ticks)
+{
+  return (long)((long long)ticks * 1000000 / RTIMER_SECOND);
+}
+/*---------------------------------------------------------------------------*/
+static void
+callback(struct rtimer *t, void *ptr)
+{
+  long late;
+  long bucket;
+
+  late = ticks_to_usec(RTIMER_CLOCK_DIFF(RTIMER_NOW(), expected));
+
+  if(samples == 0 || late < min_late) {
+    min_late = late;
+  }
+  if(samples == 0 || late > max_late) {
+    max_late = late;
+  }
+  sum_late += late;
+  bucket = late < 0 ? 0 : late / BUCKET_USEC;
+  histogram[bucket > BUCKETS ? BUCKETS : bucket]++;
+
+  if(++samples < JITTER_SAMPLES) {
+    expected += JITTER_PERIOD;
+    rtimer_set(&timer, expected, 0, callback, NULL);
+  } else {
+    process_poll(&rtimer_jitter_process);
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(rtimer_jitter_process, ev, data)
+{
+  int i;
+
+  PROCESS_BEGIN();
+
+  printf("Measuring %d rtimer callbacks, period %ld usec, RTIMER_SECOND %lu\n",
+         JITTER_SAMPLES, ticks_to_usec(JITTER_PERIOD),
+         (unsigned long)RTIMER_SECOND);
+
+  expected = RTIMER_NOW() + JITTER_PERIOD;
+  rtimer_set(&timer, expected, 0, callback, NULL);
+
+  PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+
+  printf("Lateness (usec): min %ld avg %ld max %ld\n",
+         min_late, sum_late / samples, max_late);
+  for(i = 0; i <= BUCKETS; i++) {
+    if(histogram[i] > 0) {
+      if(i < BUCKETS) {
+        printf("  %5d-%5d usec: %u\n", i * BUCKET_USEC,
+               (i + 1) * BUCKET_USEC - 1, histogram[i]);
+      } else {
+        printf("  >=%8d usec: %u\n", i * BUCKET_USEC, histogram[i]);
+      }
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,7 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+#define TAPDEV_CONF_BATCH    8
+#define TAPDEV_CONF_VNET_HDR 1
+
+#endif /* PROJECT_CONF_H_ */
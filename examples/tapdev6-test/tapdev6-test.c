@@ -0,0 +1,322 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Test of the batched, virtio-net header mode of the native tap
+ *         driver. A socket pair stands in for the tap device.
+ *
+ *         The driver is compiled into the test, so that the test can
+ *         hand it the socket instead of opening the tap device.
+ */
+
+#include "contiki.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tapdev6.c"
+
+#define NUM_FRAMES  20000
+#define ETH_HDRLEN  14
+#define IP6_HDRLEN  40
+
+PROCESS(tapdev6_test_process, "tapdev6 test");
+AUTOSTART_PROCESSES(&tapdev6_test_process);
+
+static int errors;
+
+#define CHECK(cond) do {                                         \
+    if(!(cond)) {                                                \
+      if(errors++ < 10) {                                        \
+        printf("FAIL line %d: %s\n", __LINE__, #cond);           \
+      }                                                          \
+    }                                                            \
+  } while(0)
+
+/* The other end of the tap device */
+static int host;
+static uint8_t frame[UIP_BUFSIZE];
+/*---------------------------------------------------------------------------*/
+/* The RFC 1071 sum of 16-bit big-endian words */
+static uint32_t
+reference_sum(uint32_t sum, const uint8_t *data, int len)
+{
+  int i;
+
+  for(i = 0; i + 1 < len; i += 2) {
+    sum += (data[i] << 8) | data[i + 1];
+  }
+  if(i < len) {
+    sum += data[i] << 8;
+  }
+  return sum;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+fold(uint32_t sum)
+{
+  while(sum >> 16) {
+    sum = (sum & 0xffff) + (sum >> 16);
+  }
+  return sum;
+}
+/*---------------------------------------------------------------------------*/
+/* The sum of the IPv6 pseudo-header of the packet in frame */
+static uint32_t
+pseudo_sum(int len, uint8_t proto)
+{
+  uint32_t sum;
+
+  sum = reference_sum(0, &frame[ETH_HDRLEN + 8], 32);
+  return sum + (len - ETH_HDRLEN - IP6_HDRLEN) + proto;
+}
+/*---------------------------------------------------------------------------*/
+/* Builds a UDP or TCP packet of len bytes in frame, with only the
+   pseudo-header sum in its checksum field as the kernel leaves it for
+   CHECKSUM_PARTIAL. Returns the offset of the checksum field from the
+   transport header. */
+static int
+make_partial(int len, uint8_t proto)
+{
+  int i, offset;
+  uint16_t sum;
+
+  for(i = 0; i < len; i++) {
+    frame[i] = random_rand();
+  }
+  frame[12] = 0x86;
+  frame[13] = 0xdd;
+  frame[ETH_HDRLEN] = 0x60;
+  frame[ETH_HDRLEN + 4] = (len - ETH_HDRLEN - IP6_HDRLEN) >> 8;
+  frame[ETH_HDRLEN + 5] = (len - ETH_HDRLEN - IP6_HDRLEN) & 0xff;
+  frame[ETH_HDRLEN + 6] = proto;
+  offset = proto == UIP_PROTO_UDP ? 6 : 16;
+  sum = fold(pseudo_sum(len, proto));
+  frame[ETH_HDRLEN + IP6_HDRLEN + offset] = sum >> 8;
+  frame[ETH_HDRLEN + IP6_HDRLEN + offset + 1] = sum & 0xff;
+  return offset;
+}
+/*---------------------------------------------------------------------------*/
+static void
+host_write(const struct virtio_net_hdr *hdr, const uint8_t *data, int len)
+{
+  struct iovec iov[2];
+
+  iov[0].iov_base = (void *)hdr;
+  iov[0].iov_len = sizeof(*hdr);
+  iov[1].iov_base = (void *)data;
+  iov[1].iov_len = len;
+  CHECK(writev(host, iov, 2) == sizeof(*hdr) + len);
+}
+/*---------------------------------------------------------------------------*/
+/* Frames with NEEDS_CSUM must reach the stack with a checksum that
+   verifies, and all other bytes unchanged */
+static void
+check_needs_csum(void)
+{
+  static uint8_t sent[UIP_BUFSIZE];
+  struct virtio_net_hdr hdr;
+  int i, len, offset, n;
+  uint8_t proto;
+
+  for(i = 0; i < NUM_FRAMES; i++) {
+    proto = i & 1 ? UIP_PROTO_TCP : UIP_PROTO_UDP;
+    len = ETH_HDRLEN + IP6_HDRLEN + 20 +
+      random_rand() % (UIP_BUFSIZE - ETH_HDRLEN - IP6_HDRLEN - 20 + 1);
+    offset = make_partial(len, proto);
+    memcpy(sent, frame, len);
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+    hdr.csum_start = ETH_HDRLEN + IP6_HDRLEN;
+    hdr.csum_offset = offset;
+    host_write(&hdr, frame, len);
+
+    n = tapdev_batch_begin();
+    CHECK(n == 1);
+    uip_len = tapdev_poll();
+    CHECK(uip_len == len);
+    CHECK(tapdev_poll() == 0);
+    tapdev_batch_end();
+    if(uip_len != len) {
+      continue;
+    }
+
+    /* The pseudo-header and the transport header and data sum to zero */
+    CHECK(fold(pseudo_sum(len, proto) +
+               reference_sum(0, &uip_buf[ETH_HDRLEN + IP6_HDRLEN],
+                             len - ETH_HDRLEN - IP6_HDRLEN)) == 0xffff);
+    CHECK(memcmp(uip_buf, sent, ETH_HDRLEN + IP6_HDRLEN + offset) == 0);
+    CHECK(memcmp(&uip_buf[ETH_HDRLEN + IP6_HDRLEN + offset + 2],
+                 &sent[ETH_HDRLEN + IP6_HDRLEN + offset + 2],
+                 len - ETH_HDRLEN - IP6_HDRLEN - offset - 2) == 0);
+  }
+
+  /* A checksum field that runs one byte past the frame is left alone */
+  len = ETH_HDRLEN + IP6_HDRLEN + 8;
+  make_partial(len, UIP_PROTO_UDP);
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+  hdr.csum_start = len - 7;
+  hdr.csum_offset = 6;
+  host_write(&hdr, frame, len);
+  CHECK(tapdev_batch_begin() == 1);
+  CHECK(tapdev_poll() == len);
+  CHECK(memcmp(uip_buf, frame, len) == 0);
+  tapdev_batch_end();
+}
+/*---------------------------------------------------------------------------*/
+/* Reads a frame sent by the driver and checks that it is frame number
+   i, as sent by send_frame() */
+static void
+check_sent(int i)
+{
+  struct virtio_net_hdr hdr, zero;
+  uint8_t data[UIP_BUFSIZE];
+  struct iovec iov[2];
+  int n;
+
+  iov[0].iov_base = &hdr;
+  iov[0].iov_len = sizeof(hdr);
+  iov[1].iov_base = data;
+  iov[1].iov_len = sizeof(data);
+  n = readv(host, iov, 2);
+  memset(&zero, 0, sizeof(zero));
+  CHECK(n == sizeof(hdr) + 60 + i % 100);
+  CHECK(memcmp(&hdr, &zero, sizeof(hdr)) == 0);
+  CHECK(data[0] == (i & 0xff) && data[1] == (i >> 8));
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_frame(int i)
+{
+  memset(uip_buf, 0, 60 + i % 100);
+  uip_buf[0] = i & 0xff;
+  uip_buf[1] = i >> 8;
+  uip_len = 60 + i % 100;
+  tapdev_do_send();
+}
+/*---------------------------------------------------------------------------*/
+/* Frames sent during a batch are queued, and written when the queue
+   is full and at the end of the batch */
+static void
+check_batch_send(void)
+{
+  uint8_t data[UIP_BUFSIZE];
+  int i, count, next;
+
+  next = 0;
+  for(count = 0; count <= 3 * TAPDEV_BATCH; count++) {
+    tapdev_batch_begin();
+    for(i = 0; i < count; i++) {
+      send_frame(next + i);
+      /* Whole batches are written as soon as the next frame comes */
+      CHECK(tx_count == i % TAPDEV_BATCH + 1);
+    }
+    for(i = 0; i < count - tx_count; i++) {
+      check_sent(next + i);
+    }
+    CHECK(read(host, data, sizeof(data)) == -1);
+    tapdev_batch_end();
+    CHECK(tx_count == 0);
+    for(; i < count; i++) {
+      check_sent(next + i);
+    }
+    CHECK(read(host, data, sizeof(data)) == -1);
+    next += count;
+  }
+
+  /* Outside a batch, frames are written at once */
+  send_frame(next);
+  check_sent(next);
+}
+/*---------------------------------------------------------------------------*/
+/* A batch takes at most TAPDEV_BATCH frames, in the order they came */
+static void
+check_batch_read(void)
+{
+  struct virtio_net_hdr hdr;
+  int i, n;
+
+  memset(&hdr, 0, sizeof(hdr));
+  for(i = 0; i < TAPDEV_BATCH + 3; i++) {
+    memset(frame, i, 60);
+    host_write(&hdr, frame, 60);
+  }
+  n = tapdev_batch_begin();
+  CHECK(n == TAPDEV_BATCH);
+  for(i = 0; i < n; i++) {
+    CHECK(tapdev_poll() == 60);
+    CHECK(uip_buf[0] == i && uip_buf[59] == i);
+  }
+  CHECK(tapdev_poll() == 0);
+  tapdev_batch_end();
+  n = tapdev_batch_begin();
+  CHECK(n == 3);
+  for(i = 0; i < n; i++) {
+    CHECK(tapdev_poll() == 60);
+    CHECK(uip_buf[0] == TAPDEV_BATCH + i);
+  }
+  tapdev_batch_end();
+  CHECK(tapdev_batch_begin() == 0);
+  tapdev_batch_end();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(tapdev6_test_process, ev, data)
+{
+  int sv[2];
+
+  PROCESS_BEGIN();
+
+  if(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) == -1) {
+    perror("tapdev6-test: socketpair");
+    exit(1);
+  }
+  fd = sv[0];
+  host = sv[1];
+  vnet_hdr = 1;
+  fcntl(fd, F_SETFL, O_NONBLOCK);
+  fcntl(host, F_SETFL, O_NONBLOCK);
+
+  check_needs_csum();
+  check_batch_send();
+  check_batch_read();
+
+  printf("%d errors\n", errors);
+  exit(errors != 0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A simulated TCP peer on the native platform. It sits behind
+ *         the tcpip output function, so that the full uIP stack is
+ *         exercised without a network. The peer opens a connection,
+ *         reassembles and checks the stream it receives, and
+ *         acknowledges every segment one round-trip time after it was
+ *         sent. Every drop_every:th data segment is lost.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ip/tcpip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "tcp-peer.h"
+
+#include <string.h>
+
+#define UIP_IP_BUF   ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UIP_TCP_BUF  ((struct uip_tcp_hdr *)&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN])
+
+#define TCP_FIN 0x01
+#define TCP_SYN 0x02
+#define TCP_RST 0x04
+#define TCP_ACK 0x10
+
+#define MSS_OPTION_LEN 4
+#define MAX_REPLIES    64
+
+/* Replies are sent in order, one round-trip time after the segment
+   they answer */
+struct reply {
+  clock_time_t due;
+  uint32_t ack;
+  uint8_t flags;
+};
+
+static struct reply replies[MAX_REPLIES];
+static int reply_head;
+static int reply_count;
+static struct ctimer reply_timer;
+
+static uip_ipaddr_t peer_addr;
+static const uip_lladdr_t peer_lladdr = { { 0, 0, 0, 0, 0, 0, 0, 2 } };
+static uip_ipaddr_t local_addr;
+
+static uint16_t peer_port = 4000;
+static uint16_t local_port;
+static uint32_t snd_nxt;
+static uint32_t rcv_nxt;
+static uint32_t rcv_isn;
+static uint8_t fin_sent;
+static int drop_every;
+static unsigned long data_segments;
+
+/* Reassembly of the received stream */
+static uint8_t stream[TCP_PEER_MAX_BYTES];
+static uint8_t have[TCP_PEER_MAX_BYTES];
+
+static struct tcp_peer_stats stats;
+/*---------------------------------------------------------------------------*/
+static uint32_t
+get32(const uint8_t *p)
+{
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+    ((uint32_t)p[2] << 8) | p[3];
+}
+/*---------------------------------------------------------------------------*/
+static void
+put32(uint8_t *p, uint32_t v)
+{
+  p[0] = v >> 24;
+  p[1] = v >> 16;
+  p[2] = v >> 8;
+  p[3] = v;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_segment(uint8_t flags, uint32_t ack)
+{
+  int optlen = (flags & TCP_SYN) ? MSS_OPTION_LEN : 0;
+
+  memset(uip_buf, 0, UIP_LLH_LEN + UIP_IPTCPH_LEN + optlen);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->len[1] = UIP_TCPH_LEN + optlen;
+  UIP_IP_BUF->proto = UIP_PROTO_TCP;
+  UIP_IP_BUF->ttl = 64;
+  uip_ipaddr_copy(&UIP_IP_BUF->srcipaddr, &peer_addr);
+  uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &local_addr);
+
+  UIP_TCP_BUF->srcport = UIP_HTONS(peer_port);
+  UIP_TCP_BUF->destport = UIP_HTONS(local_port);
+  put32(UIP_TCP_BUF->seqno, snd_nxt);
+  if(flags & (TCP_SYN | TCP_FIN)) {
+    snd_nxt++;
+    fin_sent = flags & TCP_FIN;
+  }
+  put32(UIP_TCP_BUF->ackno, ack);
+  UIP_TCP_BUF->tcpoffset = ((UIP_TCPH_LEN + optlen) / 4) << 4;
+  UIP_TCP_BUF->flags = flags;
+  UIP_TCP_BUF->wnd[0] = TCP_PEER_WINDOW >> 8;
+  UIP_TCP_BUF->wnd[1] = TCP_PEER_WINDOW & 0xff;
+  if(optlen > 0) {
+    /* Without an MSS option, uIP keeps the MSS of the previous
+       connection in the slot. */
+    UIP_TCP_BUF->optdata[0] = 2;
+    UIP_TCP_BUF->optdata[1] = MSS_OPTION_LEN;
+    UIP_TCP_BUF->optdata[2] = 1220 >> 8;
+    UIP_TCP_BUF->optdata[3] = 1220 & 0xff;
+  }
+
+  uip_len = UIP_IPTCPH_LEN + optlen;
+  uip_ext_len = 0;
+  UIP_TCP_BUF->tcpchksum = 0;
+  UIP_TCP_BUF->tcpchksum = ~(uip_tcpchksum());
+  tcpip_input();
+}
+/*---------------------------------------------------------------------------*/
+static void
+reply_timeout(void *ptr)
+{
+  struct reply r;
+
+  while(reply_count > 0 && replies[reply_head].due <= clock_time()) {
+    r = replies[reply_head];
+    reply_head = (reply_head + 1) % MAX_REPLIES;
+    reply_count--;
+    send_segment(r.flags, r.ack);
+  }
+  if(reply_count > 0) {
+    ctimer_set(&reply_timer, replies[reply_head].due - clock_time(),
+               reply_timeout, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+reply(uint8_t flags)
+{
+  struct reply *r;
+
+  if(reply_count == MAX_REPLIES) {
+    return;
+  }
+  r = &replies[(reply_head + reply_count) % MAX_REPLIES];
+  r->due = clock_time() + TCP_PEER_RTT;
+  r->ack = rcv_nxt;
+  r->flags = flags;
+  if(reply_count++ == 0) {
+    ctimer_set(&reply_timer, TCP_PEER_RTT, reply_timeout, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+receive(uint32_t seq, const uint8_t *data, uint16_t len, uint8_t fin)
+{
+  uint32_t offset = seq - rcv_isn - 1;
+  uint16_t i;
+
+  if(offset + len > TCP_PEER_MAX_BYTES) {
+    stats.errors++;
+    return;
+  }
+  for(i = 0; i < len; i++) {
+    if(have[offset + i]) {
+      stats.duplicates++;
+      break;
+    }
+  }
+  memcpy(&stream[offset], data, len);
+  memset(&have[offset], 1, len);
+
+  /* Advance over everything received in order */
+  offset = rcv_nxt - rcv_isn - 1;
+  while(offset < TCP_PEER_MAX_BYTES && have[offset]) {
+    if(stream[offset] != TCP_PEER_PATTERN(offset)) {
+      stats.errors++;
+    }
+    offset++;
+    stats.bytes++;
+  }
+  rcv_nxt = rcv_isn + 1 + offset;
+
+  if(fin && seq + len == rcv_nxt) {
+    rcv_nxt++;
+    reply(TCP_FIN | TCP_ACK);
+  } else {
+    reply(TCP_ACK);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+output(const uip_lladdr_t *lladdr)
+{
+  uint16_t hdrlen;
+  uint16_t len;
+  uint8_t flags;
+
+  if(UIP_IP_BUF->proto != UIP_PROTO_TCP ||
+     !uip_ipaddr_cmp(&UIP_IP_BUF->destipaddr, &peer_addr) ||
+     UIP_TCP_BUF->destport != UIP_HTONS(peer_port)) {
+    return 0;
+  }
+
+  flags = UIP_TCP_BUF->flags;
+  hdrlen = (UIP_TCP_BUF->tcpoffset >> 4) * 4;
+  len = ((UIP_IP_BUF->len[0] << 8) | UIP_IP_BUF->len[1]) - hdrlen;
+
+  if(flags & TCP_RST) {
+    stats.errors++;
+    stats.closed = 1;
+    return 0;
+  }
+  if(flags & TCP_SYN) {
+    rcv_isn = get32(UIP_TCP_BUF->seqno);
+    rcv_nxt = rcv_isn + 1;
+    reply(TCP_ACK);
+    return 0;
+  }
+  if(fin_sent && get32(UIP_TCP_BUF->ackno) == snd_nxt) {
+    stats.closed = 1;
+  }
+  if(len == 0 && !(flags & TCP_FIN)) {
+    return 0;
+  }
+
+  stats.segments++;
+  if(len > 0 && drop_every > 0 && ++data_segments % drop_every == 0) {
+    stats.dropped++;
+    return 0;
+  }
+  receive(get32(UIP_TCP_BUF->seqno), &uip_buf[UIP_LLH_LEN + UIP_IPH_LEN + hdrlen],
+          len, flags & TCP_FIN);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+tcp_peer_init(void)
+{
+  uip_ip6addr(&peer_addr, 0xfe80, 0, 0, 0, 0, 0, 0, 2);
+  uip_ipaddr_copy(&local_addr, &uip_ds6_get_link_local(-1)->ipaddr);
+  uip_ds6_nbr_add(&peer_addr, &peer_lladdr, 0, NBR_REACHABLE,
+                  NBR_TABLE_REASON_UNDEFINED, NULL);
+  tcpip_set_outputfunc(output);
+}
+/*---------------------------------------------------------------------------*/
+void
+tcp_peer_connect(uint16_t port, int drop)
+{
+  memset(&stats, 0, sizeof(stats));
+  memset(have, 0, sizeof(have));
+  drop_every = drop;
+  data_segments = 0;
+  fin_sent = 0;
+  local_port = port;
+  peer_port++;
+  snd_nxt = (uint32_t)peer_port << 16;
+  send_segment(TCP_SYN, 0);
+}
+/*---------------------------------------------------------------------------*/
+void
+tcp_peer_get_stats(struct tcp_peer_stats *s)
+{
+  memcpy(s, &stats, sizeof(stats));
+}
+/*---------------------------------------------------------------------------*/
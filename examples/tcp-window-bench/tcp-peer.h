@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+#ifndef TCP_PEER_H_
+#define TCP_PEER_H_
+
+/* Simulated round-trip time to the peer */
+#ifdef TCP_PEER_CONF_RTT
+#define TCP_PEER_RTT TCP_PEER_CONF_RTT
+#else
+#define TCP_PEER_RTT (CLOCK_SECOND / 50)
+#endif
+
+/* Window advertised by the peer */
+#ifdef TCP_PEER_CONF_WINDOW
+#define TCP_PEER_WINDOW TCP_PEER_CONF_WINDOW
+#else
+#define TCP_PEER_WINDOW 1024
+#endif
+
+/* Largest stream the peer can reassemble */
+#define TCP_PEER_MAX_BYTES 8192
+
+/* The byte the peer expects at a given stream offset */
+#define TCP_PEER_PATTERN(offset) ((uint8_t)((offset) % 251))
+
+struct tcp_peer_stats {
+  unsigned long segments;
+  unsigned long dropped;
+  unsigned long duplicates;
+  unsigned long bytes;
+  unsigned long errors;
+  int closed;
+};
+
+void tcp_peer_init(void);
+void tcp_peer_connect(uint16_t port, int drop_every);
+void tcp_peer_get_stats(struct tcp_peer_stats *s);
+
+#endif /* TCP_PEER_H_ */
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Bulk transfer benchmark for the uIP TCP send window
+ */
+
+#include "contiki.h"
+#include "net/ip/tcp-socket.h"
+#include "tcp-peer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PORT          80
+#define TOTAL_BYTES   TCP_PEER_MAX_BYTES
+
+static struct tcp_socket sock;
+static uint8_t inbuf[64];
+static uint8_t outbuf[512];
+static struct etimer et;
+
+static uint32_t queued;
+static unsigned long errors;
+
+/* Every drop_every:th data segment is lost, 0 for none */
+static const int drops[] = { 0, 32 };
+
+PROCESS(tcp_window_bench_process, "TCP send window benchmark");
+AUTOSTART_PROCESSES(&tcp_window_bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+fill(struct tcp_socket *s)
+{
+  uint8_t chunk[64];
+  int len;
+  int i;
+
+  while(queued < TOTAL_BYTES) {
+    len = MIN(sizeof(chunk), TOTAL_BYTES - queued);
+    for(i = 0; i < len; i++) {
+      chunk[i] = TCP_PEER_PATTERN(queued + i);
+    }
+    len = tcp_socket_send(s, chunk, len);
+    if(len <= 0) {
+      return;
+    }
+    queued += len;
+  }
+  tcp_socket_close(s);
+}
+/*---------------------------------------------------------------------------*/
+static int
+input(struct tcp_socket *s, void *ptr, const uint8_t *data, int len)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+event(struct tcp_socket *s, void *ptr, tcp_socket_event_t ev)
+{
+  if(ev == TCP_SOCKET_CONNECTED || ev == TCP_SOCKET_DATA_SENT) {
+    fill(s);
+  } else if(ev == TCP_SOCKET_TIMEDOUT || ev == TCP_SOCKET_ABORTED) {
+    errors++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+report(int drop, clock_time_t start)
+{
+  struct tcp_peer_stats stats;
+  clock_time_t elapsed = clock_time() - start;
+
+  tcp_peer_get_stats(&stats);
+  printf("Loss 1/%-2d: %lu bytes in %5lu ms, %4lu segments, %2lu dropped",
+         drop, stats.bytes, (unsigned long)(elapsed * 1000 / CLOCK_SECOND),
+         stats.segments, stats.dropped);
+  if(elapsed > 0) {
+    printf(" (%lu bytes/s)",
+           (unsigned long)(stats.bytes * CLOCK_SECOND / elapsed));
+  }
+  printf("\n");
+  if(stats.bytes != TOTAL_BYTES) {
+    errors++;
+  }
+  errors += stats.errors;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(tcp_window_bench_process, ev, data)
+{
+  static int run;
+  static clock_time_t start;
+  static struct tcp_peer_stats stats;
+
+  PROCESS_BEGIN();
+
+  printf("Send window %d bytes, MSS %d, RTT %lu ms\n",
+         UIP_TCP_SEND_WINDOW, UIP_TCP_MSS,
+         (unsigned long)(TCP_PEER_RTT * 1000 / CLOCK_SECOND));
+
+  tcp_peer_init();
+  tcp_socket_register(&sock, NULL, inbuf, sizeof(inbuf),
+                      outbuf, sizeof(outbuf), input, event);
+  tcp_socket_listen(&sock, PORT);
+
+  for(run = 0; run < sizeof(drops) / sizeof(drops[0]); run++) {
+    queued = 0;
+    start = clock_time();
+    tcp_peer_connect(PORT, drops[run]);
+
+    /* The transfer runs from uIP callbacks; the timer catches the end. */
+    etimer_set(&et, CLOCK_SECOND / 100);
+    do {
+      PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+      etimer_restart(&et);
+      tcp_peer_get_stats(&stats);
+    } while(!stats.closed);
+    etimer_stop(&et);
+    report(drops[run], start);
+  }
+
+  printf("%lu errors\n", errors);
+  exit(errors == 0 ? 0 : 1);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
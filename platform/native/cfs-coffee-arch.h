@@ -56,6 +56,11 @@
 #define COFFEE_LOG_TABLE_LIMIT		256
 #define COFFEE_MICRO_LOGS		0
 #define COFFEE_IO_SEMANTICS		1
+#ifdef COFFEE_CONF_INDEX_SIZE
+#define COFFEE_INDEX_SIZE		COFFEE_CONF_INDEX_SIZE
+#else
+#define COFFEE_INDEX_SIZE		128
+#endif
 
 #define COFFEE_WRITE(buf, size, offset)				\
 		xmem_pwrite((char *)(buf), (size), COFFEE_START + (offset))
@@ -66,12 +71,18 @@
 #define COFFEE_ERASE(sector)					\
   		xmem_erase(COFFEE_SECTOR_SIZE, COFFEE_START + (sector) * COFFEE_SECTOR_SIZE)
 
+#define COFFEE_MAP(offset)					\
+		xmem_map(COFFEE_START + (offset))
+
 #define READ_HEADER(hdr, page)						\
   COFFEE_READ((hdr), sizeof (*hdr), (page) * COFFEE_PAGE_SIZE)
 
 #define WRITE_HEADER(hdr, page)						\
   COFFEE_WRITE((hdr), sizeof (*hdr), (page) * COFFEE_PAGE_SIZE)
 
+/* The native xmem is an array in RAM. */
+void *xmem_map(unsigned long offset);
+
 /* Coffee types. */
 typedef int16_t coffee_page_t;
 
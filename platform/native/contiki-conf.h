@@ -53,6 +53,18 @@ int select_set_callback(int fd, const struct select_callback *callback);
 #define EEPROM_CONF_SIZE				1024
 #endif
 
+#ifndef REST_ENGINE_CONF_INDEX_SIZE
+#define REST_ENGINE_CONF_INDEX_SIZE    512
+#endif /* REST_ENGINE_CONF_INDEX_SIZE */
+
+#ifndef COAP_TRANSACTION_INDEX
+#define COAP_TRANSACTION_INDEX         1
+#endif /* COAP_TRANSACTION_INDEX */
+
+#ifndef LWM2M_ENGINE_CONF_INDEX_SIZE
+#define LWM2M_ENGINE_CONF_INDEX_SIZE   1024
+#endif /* LWM2M_ENGINE_CONF_INDEX_SIZE */
+
 #define CCIF
 #define CLIF
 
@@ -143,6 +155,9 @@ typedef unsigned short uip_stats_t;
 #define UIP_CONF_DHCP_LIGHT
 #define UIP_CONF_RECEIVE_WINDOW  48
 #define UIP_CONF_TCP_MSS         48
+#ifndef UIP_CONF_TCP_SEND_WINDOW
+#define UIP_CONF_TCP_SEND_WINDOW (8 * UIP_CONF_TCP_MSS)
+#endif /* UIP_CONF_TCP_SEND_WINDOW */
 #define UIP_CONF_UDP_CONNS       12
 #define UIP_CONF_FWCACHE_SIZE    30
 #define UIP_CONF_BROADCAST       1
@@ -270,4 +285,39 @@ int strcasecmp(const char*, const char*);
 #include PROJECT_CONF_H
 #endif /* PROJECT_CONF_H */
 
+/* Run the main loop on epoll instead of select() (Linux only). Each
+   file descriptor is registered with the kernel once, when its
+   callback is set, and updated only when the interest reported by its
+   set_fd callback changes. The loop sleeps until the next etimer
+   expires instead of waking up every millisecond. A process_poll()
+   from a signal handler wakes the loop through an eventfd. */
+#ifndef SELECT_CONF_EPOLL
+#define SELECT_CONF_EPOLL 0
+#endif /* SELECT_CONF_EPOLL */
+
+/* The longest time, in milliseconds, that the epoll loop sleeps when
+   no event timer is due earlier. This bounds the delay for select
+   callbacks that change their set_fd interest based on plain timers. */
+#ifndef SELECT_CONF_EPOLL_MAX_WAIT
+#define SELECT_CONF_EPOLL_MAX_WAIT 1000
+#endif /* SELECT_CONF_EPOLL_MAX_WAIT */
+
+#if SELECT_CONF_EPOLL
+void select_wakeup(void);
+#define PROCESS_CONF_POLL_HOOK() select_wakeup()
+#endif /* SELECT_CONF_EPOLL */
+
+/* Drive rtimers from a CLOCK_MONOTONIC timerfd instead of SIGALRM
+   (Linux only). Rtimer ticks are then microseconds in a 32-bit
+   rtimer_clock_t, and callbacks run from the main loop rather than
+   from a signal handler. */
+#ifndef RTIMER_CONF_TIMERFD
+#define RTIMER_CONF_TIMERFD 0
+#endif /* RTIMER_CONF_TIMERFD */
+
+#if RTIMER_CONF_TIMERFD
+typedef uint32_t rtimer_clock_t;
+#define RTIMER_CLOCK_DIFF(a, b)     ((int32_t)((a) - (b)))
+#endif /* RTIMER_CONF_TIMERFD */
+
 #endif /* CONTIKI_CONF_H_ */
@@ -43,11 +43,18 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/select.h>
 #include <errno.h>
 
+#if SELECT_CONF_EPOLL
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif /* SELECT_CONF_EPOLL */
+
 #ifdef __CYGWIN__
 #include "net/wpcap-drv.h"
 #endif /* __CYGWIN__ */
@@ -81,6 +88,25 @@
 static const struct select_callback *select_callback[SELECT_MAX];
 static int select_max = 0;
 
+#if SELECT_CONF_EPOLL
+static int epoll_fd = -1;
+static int wakeup_fd = -1;
+static volatile sig_atomic_t sleeping;
+
+/* The fds that have a callback, in the order they were set. Each of
+   them is added to the epoll instance once, when its callback is set. */
+static int epoll_fds[SELECT_MAX];
+static int epoll_nfds;
+/* The epoll events each fd is currently registered for. */
+static uint32_t epoll_registered[SELECT_MAX];
+/* Fds that epoll cannot watch, such as regular files, and that are
+   therefore always treated as ready, as select() would. */
+static fd_set epoll_always_ready;
+
+static void epoll_add(int fd);
+static void epoll_del(int fd);
+#endif /* SELECT_CONF_EPOLL */
+
 SENSORS(&pir_sensor, &vib_sensor, &button_sensor);
 
 static uint8_t serial_id[] = {0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08};
@@ -99,6 +125,13 @@ select_set_callback(int fd, const struct select_callback *callback)
       callback = NULL;
     }
 
+#if SELECT_CONF_EPOLL
+    if(callback != NULL && select_callback[fd] == NULL) {
+      epoll_add(fd);
+    } else if(callback == NULL && select_callback[fd] != NULL) {
+      epoll_del(fd);
+    }
+#endif /* SELECT_CONF_EPOLL */
     select_callback[fd] = callback;
 
     /* Update fd max */
@@ -120,6 +153,233 @@ select_set_callback(int fd, const struct select_callback *callback)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+#if SELECT_CONF_EPOLL
+void
+select_wakeup(void)
+{
+  uint64_t one = 1;
+
+  /* Only a sleeping loop needs to be woken up. write() is
+     async-signal-safe, so this may be called from a signal handler. */
+  if(sleeping && wakeup_fd >= 0) {
+    if(write(wakeup_fd, &one, sizeof(one)) < 0) {
+      /* The counter is already non-zero, so the loop will wake up. */
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+epoll_init(void)
+{
+  struct epoll_event ev;
+
+  epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if(epoll_fd < 0) {
+    perror("epoll_create1");
+    exit(1);
+  }
+  wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if(wakeup_fd < 0) {
+    perror("eventfd");
+    exit(1);
+  }
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.fd = -1;
+  if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wakeup_fd, &ev) < 0) {
+    perror("epoll_ctl");
+    exit(1);
+  }
+  FD_ZERO(&epoll_always_ready);
+}
+/*---------------------------------------------------------------------------*/
+static int
+epoll_register(int op, int fd, uint32_t events)
+{
+  struct epoll_event ev;
+
+  /* An fd without interest stays registered, edge-triggered, so that
+     an error or hang-up on it is reported at most once. */
+  memset(&ev, 0, sizeof(ev));
+  ev.events = events != 0 ? events : EPOLLET;
+  ev.data.fd = fd;
+  return epoll_ctl(epoll_fd, op, fd, &ev);
+}
+/*---------------------------------------------------------------------------*/
+static void
+epoll_add(int fd)
+{
+  if(epoll_fd < 0) {
+    epoll_init();
+  }
+
+  epoll_registered[fd] = 0;
+  if(epoll_register(EPOLL_CTL_ADD, fd, 0) < 0) {
+    if(errno == EPERM) {
+      FD_SET(fd, &epoll_always_ready);
+    } else {
+      perror("epoll_ctl");
+    }
+  }
+  epoll_fds[epoll_nfds++] = fd;
+}
+/*---------------------------------------------------------------------------*/
+static void
+epoll_del(int fd)
+{
+  struct epoll_event ev;
+  int i;
+
+  /* Fails harmlessly if the fd has already been closed. */
+  memset(&ev, 0, sizeof(ev));
+  epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, &ev);
+  FD_CLR(fd, &epoll_always_ready);
+  epoll_registered[fd] = 0;
+
+  for(i = 0; i < epoll_nfds; i++) {
+    if(epoll_fds[i] == fd) {
+      memmove(&epoll_fds[i], &epoll_fds[i + 1],
+              (epoll_nfds - i - 1) * sizeof(epoll_fds[0]));
+      epoll_nfds--;
+      break;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+epoll_update(int fd, uint32_t events)
+{
+  int ret;
+
+  if(events == epoll_registered[fd] || FD_ISSET(fd, &epoll_always_ready)) {
+    epoll_registered[fd] = events;
+    return;
+  }
+
+  ret = epoll_register(EPOLL_CTL_MOD, fd, events);
+  if(ret < 0 && errno == ENOENT) {
+    /* The fd was closed and reopened behind our back. */
+    ret = epoll_register(EPOLL_CTL_ADD, fd, events);
+  }
+  if(ret < 0) {
+    perror("epoll_ctl");
+  }
+  epoll_registered[fd] = events;
+}
+/*---------------------------------------------------------------------------*/
+static void
+epoll_wait_and_handle(int pending)
+{
+  struct epoll_event events[SELECT_MAX + 1];
+  fd_set fdr, fdw, wantr, wantw;
+  clock_time_t now, next;
+  uint32_t interest;
+  uint64_t count;
+  int timeout;
+  int always;
+  int i, n, fd;
+
+  /* Collect the interest of each callback and update the kernel's
+     copy of it only where it has changed. */
+  FD_ZERO(&wantr);
+  FD_ZERO(&wantw);
+  always = 0;
+  for(i = 0; i < epoll_nfds; i++) {
+    fd = epoll_fds[i];
+    interest = 0;
+    if(select_callback[fd]->set_fd(&wantr, &wantw)) {
+      if(FD_ISSET(fd, &wantr)) {
+        interest |= EPOLLIN;
+      }
+      if(FD_ISSET(fd, &wantw)) {
+        interest |= EPOLLOUT;
+      }
+    }
+    epoll_update(fd, interest);
+    if(interest != 0 && FD_ISSET(fd, &epoll_always_ready)) {
+      always = 1;
+    }
+  }
+
+  /* Sleep until the next event timer is due, unless there is already
+     work to do. */
+  if(pending || always) {
+    timeout = 0;
+  } else if(etimer_pending()) {
+    now = clock_time();
+    next = etimer_next_expiration_time();
+    if((long)(next - now) <= 0) {
+      timeout = 0;
+    } else {
+      timeout = (next - now) * 1000 / CLOCK_SECOND;
+      if(timeout > SELECT_CONF_EPOLL_MAX_WAIT) {
+        timeout = SELECT_CONF_EPOLL_MAX_WAIT;
+      }
+    }
+  } else {
+    timeout = SELECT_CONF_EPOLL_MAX_WAIT;
+  }
+
+  sleeping = 1;
+  /* A poll may have been requested after process_run() returned. */
+  if(process_nevents() > 0) {
+    timeout = 0;
+  }
+  n = epoll_wait(epoll_fd, events, SELECT_MAX + 1, timeout);
+  sleeping = 0;
+
+  if(n < 0) {
+    if(errno != EINTR) {
+      perror("epoll_wait");
+    }
+    return;
+  }
+
+  FD_ZERO(&fdr);
+  FD_ZERO(&fdw);
+  for(i = 0; i < n; i++) {
+    fd = events[i].data.fd;
+    if(fd < 0) {
+      /* Drain the wakeup counter. */
+      if(read(wakeup_fd, &count, sizeof(count)) < 0) {
+        /* Nothing to drain. */
+      }
+      continue;
+    }
+    if(events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+      FD_SET(fd, &fdr);
+    }
+    if(events[i].events & (EPOLLOUT | EPOLLERR)) {
+      FD_SET(fd, &fdw);
+    }
+  }
+  if(always) {
+    for(i = 0; i < epoll_nfds; i++) {
+      fd = epoll_fds[i];
+      if(FD_ISSET(fd, &epoll_always_ready)) {
+        if(FD_ISSET(fd, &wantr)) {
+          FD_SET(fd, &fdr);
+        }
+        if(FD_ISSET(fd, &wantw)) {
+          FD_SET(fd, &fdw);
+        }
+        events[n].data.fd = fd;
+        n++;
+      }
+    }
+  }
+
+  /* Only the fds that are ready are handed to their callback. A
+     callback may remove another one, or itself, on the way. */
+  for(i = 0; i < n; i++) {
+    fd = events[i].data.fd;
+    if(fd >= 0 && select_callback[fd] != NULL && epoll_registered[fd] != 0) {
+      select_callback[fd]->handle_fd(&fdr, &fdw);
+    }
+  }
+}
+#endif /* SELECT_CONF_EPOLL */
+/*---------------------------------------------------------------------------*/
 static int
 stdin_set_fd(fd_set *rset, fd_set *wset)
 {
@@ -250,6 +510,22 @@ main(int argc, char **argv)
   setvbuf(stdout, (char *)NULL, _IONBF, 0);
 
   select_set_callback(STDIN_FILENO, &stdin_fd);
+#if SELECT_CONF_EPOLL
+  if(epoll_fd < 0) {
+    epoll_init();
+  }
+  while(1) {
+    epoll_wait_and_handle(process_run());
+
+    etimer_request_poll();
+
+#if WITH_GUI
+    if(console_resize()) {
+       ctk_restore();
+    }
+#endif /* WITH_GUI */
+  }
+#else /* SELECT_CONF_EPOLL */
   while(1) {
     fd_set fdr;
     fd_set fdw;
@@ -294,6 +570,7 @@ main(int argc, char **argv)
     }
 #endif /* WITH_GUI */
   }
+#endif /* SELECT_CONF_EPOLL */
 
   return 0;
 }
@@ -79,6 +79,12 @@ xmem_erase(long nbytes, unsigned long offset)
   return nbytes;
 }
 /*---------------------------------------------------------------------------*/
+void *
+xmem_map(unsigned long offset)
+{
+  return &xmem[offset];
+}
+/*---------------------------------------------------------------------------*/
 void
 xmem_init(void)
 {
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Regression test for the pairing-heap event timers: timers
+ *         expire in order, stopped timers never expire, and the
+ *         timers of a process that exits are removed from the heap.
+ */
+
+#include "contiki.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define NTIMERS 24
+#define NOWNED  16
+
+PROCESS(test_process, "Etimer heap test");
+PROCESS(owner_process, "Timer owner");
+AUTOSTART_PROCESSES(&test_process);
+
+static struct etimer timers[NTIMERS];
+static struct etimer owned[NOWNED];
+static int errors;
+
+#define CHECK(cond) do {                                     \
+    if(!(cond)) {                                            \
+      printf("FAIL line %d: %s\n", __LINE__, #cond);         \
+      errors++;                                              \
+    }                                                        \
+  } while(0)
+
+/* Wrap-around safe a <= b. */
+#define NOT_AFTER(a, b) ((clock_time_t)((b) - (a)) < \
+                         ((clock_time_t)1 << (sizeof(clock_time_t) * 8 - 1)))
+/*---------------------------------------------------------------------------*/
+static clock_time_t
+random_interval(void)
+{
+  /* Few distinct values, so that many timers expire together. */
+  return 1 + (random_rand() % 32) * (CLOCK_SECOND / 32);
+}
+/*---------------------------------------------------------------------------*/
+static int
+earliest_pending(clock_time_t *t)
+{
+  int i, found;
+
+  found = 0;
+  for(i = 0; i < NTIMERS; i++) {
+    if(!etimer_expired(&timers[i]) &&
+       (!found || NOT_AFTER(etimer_expiration_time(&timers[i]), *t))) {
+      *t = etimer_expiration_time(&timers[i]);
+      found = 1;
+    }
+  }
+  return found;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(owner_process, ev, data)
+{
+  int i;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < NOWNED; i++) {
+    etimer_set(&owned[i], random_interval());
+  }
+  while(1) {
+    PROCESS_WAIT_EVENT();
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  static int i, pending, fired, round;
+  static clock_time_t last, next;
+
+  PROCESS_BEGIN();
+
+  random_init(1);
+
+  for(round = 0; round < 4; round++) {
+    /* Set all timers, then stop or set again some of them. */
+    for(i = 0; i < NTIMERS; i++) {
+      etimer_set(&timers[i], random_interval());
+    }
+    if(round & 1) {
+      process_start(&owner_process, NULL);
+    }
+    for(i = 0; i < NTIMERS; i++) {
+      switch(random_rand() % 4) {
+      case 0:
+        etimer_stop(&timers[i]);
+        break;
+      case 1:
+        etimer_set(&timers[i], random_interval());
+        break;
+      }
+    }
+
+    pending = 0;
+    for(i = 0; i < NTIMERS; i++) {
+      pending += !etimer_expired(&timers[i]);
+    }
+    if(earliest_pending(&next)) {
+      CHECK(NOT_AFTER(etimer_next_expiration_time(), next));
+    }
+
+    last = clock_time() - 1;
+    fired = 0;
+    while(fired < pending) {
+      PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER);
+      i = (struct etimer *)data - timers;
+      CHECK(i >= 0 && i < NTIMERS);
+      CHECK(etimer_expired(data));
+      CHECK(NOT_AFTER(last, etimer_expiration_time(data)));
+      CHECK(timer_expired(&((struct etimer *)data)->timer));
+      last = etimer_expiration_time(data);
+      fired++;
+
+      if(fired == (pending + 1) / 2 && process_is_running(&owner_process)) {
+        /* The heap has been reshaped by the expiries so far. Remove
+           the owner and trash its timers, as if its memory had been
+           reused, so that any timer left behind corrupts the heap. */
+        process_exit(&owner_process);
+        for(i = 0; i < NOWNED; i++) {
+          CHECK(etimer_expired(&owned[i]));
+        }
+        memset(owned, 0xa5, sizeof(owned));
+        if(earliest_pending(&next)) {
+          CHECK(NOT_AFTER(etimer_next_expiration_time(), next));
+        }
+      }
+    }
+    CHECK(!process_is_running(&owner_process));
+    CHECK(!earliest_pending(&next));
+  }
+
+  printf("Etimer heap test done, %d errors\n", errors);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
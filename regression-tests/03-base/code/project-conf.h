@@ -0,0 +1,9 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+/* Test the pairing-heap event timers. */
+#ifndef ETIMER_CONF_HEAP
+#define ETIMER_CONF_HEAP 1
+#endif
+
+#endif /* PROJECT_CONF_H_ */
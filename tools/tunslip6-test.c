@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2026, agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/*
+ * Test of the SLIP encoder and decoder of tunslip6. Packets are read
+ * from a socket pair standing in for the tun device, encoded into a
+ * pipe standing in for the serial line, decoded from it in reads of
+ * random sizes and written to another socket pair, where they must
+ * arrive unchanged. tunslip6.c is linked in with its main() renamed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+
+#define NUM_PACKETS  20000
+#define MAX_PACKET   1500
+#define LARGE_PACKET 2500
+
+extern int verbose, flowcontrol_xonxoff;
+extern unsigned char slip_buf[];
+extern int slip_end, slip_begin;
+
+int tun_to_serial(int infd, int outfd);
+void serial_to_tun(int infd, int outfd);
+void write_to_serial(int outfd, void *inbuf, int len);
+void slip_flushbuf(int fd);
+
+static int errors;
+static int tun[2], serial[2], out[2];
+static unsigned char packets[8][LARGE_PACKET];
+static int lengths[8];
+/*---------------------------------------------------------------------------*/
+/* A packet tunslip6 writes to tun: not a command or a printable line */
+static void
+make_packet(unsigned char *p, int len)
+{
+  static const unsigned char special[] = { 0300, 0333, 17, 19 };
+  int i;
+
+  p[0] = 0x60;
+  p[1] = 0x80;
+  for(i = 2; i < len; i++) {
+    switch(rand() % 4) {
+    case 0:
+      p[i] = special[rand() % sizeof(special)];
+      break;
+    case 1:
+      p[i] = rand();
+      break;
+    default:
+      p[i] = 'a';
+      break;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Decodes the serial line in reads of random sizes until it is empty */
+static void
+decode(void)
+{
+  /* The pipe holds 64 kB, more than a queue of encoded packets */
+  static unsigned char buf[65536];
+  int n, k, pos;
+
+  fcntl(serial[0], F_SETFL, O_NONBLOCK);
+  n = read(serial[0], buf, sizeof(buf));
+  if(n <= 0) {
+    return;
+  }
+  fcntl(serial[0], F_SETFL, 0);
+  for(pos = 0; pos < n; pos += k) {
+    k = rand() % 2 ? 16 : 4096;
+    k = 1 + rand() % k;
+    if(k > n - pos) {
+      k = n - pos;
+    }
+    if(write(serial[1], buf + pos, k) != k) {
+      errors++;
+    }
+    serial_to_tun(serial[0], out[0]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+check_received(int i)
+{
+  unsigned char buf[LARGE_PACKET];
+  int n;
+
+  n = read(out[1], buf, sizeof(buf));
+  if(n != lengths[i] || memcmp(buf, packets[i], n) != 0) {
+    if(errors++ < 10) {
+      printf("packet of %d bytes received as %d bytes\n", lengths[i], n);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  unsigned char buf[LARGE_PACKET];
+  int i, k, n, count, total;
+
+  verbose = 0;
+  if(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, tun) == -1 ||
+     socketpair(AF_UNIX, SOCK_SEQPACKET, 0, out) == -1 ||
+     pipe(serial) == -1) {
+    perror("tunslip6-test");
+    return 1;
+  }
+  fcntl(tun[0], F_SETFL, O_NONBLOCK);
+  fcntl(out[1], F_SETFL, O_NONBLOCK);
+
+  /* Batches of one to eight packets, with and without XON/XOFF
+     escaping */
+  srand(1);
+  total = 0;
+  for(i = 0; i < NUM_PACKETS; i += count) {
+    flowcontrol_xonxoff = (i / 1000) & 1;
+    count = 1 + rand() % 8;
+    for(k = 0; k < count; k++) {
+      lengths[k] = 2 + rand() % (MAX_PACKET - 1);
+      make_packet(packets[k], lengths[k]);
+      if(write(tun[1], packets[k], lengths[k]) != lengths[k]) {
+        errors++;
+      }
+    }
+    n = tun_to_serial(tun[0], serial[1]);
+    if(n != count) {
+      errors++;
+    }
+    slip_flushbuf(serial[1]);
+    if(slip_begin != 0 || slip_end != 0) {
+      errors++;
+    }
+    decode();
+    for(k = 0; k < count; k++) {
+      check_received(k);
+    }
+    if(read(out[1], buf, sizeof(buf)) != -1) {
+      errors++;
+    }
+    total += count;
+  }
+
+  /* A packet too large for the decoder is dropped, and the next one is
+     received */
+  lengths[0] = LARGE_PACKET;
+  make_packet(packets[0], lengths[0]);
+  lengths[1] = 100;
+  make_packet(packets[1], lengths[1]);
+  for(k = 0; k < 2; k++) {
+    write_to_serial(serial[1], packets[k], lengths[k]);
+  }
+  slip_flushbuf(serial[1]);
+  decode();
+  check_received(1);
+  if(read(out[1], buf, sizeof(buf)) != -1) {
+    errors++;
+  }
+
+  printf("%d packets, %d errors\n", total, errors);
+  return errors != 0;
+}
@@ -40,6 +40,8 @@
 #include <stdarg.h>
 #include <string.h>
 #include <time.h>
+#include <stdint.h>
+#include <sys/time.h>
 #include <sys/types.h>
 
 #include <unistd.h>
@@ -164,162 +166,270 @@ is_sensible_string(const unsigned char *s, int len)
   return 1;
 }
 
+/* Largest packet read from the tun device or from the serial line. */
+#define PACKET_SIZE   2000
+
+/* Worst case SLIP encoding of a packet: every byte escaped, plus the
+   trailing SLIP_END. */
+#define SLIP_MAX_ENCODED (2 * PACKET_SIZE + 1)
+
+/* Number of worst case packets the outbound SLIP queue holds. */
+#ifndef SLIP_QUEUE_PACKETS
+#define SLIP_QUEUE_PACKETS 8
+#endif
+
+/* Bytes read from the serial line per read() call. */
+#define SERIAL_READ_SIZE 4096
+
+struct stats {
+  unsigned long packets;
+  unsigned long bytes;
+  unsigned long dropped;
+};
+
+/* Serial to tun and tun to serial counters, in total and at the last
+   report. */
+struct stats stats_in, stats_out, last_in, last_out;
+int stats_interval = 0;
+struct timeval stats_time;
+
 /*
- * Read from serial, when we have a packet write it to tun. No output
- * buffering, input buffered by stdio.
+ * Word at a time search for the first byte that needs SLIP
+ * processing: SLIP_END and SLIP_ESC, plus XON and XOFF when they are
+ * escaped. Returns len if there is none.
  */
-void
-serial_to_tun(FILE *inslip, int outfd)
+#define ONES  0x0101010101010101ULL
+#define HIGHS 0x8080808080808080ULL
+#define HAS_BYTE(w, b) \
+  ((((w) ^ (ONES * (b))) - ONES) & ~((w) ^ (ONES * (b))) & HIGHS)
+
+static int
+is_special(unsigned char c, int xonxoff)
 {
-  static union {
-    unsigned char inbuf[2000];
-  } uip;
-  static int inbufptr = 0;
-  int ret,i;
-  unsigned char c;
+  return c == SLIP_END || c == SLIP_ESC ||
+    (xonxoff && (c == XON || c == XOFF));
+}
 
-#ifdef linux
-  ret = fread(&c, 1, 1, inslip);
-  if(ret == -1 || ret == 0) err(1, "serial_to_tun: read");
-  goto after_fread;
-#endif
+int
+slip_scan(const unsigned char *p, int len, int xonxoff)
+{
+  uint64_t w;
+  int i;
 
- read_more:
-  if(inbufptr >= sizeof(uip.inbuf)) {
-     if(timestamp) stamptime();
-     fprintf(stderr, "*** dropping large %d byte packet\n",inbufptr);
-	 inbufptr = 0;
-  }
-  ret = fread(&c, 1, 1, inslip);
-#ifdef linux
- after_fread:
-#endif
-  if(ret == -1) {
-    err(1, "serial_to_tun: read");
+  for(i = 0; i + 8 <= len; i += 8) {
+    memcpy(&w, p + i, 8);
+    if(HAS_BYTE(w, SLIP_END) || HAS_BYTE(w, SLIP_ESC) ||
+       (xonxoff && (HAS_BYTE(w, XON) || HAS_BYTE(w, XOFF)))) {
+      break;
+    }
   }
-  if(ret == 0) {
-    clearerr(inslip);
-    return;
+  for(; i < len; i++) {
+    if(is_special(p[i], xonxoff)) {
+      break;
+    }
   }
-  PROGRESS(".");
-  switch(c) {
-  case SLIP_END:
-    if(inbufptr > 0) {
-      if(uip.inbuf[0] == '!') {
-	if(uip.inbuf[1] == 'M') {
-	  /* Read gateway MAC address and autoconfigure tap0 interface */
-	  char macs[24];
-	  int i, pos;
-	  for(i = 0, pos = 0; i < 16; i++) {
-	    macs[pos++] = uip.inbuf[2 + i];
-	    if((i & 1) == 1 && i < 14) {
-	      macs[pos++] = ':';
-	    }
-	  }
-          if(timestamp) stamptime();
-	  macs[pos] = '\0';
-//	  printf("*** Gateway's MAC address: %s\n", macs);
-	  fprintf(stderr,"*** Gateway's MAC address: %s\n", macs);
-          if (timestamp) stamptime();
-	  ssystem("ifconfig %s down", tundev);
-          if (timestamp) stamptime();
-	  ssystem("ifconfig %s hw ether %s", tundev, &macs[6]);
-          if (timestamp) stamptime();
-	  ssystem("ifconfig %s up", tundev);
+  return i;
+}
+
+static unsigned char inbuf[PACKET_SIZE];
+static int inbufptr = 0;
+static int indrop = 0;
+
+/*
+ * Handle a complete packet from the serial line: either a command or
+ * debug output from the node, or an IP packet to write to tun.
+ */
+void
+serial_packet(int outfd)
+{
+  int i;
+
+  if(inbuf[0] == '!') {
+    if(inbuf[1] == 'M') {
+      /* Read gateway MAC address and autoconfigure tap0 interface */
+      char macs[24];
+      int i, pos;
+      for(i = 0, pos = 0; i < 16; i++) {
+	macs[pos++] = inbuf[2 + i];
+	if((i & 1) == 1 && i < 14) {
+	  macs[pos++] = ':';
 	}
-      } else if(uip.inbuf[0] == '?') {
-	if(uip.inbuf[1] == 'P') {
-          /* Prefix info requested */
-          struct in6_addr addr;
-	  int i;
-	  char *s = strchr(ipaddr, '/');
-	  if(s != NULL) {
-	    *s = '\0';
-	  }
-          inet_pton(AF_INET6, ipaddr, &addr);
-          if(timestamp) stamptime();
-          fprintf(stderr,"*** Address:%s => %02x%02x:%02x%02x:%02x%02x:%02x%02x\n",
-		 ipaddr,
-		 addr.s6_addr[0], addr.s6_addr[1],
-		 addr.s6_addr[2], addr.s6_addr[3],
-		 addr.s6_addr[4], addr.s6_addr[5],
-		 addr.s6_addr[6], addr.s6_addr[7]);
-	  slip_send(slipfd, '!');
-	  slip_send(slipfd, 'P');
-	  for(i = 0; i < 8; i++) {
-	    /* need to call the slip_send_char for stuffing */
-	    slip_send_char(slipfd, addr.s6_addr[i]);
-	  }
-	  slip_send(slipfd, SLIP_END);
-        }
+      }
+      if(timestamp) stamptime();
+      macs[pos] = '\0';
+//	  printf("*** Gateway's MAC address: %s\n", macs);
+      fprintf(stderr,"*** Gateway's MAC address: %s\n", macs);
+      if (timestamp) stamptime();
+      ssystem("ifconfig %s down", tundev);
+      if (timestamp) stamptime();
+      ssystem("ifconfig %s hw ether %s", tundev, &macs[6]);
+      if (timestamp) stamptime();
+      ssystem("ifconfig %s up", tundev);
+    }
+  } else if(inbuf[0] == '?') {
+    if(inbuf[1] == 'P') {
+      /* Prefix info requested */
+      struct in6_addr addr;
+      int i;
+      char *s = strchr(ipaddr, '/');
+      if(s != NULL) {
+	*s = '\0';
+      }
+      inet_pton(AF_INET6, ipaddr, &addr);
+      if(timestamp) stamptime();
+      fprintf(stderr,"*** Address:%s => %02x%02x:%02x%02x:%02x%02x:%02x%02x\n",
+	      ipaddr,
+	      addr.s6_addr[0], addr.s6_addr[1],
+	      addr.s6_addr[2], addr.s6_addr[3],
+	      addr.s6_addr[4], addr.s6_addr[5],
+	      addr.s6_addr[6], addr.s6_addr[7]);
+      slip_send(slipfd, '!');
+      slip_send(slipfd, 'P');
+      for(i = 0; i < 8; i++) {
+	/* need to call the slip_send_char for stuffing */
+	slip_send_char(slipfd, addr.s6_addr[i]);
+      }
+      slip_send(slipfd, SLIP_END);
+    }
 #define DEBUG_LINE_MARKER '\r'
-      } else if(uip.inbuf[0] == DEBUG_LINE_MARKER) {
-	fwrite(uip.inbuf + 1, inbufptr - 1, 1, stdout);
-      } else if(is_sensible_string(uip.inbuf, inbufptr)) {
-        if(verbose==1) {   /* strings already echoed below for verbose>1 */
-          if (timestamp) stamptime();
-          fwrite(uip.inbuf, inbufptr, 1, stdout);
-        }
-      } else {
-        if(verbose>2) {
-          if (timestamp) stamptime();
-          printf("Packet from SLIP of length %d - write TUN\n", inbufptr);
-          if (verbose>4) {
+  } else if(inbuf[0] == DEBUG_LINE_MARKER) {
+    fwrite(inbuf + 1, inbufptr - 1, 1, stdout);
+  } else if(is_sensible_string(inbuf, inbufptr)) {
+    if(verbose==1) {   /* strings already echoed below for verbose>1 */
+      if (timestamp) stamptime();
+      fwrite(inbuf, inbufptr, 1, stdout);
+    }
+  } else {
+    if(verbose>2) {
+      if (timestamp) stamptime();
+      printf("Packet from SLIP of length %d - write TUN\n", inbufptr);
+      if (verbose>4) {
 #if WIRESHARK_IMPORT_FORMAT
-            printf("0000");
-	        for(i = 0; i < inbufptr; i++) printf(" %02x",uip.inbuf[i]);
+	printf("0000");
+	for(i = 0; i < inbufptr; i++) printf(" %02x",inbuf[i]);
 #else
-            printf("         ");
-            for(i = 0; i < inbufptr; i++) {
-              printf("%02x", uip.inbuf[i]);
-              if((i & 3) == 3) printf(" ");
-              if((i & 15) == 15) printf("\n         ");
-            }
-#endif
-            printf("\n");
-          }
-        }
-	if(write(outfd, uip.inbuf, inbufptr) != inbufptr) {
-	  err(1, "serial_to_tun: write");
+	printf("         ");
+	for(i = 0; i < inbufptr; i++) {
+	  printf("%02x", inbuf[i]);
+	  if((i & 3) == 3) printf(" ");
+	  if((i & 15) == 15) printf("\n         ");
 	}
+#endif
+	printf("\n");
       }
-      inbufptr = 0;
     }
-    break;
-
-  case SLIP_ESC:
-    if(fread(&c, 1, 1, inslip) != 1) {
-      clearerr(inslip);
-      /* Put ESC back and give up! */
-      ungetc(SLIP_ESC, inslip);
-      return;
+    if(write(outfd, inbuf, inbufptr) != inbufptr) {
+      /* The kernel rejects malformed packets; count them rather than
+	 giving up on the serial line. */
+      if(verbose > 0) {
+	if(timestamp) stamptime();
+	fprintf(stderr, "*** serial_to_tun: write: %s\n", strerror(errno));
+      }
+      stats_in.dropped++;
+    } else {
+      stats_in.packets++;
+      stats_in.bytes += inbufptr;
     }
+  }
+}
 
-    switch(c) {
-    case SLIP_ESC_END:
-      c = SLIP_END;
-      break;
-    case SLIP_ESC_ESC:
-      c = SLIP_ESC;
-      break;
-    case SLIP_ESC_XON:
-      c = XON;
-      break;
-    case SLIP_ESC_XOFF:
-      c = XOFF;
-      break;
+/*
+ * Add n decoded bytes to the packet being received. Oversized packets
+ * are discarded up to the next SLIP_END.
+ */
+void
+serial_store(const unsigned char *p, int n)
+{
+  if(indrop) {
+    return;
+  }
+  if(inbufptr + n > sizeof(inbuf)) {
+    if(timestamp) stamptime();
+    fprintf(stderr, "*** dropping large %d byte packet\n", inbufptr + n);
+    stats_in.dropped++;
+    inbufptr = 0;
+    indrop = 1;
+    return;
+  }
+  memcpy(&inbuf[inbufptr], p, n);
+  inbufptr += n;
+}
+
+/*
+ * Read from serial, when we have a packet write it to tun. The serial
+ * line is read in bulk and runs of bytes that need no SLIP processing
+ * are copied as a whole.
+ */
+void
+serial_to_tun(int infd, int outfd)
+{
+  static int esc = 0;
+  unsigned char buf[SERIAL_READ_SIZE];
+  unsigned char c;
+  int ret, i, n;
+
+  ret = read(infd, buf, sizeof(buf));
+  if(ret == -1 && (errno == EAGAIN || errno == EINTR)) {
+    return;
+  }
+#ifdef linux
+  /* select() said the line is readable, so nothing to read is EOF. */
+  if(ret == 0) {
+    err(1, "serial_to_tun: read");
+  }
+#endif
+  if(ret == -1) {
+    err(1, "serial_to_tun: read");
+  }
+  PROGRESS(".");
+
+  for(i = 0; i < ret; ) {
+    c = buf[i];
+    if(esc) {
+      esc = 0;
+      switch(c) {
+      case SLIP_ESC_END:
+	c = SLIP_END;
+	break;
+      case SLIP_ESC_ESC:
+	c = SLIP_ESC;
+	break;
+      case SLIP_ESC_XON:
+	c = XON;
+	break;
+      case SLIP_ESC_XOFF:
+	c = XOFF;
+	break;
+      }
+    } else if(c == SLIP_END) {
+      if(inbufptr > 0 && !indrop) {
+	serial_packet(outfd);
+      }
+      inbufptr = 0;
+      indrop = 0;
+      i++;
+      continue;
+    } else if(c == SLIP_ESC) {
+      esc = 1;
+      i++;
+      continue;
+    } else if(verbose < 2) {
+      /* Copy the run up to the next SLIP_END or SLIP_ESC. */
+      n = slip_scan(&buf[i], ret - i, 0);
+      serial_store(&buf[i], n);
+      i += n;
+      continue;
     }
-    /* FALLTHROUGH */
-  default:
-    uip.inbuf[inbufptr++] = c;
+    i++;
+    serial_store(&c, 1);
 
     /* Echo lines as they are received for verbose=2,3,5+ */
     /* Echo all printable characters for verbose==4 */
     if((verbose==2) || (verbose==3) || (verbose>4)) {
       if(c=='\n') {
-        if(is_sensible_string(uip.inbuf, inbufptr)) {
+        if(is_sensible_string(inbuf, inbufptr)) {
           if (timestamp) stamptime();
-          fwrite(uip.inbuf, inbufptr, 1, stdout);
+          fwrite(inbuf, inbufptr, 1, stdout);
           inbufptr=0;
         }
       }
@@ -329,14 +439,10 @@ serial_to_tun(FILE *inslip, int outfd)
         if(c=='\n') if(timestamp) stamptime();
       }
     }
-
-    break;
   }
-
-  goto read_more;
 }
 
-unsigned char slip_buf[2000];
+unsigned char slip_buf[SLIP_QUEUE_PACKETS * SLIP_MAX_ENCODED];
 int slip_end, slip_begin;
 
 void
@@ -383,12 +489,37 @@ slip_send(int fd, unsigned char c)
   slip_end++;
 }
 
+void
+slip_send_buf(int fd, const unsigned char *p, int len)
+{
+  if(slip_end + len > sizeof(slip_buf)) {
+    err(1, "slip_send overflow");
+  }
+  memcpy(&slip_buf[slip_end], p, len);
+  slip_end += len;
+}
+
 int
 slip_empty()
 {
   return slip_end == 0;
 }
 
+/*
+ * Room left in the outbound queue, after moving the unsent bytes to
+ * the front of the buffer if another packet would not fit otherwise.
+ */
+int
+slip_room()
+{
+  if(sizeof(slip_buf) - slip_end < SLIP_MAX_ENCODED && slip_begin > 0) {
+    memmove(slip_buf, slip_buf + slip_begin, slip_end - slip_begin);
+    slip_end -= slip_begin;
+    slip_begin = 0;
+  }
+  return sizeof(slip_buf) - slip_end;
+}
+
 void
 slip_flushbuf(int fd)
 {
@@ -416,7 +547,7 @@ void
 write_to_serial(int outfd, void *inbuf, int len)
 {
   u_int8_t *p = inbuf;
-  int i;
+  int i, n;
 
   if(verbose>2) {
     if (timestamp) stamptime();
@@ -442,57 +573,104 @@ write_to_serial(int outfd, void *inbuf, int len)
    */
   /* slip_send(outfd, SLIP_END); */
 
-  for(i = 0; i < len; i++) {
-    switch(p[i]) {
-    case SLIP_END:
-      slip_send(outfd, SLIP_ESC);
-      slip_send(outfd, SLIP_ESC_END);
-      break;
-    case SLIP_ESC:
-      slip_send(outfd, SLIP_ESC);
-      slip_send(outfd, SLIP_ESC_ESC);
-      break;
-    case XON:
-      if(flowcontrol_xonxoff) {
-        slip_send(outfd, SLIP_ESC);
-        slip_send(outfd, SLIP_ESC_XON);
-      } else {
-        slip_send(outfd, p[i]);
-      }
-      break;
-    case XOFF:
-      if(flowcontrol_xonxoff) {
-        slip_send(outfd, SLIP_ESC);
-        slip_send(outfd, SLIP_ESC_XOFF);
-      } else {
-        slip_send(outfd, p[i]);
-      }
-      break;
-    default:
-      slip_send(outfd, p[i]);
-      break;
+  /* Copy the runs between bytes that need escaping as a whole. */
+  for(i = 0; i < len; ) {
+    n = slip_scan(&p[i], len - i, flowcontrol_xonxoff);
+    slip_send_buf(outfd, &p[i], n);
+    i += n;
+    if(i < len) {
+      slip_send_char(outfd, p[i]);
+      i++;
     }
   }
   slip_send(outfd, SLIP_END);
+  stats_out.packets++;
+  stats_out.bytes += len;
   PROGRESS("t");
 }
 
 
 /*
- * Read from tun, write to slip.
+ * Read from tun, write to slip. Reads packets until the tun device
+ * has no more or the outbound queue is full, or only one packet if
+ * outgoing packets are delayed. Returns the number of packets read.
  */
 int
 tun_to_serial(int infd, int outfd)
 {
   struct {
-    unsigned char inbuf[2000];
+    unsigned char inbuf[PACKET_SIZE];
   } uip;
-  int size;
+  int size, packets;
 
-  if((size = read(infd, uip.inbuf, 2000)) == -1) err(1, "tun_to_serial: read");
+  packets = 0;
+  while(slip_room() >= SLIP_MAX_ENCODED) {
+    if((size = read(infd, uip.inbuf, PACKET_SIZE)) == -1) {
+      if(errno == EAGAIN || errno == EINTR) {
+        break;
+      }
+      err(1, "tun_to_serial: read");
+    }
 
-  write_to_serial(outfd, uip.inbuf, size);
-  return size;
+    write_to_serial(outfd, uip.inbuf, size);
+    packets++;
+    if(basedelay) {
+      break;
+    }
+  }
+  return packets;
+}
+
+/*
+ * Number of packets the kernel dropped because tunslip6 did not read
+ * them from the tun device in time.
+ */
+unsigned long
+tun_dropped(void)
+{
+  unsigned long dropped = 0;
+#ifdef linux
+  char path[sizeof(tundev) + 64];
+  FILE *f;
+
+  snprintf(path, sizeof(path), "/sys/class/net/%s/statistics/tx_dropped",
+           tundev);
+  f = fopen(path, "r");
+  if(f != NULL) {
+    if(fscanf(f, "%lu", &dropped) != 1) {
+      dropped = 0;
+    }
+    fclose(f);
+  }
+#endif
+  return dropped;
+}
+
+void
+print_stats(void)
+{
+  struct timeval tv;
+  long msecs;
+
+  gettimeofday(&tv, NULL);
+  msecs = (tv.tv_sec - stats_time.tv_sec) * 1000 +
+    (tv.tv_usec - stats_time.tv_usec) / 1000;
+  if(msecs <= 0) {
+    msecs = 1;
+  }
+  stats_out.dropped = tun_dropped();
+
+  if(timestamp) stamptime();
+  fprintf(stderr, "*** serial->tun %lu packets %lu bytes (%lu bytes/s) %lu dropped,"
+          " tun->serial %lu packets %lu bytes (%lu bytes/s) %lu dropped\n",
+          stats_in.packets, stats_in.bytes,
+          (stats_in.bytes - last_in.bytes) * 1000 / msecs, stats_in.dropped,
+          stats_out.packets, stats_out.bytes,
+          (stats_out.bytes - last_out.bytes) * 1000 / msecs, stats_out.dropped);
+
+  last_in = stats_in;
+  last_out = stats_out;
+  stats_time = tv;
 }
 
 void
@@ -603,6 +781,9 @@ tun_alloc(char *dev, int tap)
 void
 cleanup(void)
 {
+  if(stats_interval) {
+    print_stats();
+  }
 #ifndef __APPLE__
   if (timestamp) stamptime();
   ssystem("ifconfig %s down", tundev);
@@ -749,7 +930,7 @@ main(int argc, char **argv)
   int tunfd, maxfd;
   int ret;
   fd_set rset, wset;
-  FILE *inslip;
+  struct timeval tv, *timeout;
   const char *siodev = NULL;
   const char *host = NULL;
   const char *port = NULL;
@@ -762,7 +943,7 @@ main(int argc, char **argv)
   prog = argv[0];
   setvbuf(stdout, NULL, _IOLBF, 0); /* Line buffered output. */
 
-  while((c = getopt(argc, argv, "B:HILPhXM:s:t:v::d::a:p:T")) != -1) {
+  while((c = getopt(argc, argv, "B:HILPhXM:s:t:v::d::a:p:TS::")) != -1) {
     switch(c) {
     case 'B':
       baudrate = atoi(optarg);
@@ -833,6 +1014,11 @@ main(int argc, char **argv)
       tap = 1;
       break;
 
+    case 'S':
+      stats_interval = 10;
+      if (optarg) stats_interval = atoi(optarg);
+      break;
+
     case '?':
     case 'h':
     default:
@@ -863,6 +1049,8 @@ fprintf(stderr,"    -v          Equivalent to -v3\n");
 fprintf(stderr," -d[basedelay]  Minimum delay between outgoing SLIP packets.\n");
 fprintf(stderr,"                Actual delay is basedelay*(#6LowPAN fragments) milliseconds.\n");
 fprintf(stderr,"                -d is equivalent to -d10.\n");
+fprintf(stderr," -S[interval]   Print throughput and drop statistics every interval seconds.\n");
+fprintf(stderr,"                -S is equivalent to -S10.\n");
 fprintf(stderr," -a serveraddr  \n");
 fprintf(stderr," -p serverport  \n");
 exit(1);
@@ -957,11 +1145,11 @@ exit(1);
     stty_telos(slipfd);
   }
   slip_send(slipfd, SLIP_END);
-  inslip = fdopen(slipfd, "r");
-  if(inslip == NULL) err(1, "main: fdopen");
 
   tunfd = tun_alloc(tundev, tap);
   if(tunfd == -1) err(1, "main: open /dev/tun");
+  /* Packets are read from tun until it has no more. */
+  if(fcntl(tunfd, F_SETFL, O_NONBLOCK) == -1) err(1, "main: fcntl");
   if (timestamp) stamptime();
   fprintf(stderr, "opened %s device ``/dev/%s''\n",
           tap ? "tap" : "tun", tundev);
@@ -972,6 +1160,7 @@ exit(1);
   signal(SIGINT, sigcleanup);
   signal(SIGALRM, sigalarm);
   ifconf(tundev, ipaddr);
+  gettimeofday(&stats_time, NULL);
 
   while(1) {
     maxfd = 0;
@@ -995,18 +1184,30 @@ exit(1);
     FD_SET(slipfd, &rset);	/* Read from slip ASAP! */
     if(slipfd > maxfd) maxfd = slipfd;
 
-    /* We only have one packet at a time queued for slip output. */
-    if(slip_empty()) {
+    /* Queue packets for slip output while there is room for one
+       more, or one packet at a time if outgoing packets are delayed. */
+    if(basedelay ? slip_empty() : slip_room() >= SLIP_MAX_ENCODED) {
       FD_SET(tunfd, &rset);
       if(tunfd > maxfd) maxfd = tunfd;
     }
 
-    ret = select(maxfd + 1, &rset, &wset, NULL, NULL);
+    timeout = NULL;
+    if(stats_interval) {
+      gettimeofday(&tv, NULL);
+      if(tv.tv_sec - stats_time.tv_sec >= stats_interval) {
+        print_stats();
+      }
+      tv.tv_sec = stats_interval;
+      tv.tv_usec = 0;
+      timeout = &tv;
+    }
+
+    ret = select(maxfd + 1, &rset, &wset, NULL, timeout);
     if(ret == -1 && errno != EINTR) {
       err(1, "select");
     } else if(ret > 0) {
       if(FD_ISSET(slipfd, &rset)) {
-        serial_to_tun(inslip, tunfd);
+        serial_to_tun(slipfd, tunfd);
       }
 
       if(FD_ISSET(slipfd, &wset)) {
@@ -1025,9 +1226,8 @@ exit(1);
        if(dmsec>delaymsec) delaymsec=0;
       }
       if(delaymsec==0) {
-        int size;
-        if(slip_empty() && FD_ISSET(tunfd, &rset)) {
-          size=tun_to_serial(tunfd, slipfd);
+        if(FD_ISSET(tunfd, &rset)) {
+          tun_to_serial(tunfd, slipfd);
           slip_flushbuf(slipfd);
           if(ipa_enable) sigalarm_reset();
           if(basedelay) {